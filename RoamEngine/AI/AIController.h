@@ -8,6 +8,7 @@
 #include <vector>
 #include <unordered_map>
 #include <string>
+#include "Core/StringId.h"
 #include "Math/Vector3.h"
 
 // AI state - what is the AI doing?
@@ -91,10 +92,42 @@ public:
     std::vector<Vector3> FindPath(const Vector3& start, const Vector3& end);
     bool IsPathBlocked(const std::vector<Vector3>& path);
 
-    // Memory - remember things
-    void RememberPosition(const std::string& key, const Vector3& position);
-    Vector3 RecallPosition(const std::string& key) const;
-    void Forget(const std::string& key);
+    // Memory - remember things. A key whose hash another key took is remembered by its text, so
+    // only the string overloads reach it; the invalid ID it would have had is no key at all.
+    void RememberPosition(const std::string& key, const Vector3& position) {
+        StringId id = StringInterner::GetInstance().Intern(key);
+        if (id.IsValid()) memory[id] = position;
+        else collidingMemory[key] = position;
+    }
+    Vector3 RecallPosition(const std::string& key) const {
+        StringId id = StringInterner::GetInstance().Find(key);
+        if (id.IsValid()) return RecallPosition(id);
+        auto it = collidingMemory.find(key);
+        return it != collidingMemory.end() ? it->second : Vector3();
+    }
+    void Forget(const std::string& key) {
+        StringId id = StringInterner::GetInstance().Find(key);
+        if (id.IsValid()) memory.erase(id);
+        else collidingMemory.erase(key);
+    }
+    void RememberPosition(StringId key, const Vector3& position) {
+        if (key.IsValid()) memory[key] = position;
+    }
+    Vector3 RecallPosition(StringId key) const {
+        auto it = memory.find(key);
+        return it != memory.end() ? it->second : Vector3();
+    }
+    void Forget(StringId key) { memory.erase(key); }
+
+    // Floating origin rebase - everything remembered or sensed is a position, so it all moves
+    void ShiftOrigin(const Vector3& shift) {
+        for (auto& [key, position] : memory) position -= shift;
+        for (auto& [key, position] : collidingMemory) position -= shift;
+        sensorData.position -= shift;
+        sensorData.lastKnownPlayerPosition -= shift;
+        for (Vector3& enemy : sensorData.visibleEnemies) enemy -= shift;
+        for (Vector3& ally : sensorData.visibleAllies) ally -= shift;
+    }
 
     // Learning - get smarter
     void LearnFromExperience(const std::string& situation, bool success);
@@ -131,7 +164,8 @@ private:
     AISensorData sensorData;
 
     // Memory system
-    std::unordered_map<std::string, Vector3> memory;
+    std::unordered_map<StringId, Vector3> memory;
+    std::unordered_map<std::string, Vector3> collidingMemory; // keys whose hash another key took
 
     // Learning system
     std::unordered_map<std::string, float> learnedExperiences;
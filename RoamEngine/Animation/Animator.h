@@ -9,6 +9,7 @@
 #include <unordered_map>
 #include <memory>
 #include <functional>
+#include "Core/StringId.h"
 
 // Animation states - what's the character doing?
 enum class AnimationState {
@@ -52,7 +53,10 @@ enum class LoopMode {
 // Keyframe - a single point in time
 struct Keyframe {
     float time;
-    std::unordered_map<std::string, float> values; // bone names or property names to values
+    // Bone or property names (interned) to values. A name that collided with another (Intern gave it
+    // the invalid ID) can't be keyframed - AddKeyframe drops values under the invalid ID rather than
+    // lump such names together, so rename the bone or property.
+    std::unordered_map<StringId, float> values;
     InterpolationType interpolation;
     std::vector<float> tangents; // for bezier curves
 };
@@ -77,8 +81,9 @@ public:
     void ClearKeyframes();
 
     // Sampling
-    std::unordered_map<std::string, float> Sample(float time) const;
+    std::unordered_map<StringId, float> Sample(float time) const;
     float SampleProperty(const std::string& property, float time) const;
+    float SampleProperty(StringId property, float time) const;
 
     // Events
     void AddEvent(float time, const std::string& eventName);
@@ -99,8 +104,8 @@ private:
 
 // Animation transition - how we move between animations
 struct AnimationTransition {
-    std::string fromState;
-    std::string toState;
+    StringId fromState;
+    StringId toState;
     float duration;
     InterpolationType interpolation;
     std::function<bool()> condition; // when to trigger this transition
@@ -128,7 +133,7 @@ public:
     float GetPlaybackSpeed() const { return playbackSpeed; }
 
     void Update(float deltaTime);
-    std::unordered_map<std::string, float> GetCurrentValues() const;
+    std::unordered_map<StringId, float> GetCurrentValues() const;
 
 private:
     std::string name;
@@ -148,23 +153,33 @@ public:
     // Animation clips
     void AddClip(std::shared_ptr<AnimationClip> clip);
     std::shared_ptr<AnimationClip> GetClip(const std::string& name) const;
+    std::shared_ptr<AnimationClip> GetClip(StringId name) const;
     void RemoveClip(const std::string& name);
+    void RemoveClip(StringId name);
     std::vector<std::string> GetClipNames() const;
 
-    // States and transitions
+    // States and transitions - names are interned as they're added, so the StringId overloads
+    // (and the transition checks every frame) compare integers. Clips, states, layers and blend
+    // parameters whose names collide with another's are kept by text, where only the string
+    // overloads find them - a transition can't name such a state. The invalid ID finds nothing.
     void AddState(const std::string& stateName, std::shared_ptr<AnimationClip> clip);
     void RemoveState(const std::string& stateName);
+    void RemoveState(StringId stateName);
     void AddTransition(const AnimationTransition& transition);
     void SetCurrentState(const std::string& stateName);
+    void SetCurrentState(StringId stateName);
     const std::string& GetCurrentState() const { return currentState; }
+    StringId GetCurrentStateId() const { return currentStateId; }
 
     // Layers
     void AddLayer(std::shared_ptr<AnimationLayer> layer);
     void RemoveLayer(const std::string& layerName);
     std::shared_ptr<AnimationLayer> GetLayer(const std::string& layerName) const;
+    std::shared_ptr<AnimationLayer> GetLayer(StringId layerName) const;
 
     // Playback control
     void Play(const std::string& clipName = "");
+    void Play(StringId clipName);
     void Pause();
     void Stop();
     void SetPlaybackSpeed(float speed);
@@ -179,7 +194,7 @@ public:
     void Update(float deltaTime);
 
     // Current values
-    std::unordered_map<std::string, float> GetCurrentValues() const;
+    std::unordered_map<StringId, float> GetCurrentValues() const;
 
     // Events
     void SetAnimationEventCallback(std::function<void(const std::string&)> callback);
@@ -188,6 +203,8 @@ public:
     // Blending
     void SetBlendParameter(const std::string& parameter, float value);
     float GetBlendParameter(const std::string& parameter) const;
+    void SetBlendParameter(StringId parameter, float value);
+    float GetBlendParameter(StringId parameter) const;
 
     // IK (Inverse Kinematics)
     void EnableIK(bool enable) { ikEnabled = enable; }
@@ -206,20 +223,25 @@ public:
 
 private:
     // Animation data
-    std::unordered_map<std::string, std::shared_ptr<AnimationClip>> clips;
-    std::unordered_map<std::string, std::shared_ptr<AnimationClip>> states;
+    std::unordered_map<StringId, std::shared_ptr<AnimationClip>> clips;
+    std::unordered_map<StringId, std::shared_ptr<AnimationClip>> states;
     std::vector<AnimationTransition> transitions;
-    std::unordered_map<std::string, std::shared_ptr<AnimationLayer>> layers;
+    std::unordered_map<StringId, std::shared_ptr<AnimationLayer>> layers;
+    std::unordered_map<std::string, std::shared_ptr<AnimationClip>> collidingClips;   // names whose hash another took
+    std::unordered_map<std::string, std::shared_ptr<AnimationClip>> collidingStates;
+    std::unordered_map<std::string, std::shared_ptr<AnimationLayer>> collidingLayers;
 
     // Current state
     std::string currentState;
+    StringId currentStateId;
     float currentTime;
     float playbackSpeed;
     bool isPlaying;
     bool isPaused;
 
     // Blending
-    std::unordered_map<std::string, float> blendParameters;
+    std::unordered_map<StringId, float> blendParameters;
+    std::unordered_map<std::string, float> collidingBlendParameters;
 
     // IK
     bool ikEnabled;
@@ -238,7 +260,7 @@ private:
     // Internal helpers
     void UpdateTransitions();
     void UpdateLayers(float deltaTime);
-    std::unordered_map<std::string, float> BlendLayerValues() const;
+    std::unordered_map<StringId, float> BlendLayerValues() const;
     void ProcessEvents(float deltaTime);
     void UpdateRootMotion();
 };
@@ -0,0 +1,169 @@
+// AssetContentTable.cpp - Implementation of the twin finder
+// Bookkeeping only - the AssetManager decides what gets loaded and deleted
+
+#include "AssetContentTable.h"
+#include "AssetManager.h"
+#include "DerivedDataCache.h"
+#include <algorithm>
+
+AssetContentKey AssetContentKey::Of(std::span<const std::byte> data) {
+    DerivedDataKey hash = DerivedDataKeyBuilder("asset-content").Add(data).Finish();
+    AssetContentKey key;
+    key.high = hash.high;
+    key.low = hash.low;
+    key.size = data.size();
+    return key;
+}
+
+AssetContentTable::AssetContentTable() : duplicateLoads(0), bytesNotLoaded(0) {
+}
+
+AssetContentTable::~AssetContentTable() {
+}
+
+bool AssetContentTable::Contains(const AssetContentKey& key, AssetType type) const {
+    return Find(key, type) != nullptr;
+}
+
+Asset* AssetContentTable::Find(const AssetContentKey& key, AssetType type) const {
+    if (!key.IsValid()) return nullptr;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(ContentId{ key, type });
+    return it != entries.end() ? it->second.asset : nullptr;
+}
+
+void AssetContentTable::Add(Asset* asset, const std::string& alias) {
+    ContentId id = IdOf(asset);
+    if (!id.key.IsValid()) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[id];
+    entry.asset = asset;
+    entry.aliases.assign(1, { alias, 1 });
+    aliasIndex.insert_or_assign(alias, id);
+}
+
+void AssetContentTable::AddAlias(Asset* resident, const std::string& alias) {
+    ContentId id = IdOf(resident);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(id);
+    if (it == entries.end()) return;
+
+    if (auto* existing = FindAlias(it->second, alias)) {
+        existing->second++;
+        return;
+    }
+    it->second.aliases.emplace_back(alias, 1);
+    aliasIndex.insert_or_assign(alias, id);
+}
+
+bool AssetContentTable::AddRef(const std::string& alias) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto index = aliasIndex.find(alias);
+    if (index == aliasIndex.end()) return false;
+    auto* existing = FindAlias(entries[index->second], alias);
+    if (!existing) return false;
+    existing->second++;
+    return true;
+}
+
+AssetContentTable::ReleaseResult AssetContentTable::Release(const std::string& alias) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto index = aliasIndex.find(alias);
+    if (index == aliasIndex.end()) return ReleaseResult::NotTracked;
+
+    auto it = entries.find(index->second);
+    if (it == entries.end()) {
+        aliasIndex.erase(index);
+        return ReleaseResult::NotTracked;
+    }
+
+    Entry& entry = it->second;
+    auto existing = std::find_if(entry.aliases.begin(), entry.aliases.end(),
+                                 [&alias](const auto& pair) { return pair.first == alias; });
+    if (existing == entry.aliases.end()) return ReleaseResult::NotTracked;
+    if (--existing->second > 0) return ReleaseResult::StillReferenced;
+
+    entry.aliases.erase(existing);
+    aliasIndex.erase(index);
+    if (!entry.aliases.empty()) return ReleaseResult::AliasRemoved;
+
+    entries.erase(it);
+    return ReleaseResult::LastAlias;
+}
+
+void AssetContentTable::CountDuplicate(uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    duplicateLoads++;
+    bytesNotLoaded += bytes;
+}
+
+int AssetContentTable::GetAliasRefCount(const std::string& alias) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto index = aliasIndex.find(alias);
+    if (index == aliasIndex.end()) return 0;
+    auto it = entries.find(index->second);
+    if (it == entries.end()) return 0;
+    for (const auto& [name, count] : it->second.aliases) {
+        if (name == alias) return count;
+    }
+    return 0;
+}
+
+std::vector<std::string> AssetContentTable::GetAliases(const Asset* asset) const {
+    std::vector<std::string> aliases;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(IdOf(asset));
+    if (it == entries.end() || it->second.asset != asset) return aliases;
+    for (const auto& [name, count] : it->second.aliases) aliases.push_back(name);
+    return aliases;
+}
+
+size_t AssetContentTable::GetResidentCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void AssetContentTable::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    aliasIndex.clear();
+}
+
+AssetContentTable::Report AssetContentTable::GetReport(size_t maxDuplicates) const {
+    Report report;
+    std::lock_guard<std::mutex> lock(mutex);
+    report.residentAssets = entries.size();
+    report.duplicateLoads = duplicateLoads;
+    report.bytesNotLoaded = bytesNotLoaded;
+
+    for (const auto& [id, entry] : entries) {
+        report.aliases += entry.aliases.size();
+        report.residentBytes += id.key.size;
+        if (entry.aliases.size() < 2) continue;
+
+        report.sharedAssets++;
+        report.duplicateBytes += id.key.size * (entry.aliases.size() - 1);
+        Duplicate duplicate;
+        duplicate.size = id.key.size;
+        for (const auto& [name, count] : entry.aliases) duplicate.aliases.push_back(name);
+        report.duplicates.push_back(std::move(duplicate));
+    }
+
+    auto saving = [](const Duplicate& duplicate) { return duplicate.size * (duplicate.aliases.size() - 1); };
+    std::sort(report.duplicates.begin(), report.duplicates.end(),
+              [&saving](const Duplicate& a, const Duplicate& b) { return saving(a) > saving(b); });
+    if (report.duplicates.size() > maxDuplicates) report.duplicates.resize(maxDuplicates);
+    return report;
+}
+
+AssetContentTable::ContentId AssetContentTable::IdOf(const Asset* asset) {
+    return ContentId{ asset->GetContentKey(), asset->GetType() };
+}
+
+std::pair<std::string, int>* AssetContentTable::FindAlias(Entry& entry, const std::string& alias) {
+    for (auto& pair : entry.aliases) {
+        if (pair.first == alias) return &pair;
+    }
+    return nullptr;
+}
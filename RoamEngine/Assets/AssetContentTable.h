@@ -0,0 +1,123 @@
+// AssetContentTable.h - The twin finder
+// Two names, same bytes? One copy in memory, and each name keeps its own count
+
+#ifndef ASSETCONTENTTABLE_H
+#define ASSETCONTENTTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Asset;
+enum class AssetType; // the full list lives in AssetManager.h
+
+// What an asset was loaded from - a 128-bit hash and the size, so a collision would need both
+struct AssetContentKey {
+    uint64_t high = 0;
+    uint64_t low = 0;
+    uint64_t size = 0;
+
+    bool IsValid() const { return high != 0 || low != 0; }
+    bool operator==(const AssetContentKey& other) const {
+        return high == other.high && low == other.low && size == other.size;
+    }
+
+    static AssetContentKey Of(std::span<const std::byte> data);
+};
+
+// Asked on a worker before parsing - true if an identical asset is already resident
+using AssetContentProbe = std::function<bool(const AssetContentKey& key, AssetType type)>;
+
+// The AssetContentTable class - resident assets by content, and the names (aliases) pointing at each.
+// Every load of an alias adds a reference to it, every unload drops one; the asset goes once the last
+// alias does. Thread-safe, but the AssetManager changes it under its own lock so it matches loadedAssets.
+class AssetContentTable {
+public:
+    AssetContentTable();
+    ~AssetContentTable();
+
+    // Lookups - by content (the same bytes loaded as a different type is a different asset)
+    bool Contains(const AssetContentKey& key, AssetType type) const;
+    Asset* Find(const AssetContentKey& key, AssetType type) const;
+
+    // A newly resident asset, under its first alias (keyed by its GetContentKey)
+    void Add(Asset* asset, const std::string& alias);
+
+    // One more reference to alias, which now points at resident - creates the alias if it's new
+    void AddAlias(Asset* resident, const std::string& alias);
+
+    // One more reference to an alias we already know - false if it isn't tracked
+    bool AddRef(const std::string& alias);
+
+    // One reference less
+    enum class ReleaseResult {
+        NotTracked,       // not ours - unload it the usual way
+        StillReferenced,  // the alias still has references, leave everything be
+        AliasRemoved,     // the alias is gone, other aliases keep the asset
+        LastAlias         // the alias and the asset are both gone - delete it
+    };
+    ReleaseResult Release(const std::string& alias);
+
+    // A load found an identical asset already resident - for the report
+    void CountDuplicate(uint64_t bytes);
+
+    // Queries
+    int GetAliasRefCount(const std::string& alias) const;
+    std::vector<std::string> GetAliases(const Asset* asset) const;
+    size_t GetResidentCount() const;
+
+    // Forget everything without touching the assets
+    void Clear();
+
+    // Duplicate report - what sharing is saving right now, and what it saved overall
+    struct Duplicate {
+        uint64_t size = 0;                // bytes per copy
+        std::vector<std::string> aliases; // every name sharing it, first one loaded first
+    };
+    struct Report {
+        size_t residentAssets = 0;
+        size_t aliases = 0;
+        size_t sharedAssets = 0;      // assets with more than one alias
+        uint64_t residentBytes = 0;   // source bytes of everything resident
+        uint64_t duplicateBytes = 0;  // what the extra aliases would take as copies of their own
+        uint64_t duplicateLoads = 0;  // loads served by an existing copy, ever
+        uint64_t bytesNotLoaded = 0;  // their bytes, ever
+        std::vector<Duplicate> duplicates; // largest saving first
+    };
+    Report GetReport(size_t maxDuplicates = 32) const;
+
+private:
+    // Prevent copying - one table per manager
+    AssetContentTable(const AssetContentTable&) = delete;
+    AssetContentTable& operator=(const AssetContentTable&) = delete;
+
+    struct ContentId {
+        AssetContentKey key;
+        AssetType type;
+        bool operator==(const ContentId& other) const { return key == other.key && type == other.type; }
+    };
+    struct ContentIdHash {
+        size_t operator()(const ContentId& id) const { return static_cast<size_t>(id.key.low ^ (id.key.high * 31) ^ static_cast<uint64_t>(id.type)); }
+    };
+
+    struct Entry {
+        Asset* asset = nullptr;
+        std::vector<std::pair<std::string, int>> aliases; // name and its reference count, in load order
+    };
+
+    static ContentId IdOf(const Asset* asset);
+    std::pair<std::string, int>* FindAlias(Entry& entry, const std::string& alias);
+
+    std::unordered_map<ContentId, Entry, ContentIdHash> entries;
+    std::unordered_map<std::string, ContentId> aliasIndex; // alias -> its entry
+    uint64_t duplicateLoads;
+    uint64_t bytesNotLoaded;
+    mutable std::mutex mutex;
+};
+
+#endif // ASSETCONTENTTABLE_H
@@ -0,0 +1,1299 @@
+// AssetCooker.cpp - Implementation of the kitchen
+// All the parsing the runtime never has to do again
+
+#include "AssetCooker.h"
+#include "CookedFormats.h"
+#include "DerivedDataCache.h"
+#include "Core/ThreadManager.h"
+#include "Math/FileIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <thread>
+
+namespace {
+    constexpr char ManifestMagic[8] = { 'R', 'O', 'A', 'M', 'C', 'K', 'M', '\0' };
+    constexpr uint32_t ManifestVersion = 1;
+
+    // Cooker versions - bump when a cooker's output changes, even if the layout didn't
+    constexpr uint32_t MeshCookerVersion = 2;
+    constexpr uint32_t TextureCookerVersion = 1;
+    constexpr uint32_t AnimationCookerVersion = 1;
+    constexpr uint32_t AudioCookerVersion = 1;
+    constexpr uint32_t ConfigCookerVersion = 1;
+
+    // Blob builder - the root struct sits at offset 0, arrays go after it and are linked by offset.
+    // Everything is written with memcpy, so growing the buffer never leaves a dangling pointer.
+    class BlobWriter {
+    public:
+        template<typename T>
+        explicit BlobWriter(const T& root) : bytes(sizeof(T)) {
+            std::memcpy(bytes.data(), &root, sizeof(T));
+        }
+
+        size_t Allocate(size_t size, size_t alignment) {
+            size_t offset = (bytes.size() + alignment - 1) & ~(alignment - 1);
+            bytes.resize(offset + size);
+            return offset;
+        }
+
+        // Point the CookedArray at fieldOffset to count elements starting at dataOffset
+        void Link(size_t fieldOffset, size_t dataOffset, size_t count) {
+            int64_t relative = count ? static_cast<int64_t>(dataOffset) - static_cast<int64_t>(fieldOffset) : 0;
+            uint64_t elements = count;
+            std::memcpy(bytes.data() + fieldOffset, &relative, sizeof(relative));
+            std::memcpy(bytes.data() + fieldOffset + sizeof(relative), &elements, sizeof(elements));
+        }
+
+        template<typename T>
+        size_t AddArray(size_t fieldOffset, const T* items, size_t count, size_t alignment = alignof(T)) {
+            static_assert(std::is_trivially_copyable_v<T>, "Only plain data goes in a blob");
+            size_t dataOffset = Allocate(count * sizeof(T), std::max(alignment, alignof(T)));
+            if (count) std::memcpy(bytes.data() + dataOffset, items, count * sizeof(T));
+            Link(fieldOffset, dataOffset, count);
+            return dataOffset;
+        }
+
+        size_t AddString(size_t fieldOffset, std::string_view text) {
+            return AddArray(fieldOffset, text.data(), text.size());
+        }
+
+        // Header size goes in last, once we know it
+        void Finish(std::vector<std::byte>& cooked) {
+            uint64_t size = bytes.size();
+            std::memcpy(bytes.data() + offsetof(CookedHeader, size), &size, sizeof(size));
+            cooked = std::move(bytes);
+        }
+
+    private:
+        std::vector<std::byte> bytes;
+    };
+
+    // GPU copies like 16-byte aligned source data
+    constexpr size_t BulkAlignment = 16;
+
+    template<typename T>
+    T MakeRoot(uint64_t sourceHash) {
+        T root{};
+        root.header.magic = CookedMagic;
+        root.header.kind = T::Kind;
+        root.header.version = T::Version;
+        root.header.sourceHash = sourceHash;
+        return root;
+    }
+
+    template<typename T>
+    T MakeRoot(std::span<const std::byte> source) {
+        return MakeRoot<T>(AssetCooker::HashSource(source));
+    }
+
+    std::string ToLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    std::string_view AsText(std::span<const std::byte> source) {
+        return std::string_view(reinterpret_cast<const char*>(source.data()), source.size());
+    }
+
+    std::string_view Trim(std::string_view text) {
+        size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) return std::string_view();
+        size_t last = text.find_last_not_of(" \t\r\n");
+        return text.substr(first, last - first + 1);
+    }
+
+    // Line by line over a text file, any line ending
+    class LineReader {
+    public:
+        explicit LineReader(std::string_view text) : text(text), position(0), lineNumber(0) {}
+
+        bool Next(std::string_view& line) {
+            if (position >= text.size()) return false;
+            size_t end = text.find('\n', position);
+            if (end == std::string_view::npos) end = text.size();
+            line = text.substr(position, end - position);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            position = end + 1;
+            lineNumber++;
+            return true;
+        }
+
+        size_t GetLineNumber() const { return lineNumber; }
+
+    private:
+        std::string_view text;
+        size_t position;
+        size_t lineNumber;
+    };
+
+    // Whitespace-separated tokens
+    std::vector<std::string_view> SplitTokens(std::string_view line) {
+        std::vector<std::string_view> tokens;
+        size_t position = 0;
+        while (position < line.size()) {
+            size_t start = line.find_first_not_of(" \t", position);
+            if (start == std::string_view::npos) break;
+            size_t end = line.find_first_of(" \t", start);
+            if (end == std::string_view::npos) end = line.size();
+            tokens.push_back(line.substr(start, end - start));
+            position = end;
+        }
+        return tokens;
+    }
+
+    template<typename T>
+    bool ParseNumber(std::string_view text, T& value) {
+        text = Trim(text);
+        if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    std::string LineError(const LineReader& reader, const std::string& message) {
+        return "line " + std::to_string(reader.GetLineNumber()) + ": " + message;
+    }
+
+    template<typename T>
+    T ReadLittle(const std::byte* data) {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    // 2x2 box filter - odd sizes reuse the last row/column
+    std::vector<std::byte> Downsample(const std::vector<std::byte>& pixels, uint32_t width, uint32_t height,
+                                      uint32_t pixelSize, uint32_t& newWidth, uint32_t& newHeight) {
+        newWidth = std::max(1u, width / 2);
+        newHeight = std::max(1u, height / 2);
+        std::vector<std::byte> result(static_cast<size_t>(newWidth) * newHeight * pixelSize);
+        for (uint32_t y = 0; y < newHeight; ++y) {
+            uint32_t y0 = std::min(y * 2, height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, height - 1);
+            for (uint32_t x = 0; x < newWidth; ++x) {
+                uint32_t x0 = std::min(x * 2, width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                for (uint32_t c = 0; c < pixelSize; ++c) {
+                    auto at = [&](uint32_t px, uint32_t py) {
+                        return static_cast<uint32_t>(pixels[(static_cast<size_t>(py) * width + px) * pixelSize + c]);
+                    };
+                    uint32_t sum = at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1);
+                    result[(static_cast<size_t>(y) * newWidth + x) * pixelSize + c] = static_cast<std::byte>((sum + 2) / 4);
+                }
+            }
+        }
+        return result;
+    }
+
+    // Binary (P5/P6) and plain-text (P2/P3) graymaps and pixmaps, 8-bit only
+    bool DecodePnm(std::span<const std::byte> source, std::vector<std::byte>& pixels, uint32_t& width, uint32_t& height,
+                   CookedPixelFormat& format, std::string& error) {
+        std::string_view text = AsText(source);
+        char type = text.size() >= 2 ? text[1] : 0;
+        bool color = type == '6' || type == '3';
+        bool plain = type == '2' || type == '3';
+
+        // Whitespace-separated decimal numbers, with # comments anywhere in between
+        size_t position = 2;
+        auto readNumber = [&](uint32_t& value) {
+            for (;;) {
+                while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))) position++;
+                if (position < text.size() && text[position] == '#') {
+                    position = text.find('\n', position);
+                    if (position == std::string_view::npos) position = text.size();
+                    continue;
+                }
+                break;
+            }
+            size_t end = position;
+            while (end < text.size() && std::isdigit(static_cast<unsigned char>(text[end]))) end++;
+            bool parsed = ParseNumber(text.substr(position, end - position), value);
+            position = end;
+            return parsed;
+        };
+
+        // Header - magic, width, height, maxval
+        uint32_t fields[3] = {};
+        for (uint32_t& field : fields) {
+            if (!readNumber(field)) {
+                error = "bad PNM header";
+                return false;
+            }
+        }
+
+        width = fields[0];
+        height = fields[1];
+        uint32_t maxValue = fields[2];
+        if (maxValue == 0 || maxValue > 255) {
+            error = "only 8-bit PNM files are supported";
+            return false;
+        }
+
+        uint32_t channels = color ? 3 : 1;
+        size_t expected = static_cast<size_t>(width) * height * channels;
+        // A plain sample takes at least two characters ("0 "), a binary one exactly a byte
+        size_t minimumSize = plain ? expected * 2 - 1 : expected;
+        if (!plain) position++; // the single whitespace before the pixels
+        if (width == 0 || height == 0 || position > source.size() || source.size() - position < minimumSize) {
+            error = "truncated PNM file";
+            return false;
+        }
+
+        std::vector<std::byte> samples;
+        if (plain) {
+            samples.resize(expected);
+            for (std::byte& sample : samples) {
+                uint32_t value = 0;
+                if (!readNumber(value) || value > maxValue) {
+                    error = "bad PNM sample";
+                    return false;
+                }
+                sample = static_cast<std::byte>(value);
+            }
+        }
+
+        format = color ? CookedPixelFormat::RGBA8 : CookedPixelFormat::R8;
+        pixels.resize(static_cast<size_t>(width) * height * CookedTexture::GetPixelSize(format));
+        const std::byte* input = plain ? samples.data() : source.data() + position;
+        for (size_t i = 0; i < static_cast<size_t>(width) * height; ++i) {
+            if (color) {
+                pixels[i * 4 + 0] = input[i * 3 + 0];
+                pixels[i * 4 + 1] = input[i * 3 + 1];
+                pixels[i * 4 + 2] = input[i * 3 + 2];
+                pixels[i * 4 + 3] = std::byte{ 255 };
+            } else {
+                pixels[i] = input[i];
+            }
+        }
+        return true;
+    }
+
+    bool DecodeTga(std::span<const std::byte> source, std::vector<std::byte>& pixels, uint32_t& width, uint32_t& height,
+                   CookedPixelFormat& format, std::string& error) {
+        if (source.size() < 18) {
+            error = "truncated TGA header";
+            return false;
+        }
+
+        const std::byte* header = source.data();
+        uint8_t idLength = static_cast<uint8_t>(header[0]);
+        uint8_t colorMapType = static_cast<uint8_t>(header[1]);
+        uint8_t imageType = static_cast<uint8_t>(header[2]);
+        width = ReadLittle<uint16_t>(header + 12);
+        height = ReadLittle<uint16_t>(header + 14);
+        uint8_t bitsPerPixel = static_cast<uint8_t>(header[16]);
+        bool topDown = (static_cast<uint8_t>(header[17]) & 0x20) != 0;
+
+        bool rle = imageType == 10 || imageType == 11;
+        bool gray = imageType == 3 || imageType == 11;
+        if (colorMapType != 0 || (imageType != 2 && imageType != 3 && !rle)) {
+            error = "unsupported TGA type (true-color or grayscale only)";
+            return false;
+        }
+        if ((gray && bitsPerPixel != 8) || (!gray && bitsPerPixel != 24 && bitsPerPixel != 32) || width == 0 || height == 0) {
+            error = "unsupported TGA pixel size";
+            return false;
+        }
+
+        uint32_t inputSize = bitsPerPixel / 8;
+        format = gray ? CookedPixelFormat::R8 : CookedPixelFormat::RGBA8;
+        uint32_t outputSize = CookedTexture::GetPixelSize(format);
+        size_t pixelCount = static_cast<size_t>(width) * height;
+        pixels.assign(pixelCount * outputSize, std::byte{ 255 });
+
+        size_t position = 18 + idLength;
+        auto store = [&](size_t index, const std::byte* input) {
+            // Stored bottom-up unless the descriptor says otherwise - we always want top-down
+            size_t x = index % width;
+            size_t y = index / width;
+            if (!topDown) y = height - 1 - y;
+            std::byte* output = pixels.data() + (y * width + x) * outputSize;
+            if (gray) {
+                output[0] = input[0];
+            } else {
+                output[0] = input[2]; // BGR(A) on disk
+                output[1] = input[1];
+                output[2] = input[0];
+                if (inputSize == 4) output[3] = input[3];
+            }
+        };
+
+        size_t index = 0;
+        while (index < pixelCount) {
+            if (!rle) {
+                if (source.size() - std::min(source.size(), position) < pixelCount * inputSize) break;
+                for (; index < pixelCount; ++index) store(index, source.data() + position + index * inputSize);
+                break;
+            }
+
+            if (position >= source.size()) break;
+            uint8_t packet = static_cast<uint8_t>(source[position++]);
+            size_t run = (packet & 0x7F) + 1;
+            bool repeated = (packet & 0x80) != 0;
+            size_t needed = repeated ? inputSize : run * inputSize;
+            if (source.size() - position < needed || pixelCount - index < run) break;
+
+            for (size_t i = 0; i < run; ++i) store(index++, source.data() + position + (repeated ? 0 : i * inputSize));
+            position += needed;
+        }
+
+        if (index < pixelCount) {
+            error = "truncated TGA pixel data";
+            return false;
+        }
+        return true;
+    }
+
+    // Mesh LODs by vertex clustering - snap every vertex to a grid and merge the ones sharing a cell.
+    // Crude next to edge collapses (UV seams get smeared), but quick, and LODs are only seen from afar.
+    constexpr size_t MaxMeshLods = 4;             // LOD 0 included
+    constexpr uint32_t LodGridResolution = 64;    // cells along the longest side for the finest LOD, halved after
+    constexpr float LodMinimumReduction = 0.75f;  // each LOD keeps at most this much of the triangles before it
+
+    struct MeshLod {
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<CookedSubmesh> submeshes;
+        float error = 0.0f;
+    };
+
+    // Interleaved vertices (stride in floats, position first), indices grouped by submesh
+    MeshLod ClusterMesh(const std::vector<float>& vertices, const std::vector<uint32_t>& indices,
+                        const std::vector<CookedSubmesh>& submeshes, size_t stride, bool hasNormals,
+                        const float* boundsMin, float cellSize) {
+        size_t vertexCount = vertices.size() / stride;
+        std::unordered_map<uint64_t, uint32_t> cellIndex;
+        std::vector<uint32_t> clusterOf(vertexCount);
+        std::vector<double> sums;
+        std::vector<uint32_t> counts;
+        for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+            const float* attributes = vertices.data() + vertex * stride;
+            uint64_t key = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                uint64_t cell = static_cast<uint64_t>(std::max(0.0f, std::floor((attributes[axis] - boundsMin[axis]) / cellSize)));
+                key = key << 21 | (cell & 0x1FFFFF);
+            }
+            auto [it, inserted] = cellIndex.emplace(key, static_cast<uint32_t>(counts.size()));
+            if (inserted) {
+                counts.push_back(0);
+                sums.resize(sums.size() + stride, 0.0);
+            }
+            clusterOf[vertex] = it->second;
+            counts[it->second]++;
+            for (size_t i = 0; i < stride; ++i) sums[it->second * stride + i] += attributes[i];
+        }
+
+        // Triangles whose corners merged are gone; only clusters something still uses become vertices
+        MeshLod lod;
+        lod.error = cellSize * 1.7320508f; // a vertex can move anywhere in its cell
+        std::vector<uint32_t> remap(counts.size(), UINT32_MAX);
+        for (const CookedSubmesh& submesh : submeshes) {
+            CookedSubmesh simplified = submesh;
+            simplified.firstIndex = static_cast<uint32_t>(lod.indices.size());
+            for (uint32_t i = submesh.firstIndex; i + 2 < submesh.firstIndex + submesh.indexCount; i += 3) {
+                uint32_t a = clusterOf[indices[i]];
+                uint32_t b = clusterOf[indices[i + 1]];
+                uint32_t c = clusterOf[indices[i + 2]];
+                if (a == b || b == c || a == c) continue;
+                for (uint32_t cluster : { a, b, c }) {
+                    if (remap[cluster] == UINT32_MAX) {
+                        remap[cluster] = static_cast<uint32_t>(lod.vertices.size() / stride);
+                        for (size_t component = 0; component < stride; ++component) {
+                            lod.vertices.push_back(static_cast<float>(sums[cluster * stride + component] / counts[cluster]));
+                        }
+                        if (hasNormals) {
+                            float* normal = lod.vertices.data() + lod.vertices.size() - stride + 3;
+                            float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                            if (length > 0.0f) {
+                                for (int axis = 0; axis < 3; ++axis) normal[axis] /= length;
+                            }
+                        }
+                    }
+                    lod.indices.push_back(remap[cluster]);
+                }
+            }
+            simplified.indexCount = static_cast<uint32_t>(lod.indices.size()) - simplified.firstIndex;
+            if (simplified.indexCount) lod.submeshes.push_back(simplified);
+        }
+        return lod;
+    }
+
+    // Config values - the same guesses ConfigManager makes from text
+    void SetConfigValue(CookedConfigEntry& entry, std::string_view text) {
+        if (text == "true" || text == "false") {
+            entry.type = CookedValueType::Bool;
+            entry.boolValue = text == "true" ? 1 : 0;
+        } else if (ParseNumber(text, entry.intValue)) {
+            entry.type = CookedValueType::Int;
+            entry.floatValue = static_cast<float>(entry.intValue);
+        } else if (ParseNumber(text, entry.floatValue)) {
+            entry.type = CookedValueType::Float;
+        } else {
+            entry.type = CookedValueType::String;
+        }
+    }
+}
+
+AssetCooker::AssetCooker() : jobSystem(nullptr) {
+    RegisterCooker(".obj", ".rmesh", MeshCookerVersion, CookMesh);
+    RegisterCooker(".tga", ".rtex", TextureCookerVersion, CookTexture);
+    RegisterCooker(".ppm", ".rtex", TextureCookerVersion, CookTexture);
+    RegisterCooker(".pgm", ".rtex", TextureCookerVersion, CookTexture);
+    RegisterCooker(".anim", ".ranim", AnimationCookerVersion, CookAnimation);
+    RegisterCooker(".wav", ".raudio", AudioCookerVersion, CookAudio);
+    RegisterCooker(".cfg", ".rcfg", ConfigCookerVersion, CookConfig);
+    RegisterCooker(".ini", ".rcfg", ConfigCookerVersion, CookConfig);
+}
+
+AssetCooker::~AssetCooker() {
+}
+
+void AssetCooker::RegisterCooker(const std::string& extension, const std::string& cookedExtension, uint32_t version, CookFunction cook) {
+    std::string key = ToLower(extension);
+    if (!key.empty() && key[0] != '.') key.insert(key.begin(), '.');
+    cookers[key] = Cooker{ cookedExtension, version, std::move(cook) };
+}
+
+bool AssetCooker::CanCook(const std::string& path) const {
+    return FindCooker(path) != nullptr;
+}
+
+std::string AssetCooker::GetCookedPath(const std::string& path) const {
+    const Cooker* cooker = FindCooker(path);
+    if (!cooker) return std::string();
+    return std::filesystem::path(path).replace_extension(cooker->cookedExtension).generic_string();
+}
+
+bool AssetCooker::CookFile(const std::string& sourcePath, std::vector<std::byte>& cooked, std::string& error) const {
+    const Cooker* cooker = FindCooker(sourcePath);
+    if (!cooker) {
+        error = "no cooker for " + sourcePath;
+        return false;
+    }
+
+    std::ifstream file(sourcePath, std::ios::binary);
+    std::vector<std::byte> source;
+    if (file) {
+        file.seekg(0, std::ios::end);
+        source.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0, std::ios::beg);
+        file.read(reinterpret_cast<char*>(source.data()), static_cast<std::streamsize>(source.size()));
+    }
+    if (!file) {
+        error = "can't read " + sourcePath;
+        return false;
+    }
+    return cooker->cook(source, cooked, error);
+}
+
+bool AssetCooker::CookDirectory(const std::string& sourceDir, const std::string& outputDir, Report& report, bool force) {
+    auto start = std::chrono::steady_clock::now();
+    report = Report();
+
+    // One parallel walk gives us every size and timestamp without a stat per file later
+    FileIndex index;
+    index.SetJobSystem(jobSystem);
+    if (!index.Build(sourceDir)) {
+        report.errors.push_back("can't read " + sourceDir);
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(outputDir, error);
+    std::string manifestPath = (std::filesystem::path(outputDir) / ManifestName).string();
+    Manifest previous;
+    if (!force) LoadManifest(manifestPath, previous);
+
+    enum class Outcome {
+        Skipped,
+        Cooked,
+        Failed
+    };
+
+    struct Task {
+        FileIndexEntry source;
+        const Cooker* cooker = nullptr;
+        std::string output;
+        Outcome outcome = Outcome::Failed;
+        ManifestEntry result;
+        std::string error;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+    };
+
+    std::vector<Task> tasks;
+    index.ForEachFile([&](const FileIndexEntry& entry) {
+        const Cooker* cooker = FindCooker(entry.path);
+        if (!cooker) return;
+        Task task;
+        task.source = entry;
+        task.cooker = cooker;
+        task.output = std::filesystem::path(entry.path).replace_extension(cooker->cookedExtension).generic_string();
+        tasks.push_back(std::move(task));
+    });
+    std::sort(tasks.begin(), tasks.end(), [](const Task& a, const Task& b) { return a.source.path < b.source.path; });
+
+    // car.obj and car.tga are fine, car.tga and car.ppm would both be car.rtex - first one wins
+    std::map<std::string, std::string> outputs;
+    for (Task& task : tasks) {
+        auto [existing, inserted] = outputs.emplace(task.output, task.source.path);
+        if (!inserted) {
+            task.cooker = nullptr;
+            task.error = task.source.path + ": same output as " + existing->second;
+        }
+    }
+
+    std::filesystem::path sourceRoot(index.GetRootPath());
+    std::filesystem::path outputRoot(outputDir);
+    auto cookOne = [&](Task& task) {
+        if (!task.cooker) return;
+
+        std::filesystem::path outputPath = outputRoot / task.output;
+        std::error_code existsError;
+        bool haveOutput = std::filesystem::exists(outputPath, existsError);
+
+        auto old = previous.find(task.source.path);
+        bool sameRecipe = old != previous.end() && old->second.cookerVersion == task.cooker->version &&
+                          old->second.output == task.output && haveOutput;
+
+        // Unchanged since last time - not even read
+        if (sameRecipe && old->second.size == task.source.size && old->second.modifiedTime == task.source.modifiedTime) {
+            task.result = old->second;
+            task.outcome = Outcome::Skipped;
+            return;
+        }
+
+        std::vector<std::byte> cooked;
+        std::string sourcePath = (sourceRoot / task.source.path).string();
+        std::ifstream file(sourcePath, std::ios::binary);
+        std::vector<std::byte> source(static_cast<size_t>(task.source.size));
+        if (!file || !file.read(reinterpret_cast<char*>(source.data()), static_cast<std::streamsize>(source.size()))) {
+            task.error = task.source.path + ": can't read";
+            return;
+        }
+        task.bytesRead = source.size();
+
+        task.result.output = task.output;
+        task.result.size = task.source.size;
+        task.result.modifiedTime = task.source.modifiedTime;
+        task.result.sourceHash = HashSource(source);
+        task.result.cookerVersion = task.cooker->version;
+
+        // Touched but not changed (a checkout, a save without edits) - keep the old output
+        if (sameRecipe && old->second.sourceHash == task.result.sourceHash) {
+            task.outcome = Outcome::Skipped;
+            return;
+        }
+
+        std::string cookError;
+        if (!task.cooker->cook(source, cooked, cookError)) {
+            task.error = task.source.path + ": " + cookError;
+            return;
+        }
+        if (!WriteOutput(outputPath.string(), cooked)) {
+            task.error = task.source.path + ": can't write " + outputPath.string();
+            return;
+        }
+        task.bytesWritten = cooked.size();
+        task.outcome = Outcome::Cooked;
+    };
+
+    if (jobSystem) {
+        jobSystem->ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) cookOne(tasks[i]);
+        });
+    } else {
+        for (Task& task : tasks) cookOne(task);
+    }
+
+    // New manifest - failures are left out so they're tried again next time
+    Manifest manifest;
+    for (Task& task : tasks) {
+        report.bytesRead += task.bytesRead;
+        report.bytesWritten += task.bytesWritten;
+        if (task.outcome == Outcome::Failed) {
+            report.failed++;
+            report.errors.push_back(task.error);
+            continue;
+        }
+        if (task.outcome == Outcome::Cooked) report.cooked++;
+        else report.skipped++;
+        manifest[task.source.path] = task.result;
+    }
+
+    // Sources that went away (or changed output name) take their old outputs with them
+    for (const auto& [sourcePath, entry] : previous) {
+        auto current = manifest.find(sourcePath);
+        if (current != manifest.end() && current->second.output == entry.output) continue;
+        if (outputs.count(entry.output)) continue; // some other source writes it now
+        std::error_code removeError;
+        if (std::filesystem::remove(outputRoot / entry.output, removeError)) report.removed++;
+    }
+
+    bool saved = SaveManifest(manifestPath, manifest);
+    if (!saved) report.errors.push_back("can't write " + manifestPath);
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return saved && report.failed == 0;
+}
+
+bool AssetCooker::CookMesh(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error) {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texCoords;
+
+    // Corners are (position, texcoord, normal) index triples - equal triples share a vertex
+    struct Corner {
+        int position;
+        int texCoord;
+        int normal;
+        bool operator==(const Corner& other) const {
+            return position == other.position && texCoord == other.texCoord && normal == other.normal;
+        }
+    };
+    struct CornerHash {
+        size_t operator()(const Corner& corner) const {
+            uint64_t key = static_cast<uint32_t>(corner.position);
+            key = key * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.texCoord);
+            key = key * 0x9E3779B97F4A7C15ull ^ static_cast<uint32_t>(corner.normal);
+            return static_cast<size_t>(key ^ (key >> 29));
+        }
+    };
+
+    std::vector<Corner> corners;
+    std::unordered_map<Corner, uint32_t, CornerHash> cornerIndex;
+    std::vector<std::string> materials;
+    std::vector<std::vector<uint32_t>> materialIndices; // triangles, grouped by material
+    size_t currentMaterial = 0;
+    bool usesNormals = false;
+    bool usesTexCoords = false;
+
+    auto resolve = [](std::string_view text, size_t count, int& index) {
+        if (text.empty()) {
+            index = -1;
+            return true;
+        }
+        int value;
+        if (!ParseNumber(text, value) || value == 0) return false;
+        index = value > 0 ? value - 1 : static_cast<int>(count) + value; // negative counts back from the end
+        return index >= 0 && static_cast<size_t>(index) < count;
+    };
+
+    LineReader reader(AsText(source));
+    std::string_view line;
+    while (reader.Next(line)) {
+        std::vector<std::string_view> tokens = SplitTokens(line);
+        if (tokens.empty() || tokens[0][0] == '#') continue;
+
+        std::string_view command = tokens[0];
+        if (command == "v" || command == "vn" || command == "vt") {
+            std::vector<float>& target = command == "v" ? positions : command == "vn" ? normals : texCoords;
+            size_t components = command == "vt" ? 2 : 3;
+            if (tokens.size() < components + 1) {
+                error = LineError(reader, "not enough components");
+                return false;
+            }
+            for (size_t i = 1; i <= components; ++i) {
+                float value;
+                if (!ParseNumber(tokens[i], value)) {
+                    error = LineError(reader, "bad number");
+                    return false;
+                }
+                target.push_back(value);
+            }
+        } else if (command == "usemtl" && tokens.size() > 1) {
+            std::string name(tokens[1]);
+            auto it = std::find(materials.begin(), materials.end(), name);
+            currentMaterial = static_cast<size_t>(it - materials.begin());
+            if (it == materials.end()) materials.push_back(name);
+        } else if (command == "f") {
+            if (tokens.size() < 4) {
+                error = LineError(reader, "faces need at least three corners");
+                return false;
+            }
+            if (materials.empty()) materials.push_back(std::string());
+            if (materialIndices.size() < materials.size()) materialIndices.resize(materials.size());
+
+            std::vector<uint32_t> face;
+            for (size_t i = 1; i < tokens.size(); ++i) {
+                std::string_view parts[3];
+                std::string_view token = tokens[i];
+                for (size_t part = 0; part < 3 && !token.empty(); ++part) {
+                    size_t slash = token.find('/');
+                    parts[part] = token.substr(0, slash);
+                    token = slash == std::string_view::npos ? std::string_view() : token.substr(slash + 1);
+                }
+
+                Corner corner;
+                if (!resolve(parts[0], positions.size() / 3, corner.position) || corner.position < 0 ||
+                    !resolve(parts[1], texCoords.size() / 2, corner.texCoord) ||
+                    !resolve(parts[2], normals.size() / 3, corner.normal)) {
+                    error = LineError(reader, "bad face index");
+                    return false;
+                }
+                usesTexCoords |= corner.texCoord >= 0;
+                usesNormals |= corner.normal >= 0;
+
+                auto [it, inserted] = cornerIndex.emplace(corner, static_cast<uint32_t>(corners.size()));
+                if (inserted) corners.push_back(corner);
+                face.push_back(it->second);
+            }
+
+            // Fan - fine for the convex polygons exporters write
+            for (size_t i = 1; i + 1 < face.size(); ++i) {
+                materialIndices[currentMaterial].insert(materialIndices[currentMaterial].end(), { face[0], face[i], face[i + 1] });
+            }
+        }
+        // o, g, s, mtllib - nothing the runtime needs
+    }
+
+    if (corners.empty()) {
+        error = "no faces";
+        return false;
+    }
+
+    MeshData mesh;
+    mesh.attributes = CookedVertexPosition | (usesNormals ? CookedVertexNormal : 0u) | (usesTexCoords ? CookedVertexTexCoord : 0u);
+    mesh.materials = std::move(materials);
+
+    // Interleave - missing normals/texcoords on some faces come out as zeros
+    mesh.vertices.reserve(corners.size() * mesh.GetStride());
+    for (const Corner& corner : corners) {
+        for (int axis = 0; axis < 3; ++axis) mesh.vertices.push_back(positions[corner.position * 3 + axis]);
+        if (usesNormals) {
+            for (int axis = 0; axis < 3; ++axis) mesh.vertices.push_back(corner.normal >= 0 ? normals[corner.normal * 3 + axis] : 0.0f);
+        }
+        if (usesTexCoords) {
+            for (int axis = 0; axis < 2; ++axis) mesh.vertices.push_back(corner.texCoord >= 0 ? texCoords[corner.texCoord * 2 + axis] : 0.0f);
+        }
+    }
+
+    // One contiguous index range per material
+    for (size_t material = 0; material < materialIndices.size(); ++material) {
+        if (materialIndices[material].empty()) continue;
+        CookedSubmesh submesh{};
+        submesh.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+        submesh.indexCount = static_cast<uint32_t>(materialIndices[material].size());
+        submesh.materialIndex = static_cast<uint32_t>(material);
+        mesh.submeshes.push_back(submesh);
+        mesh.indices.insert(mesh.indices.end(), materialIndices[material].begin(), materialIndices[material].end());
+    }
+
+    return CookMeshData(mesh, HashSource(source), cooked, error);
+}
+
+size_t AssetCooker::MeshData::GetStride() const {
+    return 3 + ((attributes & CookedVertexNormal) ? 3 : 0) + ((attributes & CookedVertexTexCoord) ? 2 : 0);
+}
+
+bool AssetCooker::CookMeshData(const MeshData& mesh, uint64_t sourceHash, std::vector<std::byte>& cooked, std::string& error) {
+    size_t stride = mesh.GetStride();
+    if (!(mesh.attributes & CookedVertexPosition) || mesh.vertices.empty() || mesh.vertices.size() % stride != 0) {
+        error = "no vertices, or not a whole number of them";
+        return false;
+    }
+    size_t vertexCount = mesh.vertices.size() / stride;
+    for (const CookedSubmesh& submesh : mesh.submeshes) {
+        if (static_cast<size_t>(submesh.firstIndex) + submesh.indexCount > mesh.indices.size() || submesh.materialIndex >= mesh.materials.size()) {
+            error = "submesh out of range";
+            return false;
+        }
+    }
+    for (uint32_t index : mesh.indices) {
+        if (index >= vertexCount) {
+            error = "index out of range";
+            return false;
+        }
+    }
+
+    CookedMesh root = MakeRoot<CookedMesh>(sourceHash);
+    root.attributes = mesh.attributes;
+    root.vertexStride = static_cast<uint32_t>(stride * sizeof(float));
+    root.vertexCount = static_cast<uint32_t>(vertexCount);
+    root.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    root.indexSize = vertexCount <= 0xFFFF ? 2 : 4;
+    for (int axis = 0; axis < 3; ++axis) {
+        root.boundsMin[axis] = INFINITY;
+        root.boundsMax[axis] = -INFINITY;
+    }
+    for (size_t vertex = 0; vertex < vertexCount; ++vertex) {
+        for (int axis = 0; axis < 3; ++axis) {
+            float value = mesh.vertices[vertex * stride + axis];
+            root.boundsMin[axis] = std::min(root.boundsMin[axis], value);
+            root.boundsMax[axis] = std::max(root.boundsMax[axis], value);
+        }
+    }
+
+    // Coarser LODs, each from the full mesh on a grid half as fine as the last. A grid that barely
+    // changes anything isn't worth the memory, so those are skipped.
+    float extent = 0.0f;
+    for (int axis = 0; axis < 3; ++axis) extent = std::max(extent, root.boundsMax[axis] - root.boundsMin[axis]);
+    bool hasNormals = (mesh.attributes & CookedVertexNormal) != 0;
+    std::vector<MeshLod> lods;
+    size_t previousTriangles = mesh.indices.size() / 3;
+    for (uint32_t resolution = LodGridResolution; extent > 0.0f && resolution >= 2 && lods.size() + 1 < MaxMeshLods; resolution /= 2) {
+        MeshLod lod = ClusterMesh(mesh.vertices, mesh.indices, mesh.submeshes, stride, hasNormals, root.boundsMin, extent / resolution);
+        size_t triangles = lod.indices.size() / 3;
+        if (triangles == 0) break;
+        if (triangles > previousTriangles * LodMinimumReduction) continue;
+        previousTriangles = triangles;
+        lods.push_back(std::move(lod));
+    }
+
+    // Each LOD's data goes in one piece, so streaming a level reads one contiguous range
+    BlobWriter writer(root);
+    auto addIndices = [&writer, &root](size_t fieldOffset, const std::vector<uint32_t>& source) {
+        if (root.indexSize == 2) {
+            std::vector<uint16_t> shortIndices(source.begin(), source.end());
+            writer.AddArray(fieldOffset, reinterpret_cast<const std::byte*>(shortIndices.data()),
+                            shortIndices.size() * sizeof(uint16_t), BulkAlignment);
+        } else {
+            writer.AddArray(fieldOffset, reinterpret_cast<const std::byte*>(source.data()),
+                            source.size() * sizeof(uint32_t), BulkAlignment);
+        }
+    };
+    writer.AddArray(offsetof(CookedMesh, vertices), reinterpret_cast<const std::byte*>(mesh.vertices.data()),
+                    mesh.vertices.size() * sizeof(float), BulkAlignment);
+    addIndices(offsetof(CookedMesh, indices), mesh.indices);
+    writer.AddArray(offsetof(CookedMesh, submeshes), mesh.submeshes.data(), mesh.submeshes.size());
+
+    std::vector<CookedString> names(mesh.materials.size());
+    size_t namesOffset = writer.AddArray(offsetof(CookedMesh, materials), names.data(), names.size());
+    for (size_t i = 0; i < mesh.materials.size(); ++i) writer.AddString(namesOffset + i * sizeof(CookedString), mesh.materials[i]);
+
+    std::vector<CookedMeshLod> lodTable(lods.size());
+    for (size_t i = 0; i < lods.size(); ++i) {
+        lodTable[i].vertexCount = static_cast<uint32_t>(lods[i].vertices.size() / stride);
+        lodTable[i].indexCount = static_cast<uint32_t>(lods[i].indices.size());
+        lodTable[i].error = lods[i].error;
+    }
+    size_t lodsOffset = writer.AddArray(offsetof(CookedMesh, lods), lodTable.data(), lodTable.size());
+    for (size_t i = 0; i < lods.size(); ++i) {
+        size_t field = lodsOffset + i * sizeof(CookedMeshLod);
+        writer.AddArray(field + offsetof(CookedMeshLod, vertices), reinterpret_cast<const std::byte*>(lods[i].vertices.data()),
+                        lods[i].vertices.size() * sizeof(float), BulkAlignment);
+        addIndices(field + offsetof(CookedMeshLod, indices), lods[i].indices);
+        writer.AddArray(field + offsetof(CookedMeshLod, submeshes), lods[i].submeshes.data(), lods[i].submeshes.size());
+    }
+
+    writer.Finish(cooked);
+    return true;
+}
+
+AssetCooker::MeshData AssetCooker::SimplifyMesh(const MeshData& mesh, float cellSize, float& error) {
+    size_t stride = mesh.GetStride();
+    float boundsMin[3] = { INFINITY, INFINITY, INFINITY };
+    for (size_t i = 0; i + stride <= mesh.vertices.size(); i += stride) {
+        for (int axis = 0; axis < 3; ++axis) boundsMin[axis] = std::min(boundsMin[axis], mesh.vertices[i + axis]);
+    }
+
+    MeshData simplified;
+    simplified.attributes = mesh.attributes;
+    simplified.materials = mesh.materials;
+    error = 0.0f;
+    if (mesh.vertices.empty() || !(cellSize > 0.0f)) {
+        simplified.vertices = mesh.vertices;
+        simplified.indices = mesh.indices;
+        simplified.submeshes = mesh.submeshes;
+        return simplified;
+    }
+
+    MeshLod lod = ClusterMesh(mesh.vertices, mesh.indices, mesh.submeshes, stride, (mesh.attributes & CookedVertexNormal) != 0, boundsMin, cellSize);
+    simplified.vertices = std::move(lod.vertices);
+    simplified.indices = std::move(lod.indices);
+    simplified.submeshes = std::move(lod.submeshes);
+    error = lod.error;
+    return simplified;
+}
+
+bool AssetCooker::CookTexture(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error) {
+    std::vector<std::byte> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    CookedPixelFormat format = CookedPixelFormat::RGBA8;
+
+    // A TGA never starts with 'P' and a digit - its second byte is the color map type, 0 or 1
+    std::string_view magic = AsText(source).substr(0, 2);
+    bool decoded;
+    if (magic == "P2" || magic == "P3" || magic == "P5" || magic == "P6") {
+        decoded = DecodePnm(source, pixels, width, height, format, error);
+    } else if (magic.size() == 2 && magic[0] == 'P' && std::isdigit(static_cast<unsigned char>(magic[1]))) {
+        error = "unsupported PNM type " + std::string(magic) + " (P2/P3/P5/P6 only)";
+        decoded = false;
+    } else {
+        decoded = DecodeTga(source, pixels, width, height, format, error);
+    }
+    if (!decoded) return false;
+
+    // The whole chain down to 1x1 - the renderer picks levels, it never builds them
+    std::vector<std::vector<std::byte>> levels;
+    std::vector<std::pair<uint32_t, uint32_t>> sizes;
+    levels.push_back(std::move(pixels));
+    sizes.emplace_back(width, height);
+    uint32_t pixelSize = CookedTexture::GetPixelSize(format);
+    while (sizes.back().first > 1 || sizes.back().second > 1) {
+        uint32_t nextWidth;
+        uint32_t nextHeight;
+        levels.push_back(Downsample(levels.back(), sizes.back().first, sizes.back().second, pixelSize, nextWidth, nextHeight));
+        sizes.emplace_back(nextWidth, nextHeight);
+    }
+
+    CookedTexture root = MakeRoot<CookedTexture>(source);
+    root.width = width;
+    root.height = height;
+    root.format = format;
+
+    BlobWriter writer(root);
+    std::vector<CookedMip> mips(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        mips[i].width = sizes[i].first;
+        mips[i].height = sizes[i].second;
+    }
+    size_t mipsOffset = writer.AddArray(offsetof(CookedTexture, mips), mips.data(), mips.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        writer.AddArray(mipsOffset + i * sizeof(CookedMip) + offsetof(CookedMip, pixels),
+                        levels[i].data(), levels[i].size(), BulkAlignment);
+    }
+
+    writer.Finish(cooked);
+    return true;
+}
+
+bool AssetCooker::CookAnimation(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error) {
+    auto splitColumns = [](std::string_view line) {
+        std::vector<std::string_view> columns;
+        size_t position = 0;
+        for (;;) {
+            size_t comma = line.find(',', position);
+            columns.push_back(Trim(line.substr(position, comma == std::string_view::npos ? std::string_view::npos : comma - position)));
+            if (comma == std::string_view::npos) break;
+            position = comma + 1;
+        }
+        return columns;
+    };
+
+    LineReader reader(AsText(source));
+    std::string_view line;
+    std::vector<std::string_view> names;
+    std::vector<float> times;
+    std::vector<std::vector<float>> values;
+
+    while (reader.Next(line)) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        std::vector<std::string_view> columns = splitColumns(line);
+
+        // Header row - "time,hips.x,hips.y,..."
+        if (names.empty()) {
+            if (columns.size() < 2) {
+                error = LineError(reader, "header needs a time column and at least one curve");
+                return false;
+            }
+            names.assign(columns.begin() + 1, columns.end());
+            values.resize(names.size());
+            continue;
+        }
+
+        if (columns.size() != names.size() + 1) {
+            error = LineError(reader, "expected " + std::to_string(names.size() + 1) + " columns");
+            return false;
+        }
+        float time;
+        if (!ParseNumber(columns[0], time) || (!times.empty() && time <= times.back())) {
+            error = LineError(reader, "times must be numbers in ascending order");
+            return false;
+        }
+        times.push_back(time);
+        for (size_t i = 0; i < names.size(); ++i) {
+            float value;
+            if (!ParseNumber(columns[i + 1], value)) {
+                error = LineError(reader, "bad number");
+                return false;
+            }
+            values[i].push_back(value);
+        }
+    }
+
+    if (times.empty()) {
+        error = "no keys";
+        return false;
+    }
+
+    CookedAnimation root = MakeRoot<CookedAnimation>(source);
+    root.duration = times.back();
+    root.keyCount = static_cast<uint32_t>(times.size());
+
+    BlobWriter writer(root);
+    writer.AddArray(offsetof(CookedAnimation, times), times.data(), times.size());
+    std::vector<CookedCurve> curves(names.size());
+    size_t curvesOffset = writer.AddArray(offsetof(CookedAnimation, curves), curves.data(), curves.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        size_t curveOffset = curvesOffset + i * sizeof(CookedCurve);
+        writer.AddString(curveOffset + offsetof(CookedCurve, name), names[i]);
+        writer.AddArray(curveOffset + offsetof(CookedCurve, values), values[i].data(), values[i].size());
+    }
+
+    writer.Finish(cooked);
+    return true;
+}
+
+bool AssetCooker::CookAudio(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error) {
+    if (source.size() < 12 || AsText(source).substr(0, 4) != "RIFF" || AsText(source).substr(8, 4) != "WAVE") {
+        error = "not a WAVE file";
+        return false;
+    }
+
+    uint16_t encoding = 0;
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bitsPerSample = 0;
+    std::span<const std::byte> data;
+    bool haveFormat = false;
+    bool haveData = false;
+
+    size_t position = 12;
+    while (position + 8 <= source.size()) {
+        std::string_view id = AsText(source).substr(position, 4);
+        uint32_t size = ReadLittle<uint32_t>(source.data() + position + 4);
+        position += 8;
+        if (size > source.size() - position) {
+            // Some writers leave the data size at a placeholder - take what's there
+            if (id != "data") break;
+            size = static_cast<uint32_t>(source.size() - position);
+        }
+
+        if (id == "fmt " && size >= 16) {
+            const std::byte* format = source.data() + position;
+            encoding = ReadLittle<uint16_t>(format);
+            channels = ReadLittle<uint16_t>(format + 2);
+            sampleRate = ReadLittle<uint32_t>(format + 4);
+            bitsPerSample = ReadLittle<uint16_t>(format + 14);
+            if (encoding == 0xFFFE && size >= 26) encoding = ReadLittle<uint16_t>(format + 24); // extensible - the real one's in the sub-format
+            haveFormat = true;
+        } else if (id == "data") {
+            data = source.subspan(position, size);
+            haveData = true;
+        }
+        // Chunks are word aligned - the last one may be missing its pad byte
+        position = std::min(source.size(), position + size + (size & 1));
+    }
+
+    bool pcm = encoding == 1 && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    bool floating = encoding == 3 && bitsPerSample == 32;
+    if (!haveFormat || !haveData || channels == 0 || (!pcm && !floating)) {
+        error = "unsupported WAVE encoding (PCM 8/16/24/32-bit or 32-bit float only)";
+        return false;
+    }
+
+    size_t sampleBytes = bitsPerSample / 8;
+    size_t frameCount = data.size() / (sampleBytes * channels);
+    size_t sampleCount = frameCount * channels;
+
+    CookedAudio root = MakeRoot<CookedAudio>(source);
+    root.sampleRate = sampleRate;
+    root.channels = channels;
+    root.frameCount = static_cast<uint32_t>(frameCount);
+    root.format = bitsPerSample <= 16 && pcm ? CookedSampleFormat::Int16 : CookedSampleFormat::Float32;
+
+    std::vector<std::byte> samples;
+    if (root.format == CookedSampleFormat::Int16) {
+        std::vector<int16_t> converted(sampleCount);
+        for (size_t i = 0; i < sampleCount; ++i) {
+            const std::byte* sample = data.data() + i * sampleBytes;
+            converted[i] = bitsPerSample == 8 ? static_cast<int16_t>((static_cast<int>(sample[0]) - 128) * 256)
+                                              : ReadLittle<int16_t>(sample);
+        }
+        samples.resize(sampleCount * sizeof(int16_t));
+        std::memcpy(samples.data(), converted.data(), samples.size());
+    } else {
+        std::vector<float> converted(sampleCount);
+        for (size_t i = 0; i < sampleCount; ++i) {
+            const std::byte* sample = data.data() + i * sampleBytes;
+            if (floating) {
+                converted[i] = ReadLittle<float>(sample);
+            } else if (bitsPerSample == 24) {
+                int32_t value = static_cast<int32_t>(static_cast<uint32_t>(sample[0]) | static_cast<uint32_t>(sample[1]) << 8 |
+                                                     static_cast<uint32_t>(sample[2]) << 16);
+                if (value & 0x800000) value -= 0x1000000;
+                converted[i] = static_cast<float>(value) / 8388608.0f;
+            } else {
+                converted[i] = static_cast<float>(ReadLittle<int32_t>(sample)) / 2147483648.0f;
+            }
+        }
+        samples.resize(sampleCount * sizeof(float));
+        std::memcpy(samples.data(), converted.data(), samples.size());
+    }
+
+    BlobWriter writer(root);
+    writer.AddArray(offsetof(CookedAudio, samples), samples.data(), samples.size(), BulkAlignment);
+    writer.Finish(cooked);
+    return true;
+}
+
+bool AssetCooker::CookConfig(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error) {
+    // key -> value text, last one wins like it would at runtime. [section] prefixes keys with "section."
+    std::map<std::string, std::string> values;
+    std::map<std::string, bool> quoted;
+    std::string section;
+
+    LineReader reader(AsText(source));
+    std::string_view line;
+    while (reader.Next(line)) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+
+        if (line.front() == '[') {
+            if (line.back() != ']') {
+                error = LineError(reader, "unterminated section");
+                return false;
+            }
+            section = std::string(Trim(line.substr(1, line.size() - 2)));
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (equals == std::string_view::npos || Trim(line.substr(0, equals)).empty()) {
+            error = LineError(reader, "expected key = value");
+            return false;
+        }
+        std::string key = std::string(Trim(line.substr(0, equals)));
+        if (!section.empty()) key = section + "." + key;
+
+        std::string_view value = Trim(line.substr(equals + 1));
+        bool isQuoted = value.size() >= 2 && value.front() == '"' && value.back() == '"';
+        if (isQuoted) value = value.substr(1, value.size() - 2);
+        values[key] = std::string(value);
+        quoted[key] = isQuoted;
+    }
+
+    CookedConfig root = MakeRoot<CookedConfig>(source);
+    BlobWriter writer(root);
+
+    // std::map keeps them sorted - exactly what CookedConfig::Find's binary search wants
+    std::vector<CookedConfigEntry> entries(values.size());
+    size_t index = 0;
+    for (const auto& [key, value] : values) {
+        CookedConfigEntry& entry = entries[index++];
+        entry = CookedConfigEntry{};
+        if (quoted[key]) entry.type = CookedValueType::String;
+        else SetConfigValue(entry, value);
+    }
+
+    size_t entriesOffset = writer.AddArray(offsetof(CookedConfig, entries), entries.data(), entries.size());
+    index = 0;
+    for (const auto& [key, value] : values) {
+        size_t entryOffset = entriesOffset + (index++) * sizeof(CookedConfigEntry);
+        writer.AddString(entryOffset + offsetof(CookedConfigEntry, key), key);
+        writer.AddString(entryOffset + offsetof(CookedConfigEntry, text), value);
+    }
+
+    writer.Finish(cooked);
+    return true;
+}
+
+uint64_t AssetCooker::HashSource(std::span<const std::byte> source) {
+    return DerivedDataKeyBuilder("cook-source").Add(source).Finish().low;
+}
+
+const AssetCooker::Cooker* AssetCooker::FindCooker(const std::string& path) const {
+    std::string extension = ToLower(std::filesystem::path(path).extension().string());
+    auto it = cookers.find(extension);
+    return it != cookers.end() ? &it->second : nullptr;
+}
+
+bool AssetCooker::LoadManifest(const std::string& path, Manifest& manifest) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[8];
+    uint32_t version = 0;
+    uint32_t count = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!file || std::memcmp(magic, ManifestMagic, sizeof(magic)) != 0 || version != ManifestVersion) return false;
+
+    auto readString = [&file](std::string& text) {
+        uint32_t length = 0;
+        file.read(reinterpret_cast<char*>(&length), sizeof(length));
+        if (!file || length > 65536) return false;
+        text.resize(length);
+        file.read(text.data(), length);
+        return static_cast<bool>(file);
+    };
+
+    Manifest loaded;
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string source;
+        ManifestEntry entry;
+        if (!readString(source) || !readString(entry.output)) return false;
+        file.read(reinterpret_cast<char*>(&entry.size), sizeof(entry.size));
+        file.read(reinterpret_cast<char*>(&entry.modifiedTime), sizeof(entry.modifiedTime));
+        file.read(reinterpret_cast<char*>(&entry.sourceHash), sizeof(entry.sourceHash));
+        file.read(reinterpret_cast<char*>(&entry.cookerVersion), sizeof(entry.cookerVersion));
+        if (!file) return false;
+        loaded[source] = std::move(entry);
+    }
+
+    manifest = std::move(loaded);
+    return true;
+}
+
+bool AssetCooker::SaveManifest(const std::string& path, const Manifest& manifest) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+
+        uint32_t count = static_cast<uint32_t>(manifest.size());
+        file.write(ManifestMagic, sizeof(ManifestMagic));
+        file.write(reinterpret_cast<const char*>(&ManifestVersion), sizeof(ManifestVersion));
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+        auto writeString = [&file](const std::string& text) {
+            uint32_t length = static_cast<uint32_t>(text.size());
+            file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            file.write(text.data(), length);
+        };
+
+        for (const auto& [source, entry] : manifest) {
+            writeString(source);
+            writeString(entry.output);
+            file.write(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+            file.write(reinterpret_cast<const char*>(&entry.modifiedTime), sizeof(entry.modifiedTime));
+            file.write(reinterpret_cast<const char*>(&entry.sourceHash), sizeof(entry.sourceHash));
+            file.write(reinterpret_cast<const char*>(&entry.cookerVersion), sizeof(entry.cookerVersion));
+        }
+        if (!file) return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    return !error;
+}
+
+bool AssetCooker::WriteOutput(const std::string& path, std::span<const std::byte> data) {
+    std::error_code error;
+    std::filesystem::path target(path);
+    std::filesystem::create_directories(target.parent_path(), error);
+
+    // Temp file, then rename - a game reading the folder never maps half a blob
+    std::string temporary = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file) return false;
+    }
+
+    std::filesystem::rename(temporary, target, error);
+    if (error) std::filesystem::remove(temporary, error);
+    return !error;
+}
@@ -0,0 +1,117 @@
+// AssetCooker.h - The kitchen
+// Turns source files (.obj, .tga, .wav...) into the blobs in CookedFormats.h, once, before the game runs
+
+#ifndef ASSETCOOKER_H
+#define ASSETCOOKER_H
+
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Assets/CookedFormats.h"
+
+class ThreadManager;
+
+// The AssetCooker class - incremental and parallel, so only what changed gets cooked again
+class AssetCooker {
+public:
+    // A cooker - source bytes in, runtime blob out. On failure, say why in error.
+    using CookFunction = std::function<bool(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error)>;
+
+    AssetCooker(); // comes with the built-in cookers already registered
+    ~AssetCooker();
+
+    // Job system - files are cooked in parallel when there are workers
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    // Cookers by source extension (with the dot, any case). The output swaps the extension for
+    // cookedExtension. Bump version whenever the cooker or its output layout changes - every file
+    // it cooked is redone on the next run.
+    void RegisterCooker(const std::string& extension, const std::string& cookedExtension, uint32_t version, CookFunction cook);
+    bool CanCook(const std::string& path) const;
+    std::string GetCookedPath(const std::string& path) const; // empty if nothing cooks it
+
+    // One file, no bookkeeping - for the editor and for tests
+    bool CookFile(const std::string& sourcePath, std::vector<std::byte>& cooked, std::string& error) const;
+
+    // Whole tree - cooks every file a cooker handles into the same place under outputDir. A manifest
+    // in outputDir remembers what each output was cooked from: unchanged sources aren't even read,
+    // touched-but-identical ones are read and hashed but not cooked, and outputs whose source is
+    // gone are deleted. force ignores the manifest.
+    struct Report {
+        size_t cooked = 0;
+        size_t skipped = 0;
+        size_t failed = 0;
+        size_t removed = 0;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        double seconds = 0.0;
+        std::vector<std::string> errors;
+    };
+    bool CookDirectory(const std::string& sourceDir, const std::string& outputDir, Report& report, bool force = false);
+
+    // The built-in cookers - public so tools can cook straight from memory
+    static bool CookMesh(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error);      // Wavefront .obj
+    static bool CookTexture(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error);   // .tga (raw or RLE), .ppm/.pgm
+    static bool CookAnimation(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error); // .anim - a CSV table, time column first
+    static bool CookAudio(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error);     // PCM/float .wav
+    static bool CookConfig(std::span<const std::byte> source, std::vector<std::byte>& cooked, std::string& error);    // key = value, like ConfigManager
+
+    // A mesh in memory - vertices interleaved in the order of the attribute bits (position always
+    // there), indices grouped into one contiguous range per submesh
+    struct MeshData {
+        uint32_t attributes = CookedVertexPosition;
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        std::vector<CookedSubmesh> submeshes;
+        std::vector<std::string> materials;
+
+        size_t GetStride() const; // floats per vertex
+    };
+
+    // Meshes built in code rather than read from a file (HLOD proxies, say) - cooked just like a
+    // .obj, LOD chain and all. sourceHash goes in the header for the manifest to compare.
+    static bool CookMeshData(const MeshData& mesh, uint64_t sourceHash, std::vector<std::byte>& cooked, std::string& error);
+
+    // Vertex clustering on a grid of cellSize world units - what the LOD chain is made with.
+    // error comes back as the furthest any surface could have moved.
+    static MeshData SimplifyMesh(const MeshData& mesh, float cellSize, float& error);
+
+    // Content hash stored in every blob header - also what the manifest compares
+    static uint64_t HashSource(std::span<const std::byte> source);
+
+    static constexpr const char* ManifestName = "CookManifest.bin";
+
+private:
+    // Prevent copying - one kitchen at a time
+    AssetCooker(const AssetCooker&) = delete;
+    AssetCooker& operator=(const AssetCooker&) = delete;
+
+    struct Cooker {
+        std::string cookedExtension;
+        uint32_t version = 0;
+        CookFunction cook;
+    };
+
+    // What the manifest remembers about one source
+    struct ManifestEntry {
+        std::string output;      // relative to outputDir
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+        uint64_t sourceHash = 0;
+        uint32_t cookerVersion = 0;
+    };
+    using Manifest = std::unordered_map<std::string, ManifestEntry>; // by source path, relative to sourceDir
+
+    const Cooker* FindCooker(const std::string& path) const;
+    static bool LoadManifest(const std::string& path, Manifest& manifest);
+    static bool SaveManifest(const std::string& path, const Manifest& manifest);
+    static bool WriteOutput(const std::string& path, std::span<const std::byte> data);
+
+    std::unordered_map<std::string, Cooker> cookers; // by lower-case extension
+    ThreadManager* jobSystem;
+};
+
+#endif // ASSETCOOKER_H
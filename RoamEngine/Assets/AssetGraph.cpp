@@ -0,0 +1,447 @@
+// AssetGraph.cpp - Implementation of the family tree
+// Everything a group needs is asked for as soon as we know about it - the pipeline sorts out the rest
+
+#include "AssetGraph.h"
+#include "AssetManager.h"
+#include <algorithm>
+
+AssetGraph::AssetGraph(AssetManager& manager) : manager(manager), nextGroupId(1) {
+}
+
+AssetGraph::~AssetGraph() {
+    Clear();
+}
+
+void AssetGraph::DeclareDependencies(const std::string& assetName, std::vector<AssetDependency> dependencies) {
+    std::lock_guard<std::mutex> lock(mutex);
+    declared[assetName] = std::move(dependencies);
+}
+
+std::vector<AssetDependency> AssetGraph::GetDeclaredDependencies(const std::string& assetName) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = declared.find(assetName);
+    return it != declared.end() ? it->second : std::vector<AssetDependency>();
+}
+
+AssetGroupId AssetGraph::LoadGroup(const std::vector<AssetDependency>& roots, int priority,
+                                   ReadyCallback onReady, ErrorCallback onError) {
+    Work work;
+    AssetGroupId id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = nextGroupId++;
+        Group& group = groups[id];
+        group.id = id;
+        group.priority = priority;
+        group.onReady = std::move(onReady);
+        group.onError = std::move(onError);
+
+        for (const AssetDependency& root : roots) {
+            NodePtr node = Acquire(root, priority, work);
+            group.roots.push_back(root.name);
+            AddToGroup(group, node, work);
+        }
+
+        // Everything was already here - still reported from Update, like any other group
+        if (group.state == GroupState::Waiting && group.pending == 0) {
+            group.state = GroupState::Ready;
+            notifications.push_back(id);
+        }
+    }
+
+    Run(work);
+    return id;
+}
+
+void AssetGraph::ReleaseGroup(AssetGroupId id) {
+    Work work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = groups.find(id);
+        if (it == groups.end()) return;
+
+        for (const std::string& member : it->second.members) {
+            auto node = nodes.find(member);
+            if (node == nodes.end()) continue;
+            auto& memberOf = node->second->groups;
+            memberOf.erase(std::remove(memberOf.begin(), memberOf.end(), id), memberOf.end());
+        }
+
+        std::vector<std::string> roots = std::move(it->second.roots);
+        groups.erase(it);
+        for (const std::string& root : roots) Release(root, work);
+    }
+
+    Run(work);
+}
+
+bool AssetGraph::SetGroupPriority(AssetGroupId id, int priority) {
+    Work work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = groups.find(id);
+        if (it == groups.end()) return false;
+
+        Group& group = it->second;
+        group.priority = priority;
+        for (const std::string& member : group.members) {
+            auto node = nodes.find(member);
+            if (node == nodes.end() || node->second->state != NodeState::Loading) continue;
+
+            // Shared assets go at the most urgent of their groups' priorities
+            Node& current = *node->second;
+            int wanted = NodePriority(current);
+            if (wanted == current.priority) continue;
+            current.priority = wanted;
+            if (current.loadId != InvalidAssetLoadId) work.priorities.emplace_back(current.loadId, wanted);
+        }
+    }
+
+    Run(work);
+    return true;
+}
+
+bool AssetGraph::IsGroupReady(AssetGroupId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = groups.find(id);
+    return it != groups.end() && it->second.state == GroupState::Ready;
+}
+
+bool AssetGraph::GetGroupProgress(AssetGroupId id, size_t& loaded, size_t& total) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = groups.find(id);
+    if (it == groups.end()) return false;
+
+    total = it->second.members.size();
+    loaded = total - it->second.pending;
+    return true;
+}
+
+void AssetGraph::Update() {
+    struct Notification {
+        AssetGroupId id;
+        GroupState state;
+        std::string error;
+        ReadyCallback onReady;
+        ErrorCallback onError;
+    };
+
+    std::vector<Notification> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (AssetGroupId id : notifications) {
+            auto it = groups.find(id);
+            if (it == groups.end()) continue; // released before it got here
+            const Group& group = it->second;
+            pending.push_back(Notification{ id, group.state, group.error, group.onReady, group.onError });
+        }
+        notifications.clear();
+    }
+
+    // Outside the lock - callbacks are free to load and release groups
+    for (const Notification& notification : pending) {
+        if (notification.state == GroupState::Ready) {
+            if (notification.onReady) notification.onReady(notification.id);
+        } else if (notification.onError) {
+            notification.onError(notification.id, notification.error);
+        }
+    }
+}
+
+void AssetGraph::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    nodes.clear();
+    groups.clear();
+    notifications.clear();
+}
+
+size_t AssetGraph::GetNodeCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nodes.size();
+}
+
+size_t AssetGraph::GetGroupCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return groups.size();
+}
+
+int AssetGraph::GetRefCount(const std::string& assetName) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = nodes.find(assetName);
+    return it != nodes.end() ? it->second->refCount : 0;
+}
+
+AssetGraph::NodePtr AssetGraph::Acquire(const AssetDependency& dependency, int priority, Work& work) {
+    auto it = nodes.find(dependency.name);
+    if (it != nodes.end()) {
+        it->second->refCount++;
+        return it->second;
+    }
+
+    auto node = std::make_shared<Node>();
+    node->name = dependency.name;
+    node->type = dependency.type;
+    node->path = dependency.path;
+    node->priority = priority;
+    node->refCount = 1;
+    nodes[node->name] = node;
+    work.loads.push_back(node);
+
+    // Known children start loading alongside their parent, not after it
+    auto known = declared.find(node->name);
+    if (known != declared.end()) {
+        std::vector<AssetDependency> dependencies = known->second;
+        Link(node, dependencies, work);
+    }
+    return node;
+}
+
+void AssetGraph::Link(const NodePtr& parent, const std::vector<AssetDependency>& dependencies, Work& work) {
+    for (const AssetDependency& dependency : dependencies) {
+        if (dependency.name == parent->name) continue;
+        auto& links = parent->dependencies;
+        if (std::find(links.begin(), links.end(), dependency.name) != links.end()) continue;
+
+        // A cycle would keep itself loaded forever - the back edge is dropped instead
+        if (Reaches(dependency.name, parent->name)) continue;
+
+        // Edge first - the child's own declared dependencies are linked inside Acquire and
+        // have to see it to spot a cycle through us
+        links.push_back(dependency.name);
+        NodePtr child = Acquire(dependency, parent->priority, work);
+
+        std::vector<AssetGroupId> parentGroups = parent->groups;
+        for (AssetGroupId groupId : parentGroups) {
+            auto group = groups.find(groupId);
+            if (group != groups.end()) AddToGroup(group->second, child, work);
+        }
+    }
+}
+
+void AssetGraph::AddToGroup(Group& group, const NodePtr& node, Work& work) {
+    std::vector<NodePtr> stack{ node };
+    while (!stack.empty()) {
+        NodePtr current = std::move(stack.back());
+        stack.pop_back();
+        if (!group.members.insert(current->name).second) continue;
+
+        current->groups.push_back(group.id);
+        if (current->state == NodeState::Loading) {
+            group.pending++;
+            if (group.priority > current->priority) {
+                current->priority = group.priority;
+                if (current->loadId != InvalidAssetLoadId) work.priorities.emplace_back(current->loadId, current->priority);
+            }
+        } else if (current->state == NodeState::Failed) {
+            FailGroup(group, current->error);
+        }
+
+        for (const std::string& dependency : current->dependencies) {
+            auto child = nodes.find(dependency);
+            if (child != nodes.end()) stack.push_back(child->second);
+        }
+    }
+}
+
+void AssetGraph::Release(const std::string& assetName, Work& work) {
+    auto it = nodes.find(assetName);
+    if (it == nodes.end()) return;
+
+    NodePtr node = it->second;
+    if (--node->refCount > 0) return;
+
+    // Still on its way - stop it if we started it, and finish the job when it lands
+    if (node->state == NodeState::Loading) {
+        if (node->ownsAsset && node->loadId != InvalidAssetLoadId) work.cancels.push_back(node->loadId);
+        return;
+    }
+    Remove(node, work);
+}
+
+void AssetGraph::Remove(const NodePtr& node, Work& work) {
+    nodes.erase(node->name);
+    if (node->ownsAsset && node->state == NodeState::Loaded) work.unloads.push_back(node->name);
+    for (const std::string& dependency : node->dependencies) Release(dependency, work);
+}
+
+void AssetGraph::Learn(const std::string& assetName, const std::vector<AssetDependency>& dependencies) {
+    if (dependencies.empty()) return;
+
+    auto& known = declared[assetName];
+    for (const AssetDependency& dependency : dependencies) {
+        auto same = [&dependency](const AssetDependency& other) { return other.name == dependency.name; };
+        if (std::find_if(known.begin(), known.end(), same) == known.end()) known.push_back(dependency);
+    }
+}
+
+bool AssetGraph::Reaches(const std::string& from, const std::string& to) const {
+    // Plain DFS over what's loaded - leaves (textures, sounds) end it straight away
+    std::vector<const Node*> stack;
+    std::unordered_set<const Node*> visited;
+    auto start = nodes.find(from);
+    if (start == nodes.end()) return false;
+    stack.push_back(start->second.get());
+
+    while (!stack.empty()) {
+        const Node* current = stack.back();
+        stack.pop_back();
+        if (current->name == to) return true;
+        if (!visited.insert(current).second) continue;
+
+        for (const std::string& dependency : current->dependencies) {
+            auto child = nodes.find(dependency);
+            if (child != nodes.end()) stack.push_back(child->second.get());
+        }
+    }
+    return false;
+}
+
+void AssetGraph::FailGroup(Group& group, const std::string& error) {
+    if (group.state != GroupState::Waiting) return;
+    group.state = GroupState::Failed;
+    group.error = error;
+    notifications.push_back(group.id);
+}
+
+int AssetGraph::NodePriority(const Node& node) const {
+    bool found = false;
+    int priority = node.priority;
+    for (AssetGroupId groupId : node.groups) {
+        auto group = groups.find(groupId);
+        if (group == groups.end()) continue;
+        priority = found ? std::max(priority, group->second.priority) : group->second.priority;
+        found = true;
+    }
+    return priority;
+}
+
+void AssetGraph::Run(Work& work) {
+    for (const auto& [loadId, priority] : work.priorities) manager.SetLoadPriority(loadId, priority);
+    for (AssetLoadId loadId : work.cancels) manager.CancelLoad(loadId);
+    for (const std::string& name : work.unloads) manager.UnloadAsset(name);
+
+    for (const NodePtr& node : work.loads) {
+        // Someone else's asset stays theirs - an already-loaded one is borrowed without counting a
+        // load, and only a load we started (or joined) is counted, so only that one gets unloaded
+        LoadRequest request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node->ownsAsset = false;
+            request.assetName = node->name;
+            request.filePath = node->path;
+            request.type = node->type;
+            request.priority = node->priority;
+        }
+        request.countIfLoaded = false;
+        request.onComplete = [this, node](Asset* asset) { OnLoaded(node, asset); };
+        request.onError = [this, node](const std::string& error) { OnFailed(node, error); };
+        request.onDecoded = [this, node](Asset* asset) { OnDecoded(node, asset); };
+
+        // Already-loaded assets complete inside this call - the lock must be free by now
+        AssetLoadId loadId = manager.LoadAssetAsync(request);
+        if (loadId == InvalidAssetLoadId) continue;
+
+        int raised = request.priority;
+        bool cancel = false;
+        bool unload = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            node->ownsAsset = true;
+            if (node->state != NodeState::Loading) {
+                // It landed (on the main thread) before we got back here - if it was dropped as it
+                // landed, Remove didn't know the load was ours
+                auto it = nodes.find(node->name);
+                unload = node->state == NodeState::Loaded && (it == nodes.end() || it->second != node);
+                if (!unload) continue;
+            } else {
+                node->loadId = loadId;
+                raised = node->priority;
+                cancel = node->refCount <= 0; // released while we were asking
+            }
+        }
+        if (unload) manager.UnloadAsset(node->name);
+        else if (cancel) manager.CancelLoad(loadId);
+        else if (raised != request.priority) manager.SetLoadPriority(loadId, raised);
+    }
+}
+
+void AssetGraph::OnDecoded(const NodePtr& node, Asset* asset) {
+    // Worker thread - the parse just finished, so start the children before the main thread even sees it
+    std::vector<AssetDependency> dependencies = asset->GetDependencies();
+
+    Work work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = nodes.find(node->name);
+        if (it == nodes.end() || it->second != node || node->expanded) return;
+
+        node->expanded = true;
+        Learn(node->name, dependencies);
+        Link(node, dependencies, work);
+    }
+    Run(work);
+}
+
+void AssetGraph::OnLoaded(const NodePtr& node, Asset* asset) {
+    // Joined loads and already-loaded assets never went through OnDecoded
+    bool expanded;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        expanded = node->expanded;
+    }
+    std::vector<AssetDependency> dependencies;
+    if (!expanded) dependencies = asset->GetDependencies();
+
+    Work work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = nodes.find(node->name);
+        if (it == nodes.end() || it->second != node) return;
+
+        // Children first - a group isn't ready until they're in too
+        if (!node->expanded) {
+            node->expanded = true;
+            Learn(node->name, dependencies);
+            Link(node, dependencies, work);
+        }
+
+        node->state = NodeState::Loaded;
+        node->loadId = InvalidAssetLoadId;
+        for (AssetGroupId groupId : node->groups) {
+            auto group = groups.find(groupId);
+            if (group == groups.end() || group->second.state != GroupState::Waiting) continue;
+            if (--group->second.pending == 0) {
+                group->second.state = GroupState::Ready;
+                notifications.push_back(groupId);
+            }
+        }
+
+        if (node->refCount <= 0) Remove(node, work);
+    }
+    Run(work);
+}
+
+void AssetGraph::OnFailed(const NodePtr& node, const std::string& error) {
+    Work work;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = nodes.find(node->name);
+        if (it == nodes.end() || it->second != node) return;
+
+        // Cancelled after being released, then wanted again before the cancel landed - try again
+        if (node->refCount > 0 && error == "Cancelled" && node->ownsAsset) {
+            node->loadId = InvalidAssetLoadId;
+            work.loads.push_back(node);
+        } else {
+            node->state = NodeState::Failed;
+            node->error = node->name + ": " + error;
+            node->loadId = InvalidAssetLoadId;
+            for (AssetGroupId groupId : node->groups) {
+                auto group = groups.find(groupId);
+                if (group != groups.end()) FailGroup(group->second, node->error);
+            }
+            if (node->refCount <= 0) Remove(node, work);
+        }
+    }
+    Run(work);
+}
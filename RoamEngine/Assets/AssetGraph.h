@@ -0,0 +1,147 @@
+// AssetGraph.h - The family tree
+// A scene needs its meshes, a mesh its materials, a material its textures - this knows who needs whom
+
+#ifndef ASSETGRAPH_H
+#define ASSETGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Assets/AssetLoadPipeline.h"
+
+class Asset;
+class AssetManager;
+enum class AssetType; // the full list lives in AssetManager.h
+
+// A reference from one asset to another - leave the path empty for the default location
+struct AssetDependency {
+    std::string name;
+    AssetType type;
+    std::string path;
+};
+
+using AssetGroupId = uint64_t;
+constexpr AssetGroupId InvalidAssetGroupId = 0;
+
+// The AssetGraph class - loads whole trees in one go and counts references across all of them
+class AssetGraph {
+public:
+    using ReadyCallback = std::function<void(AssetGroupId)>;
+    using ErrorCallback = std::function<void(AssetGroupId, const std::string&)>;
+
+    explicit AssetGraph(AssetManager& manager);
+    ~AssetGraph();
+
+    // Declared dependencies - known before the asset is even read (from a manifest, or learned from
+    // an earlier load), so the whole tree starts loading at once instead of one level per parse.
+    // Whatever Asset::GetDependencies reports on top of these is learned for next time.
+    void DeclareDependencies(const std::string& assetName, std::vector<AssetDependency> dependencies);
+    std::vector<AssetDependency> GetDeclaredDependencies(const std::string& assetName) const;
+
+    // Groups - load the roots and everything they pull in, all at the group's priority. The group
+    // is ready once every asset in the tree is loaded; onReady/onError run inside Update. A group
+    // keeps its tree loaded until it's released, failed or not - assets shared with other groups
+    // stay until the last one lets go, and assets the graph loaded itself are unloaded after that.
+    AssetGroupId LoadGroup(const std::vector<AssetDependency>& roots, int priority,
+                           ReadyCallback onReady, ErrorCallback onError = nullptr);
+    void ReleaseGroup(AssetGroupId id);
+    bool SetGroupPriority(AssetGroupId id, int priority);
+
+    // Group state - progress counts assets in the tree found so far, so total can still grow
+    bool IsGroupReady(AssetGroupId id) const;
+    bool GetGroupProgress(AssetGroupId id, size_t& loaded, size_t& total) const;
+
+    // Main thread - hands out ready and failed groups
+    void Update();
+
+    // Forget everything without unloading - for shutdown, once the loads have stopped
+    void Clear();
+
+    // Debug info
+    size_t GetNodeCount() const;
+    size_t GetGroupCount() const;
+    int GetRefCount(const std::string& assetName) const; // groups holding it as a root, plus assets depending on it
+
+private:
+    // Prevent copying - one family tree per manager
+    AssetGraph(const AssetGraph&) = delete;
+    AssetGraph& operator=(const AssetGraph&) = delete;
+
+    enum class NodeState {
+        Loading,
+        Loaded,
+        Failed
+    };
+
+    struct Node {
+        std::string name;
+        AssetType type;
+        std::string path;
+        NodeState state = NodeState::Loading;
+        AssetLoadId loadId = InvalidAssetLoadId;
+        int priority = DefaultLoadPriority;
+        int refCount = 0;
+        bool expanded = false;   // the asset's own dependency list has been read
+        bool ownsAsset = false;  // our request counted as a load (it wasn't in already) - so we unload it too
+        std::string error;
+        std::vector<std::string> dependencies;
+        std::vector<AssetGroupId> groups; // every group whose tree contains this node
+    };
+    using NodePtr = std::shared_ptr<Node>;
+
+    enum class GroupState {
+        Waiting,
+        Ready,
+        Failed
+    };
+
+    struct Group {
+        AssetGroupId id = InvalidAssetGroupId;
+        std::vector<std::string> roots;
+        int priority = DefaultLoadPriority;
+        GroupState state = GroupState::Waiting;
+        std::unordered_set<std::string> members;
+        size_t pending = 0; // members not loaded yet
+        std::string error;
+        ReadyCallback onReady;
+        ErrorCallback onError;
+    };
+
+    // What to do once the lock is gone - loading can call straight back into us
+    struct Work {
+        std::vector<NodePtr> loads;
+        std::vector<std::pair<AssetLoadId, int>> priorities;
+        std::vector<AssetLoadId> cancels;
+        std::vector<std::string> unloads;
+    };
+
+    NodePtr Acquire(const AssetDependency& dependency, int priority, Work& work);
+    void Link(const NodePtr& parent, const std::vector<AssetDependency>& dependencies, Work& work);
+    void AddToGroup(Group& group, const NodePtr& node, Work& work);
+    void Release(const std::string& assetName, Work& work);
+    void Remove(const NodePtr& node, Work& work);
+    void Learn(const std::string& assetName, const std::vector<AssetDependency>& dependencies);
+    bool Reaches(const std::string& from, const std::string& to) const;
+    void FailGroup(Group& group, const std::string& error);
+    int NodePriority(const Node& node) const;
+    void Run(Work& work);
+
+    void OnDecoded(const NodePtr& node, Asset* asset);
+    void OnLoaded(const NodePtr& node, Asset* asset);
+    void OnFailed(const NodePtr& node, const std::string& error);
+
+    AssetManager& manager;
+    std::unordered_map<std::string, NodePtr> nodes;
+    std::unordered_map<AssetGroupId, Group> groups;
+    std::unordered_map<std::string, std::vector<AssetDependency>> declared;
+    std::vector<AssetGroupId> notifications; // groups that became ready or failed since the last Update
+    AssetGroupId nextGroupId;
+    mutable std::mutex mutex;
+};
+
+#endif // ASSETGRAPH_H
@@ -0,0 +1,466 @@
+// AssetLoadPipeline.cpp - Implementation of the loading dock
+// The main thread never waits on the disk here - it queues, it finalizes, and that's it
+
+#include "AssetLoadPipeline.h"
+#include "AssetManager.h"
+#include "Math/VirtualFileSystem.h"
+#include <chrono>
+#include <thread>
+
+AssetLoadPipeline::AssetLoadPipeline()
+    : jobSystem(nullptr), asyncIO(nullptr), initialized(false), maxInFlight(16), inFlight(0),
+      nextId(1), nextSequence(0), completedCount(0), failedCount(0), cancelledCount(0), deduplicatedCount(0),
+      lastUpdateMilliseconds(0.0) {
+}
+
+AssetLoadPipeline::~AssetLoadPipeline() {
+    Shutdown();
+}
+
+void AssetLoadPipeline::Initialize(ThreadManager* jobs, AsyncFileIO* io) {
+    Shutdown();
+    jobSystem = jobs;
+    asyncIO = io;
+    initialized = true;
+}
+
+void AssetLoadPipeline::Shutdown() {
+    std::vector<IORequestId> reads;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& [id, request] : requests) {
+            request->cancelled = true;
+            if (request->stage == Stage::Reading && request->readId != InvalidIORequestId) reads.push_back(request->readId);
+        }
+        queued.clear();
+    }
+    if (asyncIO) {
+        for (IORequestId read : reads) asyncIO->Cancel(read);
+    }
+
+    // Reads and decodes still hold pointers to us - let them land before tearing down
+    while (!outstanding.IsDone()) {
+        if (jobSystem && jobSystem->RunPendingJob()) continue;
+        std::this_thread::yield();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& [id, request] : requests) delete request->asset;
+    requests.clear();
+    requestsByName.clear();
+    ready.clear();
+    inFlight = 0;
+    jobSystem = nullptr;
+    asyncIO = nullptr;
+    initialized = false;
+}
+
+AssetLoadId AssetLoadPipeline::Submit(Asset* asset, const std::string& name, const std::string& path, int priority,
+                                      CompleteCallback onComplete, ErrorCallback onError,
+                                      DecodedCallback onDecoded) {
+    if (!asset) return InvalidAssetLoadId;
+
+    AssetLoadId id;
+    bool joined = false;
+    bool raise = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // Already on its way - ride along instead of loading it twice
+        auto existing = requestsByName.find(name);
+        if (existing != requestsByName.end() && !requests[existing->second]->cancelled) {
+            RequestPtr request = requests[existing->second];
+            if (onComplete) request->onComplete.push_back(std::move(onComplete));
+            if (onError) request->onError.push_back(std::move(onError));
+            if (onDecoded && (request->stage == Stage::Queued || request->stage == Stage::Reading)) request->onDecoded.push_back(std::move(onDecoded));
+            delete asset;
+
+            id = request->id;
+            joined = true;
+            raise = priority > request->priority && !request->cancelled;
+        } else {
+            auto request = std::make_shared<Request>();
+            request->id = nextId++;
+            request->asset = asset;
+            request->name = name;
+            request->path = path;
+            request->priority = priority;
+            request->sequence = nextSequence++;
+            if (onComplete) request->onComplete.push_back(std::move(onComplete));
+            if (onError) request->onError.push_back(std::move(onError));
+            if (onDecoded) request->onDecoded.push_back(std::move(onDecoded));
+
+            if (asset->name.empty()) asset->name = name;
+            asset->filePath = path;
+            asset->loadState = LoadState::Loading;
+
+            id = request->id;
+            requests[id] = request;
+            requestsByName[request->name] = id;
+            queued.insert(KeyOf(*request));
+        }
+    }
+
+    if (joined) {
+        if (raise) SetPriority(id, priority);
+    } else {
+        Dispatch();
+    }
+    return id;
+}
+
+bool AssetLoadPipeline::SetPriority(AssetLoadId id, int priority) {
+    IORequestId readId = InvalidIORequestId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = requests.find(id);
+        if (it == requests.end()) return false;
+
+        Request& request = *it->second;
+        if (request.priority == priority) return true;
+
+        std::set<QueueKey>* home = request.stage == Stage::Queued ? &queued : request.stage == Stage::Ready ? &ready : nullptr;
+        if (home) home->erase(KeyOf(request));
+        request.priority = priority;
+        if (home) home->insert(KeyOf(request));
+        if (request.stage == Stage::Reading) readId = request.readId;
+    }
+
+    // Still waiting for the disk? Move it in the disk's queue too
+    if (asyncIO && readId != InvalidIORequestId) asyncIO->SetPriority(readId, ToIOPriority(priority));
+    return true;
+}
+
+bool AssetLoadPipeline::Cancel(AssetLoadId id) {
+    IORequestId readId = InvalidIORequestId;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = requests.find(id);
+        if (it == requests.end() || it->second->cancelled) return false;
+
+        RequestPtr request = it->second;
+        request->cancelled = true;
+
+        if (request->stage == Stage::Queued) {
+            // Never started - straight to the finalize queue so onError still runs on the main thread
+            queued.erase(KeyOf(*request));
+            request->stage = Stage::Ready;
+            ready.insert(KeyOf(*request));
+        } else if (request->stage == Stage::Reading) {
+            readId = request->readId;
+        }
+        // Decoding ones finish their decode and are thrown away when they get to the main thread
+    }
+
+    if (asyncIO && readId != InvalidIORequestId) asyncIO->Cancel(readId);
+    return true;
+}
+
+AssetLoadId AssetLoadPipeline::Find(const std::string& assetName) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = requestsByName.find(assetName);
+    return it != requestsByName.end() ? it->second : InvalidAssetLoadId;
+}
+
+size_t AssetLoadPipeline::Update(double budgetMilliseconds) {
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    size_t finalized = 0;
+    for (;;) {
+        RequestPtr request;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ready.empty() || (finalized > 0 && elapsed() >= budgetMilliseconds)) break;
+
+            auto best = ready.begin();
+            auto it = requests.find(best->id);
+            ready.erase(best);
+            if (it == requests.end()) continue;
+
+            request = it->second;
+            requests.erase(it);
+            auto byName = requestsByName.find(request->name);
+            if (byName != requestsByName.end() && byName->second == request->id) requestsByName.erase(byName);
+            if (request->holdsSlot) inFlight--;
+        }
+
+        // Outside the lock - callbacks are free to queue more loads
+        Asset* asset = request->asset;
+        bool shared = false;
+        std::string error;
+        if (request->cancelled) {
+            error = "Cancelled";
+        } else if (!request->succeeded) {
+            error = request->error;
+        } else {
+            // The same bytes are already resident - hand those out and drop ours before it costs an upload
+            Asset* resident = contentResolver && asset->GetContentKey().IsValid() ? contentResolver(asset) : nullptr;
+            if (resident && resident != asset) {
+                delete asset;
+                asset = resident;
+                shared = true;
+            } else if (request->parseSkipped && !LoadAssetData(asset, request->path)) {
+                error = "Failed to load " + request->path; // its twin went away before we got here
+            } else if (!asset->FinalizeLoad()) {
+                error = "Failed to finalize " + request->name;
+            }
+        }
+
+        if (error.empty()) {
+            if (!shared) asset->loadState = LoadState::Loaded;
+            for (const auto& callback : request->onComplete) callback(asset);
+        } else {
+            for (const auto& callback : request->onError) {
+                if (callback) callback(error);
+            }
+            delete asset;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (request->cancelled) cancelledCount++;
+            else if (error.empty()) completedCount++;
+            else failedCount++;
+            if (shared) deduplicatedCount++;
+        }
+        finalized++;
+
+        // A slot opened up - get the next read going straight away
+        Dispatch();
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    lastUpdateMilliseconds = elapsed();
+    return finalized;
+}
+
+void AssetLoadPipeline::SetMaxInFlight(uint32_t count) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        maxInFlight = count > 0 ? count : 1;
+    }
+    Dispatch();
+}
+
+void AssetLoadPipeline::SetContentDeduplication(AssetContentProbe probe, ContentResolver resolver) {
+    std::lock_guard<std::mutex> lock(mutex);
+    contentProbe = std::move(probe);
+    contentResolver = std::move(resolver); // only Update reads it, on the same thread that sets it
+}
+
+bool AssetLoadPipeline::LoadAssetData(Asset* asset, const std::string& path, std::shared_ptr<const std::vector<std::byte>> prefetched,
+                                      const AssetContentProbe& skipIfResident, bool* skipped) {
+    VirtualFileSystem& vfs = VirtualFileSystem::GetInstance();
+
+    // Hash before parsing - a twin that's already resident saves the parse, not just the memory
+    FileView mapped;
+    if (skipIfResident) {
+        std::span<const std::byte> bytes;
+        if (prefetched) bytes = std::span<const std::byte>(prefetched->data(), prefetched->size());
+        else if (vfs.Open(path, mapped)) bytes = mapped.data;
+        else return false;
+
+        asset->contentKey = AssetContentKey::Of(bytes);
+        if (skipIfResident(asset->contentKey, asset->GetType())) {
+            if (skipped) *skipped = true;
+            return true;
+        }
+    }
+
+    if (asset->SupportsMappedLoading()) {
+        // The read stage's buffer first - assets that only parse whole mapped files turn it down and get the mapping
+        if (prefetched) {
+            FileView view;
+            view.decoded = prefetched;
+            view.data = std::span<const std::byte>(prefetched->data(), prefetched->size());
+            if (asset->LoadFromView(view)) return true;
+        }
+
+        if (mapped.IsValid()) return asset->LoadFromView(mapped);
+        FileView view;
+        if (vfs.Open(path, view)) {
+            return asset->LoadFromView(view);
+        }
+    }
+
+    // Path-only loaders can still see loose files from mounted folders, just not pack contents.
+    // After a read stage the file is in the page cache, so this doesn't go to the disk again.
+    std::string loosePath = vfs.ResolveLoosePath(path);
+    return asset->LoadFromFile(loosePath.empty() ? path : loosePath);
+}
+
+AssetLoadPipeline::Stats AssetLoadPipeline::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    for (const auto& [id, request] : requests) {
+        switch (request->stage) {
+            case Stage::Queued: stats.queued++; break;
+            case Stage::Reading: stats.reading++; break;
+            case Stage::Decoding: stats.decoding++; break;
+            case Stage::Ready: stats.ready++; break;
+        }
+    }
+    stats.completed = completedCount;
+    stats.failed = failedCount;
+    stats.cancelled = cancelledCount;
+    stats.deduplicated = deduplicatedCount;
+    stats.lastUpdateMilliseconds = lastUpdateMilliseconds;
+    return stats;
+}
+
+IOPriority AssetLoadPipeline::ToIOPriority(int priority) {
+    if (priority >= CriticalLoadPriority) return IOPriority::Critical;
+    return priority < 0 ? IOPriority::Prefetch : IOPriority::Visible;
+}
+
+JobPriority AssetLoadPipeline::ToJobPriority(int priority) {
+    if (priority >= CriticalLoadPriority) return JobPriority::High;
+    return priority < 0 ? JobPriority::Low : JobPriority::Normal;
+}
+
+void AssetLoadPipeline::Dispatch() {
+    std::vector<RequestPtr> starting;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (inFlight < maxInFlight && !queued.empty()) {
+            auto best = queued.begin();
+            RequestPtr request = requests[best->id];
+            queued.erase(best);
+
+            request->stage = Stage::Reading;
+            request->holdsSlot = true;
+            inFlight++;
+            starting.push_back(std::move(request));
+        }
+    }
+
+    // Working out where a file lives can touch the disk too - not on the caller's thread
+    for (RequestPtr& request : starting) {
+        RunJob(ToJobPriority(request->priority), [this, request]() { StartRead(request); });
+    }
+}
+
+void AssetLoadPipeline::StartRead(const RequestPtr& request) {
+    // Loose files are read by the async reader. Pack entries are already mapped (or decoded by the
+    // VFS), so those go straight to the decode stage.
+    std::string loosePath = VirtualFileSystem::GetInstance().ResolveLoosePath(request->path);
+    if (!asyncIO || !asyncIO->IsInitialized() || loosePath.empty()) {
+        StartDecode(request, nullptr);
+        return;
+    }
+
+    int priority;
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = request->cancelled;
+        priority = request->priority;
+    }
+    if (cancelled) {
+        MarkReady(request);
+        return;
+    }
+
+    IORequest read;
+    read.path = loosePath;
+    read.priority = ToIOPriority(priority);
+    read.onComplete = [this, request](IOResult& result) {
+        if (result.status == IOStatus::Completed) {
+            auto data = std::make_shared<std::vector<std::byte>>(std::move(result.ownedData));
+            data->resize(static_cast<size_t>(result.bytesRead));
+            StartDecode(request, std::move(data));
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (result.status != IOStatus::Cancelled) request->error = "Failed to read " + request->path;
+                else request->cancelled = true;
+            }
+            MarkReady(request);
+        }
+        outstanding.Done();
+    };
+
+    outstanding.Add();
+    IORequestId readId = asyncIO->Submit(std::move(read));
+    if (readId == InvalidIORequestId) {
+        outstanding.Done();
+        StartDecode(request, nullptr); // the reader wouldn't take it - load it the slow way
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (request->stage == Stage::Reading) request->readId = readId;
+}
+
+void AssetLoadPipeline::StartDecode(const RequestPtr& request, std::shared_ptr<const std::vector<std::byte>> data) {
+    int priority;
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = request->cancelled;
+        if (!cancelled) {
+            request->stage = Stage::Decoding;
+            request->readId = InvalidIORequestId;
+        }
+        priority = request->priority;
+    }
+    if (cancelled) {
+        MarkReady(request);
+        return;
+    }
+
+    RunJob(ToJobPriority(priority), [this, request, data]() { Decode(request, data); });
+}
+
+void AssetLoadPipeline::Decode(const RequestPtr& request, std::shared_ptr<const std::vector<std::byte>> data) {
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = request->cancelled;
+    }
+
+    if (!cancelled) {
+        AssetContentProbe probe;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            probe = contentProbe;
+        }
+        bool skipped = false;
+        bool succeeded = LoadAssetData(request->asset, request->path, std::move(data), probe, &skipped);
+
+        std::vector<DecodedCallback> decodedCallbacks;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            request->succeeded = succeeded;
+            request->parseSkipped = skipped;
+            if (!succeeded) request->error = "Failed to load " + request->path;
+            else if (!skipped) decodedCallbacks.swap(request->onDecoded); // nothing parsed, nothing to look at
+        }
+
+        // Still ours until it's marked ready - nobody else touches the asset while these run
+        for (const auto& callback : decodedCallbacks) callback(request->asset);
+    }
+    MarkReady(request);
+}
+
+void AssetLoadPipeline::MarkReady(const RequestPtr& request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (request->stage == Stage::Ready) return;
+
+    // Shutdown already took it out of the books - nothing to hand over
+    if (requests.find(request->id) == requests.end()) return;
+
+    request->stage = Stage::Ready;
+    ready.insert(KeyOf(*request));
+}
+
+void AssetLoadPipeline::RunJob(JobPriority priority, std::function<void()> job) {
+    if (!jobSystem) {
+        job();
+        return;
+    }
+    jobSystem->Submit(std::move(job), priority, &outstanding);
+}
@@ -0,0 +1,179 @@
+// AssetLoadPipeline.h - The loading dock
+// Requests queue up by priority, the disk and the workers do the heavy lifting, the main thread just signs for delivery
+
+#ifndef ASSETLOADPIPELINE_H
+#define ASSETLOADPIPELINE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Assets/AssetContentTable.h"
+#include "Core/ThreadManager.h"
+#include "Math/AsyncFileIO.h"
+
+class Asset;
+struct FileView;
+
+using AssetLoadId = uint64_t;
+constexpr AssetLoadId InvalidAssetLoadId = 0;
+
+// Load priorities - higher loads first. From CriticalLoadPriority up the disk treats it as
+// blocking the frame, below 0 it's speculative prefetch that only gets the disk when it's idle
+constexpr int CriticalLoadPriority = 100;
+constexpr int DefaultLoadPriority = 0;
+
+// The AssetLoadPipeline class - queued -> reading (I/O) -> decoding (workers) -> ready -> finalized (main thread)
+class AssetLoadPipeline {
+public:
+    using CompleteCallback = std::function<void(Asset*)>;
+    using ErrorCallback = std::function<void(const std::string&)>;
+    using DecodedCallback = std::function<void(Asset*)>;
+    using ContentResolver = std::function<Asset*(Asset* loaded)>;
+
+    AssetLoadPipeline();
+    ~AssetLoadPipeline();
+
+    // Setup - without a job system decoding happens inline, without async I/O the read stage is skipped
+    void Initialize(ThreadManager* jobs, AsyncFileIO* io);
+    void Shutdown(); // drops everything unfinished - no callbacks, the assets are deleted
+    bool IsInitialized() const { return initialized; }
+
+    // Submit a load - the pipeline owns the asset until it's handed to onComplete (or deleted on
+    // failure), and names it if the factory didn't. A second load for the same name joins the
+    // first one: its asset is deleted, its callbacks are added and the request keeps the higher
+    // of the two priorities.
+    // onDecoded runs on the worker right after a successful parse - a head start for whoever wants
+    // to look inside early. Joins that arrive once parsing has started only get onComplete.
+    AssetLoadId Submit(Asset* asset, const std::string& name, const std::string& path, int priority,
+                       CompleteCallback onComplete, ErrorCallback onError = nullptr,
+                       DecodedCallback onDecoded = nullptr);
+
+    // Change of plans - priorities can move at any stage, they only matter until the read starts
+    // (and the read's own place in the disk queue follows along). Cancelled loads report "Cancelled".
+    bool SetPriority(AssetLoadId id, int priority);
+    bool Cancel(AssetLoadId id);
+    AssetLoadId Find(const std::string& assetName) const;
+
+    // Main thread - finalize finished loads and run their callbacks until the budget is spent.
+    // At least one load finishes per call, so a tiny budget still makes progress.
+    size_t Update(double budgetMilliseconds);
+
+    // In flight - loads between starting their read and being finalized. Bounds memory held by
+    // read buffers and decoded data, and leaves the disk to the highest priorities.
+    void SetMaxInFlight(uint32_t count);
+    uint32_t GetMaxInFlight() const { return maxInFlight; }
+
+    // Content dedup - with a probe set, every load hashes its bytes (Asset::GetContentKey) and skips
+    // the parse when the probe says an identical asset is already resident. The resolver runs on the
+    // main thread before FinalizeLoad and returns that resident asset, or nullptr to keep the new one;
+    // the new one is deleted and the callbacks get the resident one. Skipped parses whose twin was
+    // unloaded in the meantime are parsed right there instead. nullptrs turn it off.
+    void SetContentDeduplication(AssetContentProbe probe, ContentResolver resolver);
+
+    // Shared with synchronous loads - mapped view when the asset can use one, its own loader otherwise.
+    // prefetched is what the read stage already brought in, if anything. With skipIfResident the
+    // content key is worked out first, and if the probe says yes the parse is skipped and skipped set.
+    static bool LoadAssetData(Asset* asset, const std::string& path, std::shared_ptr<const std::vector<std::byte>> prefetched = nullptr,
+                              const AssetContentProbe& skipIfResident = nullptr, bool* skipped = nullptr);
+
+    // Statistics - how are we doing?
+    struct Stats {
+        uint32_t queued = 0;
+        uint32_t reading = 0;
+        uint32_t decoding = 0;
+        uint32_t ready = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t cancelled = 0;
+        uint64_t deduplicated = 0; // completed with an asset that was already resident
+        double lastUpdateMilliseconds = 0.0;
+    };
+    Stats GetStats() const;
+
+private:
+    // Prevent copying - one dock per warehouse
+    AssetLoadPipeline(const AssetLoadPipeline&) = delete;
+    AssetLoadPipeline& operator=(const AssetLoadPipeline&) = delete;
+
+    enum class Stage {
+        Queued,
+        Reading,
+        Decoding,
+        Ready
+    };
+
+    struct Request {
+        AssetLoadId id = InvalidAssetLoadId;
+        Asset* asset = nullptr;
+        std::string name;
+        std::string path;
+        int priority = DefaultLoadPriority;
+        uint64_t sequence = 0;    // submission order - first come, first served among equals
+        Stage stage = Stage::Queued;
+        bool holdsSlot = false;   // counts against maxInFlight
+        bool cancelled = false;
+        bool succeeded = false;
+        bool parseSkipped = false; // identical content was resident - see SetContentDeduplication
+        std::string error;
+        IORequestId readId = InvalidIORequestId;
+        std::vector<CompleteCallback> onComplete;
+        std::vector<ErrorCallback> onError;
+        std::vector<DecodedCallback> onDecoded;
+    };
+    using RequestPtr = std::shared_ptr<Request>;
+
+    // Sort key - highest priority first, then oldest first
+    struct QueueKey {
+        int priority;
+        uint64_t sequence;
+        AssetLoadId id;
+
+        bool operator<(const QueueKey& other) const {
+            if (priority != other.priority) return priority > other.priority;
+            return sequence < other.sequence;
+        }
+    };
+
+    static QueueKey KeyOf(const Request& request) { return QueueKey{ request.priority, request.sequence, request.id }; }
+    static IOPriority ToIOPriority(int priority);
+    static JobPriority ToJobPriority(int priority);
+
+    void Dispatch();
+    void StartRead(const RequestPtr& request);
+    void StartDecode(const RequestPtr& request, std::shared_ptr<const std::vector<std::byte>> data);
+    void Decode(const RequestPtr& request, std::shared_ptr<const std::vector<std::byte>> data);
+    void MarkReady(const RequestPtr& request);
+    void RunJob(JobPriority priority, std::function<void()> job);
+
+    std::set<QueueKey> queued;
+    std::set<QueueKey> ready;
+    std::unordered_map<AssetLoadId, RequestPtr> requests;
+    std::unordered_map<std::string, AssetLoadId> requestsByName;
+    mutable std::mutex mutex;
+
+    ThreadManager* jobSystem;
+    AsyncFileIO* asyncIO;
+    JobCounter outstanding; // jobs and reads that still point at us
+    bool initialized;
+
+    uint32_t maxInFlight;
+    uint32_t inFlight;
+    AssetLoadId nextId;
+    uint64_t nextSequence;
+
+    uint64_t completedCount;
+    uint64_t failedCount;
+    uint64_t cancelledCount;
+    uint64_t deduplicatedCount;
+    double lastUpdateMilliseconds;
+
+    AssetContentProbe contentProbe;
+    ContentResolver contentResolver;
+};
+
+#endif // ASSETLOADPIPELINE_H
@@ -10,6 +10,15 @@
 #include <vector>
 #include <mutex>
 #include <functional>
+#include <span>
+#include <algorithm>
+#include "Assets/AssetContentTable.h"
+#include "Assets/AssetGraph.h"
+#include "Assets/AssetLoadPipeline.h"
+#include "Assets/DerivedDataCache.h"
+#include "Core/StringId.h"
+#include "Math/FileSystem.h"
+#include "Math/VirtualFileSystem.h"
 
 // Asset types - what kind of stuff do we have?
 enum class AssetType {
@@ -90,12 +99,32 @@ public:
     const std::string& GetName() const { return name; }
     LoadState GetLoadState() const { return loadState; }
     const std::string& GetFilePath() const { return filePath; }
+    const AssetContentKey& GetContentKey() const { return contentKey; } // only set while deduplicating
 
     // Loading
     virtual bool LoadFromFile(const std::string& path) = 0;
     virtual bool SaveToFile(const std::string& path) = 0;
     virtual void Unload() = 0;
 
+    // Zero-copy loading - override both to parse straight out of a memory-mapped file.
+    // Hold on to the mapping if you keep pointers into it; it stays mapped while anyone does.
+    virtual bool SupportsMappedLoading() const { return false; }
+    virtual bool LoadFromMappedFile(std::shared_ptr<const MappedFile> /*mapping*/) { return false; }
+
+    // Pack-aware loading - the view may be a slice of a mounted pack. The default hands whole
+    // loose files to LoadFromMappedFile, so only assets that want to live in packs need this one.
+    virtual bool LoadFromView(const FileView& view) {
+        return view.IsWholeFile() && LoadFromMappedFile(view.mapping);
+    }
+
+    // Main-thread finish - GPU uploads and anything else a worker can't do. Async loads call it
+    // inside the frame's loading budget, so keep it short and leave the parsing to LoadFrom*.
+    virtual bool FinalizeLoad() { return true; }
+
+    // Dependencies - other assets this one can't be used without (a prefab's meshes, a material's
+    // textures). Asked right after parsing, on a worker, so group loads can start them early.
+    virtual std::vector<AssetDependency> GetDependencies() const { return {}; }
+
     // Memory management
     void AddRef() { ++refCount; }
     void Release() { if (--refCount <= 0) delete this; }
@@ -106,12 +135,15 @@ public:
     std::string GetMetadata(const std::string& key) const;
 
 protected:
+    friend class AssetLoadPipeline; // moves loadState along as the load goes
+
     AssetType type;
     std::string name;
     std::string filePath;
     LoadState loadState;
     int refCount;
     std::unordered_map<std::string, std::string> metadata;
+    AssetContentKey contentKey;
 };
 
 // Load request - for asynchronous loading
@@ -121,9 +153,11 @@ struct LoadRequest {
     AssetType type;
     std::function<void(Asset*)> onComplete;
     std::function<void(const std::string&)> onError;
-    int priority;
+    std::function<void(Asset*)> onDecoded; // optional - on a worker, straight after parsing
+    int priority; // higher first - CriticalLoadPriority and up for blocking loads, below 0 for prefetch
+    bool countIfLoaded; // false - an already-loaded asset is handed over without counting a load, so don't unload it
 
-    LoadRequest() : priority(0) {}
+    LoadRequest() : priority(DefaultLoadPriority), countIfLoaded(true) {}
 };
 
 // The AssetManager class - our asset warehouse manager
@@ -144,12 +178,13 @@ public:
     // Asset loading - get stuff from the warehouse
     template<typename T>
     AssetHandle<T> LoadAsset(const std::string& name, const std::string& path = "") {
-        std::lock_guard<std::mutex> lock(assetMutex);
+        StringId id = StringInterner::GetInstance().Intern(name); // invalid if the name collides - kept by text then
+        std::unique_lock<std::mutex> lock(assetMutex);
 
         // Check if already loaded
-        auto it = loadedAssets.find(name);
-        if (it != loadedAssets.end()) {
-            return AssetHandle<T>(dynamic_cast<T*>(it->second));
+        if (Asset* loaded = FindLoaded(id, name)) {
+            contentTable.AddRef(name);
+            return AssetHandle<T>(dynamic_cast<T*>(loaded));
         }
 
         // Create new asset
@@ -164,30 +199,165 @@ public:
             return AssetHandle<T>();
         }
 
+        // The disk work happens unlocked - async finalization and other threads' lookups don't wait on it
         std::string assetPath = path.empty() ? GetAssetPath(name) : path;
-        if (asset->LoadFromFile(assetPath)) {
-            loadedAssets[name] = asset;
-            return AssetHandle<T>(asset);
+        AssetContentProbe probe = deduplicating ? MakeContentProbe() : nullptr;
+        lock.unlock();
+        bool skipped = false;
+        bool loaded = LoadAssetData(asset, assetPath, probe, &skipped);
+        lock.lock();
+
+        // The same bytes are already resident under another name - share them
+        Asset* resident = loaded && probe ? contentTable.Find(asset->GetContentKey(), asset->GetType()) : nullptr;
+        if (resident) {
+            delete asset;
+            if (Asset* raced = FindLoaded(id, name)) {
+                contentTable.AddRef(name);
+                return AssetHandle<T>(dynamic_cast<T*>(raced));
+            }
+            contentTable.CountDuplicate(resident->GetContentKey().size);
+            Adopt(id, name, resident);
+            return AssetHandle<T>(dynamic_cast<T*>(resident));
+        }
+
+        if (loaded) {
+            lock.unlock();
+            loaded = (!skipped || LoadAssetData(asset, assetPath)) && asset->FinalizeLoad(); // a skipped parse lost its twin meanwhile
+            lock.lock();
+        }
+
+        if (!loaded) {
+            delete asset;
+            return AssetHandle<T>();
+        }
+
+        // Someone else loaded it while we weren't holding the lock - theirs wins
+        if (Asset* raced = FindLoaded(id, name)) {
+            delete asset;
+            contentTable.AddRef(name);
+            return AssetHandle<T>(dynamic_cast<T*>(raced));
         }
 
-        delete asset;
-        return AssetHandle<T>();
+        Adopt(id, name, asset);
+        return AssetHandle<T>(asset);
     }
 
     // Synchronous loading
     Asset* LoadAssetSync(const std::string& name, AssetType type, const std::string& path = "");
 
-    // Asynchronous loading - load in the background
-    void LoadAssetAsync(const LoadRequest& request);
-    void UpdateAsyncLoading();
+    // Asynchronous loading - load in the background. Reading and parsing happen on workers,
+    // onComplete/onError run on the main thread inside UpdateAsyncLoading. Already-loaded assets
+    // complete right away and return InvalidAssetLoadId.
+    AssetLoadId LoadAssetAsync(const LoadRequest& request) {
+        StringId id = StringInterner::GetInstance().Intern(request.assetName);
+        std::unique_lock<std::mutex> lock(assetMutex);
+        if (Asset* asset = FindLoaded(id, request.assetName)) {
+            if (request.countIfLoaded) contentTable.AddRef(request.assetName);
+            lock.unlock();
+            if (request.onComplete) request.onComplete(asset);
+            return InvalidAssetLoadId;
+        }
+
+        auto factoryIt = assetFactories.find(request.type);
+        Asset* asset = factoryIt != assetFactories.end() ? factoryIt->second() : nullptr;
+        lock.unlock();
+        if (!asset) {
+            if (request.onError) request.onError("No factory for " + request.assetName);
+            return InvalidAssetLoadId;
+        }
+
+        std::string path = request.filePath.empty() ? GetAssetPath(request.assetName) : request.filePath;
+        auto onComplete = [this, id, name = request.assetName, callback = request.onComplete](Asset* loaded) {
+            Asset* stored;
+            {
+                std::lock_guard<std::mutex> storeLock(assetMutex);
+                stored = Adopt(id, name, loaded);
+            }
+            if (callback) callback(stored);
+        };
+        return loadPipeline.Submit(asset, request.assetName, path, request.priority, std::move(onComplete), request.onError, request.onDecoded);
+    }
+
+    // Call once per frame - finishes async loads within the budget (see SetAsyncLoadBudget),
+    // then reports the groups that became ready
+    void UpdateAsyncLoading() {
+        loadPipeline.Update(asyncLoadBudget);
+        DeleteRetiredAssets();
+        assetGraph.Update();
+    }
 
-    // Asset unloading - clean up the warehouse
-    void UnloadAsset(const std::string& name);
+    // Async load control - priorities can change while a load waits, cancelled loads report "Cancelled"
+    bool SetLoadPriority(AssetLoadId id, int priority) { return loadPipeline.SetPriority(id, priority); }
+    bool CancelLoad(AssetLoadId id) { return loadPipeline.Cancel(id); }
+    void SetAsyncLoadBudget(double milliseconds) { asyncLoadBudget = milliseconds; }
+    void SetMaxLoadsInFlight(uint32_t count) { loadPipeline.SetMaxInFlight(count); }
+    AssetLoadPipeline::Stats GetAsyncLoadStats() const { return loadPipeline.GetStats(); }
+
+    // Group loading - one call for an asset and everything it pulls in, fetched in parallel.
+    // onReady runs once the whole tree is loaded; release the group when you're done with it.
+    AssetGroupId LoadAssetGroup(const std::vector<AssetDependency>& roots, int priority,
+                                AssetGraph::ReadyCallback onReady, AssetGraph::ErrorCallback onError = nullptr) {
+        return assetGraph.LoadGroup(roots, priority, std::move(onReady), std::move(onError));
+    }
+    void ReleaseAssetGroup(AssetGroupId id) { assetGraph.ReleaseGroup(id); }
+    bool SetAssetGroupPriority(AssetGroupId id, int priority) { return assetGraph.SetGroupPriority(id, priority); }
+    bool IsAssetGroupReady(AssetGroupId id) const { return assetGraph.IsGroupReady(id); }
+    void DeclareDependencies(const std::string& assetName, std::vector<AssetDependency> dependencies) {
+        assetGraph.DeclareDependencies(assetName, std::move(dependencies));
+    }
+    AssetGraph& GetAssetGraph() { return assetGraph; }
+
+    // Workers for async loading - the Engine hands its job system over at startup, nullptr stops it
+    void SetJobSystem(ThreadManager* jobs) {
+        if (jobs) {
+            loadPipeline.Initialize(jobs, &FileSystem::GetAsyncIO());
+        } else {
+            loadPipeline.Shutdown();
+            DeleteRetiredAssets();
+            assetGraph.Clear(); // its loads just went away without a word
+        }
+    }
+
+    // Asset unloading - clean up the warehouse. Deduplicated assets count loads per name: a name
+    // goes after as many unloads as it had loads, the asset once the last of its names has gone.
+    void UnloadAsset(const std::string& name) {
+        StringId id = StringInterner::GetInstance().Find(name);
+        Asset* orphan = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(assetMutex);
+            Asset* loaded = FindLoaded(id, name);
+            if (!loaded) return;
+
+            switch (contentTable.Release(name)) {
+                case AssetContentTable::ReleaseResult::StillReferenced:
+                    return;
+                case AssetContentTable::ReleaseResult::AliasRemoved:
+                    EraseLoaded(id, name);
+                    return;
+                case AssetContentTable::ReleaseResult::NotTracked:
+                case AssetContentTable::ReleaseResult::LastAlias:
+                    orphan = loaded;
+                    EraseLoaded(id, name);
+                    break;
+            }
+        }
+        orphan->Unload();
+        delete orphan;
+    }
     void UnloadAllAssets();
     void UnloadUnusedAssets();
 
     // Asset queries - what's in the warehouse?
-    Asset* GetAsset(const std::string& name) const;
+    Asset* GetAsset(const std::string& name) const {
+        StringId id = StringInterner::GetInstance().Find(name); // a lookup never interns - typos cost nothing
+        std::lock_guard<std::mutex> lock(assetMutex);
+        return FindLoaded(id, name);
+    }
+    Asset* GetAsset(StringId name) const {
+        std::lock_guard<std::mutex> lock(assetMutex);
+        auto it = loadedAssets.find(name);
+        return it != loadedAssets.end() ? it->second : nullptr;
+    }
     std::vector<std::string> GetAssetNames(AssetType type = AssetType::Custom) const;
     std::vector<Asset*> GetAssetsOfType(AssetType type) const;
 
@@ -205,6 +375,50 @@ public:
     void EnableCaching(bool enable) { cachingEnabled = enable; }
     void ClearCache();
 
+    // Cooked data - the output of an import step (texture compression, mesh optimization...).
+    // With caching on it goes through the DerivedDataCache, keyed by the source bytes, the settings
+    // and the cooker's name and version, so each input is cooked once per machine.
+    using Cooker = std::function<bool(std::span<const std::byte> source, std::vector<std::byte>& cooked)>;
+    bool GetCookedData(const std::string& path, std::string_view cookerName, uint32_t cookerVersion,
+                       std::string_view settings, const Cooker& cook, std::vector<std::byte>& cooked) {
+        FileView view;
+        if (!VirtualFileSystem::GetInstance().Open(path, view)) return false;
+
+        cooked.clear();
+        if (!cachingEnabled) return cook(view.data, cooked);
+
+        DerivedDataKey key = DerivedDataKeyBuilder(cookerName)
+            .Add(static_cast<uint64_t>(cookerVersion))
+            .Add(settings)
+            .Add(view.data)
+            .Finish();
+        return DerivedDataCache::GetInstance().GetOrBuild(key, cooked,
+            [&](std::vector<std::byte>& output) { return cook(view.data, output); });
+    }
+
+    // Content dedup - names whose files hold identical bytes share one resident asset. Loads hash
+    // what they read and skip the parse when a twin is already in; every name keeps its own count
+    // (see UnloadAsset). The report lists what's shared and how many bytes that saves.
+    void EnableDeduplication(bool enable) {
+        {
+            std::lock_guard<std::mutex> lock(assetMutex);
+            deduplicating = enable;
+        }
+        if (!enable) {
+            loadPipeline.SetContentDeduplication(nullptr, nullptr);
+            return;
+        }
+        loadPipeline.SetContentDeduplication(MakeContentProbe(), [this](Asset* loaded) -> Asset* {
+            std::lock_guard<std::mutex> lock(assetMutex);
+            Asset* resident = contentTable.Find(loaded->GetContentKey(), loaded->GetType());
+            if (resident) contentTable.CountDuplicate(loaded->GetContentKey().size);
+            return resident;
+        });
+    }
+    bool IsDeduplicationEnabled() const { return deduplicating; }
+    int GetAliasRefCount(const std::string& name) const { return contentTable.GetAliasRefCount(name); }
+    AssetContentTable::Report GetDuplicateReport(size_t maxDuplicates = 32) const { return contentTable.GetReport(maxDuplicates); }
+
     // Hot reloading - update assets when files change
     void EnableHotReloading(bool enable) { hotReloadingEnabled = enable; }
     void CheckForChanges();
@@ -226,9 +440,15 @@ private:
     AssetManager& operator=(const AssetManager&) = delete;
 
     // Asset storage
-    std::unordered_map<std::string, Asset*> loadedAssets;
+    std::unordered_map<StringId, Asset*> loadedAssets; // by interned name
+    std::unordered_map<std::string, Asset*> collidingAssets; // names whose hash another name took - by text
     std::unordered_map<AssetType, std::function<Asset*()>> assetFactories;
-    std::vector<LoadRequest> asyncLoadQueue;
+    AssetLoadPipeline loadPipeline;
+    AssetGraph assetGraph{ *this };
+    double asyncLoadBudget = 2.0; // milliseconds of finalizing per frame
+    AssetContentTable contentTable;
+    bool deduplicating = false;
+    std::vector<Asset*> retiredAssets; // async loads that lost to a sync load of the same name
 
     // Settings
     std::string assetRootPath;
@@ -241,12 +461,76 @@ private:
     std::unordered_map<AssetType, std::vector<std::function<void(Asset*)>>> assetProcessors;
 
     // Threading
-    std::mutex assetMutex;
+    mutable std::mutex assetMutex;
+
+    // Load through the VFS when the asset can parse from memory (packs included), the old-fashioned way otherwise
+    static bool LoadAssetData(Asset* asset, const std::string& path, const AssetContentProbe& skipIfResident = nullptr,
+                              bool* skipped = nullptr) {
+        return AssetLoadPipeline::LoadAssetData(asset, path, nullptr, skipIfResident, skipped);
+    }
+
+    // Dedup helpers - the probe runs on workers, so it only touches the table (which has its own lock)
+    AssetContentProbe MakeContentProbe() {
+        return [this](const AssetContentKey& key, AssetType type) { return contentTable.Contains(key, type); };
+    }
+
+    // Store a freshly loaded (or shared) asset under name (interned as id) and return what name now
+    // holds - assetMutex held. A name that's already in keeps its asset and counts one more load; a
+    // different asset for it (a sync load won the race) is retired, not deleted, because every
+    // request that joined the same async load is handed the same pointer.
+    Asset* Adopt(StringId id, const std::string& name, Asset* asset) {
+        auto store = [asset](auto& assets, const auto& key) {
+            auto [it, inserted] = assets.try_emplace(key, asset);
+            return std::make_pair(it->second, inserted);
+        };
+        auto [resident, inserted] = id.IsValid() ? store(loadedAssets, id) : store(collidingAssets, name);
+        if (!inserted) {
+            if (resident != asset && std::find(retiredAssets.begin(), retiredAssets.end(), asset) == retiredAssets.end()) {
+                retiredAssets.push_back(asset);
+            }
+            contentTable.AddRef(name);
+            return resident;
+        }
+        if (!deduplicating || !asset->GetContentKey().IsValid()) return asset;
+
+        Asset* twin = contentTable.Find(asset->GetContentKey(), asset->GetType());
+        if (twin == asset) contentTable.AddAlias(asset, name);
+        else if (!twin) contentTable.Add(asset, name);
+        // else an identical copy raced in from another thread - it stays untracked and unloads on its own
+        return asset;
+    }
+
+    // The asset loaded under name (interned as id), or null - assetMutex held. A name that collided
+    // has the invalid ID and lives in collidingAssets instead.
+    Asset* FindLoaded(StringId id, const std::string& name) const {
+        if (id.IsValid()) {
+            auto it = loadedAssets.find(id);
+            return it != loadedAssets.end() ? it->second : nullptr;
+        }
+        auto it = collidingAssets.find(name);
+        return it != collidingAssets.end() ? it->second : nullptr;
+    }
+    void EraseLoaded(StringId id, const std::string& name) {
+        if (id.IsValid()) loadedAssets.erase(id);
+        else collidingAssets.erase(name);
+    }
+
+    // Once the pipeline has finished handing them out
+    void DeleteRetiredAssets() {
+        std::vector<Asset*> retired;
+        {
+            std::lock_guard<std::mutex> lock(assetMutex);
+            retired.swap(retiredAssets);
+        }
+        for (Asset* asset : retired) {
+            asset->Unload();
+            delete asset;
+        }
+    }
 
     // Internal helpers
     std::string GetFileExtension(const std::string& filename) const;
     AssetType GetAssetTypeFromExtension(const std::string& extension) const;
-    void ProcessAsyncLoadQueue();
     void EvictLRUAssets();
 };
 
@@ -0,0 +1,251 @@
+// AssetPrefetcher.cpp - Implementation of the fortune teller
+// Straight lines and a bit of smoothing - good enough at vehicle speeds, and cheap enough to do every frame
+
+#include "AssetPrefetcher.h"
+#include "World/FloatingOrigin.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr float MinimumSpeed = 0.01f;    // below this, a source is standing still
+    constexpr size_t MaxPathSamples = 256;    // caps the work for very long windows
+
+    // Every cell a viewer at position could see - where it stands, plus a cone on the ground widened
+    // by each cell's radius, so a cell is in as soon as any of it might be
+    template<typename Visitor>
+    void ForEachViewCell(const PrefetchSettings& settings, const Vector3d& position, const Vector3& viewDirection, Visitor&& visit) {
+        visit(WorldCell::FromPosition(position.x, position.z, settings.cellSize));
+
+        float directionLength = std::sqrt(viewDirection.x * viewDirection.x + viewDirection.z * viewDirection.z);
+        if (directionLength < MinimumSpeed) return;
+        float directionX = viewDirection.x / directionLength;
+        float directionZ = viewDirection.z / directionLength;
+
+        float cellRadius = settings.cellSize * 0.70710678f;
+        float halfAngle = settings.viewAngle * 0.01745329f;
+        float centerOffset = settings.cellSize * 0.5f;
+        ForEachCellInRadius(position.x, position.z, settings.viewDistance, settings.cellSize, [&](const WorldCell& cell) {
+            // Offsets in double first - both sides can be a long way from zero
+            float toX = static_cast<float>(cell.x * static_cast<double>(settings.cellSize) + centerOffset - position.x);
+            float toZ = static_cast<float>(cell.z * static_cast<double>(settings.cellSize) + centerOffset - position.z);
+            float distance = std::sqrt(toX * toX + toZ * toZ);
+            if (distance > cellRadius) {
+                float slack = std::asin(std::min(1.0f, cellRadius / distance));
+                float cosine = (toX * directionX + toZ * directionZ) / distance;
+                if (cosine < std::cos(std::min(halfAngle + slack, 3.14159265f))) return;
+            }
+            visit(cell);
+        });
+    }
+}
+
+AssetPrefetcher::AssetPrefetcher(AssetGraph& graph) : graph(graph), floatingOrigin(nullptr), time(0.0) {
+}
+
+AssetPrefetcher::~AssetPrefetcher() {
+    Clear();
+}
+
+void AssetPrefetcher::SetCellAssets(const WorldCell& cell, std::vector<AssetDependency> assets) {
+    cellAssets[cell] = std::move(assets);
+}
+
+void AssetPrefetcher::AddAsset(const Vector3d& position, const AssetDependency& asset) {
+    cellAssets[GetCell(position)].push_back(asset);
+}
+
+WorldCell AssetPrefetcher::GetCell(const Vector3d& position) const {
+    return WorldCell::FromPosition(position.x, position.z, settings.cellSize);
+}
+
+void AssetPrefetcher::UpdateSource(uint32_t id, const Vector3d& position, const Vector3& viewDirection) {
+    Source& source = sources[id];
+    source.position = position;
+    source.viewDirection = viewDirection;
+    source.explicitVelocity = false;
+    source.moved = true;
+}
+
+void AssetPrefetcher::UpdateSource(uint32_t id, const Vector3d& position, const Vector3& velocity, const Vector3& viewDirection) {
+    Source& source = sources[id];
+    source.position = position;
+    source.velocity = velocity;
+    source.viewDirection = viewDirection;
+    source.explicitVelocity = true;
+    source.moved = true;
+}
+
+void AssetPrefetcher::UpdateCamera(uint32_t id, const Vector3& localPosition, const Vector3& forward) {
+    Vector3d position = floatingOrigin ? floatingOrigin->ToWorld(localPosition) : Vector3d(localPosition);
+    UpdateSource(id, position, forward);
+}
+
+void AssetPrefetcher::RemoveSource(uint32_t id) {
+    sources.erase(id);
+}
+
+void AssetPrefetcher::Update(float deltaTime) {
+    time += deltaTime;
+
+    // Velocities from positions - smoothed, or one jittery frame swings the whole path around
+    for (auto& [id, source] : sources) {
+        if (source.moved && !source.explicitVelocity) {
+            if (source.hasPosition && deltaTime > 0.0f) {
+                Vector3 measured = (source.position - source.lastPosition).ToVector3() / deltaTime;
+                float blend = deltaTime / (settings.velocitySmoothing + deltaTime);
+                source.velocity += (measured - source.velocity) * blend;
+            }
+        }
+        source.lastPosition = source.position;
+        source.hasPosition = true;
+        source.moved = false;
+    }
+
+    std::unordered_map<WorldCell, int, WorldCellHash> wanted;
+    std::unordered_set<WorldCell, WorldCellHash> visible;
+    for (const auto& [id, source] : sources) {
+        Predict(source, wanted);
+        CollectVisible(source, visible);
+    }
+
+    // Notice loads finishing - the lead time is measured from here
+    for (auto& [cell, state] : cells) {
+        if (!state.ready && graph.IsGroupReady(state.group)) {
+            state.ready = true;
+            state.readyTime = time;
+        }
+        state.visible = false;
+    }
+
+    // On screen - count the hit or miss the first time, then make sure it loads before anything speculative
+    for (const WorldCell& cell : visible) {
+        auto it = cells.find(cell);
+        if (it == cells.end()) {
+            std::vector<AssetDependency> contents = GetCellContents(cell);
+            if (contents.empty()) continue;
+            CellState state;
+            state.priority = settings.visiblePriority;
+            state.group = graph.LoadGroup(contents, state.priority, nullptr);
+            it = cells.emplace(cell, state).first;
+        }
+
+        CellState& state = it->second;
+        if (!state.seen) {
+            state.seen = true;
+            if (!state.prefetched) {
+                stats.misses++;
+            } else if (state.ready) {
+                stats.hits++;
+                stats.totalLeadTime += time - state.readyTime;
+            } else {
+                stats.lateHits++;
+            }
+        }
+        if (state.priority != settings.visiblePriority) {
+            state.priority = settings.visiblePriority;
+            graph.SetGroupPriority(state.group, state.priority);
+        }
+        state.visible = true;
+        state.lastWanted = time;
+    }
+
+    // On a path - start loading, or follow the priority as the cell gets nearer (or further)
+    for (const auto& [cell, priority] : wanted) {
+        auto it = cells.find(cell);
+        if (it == cells.end()) {
+            std::vector<AssetDependency> contents = GetCellContents(cell);
+            if (contents.empty()) continue;
+            CellState state;
+            state.priority = priority;
+            state.prefetched = true;
+            state.group = graph.LoadGroup(contents, priority, nullptr);
+            it = cells.emplace(cell, state).first;
+            stats.issued++;
+        }
+
+        CellState& state = it->second;
+        state.lastWanted = time;
+        if (!state.visible && state.priority != priority) {
+            state.priority = priority;
+            graph.SetGroupPriority(state.group, priority);
+        }
+    }
+
+    // Off every path and out of view for a while - the path changed, drop them
+    for (auto it = cells.begin(); it != cells.end();) {
+        CellState& state = it->second;
+        if (state.visible || time - state.lastWanted < settings.cancelDelay) {
+            ++it;
+            continue;
+        }
+        if (!state.seen) {
+            stats.cancelled++;
+            if (state.ready) stats.wasted++;
+        }
+        Release(state);
+        it = cells.erase(it);
+    }
+}
+
+bool AssetPrefetcher::IsCellReady(const WorldCell& cell) const {
+    auto it = cells.find(cell);
+    return it != cells.end() && graph.IsGroupReady(it->second.group);
+}
+
+bool AssetPrefetcher::IsCellVisible(const WorldCell& cell) const {
+    auto it = cells.find(cell);
+    return it != cells.end() && it->second.visible;
+}
+
+void AssetPrefetcher::Clear() {
+    for (auto& [cell, state] : cells) Release(state);
+    cells.clear();
+}
+
+std::vector<AssetDependency> AssetPrefetcher::GetCellContents(const WorldCell& cell) const {
+    auto it = cellAssets.find(cell);
+    if (it != cellAssets.end()) return it->second;
+    return cellProvider ? cellProvider(cell) : std::vector<AssetDependency>();
+}
+
+void AssetPrefetcher::Predict(const Source& source, std::unordered_map<WorldCell, int, WorldCellHash>& wanted) const {
+    auto want = [&wanted](const WorldCell& cell, int priority) {
+        auto [it, inserted] = wanted.emplace(cell, priority);
+        if (!inserted) it->second = std::max(it->second, priority);
+    };
+
+    // Standing still - just the neighbourhood
+    Vector3 velocity(source.velocity.x, 0.0f, source.velocity.z);
+    float speed = velocity.Length();
+    if (speed < MinimumSpeed || settings.lookAheadTime <= 0.0f) {
+        ForEachCellInRadius(source.position.x, source.position.z, settings.pathRadius, settings.cellSize,
+                            [&](const WorldCell& cell) { want(cell, settings.prefetchPriority); });
+        return;
+    }
+
+    // Half a cell between samples, so no cell the path crosses is skipped. At each one we want the
+    // cells around the path and the ones the viewer will see from there, assuming it keeps looking
+    // the same way - those are what would otherwise be misses.
+    float distance = speed * settings.lookAheadTime;
+    size_t samples = std::min(MaxPathSamples, static_cast<size_t>(std::ceil(distance / (settings.cellSize * 0.5f))) + 1);
+    for (size_t i = 0; i <= samples; ++i) {
+        float along = static_cast<float>(i) / static_cast<float>(samples);
+        Vector3d point = source.position + Vector3d(velocity * (settings.lookAheadTime * along));
+
+        // Sooner is more urgent
+        int priority = settings.prefetchPriority +
+                       static_cast<int>(std::lround((settings.farPrefetchPriority - settings.prefetchPriority) * along));
+        auto visit = [&](const WorldCell& cell) { want(cell, priority); };
+        ForEachCellInRadius(point.x, point.z, settings.pathRadius, settings.cellSize, visit);
+        if (i > 0) ForEachViewCell(settings, point, source.viewDirection, visit);
+    }
+}
+
+void AssetPrefetcher::CollectVisible(const Source& source, std::unordered_set<WorldCell, WorldCellHash>& visible) const {
+    ForEachViewCell(settings, source.position, source.viewDirection, [&](const WorldCell& cell) { visible.insert(cell); });
+}
+
+void AssetPrefetcher::Release(CellState& state) {
+    if (state.group != InvalidAssetGroupId) graph.ReleaseGroup(state.group);
+    state.group = InvalidAssetGroupId;
+}
@@ -0,0 +1,138 @@
+// AssetPrefetcher.h - The fortune teller
+// Guesses where the camera is headed and starts loading the cells it'll see before it gets there
+
+#ifndef ASSETPREFETCHER_H
+#define ASSETPREFETCHER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Assets/AssetGraph.h"
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+#include "World/WorldCell.h"
+
+class FloatingOrigin;
+
+// Tuning - the look-ahead window is the one to play with, the stats tell you which way
+struct PrefetchSettings {
+    float cellSize = 64.0f;
+    float lookAheadTime = 4.0f;      // seconds of extrapolated path to prefetch along
+    float pathRadius = 64.0f;        // cells this close to the path are prefetched
+    float viewDistance = 256.0f;     // cells in the view cone and this close count as visible
+    float viewAngle = 60.0f;         // half-angle of the view cone, degrees
+    float cancelDelay = 0.5f;        // how long a cell has to be off the path before its loads are dropped
+    float velocitySmoothing = 0.2f;  // seconds - smooths the velocity worked out from positions
+    int prefetchPriority = -1;       // the most urgent prefetch, for cells we're about to reach
+    int farPrefetchPriority = -100;  // the least urgent, for cells at the end of the window
+    int visiblePriority = 50;        // cells on screen - below CriticalLoadPriority, above normal loads
+};
+
+// Hit-rate metrics - counted when a cell first becomes visible
+struct PrefetchStats {
+    uint64_t hits = 0;          // prefetched and fully loaded in time
+    uint64_t lateHits = 0;      // prefetched but still loading - promoted, needs a longer window
+    uint64_t misses = 0;        // never predicted - loaded on demand
+    uint64_t issued = 0;        // cells prefetched
+    uint64_t cancelled = 0;     // dropped because the path changed
+    uint64_t wasted = 0;        // cancelled after they'd fully loaded - the window's too long
+    double totalLeadTime = 0.0; // seconds between loaded and visible, summed over hits
+
+    double GetHitRate() const {
+        uint64_t seen = hits + lateHits + misses;
+        return seen ? static_cast<double>(hits) / static_cast<double>(seen) : 0.0;
+    }
+    double GetAverageLeadTime() const { return hits ? totalLeadTime / static_cast<double>(hits) : 0.0; }
+};
+
+// The AssetPrefetcher class - loads cells along where things are going, promotes what comes into
+// view and drops what the path turned away from. Main thread only; call Update once per frame.
+class AssetPrefetcher {
+public:
+    explicit AssetPrefetcher(AssetGraph& graph);
+    ~AssetPrefetcher(); // releases every group it still holds
+
+    void SetSettings(const PrefetchSettings& newSettings) { settings = newSettings; }
+    const PrefetchSettings& GetSettings() const { return settings; }
+
+    // Cell contents - what has to be loaded to show a cell. Registered up front or asked for on
+    // demand; a provider is asked only for cells nothing was registered for.
+    using CellProvider = std::function<std::vector<AssetDependency>(const WorldCell& cell)>;
+    void SetCellAssets(const WorldCell& cell, std::vector<AssetDependency> assets);
+    void AddAsset(const Vector3d& position, const AssetDependency& asset);
+    void SetCellProvider(CellProvider provider) { cellProvider = std::move(provider); }
+    WorldCell GetCell(const Vector3d& position) const;
+
+    // Motion sources - the camera, the player, the car, in world space. Give a velocity if you know it,
+    // otherwise it's worked out from how the position moves. Only sources with a view direction make
+    // cells visible; the rest just pull their path in.
+    void UpdateSource(uint32_t id, const Vector3d& position, const Vector3& viewDirection = Vector3(0.0f));
+    void UpdateSource(uint32_t id, const Vector3d& position, const Vector3& velocity, const Vector3& viewDirection);
+    // A camera - Camera::GetPosition and GetForward. The position is local; with a floating origin
+    // it's taken through this to world space
+    void UpdateCamera(uint32_t id, const Vector3& localPosition, const Vector3& forward);
+    void SetFloatingOrigin(const FloatingOrigin* origin) { floatingOrigin = origin; }
+    void RemoveSource(uint32_t id);
+
+    // Per frame - extrapolates the paths, then issues, promotes and cancels loads
+    void Update(float deltaTime);
+
+    // Queries
+    bool IsCellRequested(const WorldCell& cell) const { return cells.count(cell) != 0; }
+    bool IsCellReady(const WorldCell& cell) const;
+    bool IsCellVisible(const WorldCell& cell) const;
+    size_t GetRequestedCellCount() const { return cells.size(); }
+
+    // Metrics
+    const PrefetchStats& GetStats() const { return stats; }
+    void ResetStats() { stats = PrefetchStats(); }
+
+    // Drop every load we started
+    void Clear();
+
+private:
+    // Prevent copying - it holds groups
+    AssetPrefetcher(const AssetPrefetcher&) = delete;
+    AssetPrefetcher& operator=(const AssetPrefetcher&) = delete;
+
+    struct Source {
+        Vector3d position;
+        Vector3 velocity;
+        Vector3 viewDirection;
+        bool explicitVelocity = false;
+        bool hasPosition = false;
+        bool moved = false; // a new position came in since the last Update
+        Vector3d lastPosition;
+    };
+
+    struct CellState {
+        AssetGroupId group = InvalidAssetGroupId;
+        int priority = 0;
+        bool visible = false;
+        bool seen = false;      // has been visible at least once - counted in the stats
+        bool prefetched = false;// asked for before it was visible
+        bool ready = false;
+        double readyTime = 0.0;
+        double lastWanted = 0.0;// the last time it was on a path or in view
+    };
+
+    std::vector<AssetDependency> GetCellContents(const WorldCell& cell) const;
+    void Predict(const Source& source, std::unordered_map<WorldCell, int, WorldCellHash>& wanted) const;
+    void CollectVisible(const Source& source, std::unordered_set<WorldCell, WorldCellHash>& visible) const;
+    void Release(CellState& state);
+
+    AssetGraph& graph;
+    PrefetchSettings settings;
+    PrefetchStats stats;
+    CellProvider cellProvider;
+    std::unordered_map<WorldCell, std::vector<AssetDependency>, WorldCellHash> cellAssets;
+    std::unordered_map<uint32_t, Source> sources;
+    std::unordered_map<WorldCell, CellState, WorldCellHash> cells;
+    const FloatingOrigin* floatingOrigin;
+    double time;
+};
+
+#endif // ASSETPREFETCHER_H
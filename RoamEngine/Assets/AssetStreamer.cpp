@@ -0,0 +1,329 @@
+// AssetStreamer.cpp - Implementation of the drip feed
+// One level at a time per asset, biggest on screen first, and the finest levels are always the first to go
+
+#include "AssetStreamer.h"
+#include "Math/VirtualFileSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    constexpr size_t IndexAlignment = 16; // mesh levels keep their indices this aligned, like the cooked file
+
+    // How big a sphere is on screen - its radius in pixels
+    float GetScreenRadius(const StreamingView& view, float viewportHeight, const Vector3& center, float radius) {
+        if (view.orthographic) {
+            return radius / std::max(view.orthoSize, 0.0001f) * viewportHeight * 0.5f;
+        }
+
+        float distance = (center - view.position).Length();
+        if (distance <= radius) return viewportHeight; // we're inside it - as big as it gets
+        float halfFov = std::tan(view.fieldOfView * 0.5f * 0.01745329f);
+        return radius / (distance * std::max(halfFov, 0.0001f)) * viewportHeight * 0.5f;
+    }
+}
+
+AssetStreamer::AssetStreamer()
+    : jobSystem(nullptr), nextId(1), residentBytes(0), inFlightBytes(0), inFlight(0), time(0.0) {
+}
+
+AssetStreamer::~AssetStreamer() {
+    if (jobSystem) jobSystem->Wait(outstanding);
+}
+
+StreamingId AssetStreamer::AddTexture(const std::string& path) {
+    FileView view;
+    if (!VirtualFileSystem::GetInstance().Open(path, view)) return InvalidStreamingId;
+    const CookedTexture* texture = GetCooked<CookedTexture>(view.data);
+    if (!texture || texture->mips.empty()) return InvalidStreamingId;
+    return Add(std::move(view), texture, nullptr);
+}
+
+StreamingId AssetStreamer::AddMesh(const std::string& path) {
+    FileView view;
+    if (!VirtualFileSystem::GetInstance().Open(path, view)) return InvalidStreamingId;
+    const CookedMesh* mesh = GetCooked<CookedMesh>(view.data);
+    if (!mesh) return InvalidStreamingId;
+    return Add(std::move(view), nullptr, mesh);
+}
+
+StreamingId AssetStreamer::Add(FileView view, const CookedTexture* texture, const CookedMesh* mesh) {
+    Entry entry;
+    entry.view = std::move(view);
+    entry.texture = texture;
+    entry.mesh = mesh;
+
+    if (texture) {
+        for (const CookedMip& mip : texture->mips) {
+            Level level;
+            level.source[0] = mip.pixels.AsSpan();
+            level.size = level.source[0].size();
+            entry.levels.push_back(std::move(level));
+        }
+    } else {
+        auto addLevel = [&entry](const CookedArray<std::byte>& vertices, const CookedArray<std::byte>& indices, float error) {
+            Level level;
+            level.source[0] = vertices.AsSpan();
+            level.source[1] = indices.AsSpan();
+            level.error = error;
+            level.size = GetIndexOffset(level) + level.source[1].size();
+            entry.levels.push_back(std::move(level));
+        };
+        addLevel(mesh->vertices, mesh->indices, 0.0f);
+        for (const CookedMeshLod& lod : mesh->lods) addLevel(lod.vertices, lod.indices, lod.error);
+    }
+
+    // Nothing resident and nothing wanted beyond the coarsest yet - the first Update streams that in
+    entry.residentLevel = static_cast<uint32_t>(entry.levels.size());
+    entry.wantedLevel = entry.GetCoarsest();
+
+    StreamingId id = nextId++;
+    entries.emplace(id, std::move(entry));
+    return id;
+}
+
+void AssetStreamer::Remove(StreamingId id) {
+    auto it = entries.find(id);
+    if (it == entries.end()) return;
+    for (const Level& level : it->second.levels) residentBytes -= level.data.size();
+    entries.erase(it); // a copy still in flight is dropped when it finishes
+}
+
+void AssetStreamer::Touch(StreamingId id, const Vector3& center, float radius) {
+    auto it = entries.find(id);
+    if (it != entries.end()) it->second.touches.emplace_back(center, radius);
+}
+
+void AssetStreamer::Update(const StreamingView& view, float deltaTime) {
+    time += deltaTime;
+    Publish();
+
+    // What each asset wants, from how big it was on screen this frame
+    for (auto& [id, entry] : entries) {
+        entry.screenRadius = 0.0f;
+        entry.pixelsPerUnit = 0.0f;
+        for (const auto& [center, radius] : entry.touches) {
+            float screenRadius = GetScreenRadius(view, settings.viewportHeight, center, radius);
+            entry.screenRadius = std::max(entry.screenRadius, screenRadius);
+            if (radius > 0.0f) entry.pixelsPerUnit = std::max(entry.pixelsPerUnit, screenRadius / radius);
+        }
+        entry.touches.clear();
+        entry.wantedLevel = PickLevel(entry);
+
+        if (entry.residentLevel >= entry.wantedLevel) {
+            entry.surplusSince = -1.0;
+        } else if (entry.surplusSince < 0.0) {
+            entry.surplusSince = time;
+        }
+    }
+
+    // Finer than wanted for long enough - a glance back shouldn't cost a reload, so they get a grace period
+    for (auto& [id, entry] : entries) {
+        if (entry.surplusSince < 0.0 || time - entry.surplusSince < settings.evictDelay) continue;
+        while (entry.residentLevel < entry.wantedLevel) EvictFinest(entry);
+        entry.surplusSince = -1.0;
+    }
+
+    // Over budget (the budget shrank, or coarsest levels pushed us over) - the cheapest levels go now
+    while (residentBytes > settings.memoryBudget && EvictCheapest(std::numeric_limits<float>::max(), nullptr)) {
+    }
+
+    // Stream in - assets with nothing to show first, then the biggest on screen
+    std::vector<std::pair<StreamingId, Entry*>> candidates;
+    for (auto& [id, entry] : entries) {
+        if (!entry.streaming && entry.residentLevel > entry.wantedLevel) candidates.emplace_back(id, &entry);
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        bool aEmpty = a.second->residentLevel == a.second->levels.size();
+        bool bEmpty = b.second->residentLevel == b.second->levels.size();
+        if (aEmpty != bEmpty) return aEmpty;
+        return a.second->screenRadius > b.second->screenRadius;
+    });
+
+    for (auto& [id, entry] : candidates) {
+        if (inFlight >= settings.maxInFlight) break;
+
+        // The coarsest level is the floor everything falls back to, so it never waits for room.
+        // Anything finer has to fit, if need be by evicting levels that matter less.
+        uint32_t level = entry->residentLevel - 1;
+        if (level != entry->GetCoarsest()) {
+            size_t needed = entry->levels[level].size;
+            while (residentBytes + inFlightBytes + needed > settings.memoryBudget &&
+                   EvictCheapest(entry->screenRadius, entry)) {
+            }
+            if (residentBytes + inFlightBytes + needed > settings.memoryBudget) {
+                stats.budgetStalls++;
+                continue;
+            }
+        }
+        Issue(id, *entry);
+    }
+
+    // Copies done inline (or quick ones on workers) show up this frame rather than the next
+    Publish();
+}
+
+bool AssetStreamer::GetTexture(StreamingId id, StreamedTextureLevel& level) const {
+    auto it = entries.find(id);
+    if (it == entries.end() || !it->second.texture) return false;
+    const Entry& entry = it->second;
+    if (entry.residentLevel >= entry.levels.size()) return false;
+
+    const CookedMip& mip = entry.texture->mips[entry.residentLevel];
+    level.mip = entry.residentLevel;
+    level.mipCount = static_cast<uint32_t>(entry.levels.size());
+    level.width = mip.width;
+    level.height = mip.height;
+    level.format = entry.texture->format;
+    level.pixels = entry.levels[entry.residentLevel].data;
+    return true;
+}
+
+bool AssetStreamer::GetMesh(StreamingId id, StreamedMeshLevel& level) const {
+    auto it = entries.find(id);
+    if (it == entries.end() || !it->second.mesh) return false;
+    const Entry& entry = it->second;
+    if (entry.residentLevel >= entry.levels.size()) return false;
+
+    const CookedMesh* mesh = entry.mesh;
+    const Level& resident = entry.levels[entry.residentLevel];
+    level.lod = entry.residentLevel;
+    level.lodCount = static_cast<uint32_t>(entry.levels.size());
+    level.vertexStride = mesh->vertexStride;
+    level.attributes = mesh->attributes;
+    level.indexSize = mesh->indexSize;
+    if (entry.residentLevel == 0) {
+        level.vertexCount = mesh->vertexCount;
+        level.indexCount = mesh->indexCount;
+        level.submeshes = mesh->submeshes.AsSpan();
+    } else {
+        const CookedMeshLod& lod = mesh->lods[entry.residentLevel - 1];
+        level.vertexCount = lod.vertexCount;
+        level.indexCount = lod.indexCount;
+        level.submeshes = lod.submeshes.AsSpan();
+    }
+
+    std::span<const std::byte> data = resident.data;
+    level.vertices = data.subspan(0, resident.source[0].size());
+    level.indices = data.subspan(GetIndexOffset(resident), resident.source[1].size());
+    return true;
+}
+
+uint32_t AssetStreamer::GetLevelCount(StreamingId id) const {
+    auto it = entries.find(id);
+    return it != entries.end() ? static_cast<uint32_t>(it->second.levels.size()) : 0;
+}
+
+uint32_t AssetStreamer::GetResidentLevel(StreamingId id) const {
+    auto it = entries.find(id);
+    return it != entries.end() ? it->second.residentLevel : 0;
+}
+
+uint32_t AssetStreamer::GetWantedLevel(StreamingId id) const {
+    auto it = entries.find(id);
+    return it != entries.end() ? it->second.wantedLevel : 0;
+}
+
+uint32_t AssetStreamer::PickLevel(const Entry& entry) const {
+    uint32_t coarsest = entry.GetCoarsest();
+    if (entry.screenRadius <= 0.0f) return coarsest;
+
+    float level;
+    if (entry.texture) {
+        // The mip whose size matches the pixels it covers
+        float texels = static_cast<float>(std::max(entry.texture->width, entry.texture->height));
+        float pixels = std::max(entry.screenRadius * 2.0f * settings.texelsPerPixel, 1.0f);
+        level = std::floor(std::log2(std::max(texels / pixels, 1.0f)) + settings.lodBias);
+    } else {
+        // The coarsest LOD whose error still hides inside a pixel or so
+        uint32_t lod = 0;
+        while (lod < coarsest && entry.levels[lod + 1].error * entry.pixelsPerUnit <= settings.maxPixelError) lod++;
+        level = static_cast<float>(lod) + std::round(settings.lodBias);
+    }
+    return static_cast<uint32_t>(std::clamp(level, 0.0f, static_cast<float>(coarsest)));
+}
+
+void AssetStreamer::Issue(StreamingId id, Entry& entry) {
+    uint32_t level = entry.residentLevel - 1;
+    const Level& source = entry.levels[level];
+    entry.streaming = true;
+    inFlight++;
+    inFlightBytes += source.size;
+
+    // Reading the mapped pages is the actual disk I/O, so it happens here rather than on the main thread.
+    // The view goes along so the mapping outlives an asset removed mid-copy.
+    auto copy = [this, id, level, view = entry.view, first = source.source[0], second = source.source[1],
+                 indexOffset = GetIndexOffset(source), size = source.size]() {
+        Finished done{ id, level, std::vector<std::byte>(size) };
+        if (!first.empty()) std::memcpy(done.data.data(), first.data(), first.size());
+        if (!second.empty()) std::memcpy(done.data.data() + indexOffset, second.data(), second.size());
+
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished.push_back(std::move(done));
+    };
+
+    if (jobSystem && jobSystem->IsInitialized()) {
+        jobSystem->Submit(std::move(copy), JobPriority::Low, &outstanding);
+    } else {
+        copy();
+    }
+}
+
+void AssetStreamer::Publish() {
+    std::vector<Finished> done;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        done.swap(finished);
+    }
+
+    for (Finished& copy : done) {
+        inFlight--;
+        inFlightBytes -= copy.data.size();
+
+        auto it = entries.find(copy.id);
+        if (it == entries.end()) continue; // removed while it was copying
+        Entry& entry = it->second;
+        entry.streaming = false;
+        if (copy.level + 1 != entry.residentLevel) continue; // the level below it was evicted meanwhile
+
+        stats.levelsStreamed++;
+        stats.bytesStreamed += copy.data.size();
+        residentBytes += copy.data.size();
+        entry.levels[copy.level].data = std::move(copy.data);
+        entry.residentLevel = copy.level;
+    }
+}
+
+void AssetStreamer::EvictFinest(Entry& entry) {
+    if (entry.residentLevel >= entry.GetCoarsest()) return; // the coarsest stays
+    Level& level = entry.levels[entry.residentLevel];
+    stats.levelsEvicted++;
+    stats.bytesEvicted += level.data.size();
+    residentBytes -= level.data.size();
+    level.data = std::vector<std::byte>();
+    entry.residentLevel++;
+}
+
+bool AssetStreamer::EvictCheapest(float belowRadius, const Entry* keep) {
+    // Levels nobody wants go first, then those of whatever is smallest on screen - and for an asset,
+    // always its finest level. Only assets smaller on screen than belowRadius are fair game.
+    Entry* victim = nullptr;
+    float victimValue = 0.0f;
+    for (auto& [id, entry] : entries) {
+        if (&entry == keep || entry.residentLevel >= entry.GetCoarsest()) continue;
+        float value = entry.residentLevel < entry.wantedLevel ? -1.0f : entry.screenRadius;
+        if (value >= belowRadius) continue;
+        if (!victim || value < victimValue || (value == victimValue && entry.residentLevel < victim->residentLevel)) {
+            victim = &entry;
+            victimValue = value;
+        }
+    }
+    if (!victim) return false;
+    EvictFinest(*victim);
+    return true;
+}
+
+size_t AssetStreamer::GetIndexOffset(const Level& level) {
+    return (level.source[0].size() + IndexAlignment - 1) & ~(IndexAlignment - 1);
+}
@@ -0,0 +1,174 @@
+// AssetStreamer.h - The drip feed
+// Textures and meshes show up blurry and blocky straight away, then sharpen as they get bigger on screen
+
+#ifndef ASSETSTREAMER_H
+#define ASSETSTREAMER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Assets/CookedFormats.h"
+#include "Core/ThreadManager.h"
+#include "Math/FileSystem.h"
+#include "Math/Vector3.h"
+
+using StreamingId = uint32_t;
+constexpr StreamingId InvalidStreamingId = 0;
+
+// The bits of the camera screen sizes are worked out from - Camera::GetPosition, GetFieldOfView, and
+// GetOrthoSize when GetType() is Orthographic
+struct StreamingView {
+    Vector3 position;
+    float fieldOfView = 60.0f;  // degrees, vertical
+    float orthoSize = 5.0f;     // half the view's height in world units
+    bool orthographic = false;
+};
+
+// Tuning - the budget is the one that matters, the rest trade sharpness for memory
+struct StreamingSettings {
+    size_t memoryBudget = 256ull * 1024 * 1024; // bytes of resident levels - coarsest levels load even past it
+    float viewportHeight = 1080.0f;  // pixels - screen sizes are worked out against this
+    float texelsPerPixel = 1.0f;     // textures - the mip giving about this many texels per screen pixel is wanted
+    float maxPixelError = 1.0f;      // meshes - the coarsest LOD whose error stays under this many pixels is wanted
+    float lodBias = 0.0f;            // levels added to every pick - positive is blurrier and cheaper
+    float evictDelay = 2.0f;         // seconds a level goes unwanted before it's dropped (no wait when over budget)
+    uint32_t maxInFlight = 8;        // level copies running at once
+};
+
+struct StreamingStats {
+    uint64_t levelsStreamed = 0;
+    uint64_t levelsEvicted = 0;
+    uint64_t bytesStreamed = 0;
+    uint64_t bytesEvicted = 0;
+    uint64_t budgetStalls = 0; // times a wanted level didn't fit the budget - raise it, or the bias
+};
+
+// What the renderer gets - the best level resident right now. The spans stay valid until the next Update.
+struct StreamedTextureLevel {
+    uint32_t mip = 0;        // 0 is full size
+    uint32_t mipCount = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    CookedPixelFormat format = CookedPixelFormat::RGBA8;
+    std::span<const std::byte> pixels;
+};
+
+struct StreamedMeshLevel {
+    uint32_t lod = 0;        // 0 is full detail
+    uint32_t lodCount = 0;
+    uint32_t vertexCount = 0;
+    uint32_t indexCount = 0;
+    uint32_t vertexStride = 0;
+    uint32_t attributes = 0; // CookedVertexAttributes bits
+    uint32_t indexSize = 0;
+    std::span<const std::byte> vertices;
+    std::span<const std::byte> indices;
+    std::span<const CookedSubmesh> submeshes;
+};
+
+// The AssetStreamer class - keeps each cooked texture and mesh at the level its screen size calls for.
+// Levels count from 0 (finest); an asset always holds an unbroken run from its finest resident level
+// down to the coarsest, so there's always something to fall back to. Copies run on the job system,
+// everything else is main thread only.
+class AssetStreamer {
+public:
+    AssetStreamer();
+    ~AssetStreamer(); // waits for the copies still running
+
+    // Job system - levels are copied in on workers when there are any, inside Update otherwise
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    void SetSettings(const StreamingSettings& newSettings) { settings = newSettings; }
+    const StreamingSettings& GetSettings() const { return settings; }
+
+    // Cooked files (.rtex, .rmesh) through the VFS - packs work too. The file is mapped, not read;
+    // the coarsest level is the first thing streamed. InvalidStreamingId if it isn't one.
+    StreamingId AddTexture(const std::string& path);
+    StreamingId AddMesh(const std::string& path);
+    void Remove(StreamingId id);
+
+    // Drawn this frame with these world-space bounds - once per instance, the biggest on screen wins.
+    // Anything not touched in a frame drifts back down to its coarsest level.
+    void Touch(StreamingId id, const Vector3& center, float radius);
+
+    // Per frame - picks levels from the touches, evicts what isn't wanted and starts copying what is
+    void Update(const StreamingView& view, float deltaTime);
+
+    // The best resident level - false until the coarsest one has arrived
+    bool GetTexture(StreamingId id, StreamedTextureLevel& level) const;
+    bool GetMesh(StreamingId id, StreamedMeshLevel& level) const;
+
+    // Queries
+    uint32_t GetLevelCount(StreamingId id) const;
+    uint32_t GetResidentLevel(StreamingId id) const; // GetLevelCount while nothing is resident
+    uint32_t GetWantedLevel(StreamingId id) const;
+    size_t GetResidentBytes() const { return residentBytes; }
+    size_t GetStreamingCount() const { return inFlight; }
+    size_t GetAssetCount() const { return entries.size(); }
+
+    // Metrics
+    const StreamingStats& GetStats() const { return stats; }
+    void ResetStats() { stats = StreamingStats(); }
+
+private:
+    // Prevent copying - jobs point back at us
+    AssetStreamer(const AssetStreamer&) = delete;
+    AssetStreamer& operator=(const AssetStreamer&) = delete;
+
+    struct Level {
+        std::span<const std::byte> source[2]; // in the mapped file - the pixels, or the vertices and indices
+        size_t size = 0;                      // resident bytes
+        float error = 0.0f;                   // meshes - world units
+        std::vector<std::byte> data;          // the resident copy, empty while it isn't
+    };
+
+    struct Entry {
+        const CookedTexture* texture = nullptr; // one of these two
+        const CookedMesh* mesh = nullptr;
+        FileView view;                          // keeps the mapping alive
+        std::vector<Level> levels;
+        uint32_t residentLevel = 0;
+        uint32_t wantedLevel = 0;
+        bool streaming = false;                 // a copy is in flight
+        float screenRadius = 0.0f;              // pixels, the largest of this frame's touches
+        float pixelsPerUnit = 0.0f;             // likewise, for mesh errors
+        double surplusSince = -1.0;             // when it started holding finer levels than it wants
+        std::vector<std::pair<Vector3, float>> touches;
+
+        uint32_t GetCoarsest() const { return static_cast<uint32_t>(levels.size()) - 1; }
+    };
+
+    struct Finished {
+        StreamingId id;
+        uint32_t level;
+        std::vector<std::byte> data;
+    };
+
+    StreamingId Add(FileView view, const CookedTexture* texture, const CookedMesh* mesh);
+    uint32_t PickLevel(const Entry& entry) const;
+    void Issue(StreamingId id, Entry& entry);
+    void Publish();
+    void EvictFinest(Entry& entry);
+    bool EvictCheapest(float belowRadius, const Entry* keep);
+    static size_t GetIndexOffset(const Level& level);
+
+    ThreadManager* jobSystem;
+    StreamingSettings settings;
+    StreamingStats stats;
+    std::unordered_map<StreamingId, Entry> entries;
+    StreamingId nextId;
+    size_t residentBytes;
+    size_t inFlightBytes;
+    uint32_t inFlight;
+    double time;
+
+    std::mutex finishedMutex;
+    std::vector<Finished> finished; // copies done on workers, published in Update
+    JobCounter outstanding;
+};
+
+#endif // ASSETSTREAMER_H
@@ -0,0 +1,79 @@
+// CookedAsset.h - The microwave
+// Loads a cooked blob by mapping it - no parse, no copy, the asset is just a checked pointer into the file
+
+#ifndef COOKEDASSET_H
+#define COOKEDASSET_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Assets/AssetManager.h"
+#include "Assets/CookedFormats.h"
+#include "Math/FileSystem.h"
+
+// The CookedAsset class - one template for every cooked kind, works from loose files and packs alike
+template<typename TBlob, AssetType Type>
+class CookedAsset : public Asset {
+public:
+    explicit CookedAsset(const std::string& name = std::string()) : Asset(Type, name), blob(nullptr) {}
+
+    bool LoadFromFile(const std::string& path) override {
+        std::shared_ptr<MappedFile> mapping = FileSystem::MapFile(path);
+        if (!mapping) return false;
+
+        FileView mapped;
+        mapped.data = mapping->GetData();
+        mapped.mapping = mapping;
+        if (!LoadFromView(mapped)) return false;
+        filePath = path;
+        return true;
+    }
+
+    // Cooked data is read-only - write the blob back out as it is
+    bool SaveToFile(const std::string& path) override {
+        if (!blob) return false;
+        const char* bytes = reinterpret_cast<const char*>(view.data.data());
+        return FileSystem::WriteBinaryFile(path, std::vector<char>(bytes, bytes + view.data.size()));
+    }
+
+    void Unload() override {
+        blob = nullptr;
+        view = FileView();
+    }
+
+    bool SupportsMappedLoading() const override { return true; }
+
+    bool LoadFromMappedFile(std::shared_ptr<const MappedFile> mapping) override {
+        if (!mapping) return false;
+        FileView mapped;
+        mapped.data = mapping->GetData();
+        mapped.mapping = std::move(mapping);
+        return LoadFromView(mapped);
+    }
+
+    // Pack entries are fine too - the blob only has to be aligned, and packs align their entries
+    bool LoadFromView(const FileView& source) override {
+        const TBlob* cooked = GetCooked<TBlob>(source.data);
+        if (!cooked) return false;
+        view = source; // keeps the mapping (or the decoded copy) alive as long as we point into it
+        blob = cooked;
+        return true;
+    }
+
+    // The blob itself - nullptr until loaded
+    const TBlob* Get() const { return blob; }
+    const TBlob* operator->() const { return blob; }
+    uint64_t GetSourceHash() const { return blob ? blob->header.sourceHash : 0; }
+
+private:
+    FileView view;
+    const TBlob* blob;
+};
+
+using CookedMeshAsset = CookedAsset<CookedMesh, AssetType::Mesh>;
+using CookedTextureAsset = CookedAsset<CookedTexture, AssetType::Texture>;
+using CookedAnimationAsset = CookedAsset<CookedAnimation, AssetType::Animation>;
+using CookedAudioAsset = CookedAsset<CookedAudio, AssetType::Audio>;
+using CookedConfigAsset = CookedAsset<CookedConfig, AssetType::Custom>;
+
+#endif // COOKEDASSET_H
@@ -0,0 +1,322 @@
+// CookedFormats.h - The ready meals
+// What the cooker leaves on disk - map the file, cast the pointer, eat. No parsing, no fix-ups.
+
+#ifndef COOKEDFORMATS_H
+#define COOKEDFORMATS_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+// The blobs are the in-memory layout, so they're only portable between little-endian machines
+static_assert(std::endian::native == std::endian::little, "Cooked assets are little-endian");
+
+constexpr uint32_t CookedMagic = 0x4B434F52; // "ROCK"
+
+enum class CookedKind : uint32_t {
+    Mesh = 1,
+    Texture = 2,
+    Animation = 3,
+    Audio = 4,
+    Config = 5
+};
+
+// Every blob starts with this - kind and version say which layout follows
+struct CookedHeader {
+    uint32_t magic;
+    CookedKind kind;
+    uint32_t version;    // layout version - a mismatch means re-cook, nothing is converted at runtime
+    uint32_t reserved;
+    uint64_t size;       // whole blob, header included
+    uint64_t sourceHash; // content hash of what it was cooked from
+};
+static_assert(sizeof(CookedHeader) == 32, "CookedHeader layout changed");
+
+// Array stand-in for a pointer - the offset counts from the field itself, so a blob works at
+// whatever address it's mapped to
+template<typename T>
+struct CookedArray {
+    int64_t offset;
+    uint64_t count;
+
+    const T* data() const {
+        return count ? reinterpret_cast<const T*>(reinterpret_cast<const std::byte*>(this) + offset) : nullptr;
+    }
+    size_t size() const { return static_cast<size_t>(count); }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t index) const { return data()[index]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+    std::span<const T> AsSpan() const { return std::span<const T>(data(), size()); }
+
+    // Bounds and alignment against the blob it came from - cheap, it never looks at the elements
+    bool IsValid(const std::byte* blob, size_t blobSize) const {
+        if (count == 0) return true;
+        const std::byte* self = reinterpret_cast<const std::byte*>(this);
+        int64_t position = (self - blob) + offset;
+        if (position < 0 || static_cast<uint64_t>(position) > blobSize) return false;
+        if (count > (blobSize - static_cast<uint64_t>(position)) / sizeof(T)) return false;
+        return reinterpret_cast<uintptr_t>(blob + position) % alignof(T) == 0;
+    }
+};
+
+struct CookedString : CookedArray<char> {
+    std::string_view View() const { return std::string_view(data(), size()); }
+};
+
+// Meshes - interleaved vertices in the order of the attribute bits, then the index buffer
+enum CookedVertexAttributes : uint32_t {
+    CookedVertexPosition = 1 << 0, // float3
+    CookedVertexNormal = 1 << 1,   // float3
+    CookedVertexTexCoord = 1 << 2  // float2
+};
+
+struct CookedSubmesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t materialIndex; // into CookedMesh::materials
+    uint32_t reserved;
+};
+
+// A coarser version of the mesh - same vertex layout, index size and materials as the full one
+struct CookedMeshLod {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float error;    // world units - the furthest any surface moved from the full mesh
+    uint32_t reserved;
+    CookedArray<std::byte> vertices;
+    CookedArray<std::byte> indices;
+    CookedArray<CookedSubmesh> submeshes;
+};
+
+struct CookedMesh {
+    static constexpr CookedKind Kind = CookedKind::Mesh;
+    static constexpr uint32_t Version = 2;
+
+    CookedHeader header;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t vertexStride;
+    uint32_t attributes;  // CookedVertexAttributes bits
+    uint32_t indexSize;   // 2 or 4 bytes
+    uint32_t reserved;
+    float boundsMin[3];
+    float boundsMax[3];
+    CookedArray<std::byte> vertices;
+    CookedArray<std::byte> indices;
+    CookedArray<CookedSubmesh> submeshes;
+    CookedArray<CookedString> materials;
+    CookedArray<CookedMeshLod> lods; // LOD 1 onwards - the fields above are LOD 0
+
+    bool IsValid(const std::byte* blob, size_t size) const {
+        if (!vertices.IsValid(blob, size) || !indices.IsValid(blob, size) || !submeshes.IsValid(blob, size) ||
+            !materials.IsValid(blob, size) || !lods.IsValid(blob, size)) return false;
+        if (indexSize != 2 && indexSize != 4) return false;
+        if (vertices.size() != static_cast<size_t>(vertexCount) * vertexStride) return false;
+        if (indices.size() != static_cast<size_t>(indexCount) * indexSize) return false;
+        if (!AreTrianglesValid(indices, vertexCount, submeshes)) return false;
+        for (const CookedString& material : materials) {
+            if (!material.IsValid(blob, size)) return false;
+        }
+        for (const CookedMeshLod& lod : lods) {
+            if (!lod.vertices.IsValid(blob, size) || !lod.indices.IsValid(blob, size) || !lod.submeshes.IsValid(blob, size)) return false;
+            if (lod.vertices.size() != static_cast<size_t>(lod.vertexCount) * vertexStride) return false;
+            if (lod.indices.size() != static_cast<size_t>(lod.indexCount) * indexSize) return false;
+            if (!AreTrianglesValid(lod.indices, lod.vertexCount, lod.submeshes)) return false;
+        }
+        return true;
+    }
+
+private:
+    // Every submesh inside the index buffer, on a real material, and every index on a real vertex -
+    // this one does read the elements, so a bad file fails here rather than in a draw call
+    bool AreTrianglesValid(const CookedArray<std::byte>& indexData, uint32_t meshVertexCount,
+                           const CookedArray<CookedSubmesh>& meshSubmeshes) const {
+        size_t meshIndexCount = indexData.size() / indexSize;
+        for (const CookedSubmesh& submesh : meshSubmeshes) {
+            if (submesh.firstIndex > meshIndexCount || submesh.indexCount > meshIndexCount - submesh.firstIndex) return false;
+            if (submesh.materialIndex >= materials.size()) return false;
+        }
+        const std::byte* data = indexData.data();
+        for (size_t i = 0; i < meshIndexCount; ++i) {
+            uint32_t index = 0;
+            if (indexSize == 2) {
+                uint16_t narrow;
+                std::memcpy(&narrow, data + i * 2, sizeof(narrow));
+                index = narrow;
+            } else {
+                std::memcpy(&index, data + i * 4, sizeof(index));
+            }
+            if (index >= meshVertexCount) return false;
+        }
+        return true;
+    }
+};
+
+// Textures - every mip level, largest first, rows tightly packed
+enum class CookedPixelFormat : uint32_t {
+    R8 = 1,
+    RG8 = 2,
+    RGBA8 = 3
+};
+
+struct CookedMip {
+    uint32_t width;
+    uint32_t height;
+    CookedArray<std::byte> pixels;
+};
+
+struct CookedTexture {
+    static constexpr CookedKind Kind = CookedKind::Texture;
+    static constexpr uint32_t Version = 1;
+
+    CookedHeader header;
+    uint32_t width;
+    uint32_t height;
+    CookedPixelFormat format;
+    uint32_t reserved;
+    CookedArray<CookedMip> mips;
+
+    static uint32_t GetPixelSize(CookedPixelFormat format) {
+        return format == CookedPixelFormat::RGBA8 ? 4 : format == CookedPixelFormat::RG8 ? 2 : 1;
+    }
+
+    bool IsValid(const std::byte* blob, size_t size) const {
+        if (!mips.IsValid(blob, size)) return false;
+        for (const CookedMip& mip : mips) {
+            if (!mip.pixels.IsValid(blob, size)) return false;
+            if (mip.pixels.size() != static_cast<size_t>(mip.width) * mip.height * GetPixelSize(format)) return false;
+        }
+        return true;
+    }
+};
+
+// Animations - one shared time line, one value per key for every curve
+struct CookedCurve {
+    CookedString name; // bone or property name, like Keyframe::values
+    CookedArray<float> values;
+};
+
+struct CookedAnimation {
+    static constexpr CookedKind Kind = CookedKind::Animation;
+    static constexpr uint32_t Version = 1;
+
+    CookedHeader header;
+    float duration;
+    uint32_t keyCount;
+    CookedArray<float> times; // ascending
+    CookedArray<CookedCurve> curves;
+
+    // Linear sample - clamps outside the time line
+    float Sample(const CookedCurve& curve, float time) const {
+        if (keyCount == 0) return 0.0f;
+        const float* first = times.data();
+        const float* next = std::upper_bound(first, first + keyCount, time);
+        if (next == first) return curve.values[0];
+        if (next == first + keyCount) return curve.values[keyCount - 1];
+
+        size_t key = static_cast<size_t>(next - first) - 1;
+        float span = times[key + 1] - times[key];
+        float blend = span > 0.0f ? (time - times[key]) / span : 0.0f;
+        return curve.values[key] + (curve.values[key + 1] - curve.values[key]) * blend;
+    }
+
+    const CookedCurve* FindCurve(std::string_view name) const {
+        for (const CookedCurve& curve : curves) {
+            if (curve.name.View() == name) return &curve;
+        }
+        return nullptr;
+    }
+
+    bool IsValid(const std::byte* blob, size_t size) const {
+        if (!times.IsValid(blob, size) || !curves.IsValid(blob, size) || times.size() != keyCount) return false;
+        for (const CookedCurve& curve : curves) {
+            if (!curve.name.IsValid(blob, size) || !curve.values.IsValid(blob, size) || curve.values.size() != keyCount) return false;
+        }
+        return true;
+    }
+};
+
+// Audio - PCM, channels interleaved. 8/16-bit sources become Int16, everything else Float32
+enum class CookedSampleFormat : uint32_t {
+    Int16 = 1,
+    Float32 = 2
+};
+
+struct CookedAudio {
+    static constexpr CookedKind Kind = CookedKind::Audio;
+    static constexpr uint32_t Version = 1;
+
+    CookedHeader header;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t frameCount;
+    CookedSampleFormat format;
+    CookedArray<std::byte> samples;
+
+    bool IsValid(const std::byte* blob, size_t size) const {
+        size_t sampleSize = format == CookedSampleFormat::Int16 ? 2 : 4;
+        return samples.IsValid(blob, size) && samples.size() == static_cast<size_t>(frameCount) * channels * sampleSize;
+    }
+};
+
+// Configs - typed entries sorted by key, so a lookup is a binary search.
+// Type numbers follow ConfigValue's alternatives.
+enum class CookedValueType : uint32_t {
+    Int = 0,
+    Float = 1,
+    Bool = 2,
+    String = 3
+};
+
+struct CookedConfigEntry {
+    CookedString key;
+    CookedString text; // the value as written - the String value, and handy for the others too
+    CookedValueType type;
+    int32_t intValue;
+    float floatValue;
+    uint32_t boolValue;
+};
+
+struct CookedConfig {
+    static constexpr CookedKind Kind = CookedKind::Config;
+    static constexpr uint32_t Version = 1;
+
+    CookedHeader header;
+    CookedArray<CookedConfigEntry> entries;
+
+    const CookedConfigEntry* Find(std::string_view key) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), key,
+            [](const CookedConfigEntry& entry, std::string_view wanted) { return entry.key.View() < wanted; });
+        return it != entries.end() && it->key.View() == key ? it : nullptr;
+    }
+
+    bool IsValid(const std::byte* blob, size_t size) const {
+        if (!entries.IsValid(blob, size)) return false;
+        for (const CookedConfigEntry& entry : entries) {
+            if (!entry.key.IsValid(blob, size) || !entry.text.IsValid(blob, size)) return false;
+        }
+        return true;
+    }
+};
+
+// Runtime entry point - checks the header and the offsets, then hands back the blob in place.
+// nullptr for the wrong kind, an old version or a truncated/corrupt file.
+template<typename T>
+const T* GetCooked(std::span<const std::byte> data) {
+    static_assert(std::is_trivially_copyable_v<T>, "Cooked layouts must be plain data");
+    if (data.size() < sizeof(T) || reinterpret_cast<uintptr_t>(data.data()) % alignof(T) != 0) return nullptr;
+
+    const T* blob = reinterpret_cast<const T*>(data.data());
+    const CookedHeader& header = blob->header;
+    if (header.magic != CookedMagic || header.kind != T::Kind || header.version != T::Version) return nullptr;
+    if (header.size < sizeof(T) || header.size > data.size()) return nullptr;
+    return blob->IsValid(data.data(), static_cast<size_t>(header.size)) ? blob : nullptr;
+}
+
+#endif // COOKEDFORMATS_H
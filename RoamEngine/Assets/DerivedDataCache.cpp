@@ -0,0 +1,557 @@
+// DerivedDataCache.cpp - Implementation of the pantry
+// One file per entry, named by its key - rename makes writes atomic, a lock file keeps cleanups apart
+
+#include "DerivedDataCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Entry file layout - header, then the payload exactly as it was handed to Put
+    constexpr char EntryMagic[8] = { 'R', 'O', 'A', 'M', 'D', 'D', 'C', '\0' };
+    constexpr uint32_t EntryVersion = 1;
+
+    struct EntryHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t payloadSize;
+        uint64_t payloadHash; // catches torn or bit-rotted entries
+    };
+    static_assert(sizeof(EntryHeader) == 32, "EntryHeader is an on-disk format");
+
+    constexpr const char* TempFolder = "tmp";
+    constexpr const char* LockFileName = "cache.lock";
+    constexpr double TrimTarget = 0.9;          // trim down to 90% so we don't trim again on the very next write
+    constexpr auto StaleTempAge = std::chrono::hours(1); // temp files this old belong to a crashed writer
+
+    constexpr uint64_t PrimeA = 0x9E3779B97F4A7C15ull;
+    constexpr uint64_t PrimeB = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PrimeC = 0x165667B19E3779F9ull;
+    constexpr uint64_t PrimeD = 0x87C37B91114253D5ull;
+
+    uint64_t Rotl(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // Final avalanche - every input bit flips about half of the output bits
+    uint64_t Avalanche(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        value ^= value >> 33;
+        return value;
+    }
+
+    uint64_t HashPayload(std::span<const std::byte> payload) {
+        return DerivedDataKeyBuilder("payload").Add(payload).Finish().low;
+    }
+
+    uint64_t GetProcessId() {
+#if defined(_WIN32)
+        return static_cast<uint64_t>(::GetCurrentProcessId());
+#else
+        return static_cast<uint64_t>(::getpid());
+#endif
+    }
+
+    // Write and flush to the disk before the rename - otherwise a crash can leave a
+    // correctly named entry with nothing in it
+    bool WriteDurably(const std::string& path, const EntryHeader& header, std::span<const std::byte> payload) {
+#if defined(_WIN32)
+        HANDLE file = ::CreateFileA(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+
+        auto writeAll = [file](const void* data, size_t size) {
+            const char* cursor = static_cast<const char*>(data);
+            while (size > 0) {
+                DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+                DWORD written = 0;
+                if (!::WriteFile(file, cursor, chunk, &written, nullptr) || written == 0) return false;
+                cursor += written;
+                size -= written;
+            }
+            return true;
+        };
+
+        bool ok = writeAll(&header, sizeof(header)) && writeAll(payload.data(), payload.size()) && ::FlushFileBuffers(file);
+        ::CloseHandle(file);
+        return ok;
+#else
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+
+        auto writeAll = [fd](const void* data, size_t size) {
+            const char* cursor = static_cast<const char*>(data);
+            while (size > 0) {
+                ssize_t written = ::write(fd, cursor, size);
+                if (written < 0 && errno == EINTR) continue;
+                if (written <= 0) return false;
+                cursor += written;
+                size -= static_cast<size_t>(written);
+            }
+            return true;
+        };
+
+        bool ok = writeAll(&header, sizeof(header)) && writeAll(payload.data(), payload.size()) && ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+#endif
+    }
+
+    // Cross-process lock - only one process trims at a time, the others just skip their turn
+    class TrimLock {
+    public:
+        explicit TrimLock(const std::string& path) {
+#if defined(_WIN32)
+            handle = ::CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                   nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (handle != INVALID_HANDLE_VALUE) {
+                OVERLAPPED overlapped = {};
+                locked = ::LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped) != 0;
+            }
+#else
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if (fd >= 0) locked = ::flock(fd, LOCK_EX | LOCK_NB) == 0;
+#endif
+        }
+
+        ~TrimLock() {
+#if defined(_WIN32)
+            if (handle != INVALID_HANDLE_VALUE) {
+                if (locked) {
+                    OVERLAPPED overlapped = {};
+                    ::UnlockFileEx(handle, 0, 1, 0, &overlapped);
+                }
+                ::CloseHandle(handle);
+            }
+#else
+            if (fd >= 0) ::close(fd); // closing drops the flock
+#endif
+        }
+
+        TrimLock(const TrimLock&) = delete;
+        TrimLock& operator=(const TrimLock&) = delete;
+
+        bool IsLocked() const { return locked; }
+
+    private:
+#if defined(_WIN32)
+        HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+        int fd = -1;
+#endif
+        bool locked = false;
+    };
+
+    // Mark an entry as just used - the modification time doubles as the LRU clock, because
+    // access times are switched off or coarsened on most mounts
+    void Touch(const std::filesystem::path& path) {
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    }
+
+    bool IsEntryFolder(const std::filesystem::path& path) {
+        std::string name = path.filename().string();
+        return name.size() == 2 && std::isxdigit(static_cast<unsigned char>(name[0])) &&
+               std::isxdigit(static_cast<unsigned char>(name[1]));
+    }
+}
+
+// DerivedDataKey
+
+std::string DerivedDataKey::ToString() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string text(32, '0');
+    for (int i = 0; i < 16; ++i) {
+        text[15 - i] = digits[(high >> (i * 4)) & 0xF];
+        text[31 - i] = digits[(low >> (i * 4)) & 0xF];
+    }
+    return text;
+}
+
+bool DerivedDataKey::FromString(std::string_view text, DerivedDataKey& key) {
+    if (text.size() != 32) return false;
+
+    DerivedDataKey parsed;
+    for (size_t i = 0; i < 32; ++i) {
+        char c = text[i];
+        uint64_t digit;
+        if (c >= '0' && c <= '9') digit = static_cast<uint64_t>(c - '0');
+        else if (c >= 'a' && c <= 'f') digit = static_cast<uint64_t>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') digit = static_cast<uint64_t>(c - 'A' + 10);
+        else return false;
+
+        uint64_t& half = i < 16 ? parsed.high : parsed.low;
+        half = (half << 4) | digit;
+    }
+
+    key = parsed;
+    return true;
+}
+
+// DerivedDataKeyBuilder
+
+DerivedDataKeyBuilder::DerivedDataKeyBuilder(std::string_view kind)
+    : stateA(PrimeA), stateB(PrimeC), pending(0), pendingBytes(0), totalBytes(0) {
+    Add(kind);
+}
+
+DerivedDataKeyBuilder& DerivedDataKeyBuilder::Add(std::string_view text) {
+    Add(static_cast<uint64_t>(text.size()));
+    Update(text.data(), text.size());
+    return *this;
+}
+
+DerivedDataKeyBuilder& DerivedDataKeyBuilder::Add(std::span<const std::byte> data) {
+    Add(static_cast<uint64_t>(data.size()));
+    Update(data.data(), data.size());
+    return *this;
+}
+
+DerivedDataKeyBuilder& DerivedDataKeyBuilder::Add(uint64_t value) {
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<uint8_t>(value >> (i * 8)); // same key on every platform
+    Update(bytes, sizeof(bytes));
+    return *this;
+}
+
+bool DerivedDataKeyBuilder::AddFile(const std::string& path) {
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error) return false;
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    Add(size);
+    std::vector<char> buffer(256 * 1024);
+    uint64_t remaining = size;
+    while (remaining > 0) {
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(remaining, buffer.size()));
+        if (!file.read(buffer.data(), static_cast<std::streamsize>(chunk))) return false; // shrank under us
+        Update(buffer.data(), chunk);
+        remaining -= chunk;
+    }
+    return true;
+}
+
+DerivedDataKey DerivedDataKeyBuilder::Finish() const {
+    DerivedDataKeyBuilder tail = *this;
+    if (tail.pendingBytes > 0) {
+        tail.MixWord(tail.pending);
+    }
+    tail.MixWord(totalBytes);
+
+    uint64_t a = tail.stateA + Rotl(tail.stateB, 23);
+    uint64_t b = tail.stateB ^ Rotl(tail.stateA, 41);
+
+    DerivedDataKey key;
+    key.high = Avalanche(a);
+    key.low = Avalanche(b + key.high);
+    return key;
+}
+
+void DerivedDataKeyBuilder::Update(const void* data, size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    totalBytes += size;
+
+    // Top up a partial word first
+    while (pendingBytes > 0 && size > 0) {
+        pending |= static_cast<uint64_t>(*bytes++) << (pendingBytes * 8);
+        --size;
+        if (++pendingBytes == 8) {
+            MixWord(pending);
+            pending = 0;
+            pendingBytes = 0;
+        }
+    }
+
+    // Whole words - the bulk of any real input
+    while (size >= 8) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; ++i) word |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+        MixWord(word);
+        bytes += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        pending |= static_cast<uint64_t>(*bytes++) << (pendingBytes * 8);
+        ++pendingBytes;
+        --size;
+    }
+}
+
+void DerivedDataKeyBuilder::MixWord(uint64_t word) {
+    // Two lanes with different multipliers and rotations, each feeding the other
+    stateA = Rotl(stateA ^ (word * PrimeB), 31) * PrimeA;
+    stateB = (Rotl(stateB + (word * PrimeD), 27) * PrimeC) ^ stateA;
+}
+
+// DerivedDataCache
+
+DerivedDataCache& DerivedDataCache::GetInstance() {
+    static DerivedDataCache instance;
+    return instance;
+}
+
+DerivedDataCache::DerivedDataCache()
+    : maxBytes(0), bytesSinceTrim(0), tempCounter(0), initialized(false),
+      statHits(0), statMisses(0), statWrites(0), statBytesRead(0), statBytesWritten(0),
+      statEvictions(0), statCorrupt(0) {
+}
+
+DerivedDataCache::~DerivedDataCache() {
+    Shutdown();
+}
+
+bool DerivedDataCache::Initialize(const std::string& root, uint64_t maxSize) {
+    if (initialized) Shutdown();
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(root) / TempFolder, error);
+    if (error) return false;
+
+    rootPath = root;
+    maxBytes = maxSize;
+    bytesSinceTrim = 0;
+    initialized = true;
+
+    // Start within budget - the last session (or another process) may have left it over
+    Trim();
+    return true;
+}
+
+void DerivedDataCache::Shutdown() {
+    initialized = false;
+}
+
+std::string DerivedDataCache::GetEntryPath(const DerivedDataKey& key) const {
+    // 256 sub-folders - keeps any one directory small enough to list quickly
+    std::string name = key.ToString();
+    return (std::filesystem::path(rootPath) / name.substr(0, 2) / name).string();
+}
+
+std::string DerivedDataCache::MakeTempPath() {
+    // Process id + thread + counter - unique across every process sharing the cache
+    size_t thread = std::hash<std::thread::id>()(std::this_thread::get_id());
+    std::string name = std::to_string(GetProcessId()) + "-" + std::to_string(thread) + "-" +
+                       std::to_string(tempCounter.fetch_add(1)) + ".tmp";
+    return (std::filesystem::path(rootPath) / TempFolder / name).string();
+}
+
+bool DerivedDataCache::Get(const DerivedDataKey& key, std::vector<std::byte>& data) {
+    if (!initialized) return false;
+
+    std::string path = GetEntryPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        statMisses++;
+        return false;
+    }
+
+    EntryHeader header;
+    bool valid = file.read(reinterpret_cast<char*>(&header), sizeof(header)) &&
+                 std::memcmp(header.magic, EntryMagic, sizeof(EntryMagic)) == 0 &&
+                 header.version == EntryVersion;
+
+    std::error_code error;
+    uint64_t fileSize = std::filesystem::file_size(path, error);
+    valid = valid && !error && fileSize == sizeof(header) + header.payloadSize;
+
+    if (valid) {
+        data.resize(static_cast<size_t>(header.payloadSize));
+        valid = header.payloadSize == 0 ||
+                file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(header.payloadSize));
+        valid = valid && HashPayload(data) == header.payloadHash;
+    }
+    file.close();
+
+    if (!valid) {
+        // Only a crash mid-rename or a bad disk gets here - drop it, the caller rebuilds it
+        std::filesystem::remove(path, error);
+        data.clear();
+        statCorrupt++;
+        statMisses++;
+        return false;
+    }
+
+    Touch(path);
+    statHits++;
+    statBytesRead += header.payloadSize;
+    return true;
+}
+
+bool DerivedDataCache::Put(const DerivedDataKey& key, std::span<const std::byte> data) {
+    if (!initialized) return false;
+
+    std::string path = GetEntryPath(key);
+    std::error_code error;
+
+    // Same key, same bytes - if someone beat us to it there's nothing to write
+    if (std::filesystem::exists(path, error)) {
+        Touch(path);
+        return true;
+    }
+
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    EntryHeader header = {};
+    std::memcpy(header.magic, EntryMagic, sizeof(EntryMagic));
+    header.version = EntryVersion;
+    header.payloadSize = data.size();
+    header.payloadHash = HashPayload(data);
+
+    std::string tempPath = MakeTempPath();
+    if (!WriteDurably(tempPath, header, data)) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        // Windows won't replace a file someone has open - fine, it holds the same bytes we do
+        std::filesystem::remove(tempPath, error);
+        if (!std::filesystem::exists(path, error)) return false;
+    }
+
+    statWrites++;
+    statBytesWritten += data.size();
+
+    // Trim once a sixteenth of the budget has been written since the last time
+    uint64_t written = bytesSinceTrim.fetch_add(sizeof(header) + data.size()) + sizeof(header) + data.size();
+    if (written > maxBytes / 16) {
+        bytesSinceTrim = 0;
+        Trim();
+    }
+    return true;
+}
+
+bool DerivedDataCache::Contains(const DerivedDataKey& key) const {
+    if (!initialized) return false;
+    std::error_code error;
+    return std::filesystem::exists(GetEntryPath(key), error);
+}
+
+bool DerivedDataCache::Remove(const DerivedDataKey& key) {
+    if (!initialized) return false;
+    std::error_code error;
+    return std::filesystem::remove(GetEntryPath(key), error);
+}
+
+bool DerivedDataCache::GetOrBuild(const DerivedDataKey& key, std::vector<std::byte>& data,
+                                  const std::function<bool(std::vector<std::byte>&)>& build) {
+    if (Get(key, data)) return true;
+
+    data.clear();
+    if (!build(data)) return false;
+
+    Put(key, data); // a failed store is only a missed shortcut for next time
+    return true;
+}
+
+uint64_t DerivedDataCache::Trim() {
+    if (!initialized) return 0;
+
+    // One trim per process at a time, one per machine through the lock file - if someone
+    // else is already at it, their trim covers ours
+    std::unique_lock<std::mutex> localLock(trimMutex, std::try_to_lock);
+    if (!localLock.owns_lock()) return 0;
+
+    TrimLock lock((std::filesystem::path(rootPath) / LockFileName).string());
+    if (!lock.IsLocked()) return 0;
+
+    struct Entry {
+        std::filesystem::path path;
+        uint64_t size;
+        std::filesystem::file_time_type lastUsed;
+    };
+    std::vector<Entry> entries;
+    uint64_t totalBytes = 0;
+
+    std::error_code error;
+    auto now = std::filesystem::file_time_type::clock::now();
+    for (const auto& folder : std::filesystem::directory_iterator(rootPath, error)) {
+        if (!folder.is_directory(error)) continue;
+
+        bool isTemp = folder.path().filename() == TempFolder;
+        if (!isTemp && !IsEntryFolder(folder.path())) continue;
+
+        for (const auto& file : std::filesystem::directory_iterator(folder.path(), error)) {
+            if (!file.is_regular_file(error)) continue;
+
+            auto lastUsed = file.last_write_time(error);
+            if (error) continue;
+
+            if (isTemp) {
+                // Writers in flight are young - only a crashed one leaves an old temp file behind
+                if (now - lastUsed > StaleTempAge) std::filesystem::remove(file.path(), error);
+                continue;
+            }
+
+            uint64_t size = file.file_size(error);
+            if (error) continue;
+            entries.push_back({ file.path(), size, lastUsed });
+            totalBytes += size;
+        }
+    }
+
+    uint64_t budget = maxBytes;
+    if (totalBytes <= budget) return totalBytes;
+
+    // Oldest first until we're comfortably under - another process reading an entry we delete
+    // keeps its open handle (POSIX) or makes the delete fail (Windows), either way it's safe
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+
+    uint64_t target = static_cast<uint64_t>(static_cast<double>(budget) * TrimTarget);
+    for (const Entry& entry : entries) {
+        if (totalBytes <= target) break;
+        if (std::filesystem::remove(entry.path, error)) {
+            totalBytes -= entry.size;
+            statEvictions++;
+        }
+    }
+
+    return totalBytes;
+}
+
+void DerivedDataCache::Clear() {
+    if (!initialized) return;
+
+    std::error_code error;
+    for (const auto& folder : std::filesystem::directory_iterator(rootPath, error)) {
+        if (folder.is_directory(error) && IsEntryFolder(folder.path())) {
+            std::filesystem::remove_all(folder.path(), error);
+        }
+    }
+}
+
+DerivedDataCache::Stats DerivedDataCache::GetStats() const {
+    Stats stats;
+    stats.hits = statHits;
+    stats.misses = statMisses;
+    stats.writes = statWrites;
+    stats.bytesRead = statBytesRead;
+    stats.bytesWritten = statBytesWritten;
+    stats.evictions = statEvictions;
+    stats.corruptEntries = statCorrupt;
+    return stats;
+}
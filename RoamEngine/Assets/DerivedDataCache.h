@@ -0,0 +1,123 @@
+// DerivedDataCache.h - The pantry
+// Anything we cooked once gets put on a shelf on disk, so the next run just takes it off again
+
+#ifndef DERIVEDDATACACHE_H
+#define DERIVEDDATACACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Cache key - 128-bit hash of everything that went into the output
+struct DerivedDataKey {
+    uint64_t high = 0;
+    uint64_t low = 0;
+
+    bool operator==(const DerivedDataKey& other) const { return high == other.high && low == other.low; }
+    bool operator!=(const DerivedDataKey& other) const { return !(*this == other); }
+
+    // 32 hex digits - also the file name in the cache
+    std::string ToString() const;
+    static bool FromString(std::string_view text, DerivedDataKey& key);
+};
+
+// Key builder - feed it the source, the settings and the tool version, in a fixed order.
+// Every field is length-prefixed, so ("ab", "c") and ("a", "bc") never collide.
+// Not a cryptographic hash - it guards against accidents, not attackers.
+class DerivedDataKeyBuilder {
+public:
+    explicit DerivedDataKeyBuilder(std::string_view kind); // "texture", "mesh"... keeps tools apart
+
+    DerivedDataKeyBuilder& Add(std::string_view text);
+    DerivedDataKeyBuilder& Add(std::span<const std::byte> data);
+    DerivedDataKeyBuilder& Add(uint64_t value);
+    bool AddFile(const std::string& path); // false if it can't be read - don't cache then
+
+    DerivedDataKey Finish() const;
+
+private:
+    void Update(const void* data, size_t size);
+    void MixWord(uint64_t word);
+
+    uint64_t stateA;
+    uint64_t stateB;
+    uint64_t pending;       // bytes waiting for a full 8-byte word
+    size_t pendingBytes;
+    uint64_t totalBytes;
+};
+
+// The DerivedDataCache class - content-addressed, shared by every process on the machine
+class DerivedDataCache {
+public:
+    static DerivedDataCache& GetInstance();
+
+    // Open the cache - everything misses until this succeeds. maxBytes bounds the total size;
+    // least recently used entries go first when it's exceeded.
+    bool Initialize(const std::string& rootPath, uint64_t maxBytes = 2ull * 1024 * 1024 * 1024);
+    void Shutdown();
+    bool IsInitialized() const { return initialized; }
+
+    // Lookup/store - writes land in a temp file and are renamed into place, so a reader (in this
+    // process or another one) sees either the whole entry or nothing
+    bool Get(const DerivedDataKey& key, std::vector<std::byte>& data);
+    bool Put(const DerivedDataKey& key, std::span<const std::byte> data);
+    bool Contains(const DerivedDataKey& key) const;
+    bool Remove(const DerivedDataKey& key);
+
+    // Get, or build and store on a miss - build returns false when it failed (nothing is cached then)
+    bool GetOrBuild(const DerivedDataKey& key, std::vector<std::byte>& data,
+                    const std::function<bool(std::vector<std::byte>&)>& build);
+
+    // Size management - Trim runs on its own as writes add up, call it directly after big imports
+    void SetMaxSize(uint64_t bytes) { maxBytes = bytes; }
+    uint64_t GetMaxSize() const { return maxBytes; }
+    uint64_t Trim();   // returns the size left after trimming
+    void Clear();
+
+    // Statistics - how are we doing?
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t writes = 0;
+        uint64_t bytesRead = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t evictions = 0;
+        uint64_t corruptEntries = 0; // failed the checksum - deleted and reported as a miss
+    };
+    Stats GetStats() const;
+    const std::string& GetRootPath() const { return rootPath; }
+
+private:
+    DerivedDataCache();
+    ~DerivedDataCache();
+
+    // Prevent copying - one pantry is enough
+    DerivedDataCache(const DerivedDataCache&) = delete;
+    DerivedDataCache& operator=(const DerivedDataCache&) = delete;
+
+    std::string GetEntryPath(const DerivedDataKey& key) const;
+    std::string MakeTempPath();
+
+    std::string rootPath;
+    std::atomic<uint64_t> maxBytes;
+    std::atomic<uint64_t> bytesSinceTrim;
+    std::atomic<uint64_t> tempCounter;
+    std::mutex trimMutex;
+    std::atomic<bool> initialized;
+
+    std::atomic<uint64_t> statHits;
+    std::atomic<uint64_t> statMisses;
+    std::atomic<uint64_t> statWrites;
+    std::atomic<uint64_t> statBytesRead;
+    std::atomic<uint64_t> statBytesWritten;
+    std::atomic<uint64_t> statEvictions;
+    std::atomic<uint64_t> statCorrupt;
+};
+
+#endif // DERIVEDDATACACHE_H
@@ -54,6 +54,7 @@ public:
     void SetPosition(const Vector3& position);
     void SetVelocity(const Vector3& velocity);
     void SetDirection(const Vector3& direction);
+    void ShiftOrigin(const Vector3& shift) { SetPosition(position - shift); }
 
     // State
     AudioState GetState() const { return state; }
@@ -88,6 +89,7 @@ public:
     void SetPosition(const Vector3& position);
     void SetVelocity(const Vector3& velocity);
     void SetOrientation(const Vector3& forward, const Vector3& up);
+    void ShiftOrigin(const Vector3& shift) { SetPosition(position - shift); }
 
     // Properties
     const Vector3& GetPosition() const { return position; }
@@ -121,6 +123,12 @@ public:
     // Listener management
     AudioListener* GetListener() { return &listener; }
 
+    // Floating origin rebase - the listener and every source, so nothing is heard to jump
+    void ShiftOrigin(const Vector3& shift) {
+        listener.ShiftOrigin(shift);
+        for (auto& source : sources) source->ShiftOrigin(shift);
+    }
+
     // Global audio settings
     void SetMasterVolume(float volume);
     void SetMusicVolume(float volume);
@@ -0,0 +1,118 @@
+// BinaryStream.h - The byte pipe
+// Raw bytes in and out of a buffer, little-endian, with no opinions about what they mean
+
+#ifndef BINARYSTREAM_H
+#define BINARYSTREAM_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Values go out as they are in memory, so saved data only moves between little-endian machines
+static_assert(std::endian::native == std::endian::little, "Binary streams are little-endian");
+
+// The BinaryWriter class - appends to a growing buffer
+class BinaryWriter {
+public:
+    BinaryWriter() {}
+    explicit BinaryWriter(size_t reserve) { buffer.reserve(reserve); }
+
+    void WriteBytes(const void* data, size_t size) {
+        if (size == 0) return;
+        size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        std::memcpy(buffer.data() + offset, data, size);
+    }
+
+    template<typename T>
+    void Write(const T& value) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Write takes plain numbers - use Serializer for anything else");
+        WriteBytes(&value, sizeof(T));
+    }
+
+    void WriteString(std::string_view text) {
+        Write(static_cast<uint32_t>(text.size()));
+        WriteBytes(text.data(), text.size());
+    }
+
+    // Room for size bytes, to be filled in place - good until the next write
+    std::byte* Reserve(size_t size) {
+        size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        return buffer.data() + offset;
+    }
+
+    // Fill in something written earlier, a length once it's known, say
+    template<typename T>
+    void Patch(size_t offset, const T& value) { std::memcpy(buffer.data() + offset, &value, sizeof(T)); }
+
+    size_t GetSize() const { return buffer.size(); }
+    const std::byte* GetData() const { return buffer.data(); }
+    std::vector<std::byte>& GetBuffer() { return buffer; }
+    void Clear() { buffer.clear(); }
+
+private:
+    std::vector<std::byte> buffer;
+};
+
+// The BinaryReader class - walks a buffer it doesn't own. Reading past the end fails the reader:
+// that read and every one after it gives zeros, so callers can read a whole record and check
+// IsOk() once at the end.
+class BinaryReader {
+public:
+    BinaryReader(const void* data, size_t size) : data(static_cast<const std::byte*>(data)), size(size), position(0), failed(false) {}
+
+    bool ReadBytes(void* destination, size_t count) {
+        const std::byte* source = Take(count);
+        if (!source) {
+            std::memset(destination, 0, count);
+            return false;
+        }
+        std::memcpy(destination, source, count);
+        return true;
+    }
+
+    template<typename T>
+    T Read() {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Read gives plain numbers - use Serializer for anything else");
+        T value;
+        ReadBytes(&value, sizeof(T));
+        return value;
+    }
+
+    std::string ReadString() {
+        uint32_t length = Read<uint32_t>();
+        const std::byte* source = Take(length);
+        return source ? std::string(reinterpret_cast<const char*>(source), length) : std::string();
+    }
+
+    // The next count bytes in place, or null past the end - the reader moves on either way
+    const std::byte* Take(size_t count) {
+        if (failed || count > size - position) {
+            failed = true;
+            return nullptr;
+        }
+        const std::byte* result = data + position;
+        position += count;
+        return result;
+    }
+    bool Skip(size_t count) { return Take(count) != nullptr; }
+
+    bool IsOk() const { return !failed; }
+    void Fail() { failed = true; }
+    size_t GetPosition() const { return position; }
+    size_t GetRemaining() const { return size - position; }
+
+private:
+    const std::byte* data;
+    size_t size;
+    size_t position;
+    bool failed;
+};
+
+#endif // BINARYSTREAM_H
@@ -7,6 +7,7 @@
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include "Core/StringId.h"
 
 // Config value types - because settings can be different things
 using ConfigValue = std::variant<int, float, bool, std::string>;
@@ -41,6 +42,21 @@ public:
     // Remove key - erase from memory
     void RemoveKey(const std::string& key);
 
+    // The same by ID - keys are interned when set or loaded, so "video.width"_sid finds them.
+    // Setting by ID only works for keys that have been interned, or the file couldn't name them.
+    // A key whose hash another key took is stored by its text, so only the string overloads see
+    // it - the invalid ID is never a key, and setting it does nothing.
+    void SetInt(StringId key, int value);
+    void SetFloat(StringId key, float value);
+    void SetBool(StringId key, bool value);
+    void SetString(StringId key, const std::string& value);
+    int GetInt(StringId key, int defaultValue = 0) const;
+    float GetFloat(StringId key, float defaultValue = 0.0f) const;
+    bool GetBool(StringId key, bool defaultValue = false) const;
+    std::string GetString(StringId key, const std::string& defaultValue = "") const;
+    bool HasKey(StringId key) const;
+    void RemoveKey(StringId key);
+
     // Clear all config - start fresh
     void Clear();
 
@@ -54,8 +70,9 @@ private:
     // Deserialize string to value - turn text into knowledge
     ConfigValue StringToValue(const std::string& str) const;
 
-    // Our config data - the sacred map
-    std::unordered_map<std::string, ConfigValue> configData;
+    // Our config data - the sacred map, keyed by interned name (SaveConfig gets the text back from the interner)
+    std::unordered_map<StringId, ConfigValue> configData;
+    std::unordered_map<std::string, ConfigValue> collidingData; // keys whose hash another key took - saved too
 
     // Current config file - where we store our wisdom
     std::string currentFile;
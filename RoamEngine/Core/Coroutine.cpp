@@ -0,0 +1,304 @@
+// Coroutine.cpp - Implementation of the patient one
+// The frame pool, the scheduler's lists and heap, and the awaitables that need the engine
+
+#include "Coroutine.h"
+#include <algorithm>
+#include <new>
+#include "Assets/AssetManager.h"
+
+namespace {
+    constexpr size_t SizeClassCount = CoroutineFrameAllocator::MaxPooledSize / CoroutineFrameAllocator::Granularity;
+
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+
+    // Frames can be made on any thread (calling a coroutine function), so the pool has a lock - it's
+    // held for a list push or pop
+    struct FramePool {
+        std::mutex mutex;
+        FreeFrame* freeLists[SizeClassCount] = {};
+        std::vector<std::unique_ptr<std::byte[]>> blocks;
+        size_t blockUsed = CoroutineFrameAllocator::BlockSize;
+        CoroutineFrameAllocator::Stats stats;
+    };
+
+    FramePool& GetFramePool() {
+        static FramePool pool;
+        return pool;
+    }
+
+    size_t SizeClassOf(size_t size) {
+        return (size + CoroutineFrameAllocator::Granularity - 1) / CoroutineFrameAllocator::Granularity - 1;
+    }
+}
+
+void* CoroutineFrameAllocator::Allocate(size_t size) {
+    if (size > MaxPooledSize) return ::operator new(size);
+
+    size_t sizeClass = SizeClassOf(size);
+    size_t rounded = (sizeClass + 1) * Granularity;
+    FramePool& pool = GetFramePool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.stats.liveFrames++;
+    pool.stats.liveBytes += rounded;
+    if (FreeFrame* frame = pool.freeLists[sizeClass]) {
+        pool.freeLists[sizeClass] = frame->next;
+        return frame;
+    }
+    if (pool.blockUsed + rounded > BlockSize) {
+        pool.blocks.push_back(std::make_unique<std::byte[]>(BlockSize));
+        pool.blockUsed = 0;
+        pool.stats.reservedBytes += BlockSize;
+    }
+    void* frame = pool.blocks.back().get() + pool.blockUsed;
+    pool.blockUsed += rounded;
+    return frame;
+}
+
+void CoroutineFrameAllocator::Free(void* frame, size_t size) {
+    if (!frame) return;
+    if (size > MaxPooledSize) {
+        ::operator delete(frame);
+        return;
+    }
+
+    size_t sizeClass = SizeClassOf(size);
+    FramePool& pool = GetFramePool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.stats.liveFrames--;
+    pool.stats.liveBytes -= (sizeClass + 1) * Granularity;
+    FreeFrame* freed = static_cast<FreeFrame*>(frame);
+    freed->next = pool.freeLists[sizeClass];
+    pool.freeLists[sizeClass] = freed;
+}
+
+CoroutineFrameAllocator::Stats CoroutineFrameAllocator::GetStats() {
+    FramePool& pool = GetFramePool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.stats;
+}
+
+CoroutineScheduler::CoroutineScheduler()
+    : running(0), mailbox(std::make_shared<CoroutineMailbox>()), jobSystem(nullptr), time(0.0), frame(0), resumedLastUpdate(0) {
+}
+
+CoroutineScheduler::~CoroutineScheduler() {
+    WaitForJobs();
+    CancelAll();
+}
+
+void CoroutineScheduler::SetJobSystem(ThreadManager* jobs) {
+    WaitForJobs();
+    jobSystem = jobs;
+}
+
+void CoroutineScheduler::WaitForJobs() {
+    if (jobSystem) jobSystem->Wait(jobsInFlight);
+}
+
+CoroutineId CoroutineScheduler::Start(Coroutine coroutine) {
+    Coroutine::Handle handle = std::exchange(coroutine.handle, nullptr);
+    if (!handle) return InvalidCoroutineId;
+
+    uint32_t index;
+    if (!freeSlots.empty()) {
+        index = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        index = static_cast<uint32_t>(slots.size());
+        slots.emplace_back();
+    }
+    Slot& slot = slots[index];
+    slot.handle = handle;
+    slot.waiting = true;
+    running++;
+
+    CoroutineId id{ index, slot.generation };
+    handle.promise().scheduler = this;
+    handle.promise().id = id;
+    Resume(id);
+    return IsRunning(id) ? id : InvalidCoroutineId;
+}
+
+bool CoroutineScheduler::Cancel(CoroutineId id) {
+    Slot* slot = Find(id);
+    if (!slot) return false;
+    if (slot->running) {
+        slot->cancelled = true;
+    } else {
+        Release(id.index);
+    }
+    return true;
+}
+
+void CoroutineScheduler::CancelAll() {
+    for (uint32_t index = 0; index < slots.size(); ++index) {
+        Slot& slot = slots[index];
+        if (!slot.handle) continue;
+        if (slot.running) {
+            slot.cancelled = true;
+        } else {
+            Release(index);
+        }
+    }
+}
+
+bool CoroutineScheduler::IsRunning(CoroutineId id) const {
+    const Slot* slot = Find(id);
+    return slot && !slot->cancelled;
+}
+
+void CoroutineScheduler::Update(float deltaTime) {
+    time += deltaTime;
+    frame++;
+
+    // Everything due, in the order it became due: last frame's NextFrame waits, expired timers, then
+    // wakes posted since the last Update (from any thread)
+    ready.clear();
+    ready.swap(nextFrame);
+    while (!timers.empty() && timers.front().wakeTime <= time) {
+        std::pop_heap(timers.begin(), timers.end(), std::greater<Timer>());
+        ready.push_back(timers.back().id);
+        timers.pop_back();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mutex);
+        ready.insert(ready.end(), mailbox->posted.begin(), mailbox->posted.end());
+        mailbox->posted.clear();
+    }
+
+    // Coroutines that wait again while this runs land in nextFrame or timers, never back in ready.
+    // Index, not iterator - a coroutine can't add to ready, but Resume can grow slots.
+    resumedLastUpdate = 0;
+    for (size_t i = 0; i < ready.size(); ++i) Resume(ready[i]);
+    ready.clear();
+}
+
+CoroutineScheduler::Stats CoroutineScheduler::GetStats() const {
+    Stats stats;
+    stats.running = running;
+    stats.waitingForFrame = nextFrame.size();
+    stats.timers = timers.size();
+    stats.resumed = resumedLastUpdate;
+    return stats;
+}
+
+CoroutineWaker CoroutineScheduler::Suspend(CoroutineId id) {
+    if (Slot* slot = Find(id)) slot->waiting = true;
+    return CoroutineWaker(mailbox, id);
+}
+
+void CoroutineScheduler::WaitForNextFrame(CoroutineId id) {
+    Suspend(id);
+    nextFrame.push_back(id);
+}
+
+void CoroutineScheduler::WaitUntil(CoroutineId id, double wakeTime) {
+    Suspend(id);
+    timers.push_back(Timer{ wakeTime, id });
+    std::push_heap(timers.begin(), timers.end(), std::greater<Timer>());
+}
+
+void CoroutineScheduler::SubmitJob(std::function<void()> job) {
+    if (!jobSystem) {
+        job();
+        return;
+    }
+    jobSystem->Submit(std::move(job), JobPriority::Normal, &jobsInFlight);
+}
+
+CoroutineScheduler::Slot* CoroutineScheduler::Find(CoroutineId id) {
+    if (id.index >= slots.size()) return nullptr;
+    Slot& slot = slots[id.index];
+    return slot.handle && slot.generation == id.generation ? &slot : nullptr;
+}
+
+const CoroutineScheduler::Slot* CoroutineScheduler::Find(CoroutineId id) const {
+    if (id.index >= slots.size()) return nullptr;
+    const Slot& slot = slots[id.index];
+    return slot.handle && slot.generation == id.generation ? &slot : nullptr;
+}
+
+void CoroutineScheduler::Resume(CoroutineId id) {
+    // Stale wakes (cancelled, finished, or already resumed by something else) drop out here
+    Slot* slot = Find(id);
+    if (!slot || !slot->waiting || slot->running || slot->cancelled) return;
+    slot->waiting = false;
+    slot->running = true;
+    Coroutine::Handle handle = slot->handle;
+    resumedLastUpdate++;
+
+    handle.resume();
+
+    // The coroutine may have started others, so slots may have moved
+    Slot& after = slots[id.index];
+    after.running = false;
+    if (handle.done() || after.cancelled) Release(id.index);
+}
+
+void CoroutineScheduler::Release(uint32_t index) {
+    Slot& slot = slots[index];
+    Coroutine::Handle handle = slot.handle;
+    slot.handle = nullptr;
+    slot.waiting = false;
+    slot.running = false;
+    slot.cancelled = false;
+    slot.generation = slot.generation == UINT32_MAX ? 1 : slot.generation + 1;
+    freeSlots.push_back(index);
+    running--;
+    handle.destroy(); // last - the frame's destructors may well start or cancel other coroutines
+}
+
+// CoroutineEvent
+
+void CoroutineEvent::Set() {
+    std::vector<CoroutineWaker> woken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        set = true;
+        woken.swap(waiters);
+    }
+    for (const CoroutineWaker& waker : woken) waker.Wake();
+}
+
+void CoroutineEvent::Reset() {
+    std::lock_guard<std::mutex> lock(mutex);
+    set = false;
+}
+
+bool CoroutineEvent::IsSet() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return set;
+}
+
+bool CoroutineEvent::AddWaiter(CoroutineScheduler& scheduler, CoroutineId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (set) return false;
+    waiters.push_back(scheduler.Suspend(id));
+    return true;
+}
+
+// Await::AssetLoad
+
+bool Await::AssetLoad::Begin(CoroutineScheduler& scheduler, CoroutineId id) {
+    state = std::make_shared<State>();
+    auto finish = [state = state](Asset* asset) {
+        state->asset = asset;
+        state->done = true;
+        state->waker.Wake(); // nothing to wake if it finished inside LoadAssetAsync
+    };
+
+    LoadRequest request;
+    request.assetName = name;
+    request.filePath = path;
+    request.type = type;
+    request.priority = priority;
+    request.onComplete = finish;
+    request.onError = [finish](const std::string&) { finish(nullptr); };
+    AssetManager::GetInstance().LoadAssetAsync(request);
+
+    if (state->done) return false;
+    state->waker = scheduler.Suspend(id);
+    return true;
+}
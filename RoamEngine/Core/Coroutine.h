@@ -0,0 +1,372 @@
+// Coroutine.h - The patient one
+// Gameplay code that waits - for a frame, a timer, a load, a job or an event - written top to bottom
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Core/ThreadManager.h"
+
+class Asset;
+class CoroutineScheduler;
+enum class AssetType; // the full list lives in AssetManager.h
+
+// A coroutine handle - slot plus generation, like Entity, so a handle to a finished coroutine
+// doesn't point at whatever reused its slot. Generation 0 is never alive.
+struct CoroutineId {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+    bool operator==(const CoroutineId& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const CoroutineId& other) const { return !(*this == other); }
+};
+
+constexpr CoroutineId InvalidCoroutineId{};
+
+// The CoroutineFrameAllocator class - where coroutine frames live. Frames are rounded up to a size
+// class and kept on per-class free lists carved from big blocks, so starting and finishing
+// thousands of coroutines a frame never touches the general heap. Blocks are kept once made (the
+// pool stays at its high-water mark); frames bigger than the largest class go to the heap.
+class CoroutineFrameAllocator {
+public:
+    static void* Allocate(size_t size);
+    static void Free(void* frame, size_t size);
+
+    struct Stats {
+        size_t liveFrames = 0;
+        size_t liveBytes = 0;     // rounded up to the size class
+        size_t reservedBytes = 0; // in blocks
+    };
+    static Stats GetStats();
+
+    static constexpr size_t Granularity = 64;
+    static constexpr size_t MaxPooledSize = 4096;
+    static constexpr size_t BlockSize = 256 * 1024;
+};
+
+// The Coroutine class - what a coroutine function returns. Calling one only makes the frame; nothing
+// runs until it's handed to CoroutineScheduler::Start, which owns it from then on.
+//
+//     Coroutine OpenDoor(Door* door, CoroutineEvent* unlocked) {
+//         co_await Await::Event(*unlocked);
+//         Asset* sound = co_await Await::AssetLoad("door_open", AssetType::Audio);
+//         door->PlayOpen(sound);
+//         co_await Await::Seconds(2.0f);
+//         door->Close();
+//     }
+//     scheduler.Start(OpenDoor(door, &door->unlocked));
+//
+// Coroutines run on the thread that calls CoroutineScheduler::Update (the main thread) and nowhere
+// else. The engine doesn't use exceptions; one escaping a coroutine terminates.
+class Coroutine {
+public:
+    struct promise_type {
+        CoroutineScheduler* scheduler = nullptr;
+        CoroutineId id;
+
+        Coroutine get_return_object() { return Coroutine(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void* operator new(size_t size) { return CoroutineFrameAllocator::Allocate(size); }
+        static void operator delete(void* frame, size_t size) { CoroutineFrameAllocator::Free(frame, size); }
+    };
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Coroutine(Coroutine&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Coroutine& operator=(Coroutine&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    ~Coroutine() {
+        if (handle) handle.destroy(); // never started
+    }
+
+private:
+    friend class CoroutineScheduler;
+    explicit Coroutine(Handle handle) : handle(handle) {}
+
+    // Prevent copying - a frame has one owner
+    Coroutine(const Coroutine&) = delete;
+    Coroutine& operator=(const Coroutine&) = delete;
+
+    Handle handle;
+};
+
+// Wakes posted from anywhere, collected by the scheduler at its next Update
+struct CoroutineMailbox {
+    std::mutex mutex;
+    std::vector<CoroutineId> posted;
+};
+
+// The CoroutineWaker class - what something asynchronous keeps so it can wake a coroutine when it's
+// done. Wake is thread-safe, and harmless once the coroutine is cancelled or the scheduler is gone.
+class CoroutineWaker {
+public:
+    CoroutineWaker() {}
+
+    void Wake() const {
+        if (!mailbox) return;
+        std::lock_guard<std::mutex> lock(mailbox->mutex);
+        mailbox->posted.push_back(id);
+    }
+    bool IsValid() const { return mailbox != nullptr; }
+
+private:
+    friend class CoroutineScheduler;
+    CoroutineWaker(std::shared_ptr<CoroutineMailbox> mailbox, CoroutineId id) : mailbox(std::move(mailbox)), id(id) {}
+
+    std::shared_ptr<CoroutineMailbox> mailbox;
+    CoroutineId id;
+};
+
+// The CoroutineScheduler class - owns the running coroutines and resumes them when what they wait on
+// happens. Nothing is polled: a coroutine waiting on the next frame sits in a list swapped out once
+// per Update, one waiting on a timer sits in a heap ordered by wake time, and everything else (events,
+// loads, jobs) pushes it onto the ready list itself. A frame with ten thousand coroutines asleep costs
+// what the ones waking up cost.
+//
+// Time is the scheduler's own: the sum of the deltas given to Update, so game time (scaled, paused)
+// if that's what TimeManager hands it. Everything here is for the main thread except the wakers.
+class CoroutineScheduler {
+public:
+    CoroutineScheduler();
+    ~CoroutineScheduler(); // waits for its jobs, then destroys whatever is still waiting
+
+    // Workers for Await::Job - without them jobs run inline, on the spot. Changing it waits for the
+    // jobs already out.
+    void SetJobSystem(ThreadManager* jobs);
+    ThreadManager* GetJobSystem() const { return jobSystem; }
+
+    // Take a coroutine and run it up to its first wait. Returns InvalidCoroutineId if it finished
+    // without waiting (or was empty).
+    CoroutineId Start(Coroutine coroutine);
+
+    // Destroy a waiting coroutine, locals and all - false if it isn't running. A coroutine can
+    // cancel itself; it goes at its next wait. Jobs it started keep going, so give Await::Job
+    // copies rather than references to the coroutine's locals.
+    bool Cancel(CoroutineId id);
+    void CancelAll();
+    bool IsRunning(CoroutineId id) const;
+
+    // Call once per frame - advances the clock by deltaTime seconds and resumes whatever is due:
+    // the ones that asked for this frame, expired timers, then anything woken since last time
+    void Update(float deltaTime);
+
+    double GetTime() const { return time; }
+    uint64_t GetFrame() const { return frame; }
+
+    struct Stats {
+        size_t running = 0;
+        size_t waitingForFrame = 0;
+        size_t timers = 0;  // timer entries, including ones left by cancelled coroutines
+        size_t resumed = 0; // in the last Update
+    };
+    Stats GetStats() const;
+
+    // For awaitables - a coroutine about to wait on something. Suspend marks it waiting and hands
+    // back the waker to call when that something happens; the rest pick their own wake-up.
+    CoroutineWaker Suspend(CoroutineId id);
+    void WaitForNextFrame(CoroutineId id);
+    void WaitUntil(CoroutineId id, double wakeTime);
+    void SubmitJob(std::function<void()> job);
+
+private:
+    // Prevent copying - coroutines know which scheduler they're on
+    CoroutineScheduler(const CoroutineScheduler&) = delete;
+    CoroutineScheduler& operator=(const CoroutineScheduler&) = delete;
+
+    struct Slot {
+        Coroutine::Handle handle;
+        uint32_t generation = 1;
+        bool waiting = false;   // suspended on something - only then can it be resumed
+        bool running = false;   // somewhere up the call stack right now
+        bool cancelled = false; // cancelled while running - destroyed when it next suspends
+    };
+
+    struct Timer {
+        double wakeTime;
+        CoroutineId id;
+        bool operator>(const Timer& other) const { return wakeTime > other.wakeTime; }
+    };
+
+    Slot* Find(CoroutineId id);
+    const Slot* Find(CoroutineId id) const;
+    void Resume(CoroutineId id);
+    void Release(uint32_t index);
+    void WaitForJobs();
+
+    std::vector<Slot> slots;
+    std::vector<uint32_t> freeSlots;
+    size_t running;
+
+    std::vector<CoroutineId> nextFrame;
+    std::vector<Timer> timers; // min-heap on wakeTime
+    std::vector<CoroutineId> ready;
+    std::shared_ptr<CoroutineMailbox> mailbox;
+
+    ThreadManager* jobSystem;
+    JobCounter jobsInFlight;
+
+    double time;
+    uint64_t frame;
+    size_t resumedLastUpdate;
+};
+
+// The CoroutineEvent class - a flag coroutines can wait on. Set wakes everyone waiting and stays set
+// (later waits go straight through) until Reset. Set and Reset are thread-safe. An event destroyed
+// with coroutines still waiting leaves them asleep until they're cancelled.
+class CoroutineEvent {
+public:
+    CoroutineEvent() : set(false) {}
+
+    void Set();
+    void Reset();
+    bool IsSet() const;
+
+    // False if it's already set - otherwise the coroutine is on the list
+    bool AddWaiter(CoroutineScheduler& scheduler, CoroutineId id);
+
+private:
+    // Prevent copying - waiters are on this one
+    CoroutineEvent(const CoroutineEvent&) = delete;
+    CoroutineEvent& operator=(const CoroutineEvent&) = delete;
+
+    mutable std::mutex mutex;
+    bool set;
+    std::vector<CoroutineWaker> waiters;
+};
+
+// Things to co_await inside a Coroutine
+namespace Await {
+    // Resume in the next Update
+    struct NextFrame {
+        bool await_ready() const { return false; }
+        void await_suspend(Coroutine::Handle handle) const {
+            handle.promise().scheduler->WaitForNextFrame(handle.promise().id);
+        }
+        void await_resume() const {}
+    };
+
+    // Resume in the first Update at least this many seconds of scheduler time from now
+    struct Seconds {
+        explicit Seconds(float seconds) : seconds(seconds) {}
+
+        bool await_ready() const { return false; }
+        void await_suspend(Coroutine::Handle handle) const {
+            CoroutineScheduler& scheduler = *handle.promise().scheduler;
+            scheduler.WaitUntil(handle.promise().id, scheduler.GetTime() + seconds);
+        }
+        void await_resume() const {}
+
+        float seconds;
+    };
+
+    // Resume once the event is set - straight through if it already is
+    struct Event {
+        explicit Event(CoroutineEvent& event) : event(event) {}
+
+        bool await_ready() const { return event.IsSet(); }
+        bool await_suspend(Coroutine::Handle handle) const {
+            return event.AddWaiter(*handle.promise().scheduler, handle.promise().id);
+        }
+        void await_resume() const {}
+
+        CoroutineEvent& event;
+    };
+
+    // Load an asset through AssetManager::LoadAssetAsync and resume with it - nullptr if it failed.
+    // Like any LoadAssetAsync, the load holds a reference the caller unloads. Already-loaded assets
+    // don't wait at all.
+    class AssetLoad {
+    public:
+        AssetLoad(std::string name, AssetType type, int priority = 0 /* DefaultLoadPriority */, std::string path = "")
+            : name(std::move(name)), path(std::move(path)), type(type), priority(priority) {}
+
+        bool await_ready() const { return false; }
+        bool await_suspend(Coroutine::Handle handle) { return Begin(*handle.promise().scheduler, handle.promise().id); }
+        Asset* await_resume() const { return state ? state->asset : nullptr; }
+
+    private:
+        // Only touched on the main thread - LoadAssetAsync reports in UpdateAsyncLoading or right away
+        struct State {
+            Asset* asset = nullptr;
+            bool done = false;
+            CoroutineWaker waker;
+        };
+
+        bool Begin(CoroutineScheduler& scheduler, CoroutineId id);
+
+        std::string name;
+        std::string path;
+        AssetType type;
+        int priority;
+        std::shared_ptr<State> state;
+    };
+
+    // Run function on a worker and resume with what it returns - a path query, say:
+    //     std::vector<Vector3> path = co_await Await::Job([ai, from, to] { return ai->FindPath(from, to); });
+    template<typename Function>
+    class Job {
+    public:
+        using Result = std::invoke_result_t<Function&>;
+
+        explicit Job(Function function) : function(std::move(function)) {}
+
+        bool await_ready() const { return false; }
+        bool await_suspend(Coroutine::Handle handle) {
+            CoroutineScheduler& scheduler = *handle.promise().scheduler;
+            state = std::make_shared<State>();
+            if (!scheduler.GetJobSystem()) {
+                Run(*state, function);
+                return false;
+            }
+            CoroutineWaker waker = scheduler.Suspend(handle.promise().id);
+            scheduler.SubmitJob([state = state, function = std::move(function), waker]() mutable {
+                Run(*state, function);
+                waker.Wake();
+            });
+            return true;
+        }
+        Result await_resume() {
+            if constexpr (!std::is_void_v<Result>) return std::move(*state->result);
+        }
+
+    private:
+        struct Empty {};
+        struct State {
+            std::optional<std::conditional_t<std::is_void_v<Result>, Empty, Result>> result;
+        };
+
+        static void Run(State& state, Function& function) {
+            if constexpr (std::is_void_v<Result>) {
+                function();
+                state.result.emplace();
+            } else {
+                state.result.emplace(function());
+            }
+        }
+
+        Function function;
+        std::shared_ptr<State> state;
+    };
+}
+
+#endif // COROUTINE_H
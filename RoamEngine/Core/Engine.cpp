@@ -2,6 +2,7 @@
 // This code is either brilliant or a complete disaster
 
 #include "Engine.h"
+#include <algorithm>
 #include <iostream>
 
 // Include all the managers - hope they don't fight
@@ -12,6 +13,14 @@
 #include "EventSystem.h"
 #include "ResourceManager.h"
 #include "ThreadManager.h"
+#include "Coroutine.h"
+#include "Math/FileSystem.h"
+#include "Math/AsyncFileIO.h"
+#include "Math/FileIndex.h"
+#include "Math/VirtualFileSystem.h"
+#include "Assets/AssetManager.h"
+#include "Assets/DerivedDataCache.h"
+#include "Scene/SpatialIndex.h"
 
 Engine::Engine() : isRunning(false) {
     // Constructor - setting up the throne room
@@ -35,14 +44,48 @@ bool Engine::Initialize(const std::string& configFile) {
         eventSystem = std::make_unique<EventSystem>();
         resourceManager = std::make_unique<ResourceManager>();
         threadManager = std::make_unique<ThreadManager>();
+        spatialIndex = std::make_unique<SpatialIndex>();
+        coroutineScheduler = std::make_unique<CoroutineScheduler>();
         application = std::make_unique<Application>();
 
-        // Load config - because defaults are for losers
+        // Load config - because defaults are for losers (and the job system reads it next)
         if (!configManager->LoadConfig(configFile)) {
             std::cerr << "Failed to load config file: " << configFile << std::endl;
             return false;
         }
 
+        // Workers first, then the background reader that hands its callbacks to them
+        FiberSettings fibers;
+        fibers.enabled = configManager->GetBool("jobs.fibers", fibers.enabled);
+        fibers.fiberCount = static_cast<uint32_t>(std::max(0, configManager->GetInt("jobs.fiberCount", static_cast<int>(fibers.fiberCount))));
+        fibers.maxFiberCount = static_cast<uint32_t>(std::max(0, configManager->GetInt("jobs.maxFiberCount", static_cast<int>(fibers.maxFiberCount))));
+        fibers.stackSize = static_cast<size_t>(std::max(16, configManager->GetInt("jobs.fiberStackKB", static_cast<int>(fibers.stackSize / 1024)))) * 1024;
+        uint32_t workerCount = static_cast<uint32_t>(std::max(0, configManager->GetInt("jobs.workers", 0))); // 0 - one per core
+        threadManager->Initialize(workerCount, fibers);
+        FileSystem::GetAsyncIO().Initialize(threadManager.get());
+        VirtualFileSystem::GetInstance().SetJobSystem(threadManager.get());
+        AssetManager::GetInstance().SetJobSystem(threadManager.get());
+        coroutineScheduler->SetJobSystem(threadManager.get());
+
+        // Derived data cache - not fatal if it won't open, everything just gets cooked from scratch
+        std::string cachePath = configManager->GetString("ddc.path", "DerivedDataCache");
+        uint64_t cacheMegabytes = static_cast<uint64_t>(configManager->GetInt("ddc.maxSizeMB", 2048));
+        if (!DerivedDataCache::GetInstance().Initialize(cachePath, cacheMegabytes * 1024 * 1024)) {
+            std::cerr << "Failed to open derived data cache at " << cachePath << " - cooking without it" << std::endl;
+        }
+
+        // File index - last run's listing plus whatever changed since, instead of walking the whole tree
+        FileIndex& fileIndex = FileSystem::GetFileIndex();
+        fileIndex.SetJobSystem(threadManager.get());
+        std::string assetsPath = configManager->GetString("assets.path", "Assets");
+        std::string indexPath = cachePath + "/FileIndex.bin";
+        if (fileIndex.Load(indexPath, assetsPath)) {
+            fileIndex.Validate();
+        } else if (!fileIndex.Build(assetsPath)) {
+            std::cerr << "Failed to index " << assetsPath << " - asset discovery goes to the disk" << std::endl;
+        }
+        fileIndex.StartWatching();
+
         // Initialize application last - it's the boss
         if (!application->Initialize()) {
             std::cerr << "Failed to initialize application" << std::endl;
@@ -75,9 +118,19 @@ void Engine::Run() {
         // Process events - handle the chaos
         eventSystem->ProcessEvents();
 
+        // Catch the file index up with the disk - a handful of inotify events on a normal frame
+        FileSystem::GetFileIndex().Poll();
+
         // Update application - do the actual work
         application->Update();
 
+        // Hand over finished loads - bounded by the asset manager's per-frame budget
+        AssetManager::GetInstance().UpdateAsyncLoading();
+
+        // Wake the coroutines whose frame, timer, load or job came up - after the loads, so one
+        // that finished this frame is picked up this frame
+        coroutineScheduler->Update(timeManager->GetDeltaTime());
+
         // Render - make it pretty
         application->Render();
 
@@ -97,6 +150,18 @@ void Engine::Shutdown() {
     }
 
     // Shutdown managers in reverse order - like a civilized shutdown
+    FileIndex& fileIndex = FileSystem::GetFileIndex();
+    if (configManager && !fileIndex.GetRootPath().empty()) {
+        fileIndex.Save(configManager->GetString("ddc.path", "DerivedDataCache") + "/FileIndex.bin");
+    }
+    fileIndex.Clear();
+    fileIndex.SetJobSystem(nullptr);
+    coroutineScheduler.reset(); // waits for its jobs, so while the workers are still here
+    AssetManager::GetInstance().SetJobSystem(nullptr); // waits for its reads, so before the reader goes
+    DerivedDataCache::GetInstance().Shutdown();
+    FileSystem::GetAsyncIO().Shutdown();
+    VirtualFileSystem::GetInstance().SetJobSystem(nullptr);
+    spatialIndex.reset();
     threadManager.reset();
     resourceManager.reset();
     eventSystem.reset();
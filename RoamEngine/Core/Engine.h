@@ -15,6 +15,8 @@ class ConfigManager;
 class EventSystem;
 class ResourceManager;
 class ThreadManager;
+class SpatialIndex;
+class CoroutineScheduler;
 
 // The Engine class - our digital god
 class Engine {
@@ -35,6 +37,9 @@ public:
     Application* GetApplication() { return application.get(); }
     Logger* GetLogger() { return logger.get(); }
     TimeManager* GetTimeManager() { return timeManager.get(); }
+    ThreadManager* GetThreadManager() { return threadManager.get(); }
+    SpatialIndex* GetSpatialIndex() { return spatialIndex.get(); }
+    CoroutineScheduler* GetCoroutineScheduler() { return coroutineScheduler.get(); }
 
 private:
     // All our precious managers
@@ -45,6 +50,8 @@ private:
     std::unique_ptr<EventSystem> eventSystem;
     std::unique_ptr<ResourceManager> resourceManager;
     std::unique_ptr<ThreadManager> threadManager;
+    std::unique_ptr<SpatialIndex> spatialIndex;
+    std::unique_ptr<CoroutineScheduler> coroutineScheduler;
 
     // Engine state - running or crying in a corner
     bool isRunning;
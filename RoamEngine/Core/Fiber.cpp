@@ -0,0 +1,241 @@
+// Fiber.cpp - Implementation of the understudy
+// The context switch itself, in assembly, and the stacks it switches between
+
+#include "Fiber.h"
+#include <algorithm>
+#include <cstring>
+
+#if ROAM_FIBERS_SUPPORTED
+#include <sys/mman.h>
+#include <unistd.h>
+
+// RoamFiberSwitch(void** saveStackPointer, void* loadStackPointer) pushes the callee-saved registers
+// (and the floating-point control state, which the ABI also says survives a call), saves the stack
+// pointer, loads the other one and pops its registers. RoamFiberStart is where a new fiber's first
+// switch "returns" to: it calls entry(argument) from the registers Create left for it.
+#if defined(__x86_64__)
+asm(R"(
+    .text
+    .globl RoamFiberSwitch
+    .type RoamFiberSwitch, @function
+    .p2align 4
+RoamFiberSwitch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size RoamFiberSwitch, .-RoamFiberSwitch
+
+    .globl RoamFiberStart
+    .type RoamFiberStart, @function
+    .p2align 4
+RoamFiberStart:
+    movq %r13, %rdi
+    callq *%r12
+    ud2
+    .size RoamFiberStart, .-RoamFiberStart
+)");
+#elif defined(__aarch64__)
+asm(R"(
+    .text
+    .globl RoamFiberSwitch
+    .type RoamFiberSwitch, %function
+    .p2align 4
+RoamFiberSwitch:
+    sub sp, sp, #176
+    stp x19, x20, [sp, #0]
+    stp x21, x22, [sp, #16]
+    stp x23, x24, [sp, #32]
+    stp x25, x26, [sp, #48]
+    stp x27, x28, [sp, #64]
+    stp x29, x30, [sp, #80]
+    stp d8, d9, [sp, #96]
+    stp d10, d11, [sp, #112]
+    stp d12, d13, [sp, #128]
+    stp d14, d15, [sp, #144]
+    mrs x9, fpcr
+    str x9, [sp, #160]
+    mov x9, sp
+    str x9, [x0]
+    mov sp, x1
+    ldp x19, x20, [sp, #0]
+    ldp x21, x22, [sp, #16]
+    ldp x23, x24, [sp, #32]
+    ldp x25, x26, [sp, #48]
+    ldp x27, x28, [sp, #64]
+    ldp x29, x30, [sp, #80]
+    ldp d8, d9, [sp, #96]
+    ldp d10, d11, [sp, #112]
+    ldp d12, d13, [sp, #128]
+    ldp d14, d15, [sp, #144]
+    ldr x9, [sp, #160]
+    msr fpcr, x9
+    add sp, sp, #176
+    ret
+    .size RoamFiberSwitch, .-RoamFiberSwitch
+
+    .globl RoamFiberStart
+    .type RoamFiberStart, %function
+    .p2align 4
+RoamFiberStart:
+    mov x0, x20
+    blr x19
+    brk #0
+    .size RoamFiberStart, .-RoamFiberStart
+)");
+#endif
+
+extern "C" void RoamFiberSwitch(void** saveStackPointer, void* loadStackPointer);
+extern "C" void RoamFiberStart();
+#endif // ROAM_FIBERS_SUPPORTED
+
+Fiber::Fiber() : stack(nullptr), mappingSize(0), stackSize(0) {
+}
+
+Fiber::~Fiber() {
+#if ROAM_FIBERS_SUPPORTED
+    if (stack) munmap(stack, mappingSize);
+#endif
+}
+
+bool Fiber::Create(size_t requestedSize, EntryPoint entry, void* argument) {
+#if ROAM_FIBERS_SUPPORTED
+    if (stack || !entry) return false;
+
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t size = (requestedSize + pageSize - 1) / pageSize * pageSize;
+    void* mapping = mmap(nullptr, size + pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) return false;
+    mprotect(mapping, pageSize, PROT_NONE); // an overflow faults here instead of walking into the next stack
+
+    stack = mapping;
+    mappingSize = size + pageSize;
+    stackSize = size;
+
+    // The frame RoamFiberSwitch expects to pop, laid out so that its ret lands in RoamFiberStart
+    // with the stack aligned for the call to entry
+    uintptr_t top = reinterpret_cast<uintptr_t>(mapping) + mappingSize;
+#if defined(__x86_64__)
+    uint64_t* frame = reinterpret_cast<uint64_t*>(top) - 8;
+    frame[0] = 0x1F80u | (uint64_t(0x037Fu) << 32);              // default MXCSR, then x87 control word
+    frame[1] = 0;                                                // r15
+    frame[2] = 0;                                                // r14
+    frame[3] = reinterpret_cast<uint64_t>(argument);             // r13
+    frame[4] = reinterpret_cast<uint64_t>(entry);                // r12
+    frame[5] = 0;                                                // rbx
+    frame[6] = 0;                                                // rbp
+    frame[7] = reinterpret_cast<uint64_t>(&RoamFiberStart);      // return address
+#elif defined(__aarch64__)
+    uint64_t* frame = reinterpret_cast<uint64_t*>(top - 176);
+    std::memset(frame, 0, 176);
+    frame[0] = reinterpret_cast<uint64_t>(entry);                // x19
+    frame[1] = reinterpret_cast<uint64_t>(argument);             // x20
+    frame[11] = reinterpret_cast<uint64_t>(&RoamFiberStart);     // x30
+#endif
+    context.stackPointer = frame;
+    return true;
+#else
+    (void)requestedSize;
+    (void)entry;
+    (void)argument;
+    return false;
+#endif
+}
+
+void Fiber::Switch(FiberContext& from, FiberContext& to) {
+#if ROAM_FIBERS_SUPPORTED
+    RoamFiberSwitch(&from.stackPointer, to.stackPointer);
+#else
+    (void)from;
+    (void)to;
+#endif
+}
+
+// FiberPool
+
+FiberPool::FiberPool() : maxCount(0), stackSize(0), entry(nullptr), argument(nullptr) {
+}
+
+FiberPool::~FiberPool() {
+    Destroy();
+}
+
+bool FiberPool::Create(uint32_t count, uint32_t maxFiberCount, size_t fiberStackSize, Fiber::EntryPoint fiberEntry, void* fiberArgument) {
+    Destroy();
+    std::lock_guard<std::mutex> lock(mutex);
+    maxCount = std::max(count, maxFiberCount);
+    stackSize = fiberStackSize;
+    entry = fiberEntry;
+    argument = fiberArgument;
+    fibers.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        Fiber* fiber = new Fiber();
+        fibers.push_back(fiber);
+        if (!fiber->Create(stackSize, entry, argument)) {
+            for (Fiber* made : fibers) delete made;
+            fibers.clear();
+            return false;
+        }
+    }
+    freeFibers = fibers;
+    return true;
+}
+
+void FiberPool::Destroy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Fiber* fiber : fibers) delete fiber;
+    fibers.clear();
+    freeFibers.clear();
+}
+
+Fiber* FiberPool::Acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!freeFibers.empty()) {
+        Fiber* fiber = freeFibers.back();
+        freeFibers.pop_back();
+        return fiber;
+    }
+
+    // All out - more are parked than the pool was sized for, so grow it
+    if (fibers.empty()) return nullptr; // never created, or destroyed
+    if (fibers.size() >= maxCount) return nullptr; // the caller waits some other way
+    Fiber* fiber = new Fiber();
+    if (!fiber->Create(stackSize, entry, argument)) {
+        delete fiber;
+        return nullptr;
+    }
+    fibers.push_back(fiber);
+    return fiber;
+}
+
+void FiberPool::Release(Fiber* fiber) {
+    std::lock_guard<std::mutex> lock(mutex);
+    freeFibers.push_back(fiber);
+}
+
+uint32_t FiberPool::GetCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<uint32_t>(fibers.size());
+}
+
+uint32_t FiberPool::GetFreeCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<uint32_t>(freeFibers.size());
+}
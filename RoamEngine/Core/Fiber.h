@@ -0,0 +1,94 @@
+// Fiber.h - The understudy
+// Stacks a thread can switch between by hand, so a job can step aside without its worker stopping
+
+#ifndef FIBER_H
+#define FIBER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Hand-written switches for x86-64 and AArch64 Linux - anywhere else fibers are off and the job
+// system waits the way it always has
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define ROAM_FIBERS_SUPPORTED 1
+#else
+#define ROAM_FIBERS_SUPPORTED 0
+#endif
+
+// A suspended execution - just the stack pointer, everything else was pushed onto the stack by the
+// switch. A thread's own stack gets one of these the first time it switches to a fiber.
+struct FiberContext {
+    void* stackPointer = nullptr;
+};
+
+// The Fiber class - a stack and the context suspended on it. A new fiber starts in entry(argument)
+// the first time it's switched to; entry must never return, only switch away.
+class Fiber {
+public:
+    using EntryPoint = void (*)(void* argument);
+
+    Fiber();
+    ~Fiber();
+
+    // Map the stack (plus a guard page below it) and set the fiber up to start in entry - false if
+    // fibers aren't supported here or the memory couldn't be had
+    bool Create(size_t stackSize, EntryPoint entry, void* argument);
+    bool IsCreated() const { return stack != nullptr; }
+
+    FiberContext& GetContext() { return context; }
+    size_t GetStackSize() const { return stackSize; }
+
+    // Save what's running into from and carry on in to. Returns when something switches back to from.
+    static void Switch(FiberContext& from, FiberContext& to);
+
+private:
+    // Prevent copying - the context points into our stack
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    FiberContext context;
+    void* stack;        // the whole mapping, guard page first
+    size_t mappingSize;
+    size_t stackSize;
+};
+
+// The FiberPool class - fibers made up front, all starting in the same entry point. If they're all in
+// use Acquire makes another rather than fail, and the pool keeps it - up to maxCount, where Acquire
+// gives up so a runaway fork/join can't map stacks without end. Acquire and Release are
+// thread-safe. A released fiber keeps its suspended context, so acquiring it again resumes it where
+// it left off rather than starting over.
+class FiberPool {
+public:
+    FiberPool();
+    ~FiberPool();
+
+    // False if any fiber couldn't be made - the pool is left empty. It never grows past maxCount
+    // (or count, if that's more).
+    bool Create(uint32_t count, uint32_t maxCount, size_t stackSize, Fiber::EntryPoint entry, void* argument);
+    void Destroy();
+
+    Fiber* Acquire(); // nullptr if all are in use at the cap, or a new one couldn't be made
+    void Release(Fiber* fiber);
+
+    uint32_t GetCount() const;
+    uint32_t GetFreeCount() const;
+
+private:
+    // Prevent copying - fibers are handed out by address
+    FiberPool(const FiberPool&) = delete;
+    FiberPool& operator=(const FiberPool&) = delete;
+
+    std::vector<Fiber*> fibers;
+    std::vector<Fiber*> freeFibers;
+    mutable std::mutex mutex;
+
+    // For making more
+    uint32_t maxCount;
+    size_t stackSize;
+    Fiber::EntryPoint entry;
+    void* argument;
+};
+
+#endif // FIBER_H
@@ -0,0 +1,135 @@
+// Reflection.h - The mirror
+// What a type is made of, spelled out once at compile time so code can walk its fields
+
+#ifndef REFLECTION_H
+#define REFLECTION_H
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+
+// Describing a type - specialize Reflect next to it:
+//
+//     template<> struct Reflect<Health> {
+//         static constexpr std::string_view Name = "Health";
+//         static constexpr uint32_t Version = 2;
+//         static constexpr auto Fields = std::make_tuple(
+//             MakeField("current", &Health::current),
+//             MakeField("maximum", &Health::maximum),
+//             MakeField("regeneration", &Health::regeneration, 2),   // added in version 2
+//             MakeRetiredField<int32_t, Health>("armour", 1, 2));    // gone in version 2
+//     };
+//
+// Name identifies the type in saved data, so don't change it once anything's been saved. Version
+// is optional (1 if left out). Fields are in the order they're stored; put new ones at the end.
+template<typename T>
+struct Reflect;
+
+template<typename T>
+concept Reflected = requires {
+    { Reflect<T>::Name } -> std::convertible_to<std::string_view>;
+    Reflect<T>::Fields;
+};
+
+// A member - since is the version it first appeared in
+template<typename Class, typename Member>
+struct Field {
+    using ClassType = Class;
+    using MemberType = Member;
+
+    std::string_view name;
+    Member Class::* pointer;
+    uint32_t since;
+
+    bool IsIn(uint32_t version) const { return version >= since; }
+    Member& Get(Class& object) const { return object.*pointer; }
+    const Member& Get(const Class& object) const { return object.*pointer; }
+};
+
+// A member that used to exist - read from data saved in [since, until), handed to migrate if there
+// is one, never written
+template<typename Class, typename Value>
+struct RetiredField {
+    using ClassType = Class;
+    using ValueType = Value;
+
+    std::string_view name;
+    uint32_t since;
+    uint32_t until;
+    void (*migrate)(Class& object, const Value& value);
+
+    bool IsIn(uint32_t version) const { return version >= since && version < until; }
+};
+
+template<typename Class, typename Member>
+constexpr Field<Class, Member> MakeField(std::string_view name, Member Class::* pointer, uint32_t since = 1) {
+    return Field<Class, Member>{ name, pointer, since };
+}
+
+template<typename Value, typename Class>
+constexpr RetiredField<Class, Value> MakeRetiredField(std::string_view name, uint32_t since, uint32_t until,
+                                                      void (*migrate)(Class&, const Value&) = nullptr) {
+    return RetiredField<Class, Value>{ name, since, until, migrate };
+}
+
+template<typename F>
+struct IsRetiredField : std::false_type {};
+template<typename Class, typename Value>
+struct IsRetiredField<RetiredField<Class, Value>> : std::true_type {};
+
+// The current version of a reflected type
+template<Reflected T>
+constexpr uint32_t GetReflectedVersion() {
+    if constexpr (requires { Reflect<T>::Version; }) {
+        return Reflect<T>::Version;
+    } else {
+        return 1;
+    }
+}
+
+// Every field, retired ones included, in order - function gets each field descriptor
+template<Reflected T, typename Function>
+constexpr void ForEachField(Function&& function) {
+    std::apply([&](const auto&... fields) { (function(fields), ...); }, Reflect<T>::Fields);
+}
+
+// Only the fields the type has now
+template<Reflected T, typename Function>
+constexpr void ForEachCurrentField(Function&& function) {
+    ForEachField<T>([&](const auto& field) {
+        if constexpr (!IsRetiredField<std::decay_t<decltype(field)>>::value) function(field);
+    });
+}
+
+template<Reflected T>
+constexpr size_t GetFieldCount() {
+    size_t count = 0;
+    ForEachCurrentField<T>([&](const auto&) { count++; });
+    return count;
+}
+
+// The engine's own value types
+template<> struct Reflect<Vector3> {
+    static constexpr std::string_view Name = "Vector3";
+    static constexpr auto Fields = std::make_tuple(MakeField("x", &Vector3::x), MakeField("y", &Vector3::y), MakeField("z", &Vector3::z));
+};
+
+template<> struct Reflect<Vector3d> {
+    static constexpr std::string_view Name = "Vector3d";
+    static constexpr auto Fields = std::make_tuple(MakeField("x", &Vector3d::x), MakeField("y", &Vector3d::y), MakeField("z", &Vector3d::z));
+};
+
+template<> struct Reflect<Quaternion> {
+    static constexpr std::string_view Name = "Quaternion";
+    static constexpr auto Fields = std::make_tuple(MakeField("x", &Quaternion::x), MakeField("y", &Quaternion::y),
+                                                   MakeField("z", &Quaternion::z), MakeField("w", &Quaternion::w));
+};
+
+#endif // REFLECTION_H
@@ -8,6 +8,8 @@
 #include <unordered_map>
 #include <memory>
 #include <mutex>
+#include "Math/FileSystem.h"
+#include "Math/VirtualFileSystem.h"
 
 // Resource types - what we can load
 enum class ResourceType {
@@ -33,6 +35,16 @@ public:
     // Unload the resource - free the memory
     virtual void Unload() = 0;
 
+    // Zero-copy loading - override both to parse straight out of a memory-mapped file.
+    // Hold on to the mapping if you keep pointers into it; it stays mapped while anyone does.
+    virtual bool SupportsMappedLoading() const { return false; }
+    virtual bool LoadFromMappedFile(std::shared_ptr<const MappedFile> /*mapping*/) { return false; }
+
+    // Pack-aware loading - the view may be a slice of a mounted pack, whole loose files go to LoadFromMappedFile
+    virtual bool LoadFromView(const FileView& view) {
+        return view.IsWholeFile() && LoadFromMappedFile(view.mapping);
+    }
+
     // Get resource type - what are you?
     virtual ResourceType GetType() const = 0;
 
@@ -99,7 +111,7 @@ public:
 
         // Create new resource
         auto resource = std::make_unique<T>(path);
-        if (resource->Load()) {
+        if (LoadResourceData(*resource)) {
             T* ptr = resource.get();
             resources[path] = std::move(resource);
             return ResourceHandle<T>(ptr);
@@ -118,6 +130,17 @@ public:
     size_t GetMemoryUsage() const;
 
 private:
+    // Load through the VFS when the resource can parse from memory (packs included), the old-fashioned way otherwise
+    static bool LoadResourceData(Resource& resource) {
+        if (resource.SupportsMappedLoading()) {
+            FileView view;
+            if (VirtualFileSystem::GetInstance().Open(resource.GetFilePath(), view)) {
+                return resource.LoadFromView(view);
+            }
+        }
+        return resource.Load();
+    }
+
     // Our resource collection - the library
     std::unordered_map<std::string, std::unique_ptr<Resource>> resources;
 
@@ -0,0 +1,58 @@
+// Serializer.cpp - Implementation of the packer
+// Only the schema table lives here - the rest is templates, stamped out per type
+
+#include "Serializer.h"
+#include <atomic>
+
+uint32_t SchemaTable::NextTypeIndex() {
+    static std::atomic<uint32_t> next{ 0 };
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool SchemaTable::Add(std::string_view name, uint32_t version) {
+    if (Find(name) != 0) return false;
+    entries.push_back(Entry{ std::string(name), version });
+    versionCache.clear();
+    return true;
+}
+
+uint32_t SchemaTable::Find(std::string_view name) const {
+    for (const Entry& entry : entries) {
+        if (entry.name == name) return entry.version;
+    }
+    return 0;
+}
+
+void SchemaTable::Clear() {
+    entries.clear();
+    versionCache.clear();
+}
+
+void SchemaTable::Write(BinaryWriter& writer) const {
+    writer.Write(static_cast<uint32_t>(entries.size()));
+    for (const Entry& entry : entries) {
+        writer.WriteString(entry.name);
+        writer.Write(entry.version);
+    }
+}
+
+bool SchemaTable::Read(BinaryReader& reader) {
+    Clear();
+    uint32_t count = reader.Read<uint32_t>();
+    if (!reader.IsOk() || count > reader.GetRemaining() / 8) { // every entry is at least a length and a version
+        reader.Fail();
+        return false;
+    }
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        std::string name = reader.ReadString();
+        uint32_t version = reader.Read<uint32_t>();
+        if (!reader.IsOk() || version == 0) {
+            reader.Fail();
+            Clear();
+            return false;
+        }
+        entries.push_back(Entry{ std::move(name), version });
+    }
+    return true;
+}
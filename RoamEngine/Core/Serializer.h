@@ -0,0 +1,288 @@
+// Serializer.h - The packer
+// Turns reflected types into bytes and back - memcpy wherever the bytes already are the format
+
+#ifndef SERIALIZER_H
+#define SERIALIZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include "Core/BinaryStream.h"
+#include "Core/Reflection.h"
+
+// The SchemaTable class - the version of every reflected type in a stream, written once up front
+// so data saved by an older build can be read field by field and migrated. Lookups by type are
+// cached, so a table is used from one thread at a time.
+class SchemaTable {
+public:
+    // T and every reflected type reachable from its fields, at their current versions
+    template<typename T>
+    void Add();
+    bool Add(std::string_view name, uint32_t version); // false if it was already there
+
+    // 0 if the stream has no such type
+    uint32_t Find(std::string_view name) const;
+    template<Reflected T>
+    uint32_t GetVersion() const;
+
+    size_t GetCount() const { return entries.size(); }
+    void Clear();
+
+    void Write(BinaryWriter& writer) const;
+    bool Read(BinaryReader& reader);
+
+private:
+    struct Entry {
+        std::string name;
+        uint32_t version;
+    };
+
+    static constexpr uint32_t NotLookedUp = UINT32_MAX;
+
+    static uint32_t NextTypeIndex();
+    template<typename T>
+    static uint32_t GetTypeIndex() {
+        static const uint32_t index = NextTypeIndex();
+        return index;
+    }
+
+    std::vector<Entry> entries;
+    mutable std::vector<uint32_t> versionCache; // by GetTypeIndex
+};
+
+namespace SerializerDetail {
+    template<typename T> struct IsStdVector : std::false_type {};
+    template<typename T, typename Allocator> struct IsStdVector<std::vector<T, Allocator>> : std::true_type {};
+    template<typename T> struct IsStdArray : std::false_type {};
+    template<typename T, size_t N> struct IsStdArray<std::array<T, N>> : std::true_type {};
+    template<typename T> constexpr bool AlwaysFalse = false;
+}
+
+// The Serializer class - the binary format is every current field in order, packed, numbers as
+// they are in memory. Types it understands: numbers and enums, std::string, std::vector and
+// std::array of anything it understands, and reflected types made of those.
+//
+// A block is a type whose memory already is that format - a number, or a trivially copyable
+// reflected type whose fields are blocks laid out in field order with no padding. Blocks, and
+// arrays and vectors of them, are written and read with one memcpy. Reading data saved at an older
+// version goes field by field instead: fields added since keep their defaults, retired fields are
+// read and handed to their migrate function, and Reflect<T>::Migrate(T&, uint32_t version) runs
+// afterwards if the type has one. Data from a newer version than the code fails.
+class Serializer {
+public:
+    template<typename T>
+    static void Write(BinaryWriter& writer, const T& value);
+    template<typename T>
+    static void WriteArray(BinaryWriter& writer, const T* values, size_t count);
+
+    // Without a schema, the data is taken to be at the current versions - fine for anything written
+    // by this same build (replication, say). values for ReadArray are constructed already.
+    template<typename T>
+    static bool Read(BinaryReader& reader, T& value, const SchemaTable* schema = nullptr);
+    template<typename T>
+    static bool ReadArray(BinaryReader& reader, T* values, size_t count, const SchemaTable* schema = nullptr);
+
+    template<typename T>
+    static bool IsBlock();
+    // T and every type inside it saved at today's versions - a block can then be read straight in
+    template<typename T>
+    static bool IsCurrent(const SchemaTable* schema);
+
+private:
+    template<typename T>
+    static constexpr bool IsBlockType();
+    template<Reflected T>
+    static bool HasBlockLayout();
+    template<Reflected T>
+    static bool ReadFields(BinaryReader& reader, T& value, uint32_t version, const SchemaTable* schema);
+};
+
+// SchemaTable templates
+
+template<typename T>
+void SchemaTable::Add() {
+    if constexpr (SerializerDetail::IsStdVector<T>::value || SerializerDetail::IsStdArray<T>::value) {
+        Add<typename T::value_type>();
+    } else if constexpr (Reflected<T>) {
+        if (!Add(Reflect<T>::Name, GetReflectedVersion<T>())) return; // seen it - this also stops types that contain themselves
+        ForEachCurrentField<T>([this](const auto& field) {
+            Add<typename std::decay_t<decltype(field)>::MemberType>();
+        });
+    }
+}
+
+template<Reflected T>
+uint32_t SchemaTable::GetVersion() const {
+    uint32_t index = GetTypeIndex<T>();
+    if (index >= versionCache.size()) versionCache.resize(index + 1, NotLookedUp);
+    if (versionCache[index] == NotLookedUp) versionCache[index] = Find(Reflect<T>::Name);
+    return versionCache[index];
+}
+
+// Serializer templates
+
+template<typename T>
+constexpr bool Serializer::IsBlockType() {
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        return true;
+    } else if constexpr (SerializerDetail::IsStdArray<T>::value) {
+        return IsBlockType<typename T::value_type>();
+    } else if constexpr (Reflected<T>) {
+        if (!std::is_trivially_copyable_v<T> || !std::is_default_constructible_v<T>) return false;
+        bool blocks = true;
+        size_t size = 0;
+        ForEachCurrentField<T>([&](const auto& field) {
+            using Member = typename std::decay_t<decltype(field)>::MemberType;
+            blocks = blocks && IsBlockType<Member>();
+            size += sizeof(Member);
+        });
+        return blocks && size == sizeof(T);
+    } else {
+        return false;
+    }
+}
+
+template<Reflected T>
+bool Serializer::HasBlockLayout() {
+    // The sizes add up, so no padding - check the fields are also in memory order, once
+    T object{};
+    const std::byte* base = reinterpret_cast<const std::byte*>(&object);
+    size_t expected = 0;
+    bool ordered = true;
+    ForEachCurrentField<T>([&](const auto& field) {
+        using Member = typename std::decay_t<decltype(field)>::MemberType;
+        size_t offset = static_cast<size_t>(reinterpret_cast<const std::byte*>(&field.Get(object)) - base);
+        ordered = ordered && offset == expected && IsBlock<Member>();
+        expected += sizeof(Member);
+    });
+    return ordered;
+}
+
+template<typename T>
+bool Serializer::IsBlock() {
+    if constexpr (!IsBlockType<T>()) {
+        return false;
+    } else if constexpr (SerializerDetail::IsStdArray<T>::value) {
+        return IsBlock<typename T::value_type>();
+    } else if constexpr (Reflected<T>) {
+        static const bool layout = HasBlockLayout<T>();
+        return layout;
+    } else {
+        return true;
+    }
+}
+
+template<typename T>
+bool Serializer::IsCurrent(const SchemaTable* schema) {
+    if (!schema) return true;
+    if constexpr (SerializerDetail::IsStdVector<T>::value || SerializerDetail::IsStdArray<T>::value) {
+        return IsCurrent<typename T::value_type>(schema);
+    } else if constexpr (Reflected<T>) {
+        if (schema->GetVersion<T>() != GetReflectedVersion<T>()) return false;
+        bool current = true;
+        ForEachCurrentField<T>([&](const auto& field) {
+            current = current && IsCurrent<typename std::decay_t<decltype(field)>::MemberType>(schema);
+        });
+        return current;
+    } else {
+        return true;
+    }
+}
+
+template<typename T>
+void Serializer::Write(BinaryWriter& writer, const T& value) {
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        writer.Write(value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        writer.WriteString(value);
+    } else if constexpr (SerializerDetail::IsStdVector<T>::value) {
+        writer.Write(static_cast<uint32_t>(value.size()));
+        WriteArray(writer, value.data(), value.size());
+    } else if constexpr (SerializerDetail::IsStdArray<T>::value) {
+        WriteArray(writer, value.data(), value.size());
+    } else if constexpr (Reflected<T>) {
+        if (IsBlock<T>()) {
+            writer.WriteBytes(&value, sizeof(T));
+            return;
+        }
+        ForEachCurrentField<T>([&](const auto& field) { Write(writer, field.Get(value)); });
+    } else {
+        static_assert(SerializerDetail::AlwaysFalse<T>, "No way to serialize this type - give it a Reflect<> specialization");
+    }
+}
+
+template<typename T>
+void Serializer::WriteArray(BinaryWriter& writer, const T* values, size_t count) {
+    if (IsBlock<T>()) {
+        writer.WriteBytes(values, count * sizeof(T));
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) Write(writer, values[i]);
+}
+
+template<typename T>
+bool Serializer::Read(BinaryReader& reader, T& value, const SchemaTable* schema) {
+    if constexpr (std::is_arithmetic_v<T> || std::is_enum_v<T>) {
+        return reader.ReadBytes(&value, sizeof(T));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        value = reader.ReadString();
+        return reader.IsOk();
+    } else if constexpr (SerializerDetail::IsStdVector<T>::value) {
+        uint32_t count = reader.Read<uint32_t>();
+        if (!reader.IsOk() || count > reader.GetRemaining()) { // a bad count, not a huge allocation
+            reader.Fail();
+            return false;
+        }
+        value.clear();
+        value.resize(count);
+        return ReadArray(reader, value.data(), value.size(), schema);
+    } else if constexpr (SerializerDetail::IsStdArray<T>::value) {
+        return ReadArray(reader, value.data(), value.size(), schema);
+    } else if constexpr (Reflected<T>) {
+        uint32_t version = schema ? schema->GetVersion<T>() : GetReflectedVersion<T>();
+        if (version == 0 || version > GetReflectedVersion<T>()) {
+            reader.Fail();
+            return false;
+        }
+        if (IsBlock<T>() && IsCurrent<T>(schema)) return reader.ReadBytes(&value, sizeof(T));
+        return ReadFields(reader, value, version, schema);
+    } else {
+        static_assert(SerializerDetail::AlwaysFalse<T>, "No way to serialize this type - give it a Reflect<> specialization");
+        return false;
+    }
+}
+
+template<typename T>
+bool Serializer::ReadArray(BinaryReader& reader, T* values, size_t count, const SchemaTable* schema) {
+    if (IsBlock<T>() && IsCurrent<T>(schema)) return reader.ReadBytes(values, count * sizeof(T));
+    for (size_t i = 0; i < count; ++i) {
+        if (!Read(reader, values[i], schema)) return false;
+    }
+    return true;
+}
+
+template<Reflected T>
+bool Serializer::ReadFields(BinaryReader& reader, T& value, uint32_t version, const SchemaTable* schema) {
+    bool ok = true;
+    ForEachField<T>([&](const auto& field) {
+        using Descriptor = std::decay_t<decltype(field)>;
+        if (!ok || !field.IsIn(version)) return;
+        if constexpr (IsRetiredField<Descriptor>::value) {
+            typename Descriptor::ValueType old{};
+            ok = Read(reader, old, schema);
+            if (ok && field.migrate) field.migrate(value, old);
+        } else {
+            ok = Read(reader, field.Get(value), schema);
+        }
+    });
+    if constexpr (requires { Reflect<T>::Migrate(value, version); }) {
+        if (ok && version != GetReflectedVersion<T>()) Reflect<T>::Migrate(value, version);
+    }
+    return ok;
+}
+
+#endif // SERIALIZER_H
@@ -0,0 +1,81 @@
+// StringId.cpp - Implementation of the name tag
+// The interner: a hash map of views into an arena that only ever grows
+
+#include "StringId.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+StringInterner& StringInterner::GetInstance() {
+    static StringInterner instance;
+    return instance;
+}
+
+StringInterner::StringInterner() : blockUsed(0), blockCapacity(0), bytes(0), collisions(0) {
+}
+
+StringInterner::~StringInterner() {
+}
+
+StringId StringInterner::Intern(std::string_view text) {
+    StringId id(text);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = names.find(id.GetValue());
+        if (it != names.end() && it->second == text) return id;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto it = names.find(id.GetValue());
+    if (it != names.end()) {
+        if (it->second == text) return id; // another thread got there first
+    } else {
+        names.emplace(id.GetValue(), Store(text));
+        return id;
+    }
+    collisions++;
+    return StringId();
+}
+
+StringId StringInterner::Find(std::string_view text) const {
+    StringId id(text);
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = names.find(id.GetValue());
+    return it != names.end() && it->second == text ? id : StringId();
+}
+
+std::string_view StringInterner::GetString(StringId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = names.find(id.GetValue());
+    return it != names.end() ? it->second : std::string_view();
+}
+
+bool StringInterner::Contains(StringId id) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return names.count(id.GetValue()) != 0;
+}
+
+StringInterner::Stats StringInterner::GetStats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    Stats stats;
+    stats.names = names.size();
+    stats.bytes = bytes;
+    stats.collisions = collisions;
+    return stats;
+}
+
+std::string_view StringInterner::Store(std::string_view text) {
+    size_t size = text.size() + 1;
+    if (blockUsed + size > blockCapacity) {
+        // A name longer than a block gets one of its own
+        blockCapacity = std::max(BlockSize, size);
+        blocks.push_back(std::make_unique<char[]>(blockCapacity));
+        blockUsed = 0;
+    }
+    char* destination = blocks.back().get() + blockUsed;
+    if (!text.empty()) std::memcpy(destination, text.data(), text.size());
+    destination[text.size()] = '\0';
+    blockUsed += size;
+    bytes += size;
+    return std::string_view(destination, text.size());
+}
@@ -0,0 +1,120 @@
+// StringId.h - The name tag
+// Names as 32-bit numbers, so the hot code compares integers instead of strings
+
+#ifndef STRINGID_H
+#define STRINGID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// The StringId class - a name's 32-bit FNV-1a hash. The hash is the ID, so the same name gets the
+// same ID in every run and on every thread, and a literal can be turned into one at compile time:
+//
+//     constexpr StringId Jump("Jump");            // or "Jump"_sid
+//     input.IsActionPressed(Jump);                // no hashing, no string compares
+//
+// Making a StringId from text only hashes it. Names that should be readable back, or checked for
+// collisions, go through StringInterner::Intern - the APIs that take names do that when something
+// is created, so lookups by ID afterwards need nothing but the number. The exception is a name
+// whose hash another name already had: Intern gives it the invalid ID, the APIs keep it by its
+// text, and only their string overloads reach it - its literal is the other name's ID. 0 is never
+// a name, and no ID overload stores or finds anything under it.
+class StringId {
+public:
+    constexpr StringId() : value(0) {}
+    constexpr explicit StringId(std::string_view text) : value(Hash(text)) {}
+
+    static constexpr StringId FromValue(uint32_t value) {
+        StringId id;
+        id.value = value;
+        return id;
+    }
+
+    constexpr uint32_t GetValue() const { return value; }
+    constexpr bool IsValid() const { return value != 0; }
+
+    constexpr bool operator==(const StringId& other) const { return value == other.value; }
+    constexpr bool operator!=(const StringId& other) const { return value != other.value; }
+    constexpr bool operator<(const StringId& other) const { return value < other.value; }
+
+    // FNV-1a, with the one text that would hash to 0 moved to 1 (where it may collide - Intern says so)
+    static constexpr uint32_t Hash(std::string_view text) {
+        uint32_t hash = 2166136261u;
+        for (char c : text) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+private:
+    uint32_t value;
+};
+
+// "Jump"_sid - the ID of a literal, worked out by the compiler
+consteval StringId operator""_sid(const char* text, size_t length) {
+    return StringId(std::string_view(text, length));
+}
+
+// The value already is a hash - use it as is
+template<>
+struct std::hash<StringId> {
+    size_t operator()(const StringId& id) const noexcept { return id.GetValue(); }
+};
+
+// The StringInterner class - every name that has been given an ID, so IDs can be turned back into
+// text (saving, logging, the editor) and two names that hash the same are caught. Strings are never
+// freed, so a view from GetString stays good for the life of the program. Thread-safe; names that
+// are already in only take a shared lock.
+class StringInterner {
+public:
+    static StringInterner& GetInstance();
+
+    // The ID for text, remembering the text. If a different name already has that hash the new one
+    // gets the invalid ID, never somebody else's - callers keep such names by text (or rename one).
+    StringId Intern(std::string_view text);
+
+    // The ID text was interned as, without adding it - invalid if it never was, or if its hash
+    // belongs to another name. For lookups by name, so a typo doesn't take up space for good.
+    StringId Find(std::string_view text) const;
+
+    // The text an ID was interned from, null-terminated - empty if it never was
+    std::string_view GetString(StringId id) const;
+    bool Contains(StringId id) const;
+
+    struct Stats {
+        size_t names = 0;
+        size_t bytes = 0;       // text held, terminators included
+        size_t collisions = 0;  // Intern calls turned away because their hash was taken
+    };
+    Stats GetStats() const;
+
+private:
+    StringInterner();
+    ~StringInterner();
+
+    // Prevent copying - there is one list of names
+    StringInterner(const StringInterner&) = delete;
+    StringInterner& operator=(const StringInterner&) = delete;
+
+    static constexpr size_t BlockSize = 64 * 1024;
+
+    // Copy text into the arena, null-terminated - lock held
+    std::string_view Store(std::string_view text);
+
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint32_t, std::string_view> names;
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed;
+    size_t blockCapacity;
+    size_t bytes;
+    size_t collisions;
+};
+
+#endif // STRINGID_H
@@ -0,0 +1,361 @@
+// ThreadManager.cpp - Implementation of the foreman
+// Keeping every core busy without letting any of them trip over each other
+
+#include "ThreadManager.h"
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace {
+    thread_local bool isWorkerThread = false;
+
+    // Where a worker is with fibers. The switched-from fiber can't be released or parked until it's
+    // off the CPU, so it leaves that to whoever runs next (FinishSwitch).
+    struct FiberThreadState {
+        FiberContext threadContext; // the worker's own stack
+        Fiber* current = nullptr;
+        Fiber* toRelease = nullptr;
+        Fiber* toPark = nullptr;
+        JobCounter* parkOn = nullptr;
+    };
+    thread_local FiberThreadState fiberThreadState;
+
+#if ROAM_FIBERS_SUPPORTED
+    // A fiber can come back on another thread, so code that switches must never reuse a
+    // thread_local's address from before the switch - this is asked afresh every time
+    __attribute__((noinline)) FiberThreadState& GetFiberThreadState() {
+        asm volatile("");
+        return fiberThreadState;
+    }
+#else
+    FiberThreadState& GetFiberThreadState() { return fiberThreadState; }
+#endif
+}
+
+ThreadManager::ThreadManager() : stopping(false), usingFibers(false) {
+}
+
+ThreadManager::~ThreadManager() {
+    Shutdown();
+}
+
+bool ThreadManager::Initialize(uint32_t workerCount, const FiberSettings& fibers) {
+    if (!workers.empty()) return true;
+
+    if (workerCount == 0) {
+        uint32_t cores = std::max(1u, std::thread::hardware_concurrency());
+        workerCount = std::max(1u, cores - 1);
+    }
+
+    // Every worker starts on a fiber, and needs at least one more to park into
+    usingFibers = fibers.enabled &&
+                  fiberPool.Create(std::max(fibers.fiberCount, workerCount * 2), fibers.maxFiberCount, fibers.stackSize, &ThreadManager::FiberEntry, this);
+
+    stopping = false;
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadManager::WorkerLoop, this);
+    }
+    return true;
+}
+
+void ThreadManager::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+    workers.clear();
+
+    // Anything still queued runs here - dropping jobs would leave counters waiting forever
+    Job job;
+    while (PopJob(job)) {
+        Execute(job);
+    }
+
+    // The workers only leave once no fiber is parked, so none of these is holding a job
+    fiberPool.Destroy();
+    usingFibers = false;
+}
+
+void ThreadManager::Submit(std::function<void()> job, JobPriority priority, JobCounter* counter) {
+    if (counter) counter->Add();
+
+    // No workers (not initialized, or already shut down) - just do it now
+    if (workers.empty()) {
+        Job inlineJob{ std::move(job), counter };
+        Execute(inlineJob);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queues[static_cast<size_t>(priority)].push_back(Job{ std::move(job), counter });
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadManager::Wait(JobCounter& counter) {
+    while (!counter.IsDone()) {
+        if (ParkCurrentFiber(counter)) continue; // woken - but check, the wake can be for a counter that lived here before
+        if (!RunPendingJob()) {
+            // Nothing to steal - the last jobs are running elsewhere, give them the core
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool ThreadManager::RunPendingJob() {
+    Job job;
+    if (!PopJob(job)) return false;
+    Execute(job);
+    return true;
+}
+
+void ThreadManager::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body,
+                                JobPriority priority) {
+    if (count == 0) return;
+    grainSize = std::max<size_t>(1, grainSize);
+
+    // Small enough to not bother anyone else
+    if (count <= grainSize || workers.empty()) {
+        body(0, count);
+        return;
+    }
+
+    JobCounter counter;
+    for (size_t begin = grainSize; begin < count; begin += grainSize) {
+        size_t end = std::min(count, begin + grainSize);
+        Submit([&body, begin, end]() { body(begin, end); }, priority, &counter);
+    }
+
+    // The caller takes the first chunk instead of twiddling its thumbs
+    body(0, grainSize);
+    Wait(counter);
+}
+
+bool ThreadManager::IsWorkerThread() {
+    return isWorkerThread;
+}
+
+size_t ThreadManager::GetQueuedJobCount() const {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    size_t total = 0;
+    for (const auto& queue : queues) total += queue.size();
+    return total;
+}
+
+ThreadManager::FiberStats ThreadManager::GetFiberStats() const {
+    FiberStats stats;
+    stats.fibers = fiberPool.GetCount();
+    stats.freeFibers = fiberPool.GetFreeCount();
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stats.parked = parkedFibers.size();
+    stats.ready = readyFibers.size();
+    return stats;
+}
+
+void ThreadManager::WorkerLoop() {
+    isWorkerThread = true;
+
+    // With fibers, jobs run on them - the thread comes back here to stop, or when a job had to wait
+    // with the pool at its cap. Jobs run here, on the thread's own stack, until a fiber can be had again.
+    for (;;) {
+        Job job;
+        Fiber* fiber = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            for (;;) {
+                if (!readyFibers.empty()) {
+                    fiber = readyFibers.front();
+                    readyFibers.pop_front();
+                    break;
+                }
+                bool queued = std::any_of(std::begin(queues), std::end(queues), [](const std::deque<Job>& queue) { return !queue.empty(); });
+                if (queued) {
+                    // A free fiber picks the job up itself
+                    if (usingFibers) fiber = fiberPool.Acquire();
+                    if (!fiber) PopJobLocked(job);
+                    break;
+                }
+                if (PollParkedFibers()) continue;
+                if (stopping && parkedFibers.empty()) return; // nothing left for us
+                if (parkedFibers.empty()) {
+                    jobAvailable.wait(lock);
+                } else {
+                    jobAvailable.wait_for(lock, std::chrono::milliseconds(1)); // for counters finished by hand
+                }
+            }
+        }
+
+        if (fiber) {
+            FiberThreadState& state = GetFiberThreadState();
+            state.current = fiber;
+            Fiber::Switch(state.threadContext, fiber->GetContext());
+            FinishSwitch();
+            continue;
+        }
+        Execute(job);
+    }
+}
+
+bool ThreadManager::PopJob(Job& job) {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return PopJobLocked(job);
+}
+
+bool ThreadManager::PopJobLocked(Job& job) {
+    for (auto& queue : queues) {
+        if (!queue.empty()) {
+            job = std::move(queue.front());
+            queue.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadManager::Execute(Job& job) {
+    if (job.function) job.function();
+    if (job.counter && job.counter->Done() && usingFibers) WakeFibers(job.counter);
+}
+
+// Fibers
+
+void ThreadManager::FiberEntry(void* manager) {
+    static_cast<ThreadManager*>(manager)->FiberLoop();
+}
+
+void ThreadManager::FiberLoop() {
+    // A fiber released to the pool stays suspended somewhere in here, and picks up from there when
+    // it's next acquired - so every way back round starts by finishing the switch that got us here
+    for (;;) {
+        FinishSwitch();
+
+        Job job;
+        Fiber* resume = nullptr;
+        bool haveJob = false;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            for (;;) {
+                // Parked jobs first - they're holding stack and whatever their callers are waiting for
+                if (!readyFibers.empty()) {
+                    resume = readyFibers.front();
+                    readyFibers.pop_front();
+                    break;
+                }
+                if (PopJobLocked(job)) {
+                    haveJob = true;
+                    break;
+                }
+                if (PollParkedFibers()) continue; // a counter finished by hand rather than by a job
+                if (stopping && parkedFibers.empty()) break;
+                if (parkedFibers.empty()) {
+                    jobAvailable.wait(lock);
+                } else {
+                    jobAvailable.wait_for(lock, std::chrono::milliseconds(1)); // for counters finished by hand
+                }
+            }
+        }
+
+        if (haveJob) {
+            Execute(job);
+            continue;
+        }
+
+        // Hand this fiber back and switch to the parked one, or back to the thread to stop. Locks
+        // are all released - nothing is held across a switch.
+        FiberThreadState& state = GetFiberThreadState();
+        Fiber* self = state.current;
+        state.toRelease = self;
+        state.current = resume;
+        Fiber::Switch(self->GetContext(), resume ? resume->GetContext() : state.threadContext);
+    }
+}
+
+bool ThreadManager::ParkCurrentFiber(JobCounter& counter) {
+    FiberThreadState& state = GetFiberThreadState();
+    if (!state.current) return false; // not on a fiber - the caller helps out instead
+
+    Fiber* next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!readyFibers.empty()) {
+            next = readyFibers.front();
+            readyFibers.pop_front();
+        }
+    }
+    if (!next) next = fiberPool.Acquire();
+
+    // Whatever runs next files us under counter once we're off this stack. With the pool at its cap
+    // (or out of memory for stacks) that's the worker's own stack - helping out inline here instead
+    // would nest jobs on a fiber's small stack until it overflowed.
+    Fiber* self = state.current;
+    state.toPark = self;
+    state.parkOn = &counter;
+    state.current = next;
+    Fiber::Switch(self->GetContext(), next ? next->GetContext() : state.threadContext);
+
+    // Woken - quite possibly on another worker
+    FinishSwitch();
+    return true;
+}
+
+void ThreadManager::FinishSwitch() {
+    FiberThreadState& state = GetFiberThreadState();
+    if (Fiber* released = std::exchange(state.toRelease, nullptr)) fiberPool.Release(released);
+
+    Fiber* parked = std::exchange(state.toPark, nullptr);
+    if (!parked) return;
+    JobCounter* counter = std::exchange(state.parkOn, nullptr);
+    {
+        // Checked under the lock WakeFibers takes after the last Done, so the wake can't slip past
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!counter->IsDone()) {
+            parkedFibers.push_back(ParkedFiber{ parked, counter });
+            return;
+        }
+        readyFibers.push_back(parked);
+    }
+    jobAvailable.notify_one();
+}
+
+void ThreadManager::WakeFibers(const JobCounter* counter) {
+    // counter may be gone already (its waiter wasn't parked) - it's only compared, never read
+    size_t woken = 0;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (size_t i = 0; i < parkedFibers.size();) {
+            if (parkedFibers[i].counter == counter) {
+                readyFibers.push_back(parkedFibers[i].fiber);
+                parkedFibers[i] = parkedFibers.back();
+                parkedFibers.pop_back();
+                woken++;
+            } else {
+                ++i;
+            }
+        }
+    }
+    if (woken == 1) jobAvailable.notify_one();
+    else if (woken > 1) jobAvailable.notify_all();
+}
+
+bool ThreadManager::PollParkedFibers() {
+    // Parked fibers keep their counters alive, so these can be read
+    bool woke = false;
+    for (size_t i = 0; i < parkedFibers.size();) {
+        if (parkedFibers[i].counter->IsDone()) {
+            readyFibers.push_back(parkedFibers[i].fiber);
+            parkedFibers[i] = parkedFibers.back();
+            parkedFibers.pop_back();
+            woke = true;
+        } else {
+            ++i;
+        }
+    }
+    return woke;
+}
@@ -0,0 +1,137 @@
+// ThreadManager.h - The foreman
+// Hands work out to the worker threads and makes sure nobody slacks off
+
+#ifndef THREADMANAGER_H
+#define THREADMANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Core/Fiber.h"
+
+// Job priorities - who gets a worker first?
+enum class JobPriority {
+    High,    // someone is waiting on this right now
+    Normal,  // regular frame work
+    Low,     // background stuff - streaming, cooking, cleanup
+    Count
+};
+
+// Job counter - how many jobs are still out? Wait() on it until it hits zero
+class JobCounter {
+public:
+    JobCounter() : pending(0) {}
+
+    void Add(int count = 1) { pending.fetch_add(count, std::memory_order_relaxed); }
+    bool Done() { return pending.fetch_sub(1, std::memory_order_acq_rel) == 1; } // true for the one that finished it
+    bool IsDone() const { return pending.load(std::memory_order_acquire) == 0; }
+    int GetPending() const { return pending.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<int> pending;
+};
+
+// Job fibers - optional, and only where Fiber supports them. With them on, workers run jobs on fibers
+// from a pool (see FiberPool), and a job that Waits on an unfinished counter parks its fiber: the
+// worker carries on with other jobs on another fiber, and whichever worker is free picks the parked
+// one up once the counter reaches zero. Nested waits then cost a fiber each instead of a worker's
+// stack, and no core sits spinning. A parked job can come back on a different thread, so it mustn't
+// hold thread_locals or locks across a Wait.
+struct FiberSettings {
+    bool enabled = false;
+    uint32_t fiberCount = 128;     // made up front (at least two per worker) - more are made if they all get parked
+    uint32_t maxFiberCount = 1024; // the pool stops growing here - past it a waiting job parks and its worker runs jobs on its own stack
+    size_t stackSize = 256 * 1024; // reserved up front, committed as it's touched
+};
+
+// The ThreadManager class - our job system
+class ThreadManager {
+public:
+    ThreadManager();
+    ~ThreadManager();
+
+    // Spin up the workers - 0 means one per core, minus the main thread. If the fibers can't be made
+    // the workers run without them (see IsUsingFibers).
+    bool Initialize(uint32_t workerCount = 0, const FiberSettings& fibers = FiberSettings());
+    void Shutdown();
+    bool IsInitialized() const { return !workers.empty(); }
+
+    // Submit a job - the counter (if any) is bumped now and dropped when the job finishes
+    void Submit(std::function<void()> job, JobPriority priority = JobPriority::Normal, JobCounter* counter = nullptr);
+
+    // Wait for a counter - a job on a fiber parks until it's done; anything else (the main thread, or a
+    // job its worker is running on its own stack) runs other jobs meanwhile. Either way nested waits
+    // can't deadlock, and inline jobs only ever nest on a thread's own stack, never a fiber's.
+    void Wait(JobCounter& counter);
+
+    // Run one queued job on the calling thread - false if there was nothing to do
+    bool RunPendingJob();
+
+    // Split [0, count) into chunks of grainSize and run them across the workers
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t begin, size_t end)>& body,
+                     JobPriority priority = JobPriority::Normal);
+
+    // Worker info
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+    static bool IsWorkerThread();
+    size_t GetQueuedJobCount() const;
+
+    // Fiber info
+    bool IsUsingFibers() const { return usingFibers; }
+    struct FiberStats {
+        uint32_t fibers = 0;
+        uint32_t freeFibers = 0;
+        size_t parked = 0; // waiting on a counter
+        size_t ready = 0;  // counter done, waiting for a worker
+    };
+    FiberStats GetFiberStats() const;
+
+private:
+    // A job and the counter it reports to
+    struct Job {
+        std::function<void()> function;
+        JobCounter* counter;
+    };
+
+    // A fiber waiting on a counter
+    struct ParkedFiber {
+        Fiber* fiber;
+        JobCounter* counter;
+    };
+
+    void WorkerLoop();
+    bool PopJob(Job& job);
+    bool PopJobLocked(Job& job); // queueMutex held
+    void Execute(Job& job);
+
+    // Fiber helpers
+    static void FiberEntry(void* manager);
+    void FiberLoop();
+    bool ParkCurrentFiber(JobCounter& counter);
+    void FinishSwitch();
+    void WakeFibers(const JobCounter* counter);
+    bool PollParkedFibers(); // queueMutex held
+
+    // Queues - one per priority, always drained highest first
+    std::deque<Job> queues[static_cast<size_t>(JobPriority::Count)];
+    mutable std::mutex queueMutex;
+    std::condition_variable jobAvailable;
+
+    // Workers
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    // Fibers - parked and ready are guarded by queueMutex
+    FiberPool fiberPool;
+    std::vector<ParkedFiber> parkedFibers;
+    std::deque<Fiber*> readyFibers;
+    bool usingFibers;
+};
+
+#endif // THREADMANAGER_H
@@ -7,6 +7,7 @@
 #include <unordered_map>
 #include <vector>
 #include <functional>
+#include "Core/StringId.h"
 #include "Math/Vector3.h"
 
 // Key codes - what keys are being pressed?
@@ -155,6 +156,7 @@ struct InputEvent {
 // Input action - a named input binding
 struct InputAction {
     std::string name;
+    StringId id; // invalid if the name collided with another action's - see CreateAction
     std::vector<KeyCode> keys;
     std::vector<MouseButton> mouseButtons;
     float axisValue;
@@ -192,7 +194,8 @@ public:
     float GetJoystickAxis(int joystickId, int axis) const;
     bool IsJoystickButtonPressed(int joystickId, int button) const;
 
-    // Input actions
+    // Input actions - an action whose name hashes the same as an existing one's is kept by its
+    // text instead, and only these string overloads find it
     void CreateAction(const std::string& name);
     void BindKeyToAction(const std::string& actionName, KeyCode key);
     void BindMouseButtonToAction(const std::string& actionName, MouseButton button);
@@ -201,6 +204,15 @@ public:
     bool IsActionDown(const std::string& actionName) const;
     float GetActionAxis(const std::string& actionName) const;
 
+    // The same by ID - CreateAction interns the name, so "Jump"_sid finds it without hashing a string.
+    // The invalid ID is never an action: binding to it does nothing and every query on it is false.
+    void BindKeyToAction(StringId action, KeyCode key);
+    void BindMouseButtonToAction(StringId action, MouseButton button);
+    bool IsActionPressed(StringId action) const;
+    bool IsActionReleased(StringId action) const;
+    bool IsActionDown(StringId action) const;
+    float GetActionAxis(StringId action) const;
+
     // Event handling
     void AddEventListener(std::function<void(const InputEvent&)> listener);
     void RemoveEventListener(std::function<void(const InputEvent&)> listener);
@@ -245,7 +257,8 @@ private:
     std::vector<std::vector<bool>> joystickButtons;
 
     // Input actions
-    std::unordered_map<std::string, InputAction> actions;
+    std::unordered_map<StringId, InputAction> actions;
+    std::unordered_map<std::string, InputAction> collidingActions; // names whose hash another action took
 
     // Event listeners
     std::vector<std::function<void(const InputEvent&)>> eventListeners;
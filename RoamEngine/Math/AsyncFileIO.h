@@ -0,0 +1,178 @@
+// AsyncFileIO.h - The delivery service
+// Reads happen in the background, callbacks show up on the job system when the bytes arrive
+
+#ifndef ASYNCFILEIO_H
+#define ASYNCFILEIO_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ThreadManager;
+
+// Read priorities - the queue is always drained top to bottom
+enum class IOPriority {
+    Critical,  // the frame is stalled on this one
+    Visible,   // on screen (or about to be) - stream it in next
+    Prefetch,  // speculative - only when nobody else needs the disk
+    Count
+};
+
+// How a request ended up
+enum class IOStatus {
+    Pending,
+    Completed,
+    Failed,
+    Cancelled
+};
+
+// Which backend is doing the actual reading
+enum class IOBackend {
+    IOUring,     // Linux io_uring - batched submission, no thread per read
+    ThreadPool   // blocking pread on a few I/O threads - works everywhere
+};
+
+using IORequestId = uint64_t;
+constexpr IORequestId InvalidIORequestId = 0;
+
+// The result handed to the completion callback
+struct IOResult {
+    IORequestId id = InvalidIORequestId;
+    IOStatus status = IOStatus::Pending;
+    int errorCode = 0;                // errno-style, 0 unless Failed
+    uint64_t bytesRead = 0;           // short if the file ended early
+    std::span<std::byte> data;        // what was read - points into the caller buffer or ownedData
+    std::vector<std::byte> ownedData; // filled when the request didn't bring its own buffer
+};
+
+// A single read - whole file by default, or a range of it
+struct IORequest {
+    std::string path;
+    uint64_t offset = 0;
+    uint64_t size = 0;                 // 0 = from offset to the end of the file
+    std::span<std::byte> destination;  // optional - must hold size bytes and outlive the request
+    IOPriority priority = IOPriority::Visible;
+    std::function<void(IOResult&)> onComplete;
+};
+
+// The AsyncFileIO class - our background reader
+class AsyncFileIO {
+public:
+    AsyncFileIO();
+    ~AsyncFileIO();
+
+    // Start the backend - callbacks go through the job system when given one, otherwise they
+    // run on the I/O thread (keep them short). io_uring is tried first unless forceThreadPool is set.
+    bool Initialize(ThreadManager* jobSystem = nullptr, uint32_t queueDepth = 128,
+                    uint32_t fallbackThreads = 4, bool forceThreadPool = false);
+
+    // Stop the backend - anything not done yet completes as Cancelled
+    void Shutdown();
+    bool IsInitialized() const { return running; }
+
+    // Submit reads - a batch goes into the queue under one lock and one wakeup
+    IORequestId Submit(IORequest request);
+    std::vector<IORequestId> SubmitBatch(std::vector<IORequest>& requests);
+
+    // Cancel a read - queued ones never touch the disk, in-flight ones are cancelled in the kernel
+    // where possible. False if the request already finished (or never existed).
+    bool Cancel(IORequestId id);
+
+    // Bump (or demote) a read that hasn't been started yet
+    bool SetPriority(IORequestId id, IOPriority priority);
+
+    // Block until everything submitted so far has completed - tests and loading screens only
+    void WaitIdle();
+
+    // Info and stats
+    IOBackend GetBackend() const { return backend; }
+    const char* GetBackendName() const;
+
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t cancelled = 0;
+        uint64_t bytesRead = 0;
+        uint32_t queued = 0;
+        uint32_t inFlight = 0;
+    };
+    Stats GetStats() const;
+
+private:
+    // Everything we know about one request while it's alive
+    struct PendingRead {
+        IORequestId id;
+        IORequest request;
+        IOResult result;
+        std::byte* target;       // where the next chunk lands
+        uint64_t remaining;      // bytes still wanted
+        uint64_t fileOffset;     // where the next chunk comes from
+        intptr_t file;           // fd on POSIX, HANDLE on Windows, -1 when closed
+        bool cancelRequested;
+    };
+    using PendingReadPtr = std::shared_ptr<PendingRead>;
+
+    // Queue handling - all under queueMutex
+    bool PopNext(PendingReadPtr& read);
+    PendingReadPtr FindQueued(IORequestId id, bool remove);
+
+    // Shared between backends
+    bool OpenForRead(PendingRead& read, int& errorCode);
+    static void CloseFile(PendingRead& read);
+    void Complete(PendingReadPtr read, IOStatus status, int errorCode);
+
+    // Thread pool backend
+    void PoolWorker();
+    void ReadBlocking(PendingRead& read);
+
+    // io_uring backend
+    bool InitializeUring(uint32_t queueDepth);
+    void ShutdownUring();
+    void UringLoop();
+    bool QueueUringRead(PendingRead& read);
+    void QueueUringCancel(IORequestId id);
+    void ArmUringWakeup();
+    void WakeUringLoop();
+
+    ThreadManager* jobSystem;
+    IOBackend backend;
+    std::atomic<bool> running;
+    uint32_t maxInFlight;
+
+    // Queued requests, one list per priority
+    std::deque<PendingReadPtr> queues[static_cast<size_t>(IOPriority::Count)];
+    std::unordered_map<IORequestId, PendingReadPtr> inFlight;
+    std::vector<IORequestId> cancelsToIssue;
+    mutable std::mutex queueMutex;
+    std::condition_variable queueSignal;
+    std::condition_variable idleSignal;
+    IORequestId nextId;
+    uint32_t outstanding;        // submitted but callback not run yet
+    bool stopping;
+
+    std::vector<std::thread> threads;
+
+    // io_uring state - raw mmap'd rings, opaque here so the kernel headers stay in the .cpp
+    struct UringState;
+    std::unique_ptr<UringState> uring;
+
+    // Stats
+    std::atomic<uint64_t> statSubmitted;
+    std::atomic<uint64_t> statCompleted;
+    std::atomic<uint64_t> statFailed;
+    std::atomic<uint64_t> statCancelled;
+    std::atomic<uint64_t> statBytesRead;
+};
+
+#endif // ASYNCFILEIO_H
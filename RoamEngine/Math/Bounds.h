@@ -0,0 +1,130 @@
+// Bounds.h - The shapes that hold other shapes
+// Boxes, planes and frusta - cheap stand-ins for whatever's inside them
+
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <algorithm>
+#include <cmath>
+#include "Math/Matrix4x4.h"
+#include "Math/Vector3.h"
+
+// Axis-aligned box - min and max corners. Default is empty (min above max), so the first Merge
+// takes the other box as it is.
+struct Aabb {
+    Vector3 min = Vector3(INFINITY);
+    Vector3 max = Vector3(-INFINITY);
+
+    Aabb() = default;
+    Aabb(const Vector3& min, const Vector3& max) : min(min), max(max) {}
+    static Aabb FromCenter(const Vector3& center, const Vector3& halfExtents) { return Aabb(center - halfExtents, center + halfExtents); }
+
+    bool IsEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+    Vector3 GetCenter() const { return (min + max) * 0.5f; }
+    Vector3 GetExtents() const { return (max - min) * 0.5f; }
+
+    // Surface area - what the tree builders minimise
+    float GetSurfaceArea() const {
+        Vector3 size = max - min;
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    bool Contains(const Aabb& other) const {
+        return other.min.x >= min.x && other.min.y >= min.y && other.min.z >= min.z &&
+               other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+    }
+    bool Overlaps(const Aabb& other) const {
+        return other.min.x <= max.x && other.max.x >= min.x &&
+               other.min.y <= max.y && other.max.y >= min.y &&
+               other.min.z <= max.z && other.max.z >= min.z;
+    }
+
+    // Squared distance from a point to the box - zero inside
+    float DistanceSquared(const Vector3& point) const {
+        float dx = std::max(std::max(min.x - point.x, point.x - max.x), 0.0f);
+        float dy = std::max(std::max(min.y - point.y, point.y - max.y), 0.0f);
+        float dz = std::max(std::max(min.z - point.z, point.z - max.z), 0.0f);
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    // Slab test - where a ray enters the box, or false if it misses within [0, maxDistance].
+    // inverseDirection is 1 / direction per axis (infinite for zero components is fine).
+    bool IntersectRay(const Vector3& origin, const Vector3& inverseDirection, float maxDistance, float& distance) const {
+        float t1 = (min.x - origin.x) * inverseDirection.x, t2 = (max.x - origin.x) * inverseDirection.x;
+        float enter = std::min(t1, t2), exit = std::max(t1, t2);
+        t1 = (min.y - origin.y) * inverseDirection.y; t2 = (max.y - origin.y) * inverseDirection.y;
+        enter = std::max(enter, std::min(t1, t2)); exit = std::min(exit, std::max(t1, t2));
+        t1 = (min.z - origin.z) * inverseDirection.z; t2 = (max.z - origin.z) * inverseDirection.z;
+        enter = std::max(enter, std::min(t1, t2)); exit = std::min(exit, std::max(t1, t2));
+        enter = std::max(enter, 0.0f);
+        if (!(enter <= exit) || enter > maxDistance) return false; // also false for NaN from 0 * inf
+        distance = enter;
+        return true;
+    }
+
+    static Aabb Merge(const Aabb& a, const Aabb& b) {
+        return Aabb(Vector3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z)),
+                    Vector3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z)));
+    }
+    Aabb Expanded(const Vector3& amount) const { return Aabb(min - amount, max + amount); }
+    Aabb Translated(const Vector3& offset) const { return Aabb(min + offset, max + offset); }
+};
+
+// Plane - points p with Dot(normal, p) + distance == 0, normal pointing to the inside
+struct Plane {
+    Vector3 normal = Vector3(0.0f, 1.0f, 0.0f);
+    float distance = 0.0f;
+
+    float GetSignedDistance(const Vector3& point) const { return Vector3::Dot(normal, point) + distance; }
+};
+
+// Frustum - six planes facing in. Near, far, left, right, bottom, top.
+struct Frustum {
+    enum Side { Near, Far, Left, Right, Bottom, Top, SideCount };
+
+    Plane planes[SideCount];
+
+    // From a projection * view matrix (column vectors, clip depth -w..w as in GL) - planes normalized
+    static Frustum FromMatrix(const Matrix4x4& viewProjection) {
+        const float (&m)[4][4] = viewProjection.m;
+        Frustum frustum;
+        auto set = [&](Side side, float sign, int row) {
+            Vector3 normal(m[3][0] + sign * m[row][0], m[3][1] + sign * m[row][1], m[3][2] + sign * m[row][2]);
+            float length = normal.Length();
+            float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            frustum.planes[side].normal = normal * scale;
+            frustum.planes[side].distance = (m[3][3] + sign * m[row][3]) * scale;
+        };
+        set(Near, 1.0f, 2);
+        set(Far, -1.0f, 2);
+        set(Left, 1.0f, 0);
+        set(Right, -1.0f, 0);
+        set(Bottom, 1.0f, 1);
+        set(Top, -1.0f, 1);
+        return frustum;
+    }
+
+    // Box against one plane - the corner furthest along the normal decides whether any of it is
+    // inside, the nearest corner whether all of it is
+    static bool IsOutside(const Plane& plane, const Aabb& box) {
+        Vector3 corner(plane.normal.x >= 0.0f ? box.max.x : box.min.x,
+                       plane.normal.y >= 0.0f ? box.max.y : box.min.y,
+                       plane.normal.z >= 0.0f ? box.max.z : box.min.z);
+        return plane.GetSignedDistance(corner) < 0.0f;
+    }
+    static bool IsInside(const Plane& plane, const Aabb& box) {
+        Vector3 corner(plane.normal.x >= 0.0f ? box.min.x : box.max.x,
+                       plane.normal.y >= 0.0f ? box.min.y : box.max.y,
+                       plane.normal.z >= 0.0f ? box.min.z : box.max.z);
+        return plane.GetSignedDistance(corner) >= 0.0f;
+    }
+
+    bool Overlaps(const Aabb& box) const {
+        for (const Plane& plane : planes) {
+            if (IsOutside(plane, box)) return false;
+        }
+        return true;
+    }
+};
+
+#endif // BOUNDS_H
@@ -0,0 +1,263 @@
+// Compression.cpp - Implementation of the vacuum sealer
+// LZ4 lives right here (it's small), zstd comes from the real library when it's linked in
+
+#include "Compression.h"
+#include <cstring>
+
+#if defined(ROAM_HAS_ZSTD)
+#include <zstd.h>
+#endif
+
+namespace {
+    // LZ4 block format rules - breaking these makes the output unreadable by other LZ4 decoders
+    constexpr size_t MinMatch = 4;
+    constexpr size_t LastLiterals = 5;   // the last 5 bytes are always literals
+    constexpr size_t MatchFindLimit = 12; // no match may start in the last 12 bytes
+    constexpr size_t MaxOffset = 65535;
+    constexpr int HashLog = 12;
+
+    uint32_t Read32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t HashSequence(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HashLog);
+    }
+
+    // Length bytes past the 4-bit token field: 255, 255, ..., remainder
+    uint8_t* WriteLength(uint8_t* op, size_t length) {
+        while (length >= 255) {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = static_cast<uint8_t>(length);
+        return op;
+    }
+
+    bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= end) return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+}
+
+bool Compression::IsSupported(CompressionMethod method) {
+    switch (method) {
+        case CompressionMethod::None: return true;
+        case CompressionMethod::LZ4: return true;
+#if defined(ROAM_HAS_ZSTD)
+        case CompressionMethod::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+const char* Compression::GetName(CompressionMethod method) {
+    switch (method) {
+        case CompressionMethod::None: return "none";
+        case CompressionMethod::LZ4: return "lz4";
+        case CompressionMethod::Zstd: return "zstd";
+        default: return "unknown";
+    }
+}
+
+size_t Compression::GetMaxCompressedSize(CompressionMethod method, size_t inputSize) {
+    switch (method) {
+        case CompressionMethod::LZ4: return inputSize + inputSize / 255 + 16;
+#if defined(ROAM_HAS_ZSTD)
+        case CompressionMethod::Zstd: return ZSTD_compressBound(inputSize);
+#endif
+        default: return inputSize;
+    }
+}
+
+size_t Compression::Compress(CompressionMethod method, std::span<const std::byte> input, std::span<std::byte> output, int level) {
+    switch (method) {
+        case CompressionMethod::None:
+            if (output.size() < input.size()) return 0;
+            if (!input.empty()) std::memcpy(output.data(), input.data(), input.size());
+            return input.size();
+        case CompressionMethod::LZ4:
+            return CompressLZ4(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                               reinterpret_cast<uint8_t*>(output.data()), output.size());
+#if defined(ROAM_HAS_ZSTD)
+        case CompressionMethod::Zstd: {
+            // Level 0 is zstd's own default
+            size_t result = ZSTD_compress(output.data(), output.size(), input.data(), input.size(), level);
+            return ZSTD_isError(result) ? 0 : result;
+        }
+#endif
+        default:
+            (void)level;
+            return 0;
+    }
+}
+
+bool Compression::Decompress(CompressionMethod method, std::span<const std::byte> input, std::span<std::byte> output) {
+    switch (method) {
+        case CompressionMethod::None:
+            if (input.size() != output.size()) return false;
+            if (!input.empty()) std::memcpy(output.data(), input.data(), input.size());
+            return true;
+        case CompressionMethod::LZ4:
+            return DecompressLZ4(reinterpret_cast<const uint8_t*>(input.data()), input.size(),
+                                 reinterpret_cast<uint8_t*>(output.data()), output.size());
+#if defined(ROAM_HAS_ZSTD)
+        case CompressionMethod::Zstd: {
+            size_t result = ZSTD_decompress(output.data(), output.size(), input.data(), input.size());
+            return !ZSTD_isError(result) && result == output.size();
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+size_t Compression::CompressLZ4(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity) {
+    // Greedy single-probe matcher - positions are remembered by hash, last one wins
+    thread_local uint32_t hashTable[1 << HashLog];
+    std::memset(hashTable, 0, sizeof(hashTable));
+
+    const uint8_t* ip = input;
+    const uint8_t* anchor = input;
+    const uint8_t* const inputEnd = input + inputSize;
+    uint8_t* op = output;
+    uint8_t* const outputEnd = output + outputCapacity;
+
+    if (inputSize > MatchFindLimit) {
+        const uint8_t* const matchFindLimit = inputEnd - MatchFindLimit;
+        const uint8_t* const matchLimit = inputEnd - LastLiterals;
+
+        size_t misses = 0;
+        while (ip < matchFindLimit) {
+            uint32_t sequence = Read32(ip);
+            uint32_t hash = HashSequence(sequence);
+            const uint8_t* match = input + hashTable[hash];
+            hashTable[hash] = static_cast<uint32_t>(ip - input);
+
+            if (match >= ip || static_cast<size_t>(ip - match) > MaxOffset || Read32(match) != sequence) {
+                // Nothing matching for a while? Probably incompressible - start taking bigger steps
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+
+            // Grow the match backwards into the pending literals, then forwards as far as allowed
+            while (ip > anchor && match > input && ip[-1] == match[-1]) {
+                --ip;
+                --match;
+            }
+            size_t matchLength = MinMatch;
+            while (ip + matchLength < matchLimit && ip[matchLength] == match[matchLength]) ++matchLength;
+
+            // Token, literals, offset, match length - bail if it won't fit
+            size_t literalLength = static_cast<size_t>(ip - anchor);
+            size_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+            if (static_cast<size_t>(outputEnd - op) < worstCase) return 0;
+
+            uint8_t* token = op++;
+            if (literalLength >= 15) {
+                *token = 15 << 4;
+                op = WriteLength(op, literalLength - 15);
+            } else {
+                *token = static_cast<uint8_t>(literalLength << 4);
+            }
+            std::memcpy(op, anchor, literalLength);
+            op += literalLength;
+
+            uint16_t offset = static_cast<uint16_t>(ip - match);
+            *op++ = static_cast<uint8_t>(offset & 0xFF);
+            *op++ = static_cast<uint8_t>(offset >> 8);
+
+            size_t extraMatch = matchLength - MinMatch;
+            if (extraMatch >= 15) {
+                *token |= 15;
+                op = WriteLength(op, extraMatch - 15);
+            } else {
+                *token |= static_cast<uint8_t>(extraMatch);
+            }
+
+            ip += matchLength;
+            anchor = ip;
+
+            // Remember a spot inside the match too - cheap, and finds the next repeat sooner
+            if (ip < matchFindLimit) {
+                hashTable[HashSequence(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - input);
+            }
+        }
+    }
+
+    // Whatever's left goes out as one final literal run
+    size_t literalLength = static_cast<size_t>(inputEnd - anchor);
+    size_t worstCase = 1 + literalLength / 255 + 1 + literalLength;
+    if (static_cast<size_t>(outputEnd - op) < worstCase) return 0;
+
+    if (literalLength >= 15) {
+        *op++ = 15 << 4;
+        op = WriteLength(op, literalLength - 15);
+    } else {
+        *op++ = static_cast<uint8_t>(literalLength << 4);
+    }
+    if (literalLength > 0) std::memcpy(op, anchor, literalLength);
+    op += literalLength;
+
+    return static_cast<size_t>(op - output);
+}
+
+bool Compression::DecompressLZ4(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize) {
+    // Every length and offset is checked - pack files come off disks we don't control
+    const uint8_t* ip = input;
+    const uint8_t* const inputEnd = input + inputSize;
+    uint8_t* op = output;
+    uint8_t* const outputEnd = output + outputSize;
+
+    while (ip < inputEnd) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, inputEnd, literalLength)) return false;
+        if (literalLength > static_cast<size_t>(inputEnd - ip) || literalLength > static_cast<size_t>(outputEnd - op)) {
+            return false;
+        }
+        if (literalLength <= 16 && inputEnd - ip >= 16 && outputEnd - op >= 16) {
+            std::memcpy(op, ip, 16); // short run - one fixed-size copy, the overshoot gets overwritten
+        } else if (literalLength > 0) {
+            std::memcpy(op, ip, literalLength);
+        }
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == inputEnd) break; // the last sequence has no match
+
+        if (inputEnd - ip < 2) return false;
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - output)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(ip, inputEnd, matchLength)) return false;
+        matchLength += MinMatch;
+        if (matchLength > static_cast<size_t>(outputEnd - op)) return false;
+
+        const uint8_t* match = op - offset;
+        if (offset >= 8 && static_cast<size_t>(outputEnd - op) >= matchLength + 8) {
+            // 8 bytes at a time - each chunk's source was fully written before we get to it
+            for (size_t i = 0; i < matchLength; i += 8) std::memcpy(op + i, match + i, 8);
+            op += matchLength;
+        } else if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        } else {
+            // Overlapping copy - this is how LZ4 encodes runs, byte at a time is the correct behaviour
+            for (size_t i = 0; i < matchLength; ++i) *op++ = match[i];
+        }
+    }
+
+    return op == outputEnd;
+}
@@ -0,0 +1,40 @@
+// Compression.h - The vacuum sealer
+// Squeezes the air out of asset data, and lets it back in when we need it
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Compression methods - the numbers are stored in pack files, don't renumber them
+enum class CompressionMethod : uint8_t {
+    None = 0,
+    LZ4 = 1,   // fast to decode - the default for streaming
+    Zstd = 2   // smaller, slower to decode - for slow disks and downloads (needs ROAM_HAS_ZSTD)
+};
+
+// The Compression class - block codecs, no streaming, no framing
+class Compression {
+public:
+    // Is this method compiled in?
+    static bool IsSupported(CompressionMethod method);
+    static const char* GetName(CompressionMethod method);
+
+    // Worst-case output size for an input of inputSize bytes
+    static size_t GetMaxCompressedSize(CompressionMethod method, size_t inputSize);
+
+    // Compress a block - returns the compressed size, or 0 if it didn't fit in output
+    // level: zstd level (0 = its default), ignored by LZ4
+    static size_t Compress(CompressionMethod method, std::span<const std::byte> input, std::span<std::byte> output, int level = 0);
+
+    // Decompress a block - output must be exactly the original size, anything else is a failure
+    static bool Decompress(CompressionMethod method, std::span<const std::byte> input, std::span<std::byte> output);
+
+private:
+    static size_t CompressLZ4(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputCapacity);
+    static bool DecompressLZ4(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize);
+};
+
+#endif // COMPRESSION_H
@@ -0,0 +1,945 @@
+// FileIndex.cpp - Implementation of the card catalogue
+// getdents64 + openat on Linux, FindFirstFileEx on Windows, inotify to keep it honest
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+#include "FileIndex.h"
+#include "Core/ThreadManager.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <set>
+
+namespace {
+    // Index file layout - a header, the root it was built from, then one listing per directory
+    constexpr char IndexMagic[8] = { 'R', 'O', 'A', 'M', 'F', 'I', 'X', '\0' };
+    constexpr uint32_t IndexVersion = 1;
+
+    constexpr size_t ListBufferSize = 64 * 1024;
+
+    std::string JoinPath(const std::string& directory, const std::string& name) {
+        return directory.empty() ? name : directory + "/" + name;
+    }
+
+    // Absolute, '.' and '..' resolved, forward slashes, no trailing slash
+    std::string NormalizeAbsolute(const std::string& path) {
+        std::error_code error;
+        std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        if (error) return std::string();
+
+        std::string normalized = absolute.lexically_normal().generic_string();
+        while (normalized.size() > 1 && normalized.back() == '/') normalized.pop_back();
+        return normalized;
+    }
+
+    template<typename Record>
+    bool NameLess(const Record& a, const Record& b) {
+        return a.name < b.name;
+    }
+
+#if defined(_WIN32)
+    int64_t ToNanoseconds(const FILETIME& time) {
+        // 100ns ticks since 1601 - move them to the Unix epoch
+        uint64_t ticks = (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+        return (static_cast<int64_t>(ticks) - 116444736000000000ll) * 100;
+    }
+#else
+    int64_t ToNanoseconds(const struct stat& info) {
+#if defined(__APPLE__)
+        return static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000ll + info.st_mtimespec.tv_nsec;
+#else
+        return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000ll + info.st_mtim.tv_nsec;
+#endif
+    }
+
+    int OpenDirectoryAt(int rootDescriptor, const std::string& relative) {
+        // O_NOFOLLOW - symlinked directories aren't walked, that's how you get cycles
+        return ::openat(rootDescriptor, relative.empty() ? "." : relative.c_str(),
+                        O_RDONLY | O_DIRECTORY | O_CLOEXEC | (relative.empty() ? 0 : O_NOFOLLOW));
+    }
+#endif
+
+    // Simple binary writer/reader for the index file - lengths first, every read bounds-checked
+    class IndexWriter {
+    public:
+        void WriteRaw(const void* data, size_t size) { buffer.append(static_cast<const char*>(data), size); }
+        void Write32(uint32_t value) { WriteRaw(&value, sizeof(value)); }
+        void Write64(uint64_t value) { WriteRaw(&value, sizeof(value)); }
+        void WriteString(const std::string& text) {
+            Write32(static_cast<uint32_t>(text.size()));
+            WriteRaw(text.data(), text.size());
+        }
+
+        std::string buffer;
+    };
+
+    class IndexReader {
+    public:
+        explicit IndexReader(const std::string& data) : buffer(data), position(0), failed(false) {}
+
+        bool ReadRaw(void* data, size_t size) {
+            if (failed || buffer.size() - position < size) {
+                failed = true;
+                return false;
+            }
+            std::memcpy(data, buffer.data() + position, size);
+            position += size;
+            return true;
+        }
+
+        uint32_t Read32() {
+            uint32_t value = 0;
+            ReadRaw(&value, sizeof(value));
+            return value;
+        }
+
+        uint64_t Read64() {
+            uint64_t value = 0;
+            ReadRaw(&value, sizeof(value));
+            return value;
+        }
+
+        std::string ReadString() {
+            uint32_t size = Read32();
+            if (failed || buffer.size() - position < size) {
+                failed = true;
+                return std::string();
+            }
+            std::string text(buffer.data() + position, size);
+            position += size;
+            return text;
+        }
+
+        bool IsValid() const { return !failed; }
+        bool IsAtEnd() const { return position == buffer.size(); }
+
+    private:
+        const std::string& buffer;
+        size_t position;
+        bool failed;
+    };
+}
+
+FileIndex::FileIndex()
+    : jobSystem(nullptr), rootDescriptor(-1), watchDescriptor(-1), watchFailed(false), rescanNeeded(false) {
+}
+
+FileIndex::~FileIndex() {
+    Clear();
+}
+
+bool FileIndex::OpenRoot(const std::string& path) {
+    rootPath = NormalizeAbsolute(path);
+    if (rootPath.empty()) return false;
+
+#if defined(_WIN32)
+    DWORD attributes = ::GetFileAttributesA(rootPath.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    rootDescriptor = ::open(rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return rootDescriptor >= 0;
+#endif
+}
+
+bool FileIndex::Build(const std::string& path) {
+    Clear();
+    if (!OpenRoot(path)) {
+        Clear();
+        return false;
+    }
+
+    DirectoryMap scanned;
+    ScanTrees({ std::string() }, scanned);
+    if (scanned.find(std::string()) == scanned.end()) {
+        Clear();
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    directories = std::move(scanned);
+    return true;
+}
+
+void FileIndex::Clear() {
+    StopWatching();
+
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    directories.clear();
+    rootPath.clear();
+#if !defined(_WIN32)
+    if (rootDescriptor >= 0) ::close(rootDescriptor);
+#endif
+    rootDescriptor = -1;
+}
+
+bool FileIndex::Save(const std::string& indexPath) const {
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    if (rootPath.empty()) return false;
+
+    // Sorted, so the same tree always writes the same file
+    std::vector<const DirectoryMap::value_type*> sorted;
+    sorted.reserve(directories.size());
+    for (const auto& directory : directories) sorted.push_back(&directory);
+    std::sort(sorted.begin(), sorted.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+    IndexWriter writer;
+    writer.WriteRaw(IndexMagic, sizeof(IndexMagic));
+    writer.Write32(IndexVersion);
+    writer.Write32(static_cast<uint32_t>(sorted.size()));
+    writer.WriteString(rootPath);
+
+    for (const auto* directory : sorted) {
+        const DirectoryRecord& record = directory->second;
+        writer.WriteString(directory->first);
+        writer.Write64(static_cast<uint64_t>(record.modifiedTime));
+        writer.Write32(static_cast<uint32_t>(record.files.size()));
+        for (const FileRecord& file : record.files) {
+            writer.WriteString(file.name);
+            writer.Write64(file.size);
+            writer.Write64(static_cast<uint64_t>(file.modifiedTime));
+        }
+        writer.Write32(static_cast<uint32_t>(record.subdirectories.size()));
+        for (const std::string& subdirectory : record.subdirectories) writer.WriteString(subdirectory);
+    }
+    lock.unlock();
+
+    // Temp file and rename - a crash mid-save leaves the old index, not half of a new one
+    std::error_code error;
+    std::filesystem::path target(indexPath);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), error);
+
+    std::string tempPath = indexPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(writer.buffer.data(), static_cast<std::streamsize>(writer.buffer.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, indexPath, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool FileIndex::Load(const std::string& indexPath, const std::string& path) {
+    Clear();
+
+    std::string data;
+    {
+        std::ifstream in(indexPath, std::ios::binary);
+        if (!in) return false;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    IndexReader reader(data);
+    char magic[sizeof(IndexMagic)];
+    if (!reader.ReadRaw(magic, sizeof(magic)) || std::memcmp(magic, IndexMagic, sizeof(IndexMagic)) != 0) return false;
+    if (reader.Read32() != IndexVersion) return false;
+
+    uint32_t directoryCount = reader.Read32();
+    std::string savedRoot = reader.ReadString();
+    if (!reader.IsValid() || savedRoot != NormalizeAbsolute(path)) return false;
+
+    DirectoryMap loaded;
+    loaded.reserve(directoryCount);
+    for (uint32_t i = 0; i < directoryCount && reader.IsValid(); ++i) {
+        std::string relative = reader.ReadString();
+        DirectoryRecord record;
+        record.modifiedTime = static_cast<int64_t>(reader.Read64());
+
+        uint32_t fileCount = reader.Read32();
+        for (uint32_t f = 0; f < fileCount && reader.IsValid(); ++f) {
+            FileRecord file;
+            file.name = reader.ReadString();
+            file.size = reader.Read64();
+            file.modifiedTime = static_cast<int64_t>(reader.Read64());
+            record.files.push_back(std::move(file));
+        }
+
+        uint32_t subdirectoryCount = reader.Read32();
+        for (uint32_t d = 0; d < subdirectoryCount && reader.IsValid(); ++d) {
+            record.subdirectories.push_back(reader.ReadString());
+        }
+
+        loaded[relative] = std::move(record);
+    }
+    if (!reader.IsValid() || !reader.IsAtEnd() || loaded.find(std::string()) == loaded.end()) return false;
+
+    if (!OpenRoot(path)) {
+        Clear();
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    directories = std::move(loaded);
+    return true;
+}
+
+size_t FileIndex::Validate(bool statFiles) {
+    std::vector<std::string> changed;
+    {
+        // Workers only read the index here - nobody writes it until we let go
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        if (rootPath.empty()) return 0;
+
+        std::vector<const DirectoryMap::value_type*> entries;
+        entries.reserve(directories.size());
+        for (const auto& directory : directories) entries.push_back(&directory);
+
+        std::vector<uint8_t> unchanged(entries.size(), 0);
+        auto check = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                unchanged[i] = CheckDirectory(entries[i]->first, entries[i]->second, statFiles) ? 1 : 0;
+            }
+        };
+
+        if (jobSystem) jobSystem->ParallelFor(entries.size(), 32, check, JobPriority::High);
+        else check(0, entries.size());
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!unchanged[i]) changed.push_back(entries[i]->first);
+        }
+    }
+
+    return RefreshDirectories(changed);
+}
+
+bool FileIndex::StartWatching() {
+#if defined(__linux__)
+    if (watchDescriptor >= 0) return true;
+    if (rootPath.empty()) return false;
+
+    watchDescriptor = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watchDescriptor < 0) return false;
+    watchFailed = false;
+
+    std::vector<std::string> watchList;
+    {
+        std::shared_lock<std::shared_mutex> lock(indexMutex);
+        watchList.reserve(directories.size());
+        for (const auto& directory : directories) watchList.push_back(directory.first);
+    }
+    for (const std::string& relative : watchList) {
+        if (!AddWatch(relative)) break;
+    }
+    if (watchFailed) {
+        StopWatching();
+        return false;
+    }
+
+    // Whatever moved between the last scan and the watches going up
+    Validate(false);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileIndex::StopWatching() {
+#if defined(__linux__)
+    if (watchDescriptor >= 0) ::close(watchDescriptor); // closing drops every watch with it
+#endif
+    watchDescriptor = -1;
+
+    std::lock_guard<std::mutex> lock(watchMutex);
+    watchedDirectories.clear();
+    directoryWatches.clear();
+}
+
+size_t FileIndex::Poll() {
+#if defined(__linux__)
+    if (watchDescriptor < 0) return 0;
+
+    // Coalesce first - an editor saving one file can easily send a dozen events
+    std::set<std::string> relistDirectories;
+    std::set<std::string> touchedFiles;
+
+    thread_local std::vector<char> buffer(ListBufferSize);
+    for (;;) {
+        ssize_t bytes = ::read(watchDescriptor, buffer.data(), buffer.size());
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) break; // EAGAIN - drained
+
+        for (ssize_t offset = 0; offset < bytes;) {
+            inotify_event event;
+            std::memcpy(&event, buffer.data() + offset, sizeof(event));
+            const char* name = buffer.data() + offset + sizeof(inotify_event);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event.len);
+
+            if (event.mask & IN_Q_OVERFLOW) {
+                rescanNeeded = true;
+                continue;
+            }
+
+            std::string directory;
+            {
+                std::lock_guard<std::mutex> lock(watchMutex);
+                auto it = watchedDirectories.find(event.wd);
+                if (it == watchedDirectories.end()) continue;
+                directory = it->second;
+
+                if (event.mask & IN_IGNORED) {
+                    directoryWatches.erase(directory);
+                    watchedDirectories.erase(it);
+                    continue;
+                }
+            }
+
+            // Events about the directory itself arrive from its parent as well - handle them there
+            if (event.len == 0) continue;
+
+            if (event.mask & IN_ISDIR) {
+                relistDirectories.insert(directory);
+            } else {
+                touchedFiles.insert(JoinPath(directory, std::string(name)));
+            }
+        }
+    }
+
+    if (rescanNeeded) {
+        // The kernel dropped events - only a full check can tell what we missed
+        rescanNeeded = false;
+        size_t changes = Validate(true);
+        if (watchFailed) StopWatching();
+        return changes;
+    }
+
+    size_t changes = RefreshDirectories(std::vector<std::string>(relistDirectories.begin(), relistDirectories.end()));
+    for (const std::string& file : touchedFiles) {
+        size_t slash = file.rfind('/');
+        std::string directory = slash == std::string::npos ? std::string() : file.substr(0, slash);
+        if (relistDirectories.count(directory)) continue; // already fresh
+        if (RefreshFile(file)) changes++;
+    }
+
+    // Ran out of watches for new folders - stop pretending we see everything
+    if (watchFailed) StopWatching();
+    return changes;
+#else
+    return 0;
+#endif
+}
+
+bool FileIndex::Covers(const std::string& path) const {
+    std::string relative;
+    return ToRelative(path, relative);
+}
+
+bool FileIndex::GetEntry(const std::string& path, FileIndexEntry& entry) const {
+    std::string relative;
+    if (!ToRelative(path, relative) || relative.empty()) return false;
+
+    size_t slash = relative.rfind('/');
+    std::string directory = slash == std::string::npos ? std::string() : relative.substr(0, slash);
+    FileRecord key;
+    key.name = slash == std::string::npos ? relative : relative.substr(slash + 1);
+
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    auto it = directories.find(directory);
+    if (it == directories.end()) return false;
+
+    const auto& files = it->second.files;
+    auto file = std::lower_bound(files.begin(), files.end(), key, NameLess<FileRecord>);
+    if (file == files.end() || file->name != key.name) return false;
+
+    entry.path = relative;
+    entry.size = file->size;
+    entry.modifiedTime = file->modifiedTime;
+    return true;
+}
+
+bool FileIndex::FileExists(const std::string& path) const {
+    FileIndexEntry entry;
+    return GetEntry(path, entry);
+}
+
+bool FileIndex::DirectoryExists(const std::string& path) const {
+    std::string relative;
+    if (!ToRelative(path, relative)) return false;
+
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    return directories.find(relative) != directories.end();
+}
+
+std::vector<std::string> FileIndex::GetFiles(const std::string& directory, const std::string& extension, bool recursive) const {
+    std::vector<std::string> result;
+    std::string relative;
+    if (!ToRelative(directory, relative)) return result;
+
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\') prefix += '/';
+
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    std::function<void(const std::string&, const std::string&)> visit = [&](const std::string& current, const std::string& currentPrefix) {
+        auto it = directories.find(current);
+        if (it == directories.end()) return;
+
+        for (const FileRecord& file : it->second.files) {
+            if (MatchesExtension(file.name, extension)) result.push_back(currentPrefix + file.name);
+        }
+        if (recursive) {
+            for (const std::string& subdirectory : it->second.subdirectories) {
+                visit(JoinPath(current, subdirectory), currentPrefix + subdirectory + "/");
+            }
+        }
+    };
+    visit(relative, prefix);
+    return result;
+}
+
+std::vector<std::string> FileIndex::GetDirectories(const std::string& directory, bool recursive) const {
+    std::vector<std::string> result;
+    std::string relative;
+    if (!ToRelative(directory, relative)) return result;
+
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix.back() != '/' && prefix.back() != '\\') prefix += '/';
+
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    std::function<void(const std::string&, const std::string&)> visit = [&](const std::string& current, const std::string& currentPrefix) {
+        auto it = directories.find(current);
+        if (it == directories.end()) return;
+
+        for (const std::string& subdirectory : it->second.subdirectories) {
+            result.push_back(currentPrefix + subdirectory);
+            if (recursive) visit(JoinPath(current, subdirectory), currentPrefix + subdirectory + "/");
+        }
+    };
+    visit(relative, prefix);
+    return result;
+}
+
+void FileIndex::ForEachFile(const std::function<void(const FileIndexEntry&)>& visitor) const {
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    FileIndexEntry entry;
+    for (const auto& [relative, record] : directories) {
+        for (const FileRecord& file : record.files) {
+            entry.path = JoinPath(relative, file.name);
+            entry.size = file.size;
+            entry.modifiedTime = file.modifiedTime;
+            visitor(entry);
+        }
+    }
+}
+
+bool FileIndex::MatchesExtension(const std::string& fileName, const std::string& extension) {
+    if (extension.empty()) return true;
+
+    size_t start = extension[0] == '.' ? 1 : 0;
+    size_t length = extension.size() - start;
+    if (fileName.size() < length + 1 || fileName[fileName.size() - length - 1] != '.') return false;
+
+    for (size_t i = 0; i < length; ++i) {
+        unsigned char a = static_cast<unsigned char>(fileName[fileName.size() - length + i]);
+        unsigned char b = static_cast<unsigned char>(extension[start + i]);
+        if (std::tolower(a) != std::tolower(b)) return false;
+    }
+    return true;
+}
+
+size_t FileIndex::GetFileCount() const {
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    size_t count = 0;
+    for (const auto& directory : directories) count += directory.second.files.size();
+    return count;
+}
+
+size_t FileIndex::GetDirectoryCount() const {
+    std::shared_lock<std::shared_mutex> lock(indexMutex);
+    return directories.size();
+}
+
+bool FileIndex::ToRelative(const std::string& path, std::string& relative) const {
+    if (rootPath.empty()) return false;
+
+    std::string normalized = NormalizeAbsolute(path);
+    if (normalized == rootPath) {
+        relative.clear();
+        return true;
+    }
+
+    // "/" as the root already ends in a slash - everything else needs one added
+    size_t prefixLength = rootPath.back() == '/' ? rootPath.size() : rootPath.size() + 1;
+    if (normalized.size() <= prefixLength || normalized.compare(0, rootPath.size(), rootPath) != 0 ||
+        normalized[prefixLength - 1] != '/') {
+        return false;
+    }
+
+    relative = normalized.substr(prefixLength);
+    return true;
+}
+
+bool FileIndex::ListDirectory(const std::string& relativeDir, DirectoryRecord& record) const {
+    record.files.clear();
+    record.subdirectories.clear();
+
+#if defined(_WIN32)
+    std::string directoryPath = relativeDir.empty() ? rootPath : rootPath + "/" + relativeDir;
+
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!::GetFileAttributesExA(directoryPath.c_str(), GetFileExInfoStandard, &info)) return false;
+    record.modifiedTime = ToNanoseconds(info.ftLastWriteTime);
+
+    // Basic info and large fetches - no short names, fewer round trips to the file system
+    WIN32_FIND_DATAA data;
+    HANDLE find = ::FindFirstFileExA((directoryPath + "/*").c_str(), FindExInfoBasic, &data,
+                                     FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE) return false;
+
+    do {
+        std::string name = data.cFileName;
+        if (name == "." || name == "..") continue;
+
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            if (!(data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) record.subdirectories.push_back(std::move(name));
+        } else {
+            FileRecord file;
+            file.name = std::move(name);
+            file.size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+            file.modifiedTime = ToNanoseconds(data.ftLastWriteTime);
+            record.files.push_back(std::move(file));
+        }
+    } while (::FindNextFileA(find, &data));
+    ::FindClose(find);
+#else
+    int directory = OpenDirectoryAt(rootDescriptor, relativeDir);
+    if (directory < 0) return false;
+
+    struct stat info;
+    if (::fstat(directory, &info) != 0) {
+        ::close(directory);
+        return false;
+    }
+    record.modifiedTime = ToNanoseconds(info);
+
+    // d_type says what it is for free - only files pay for a stat, and relative to this directory
+    auto addEntry = [&](const char* name, unsigned char type) {
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) return;
+
+        if (type == DT_DIR) {
+            record.subdirectories.emplace_back(name);
+            return;
+        }
+        if (type != DT_REG && type != DT_LNK && type != DT_UNKNOWN) return;
+
+        // Symlinked files are followed, symlinked directories are not
+        struct stat entryInfo;
+        if (::fstatat(directory, name, &entryInfo, type == DT_LNK ? 0 : AT_SYMLINK_NOFOLLOW) != 0) return;
+
+        if (S_ISREG(entryInfo.st_mode)) {
+            FileRecord file;
+            file.name = name;
+            file.size = static_cast<uint64_t>(entryInfo.st_size);
+            file.modifiedTime = ToNanoseconds(entryInfo);
+            record.files.push_back(std::move(file));
+        } else if (S_ISDIR(entryInfo.st_mode) && type == DT_UNKNOWN) {
+            record.subdirectories.emplace_back(name);
+        }
+    };
+
+#if defined(__linux__)
+    // getdents64 straight into a big buffer - one syscall per few hundred entries
+    thread_local std::vector<char> buffer(ListBufferSize);
+    for (;;) {
+        long bytes = ::syscall(SYS_getdents64, directory, buffer.data(), buffer.size());
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes < 0) {
+            ::close(directory);
+            return false;
+        }
+        if (bytes == 0) break;
+
+        // linux_dirent64: ino (8), off (8), reclen (2), type (1), name
+        for (long offset = 0; offset < bytes;) {
+            const char* entry = buffer.data() + offset;
+            unsigned short recordLength;
+            std::memcpy(&recordLength, entry + 16, sizeof(recordLength));
+            addEntry(entry + 19, static_cast<unsigned char>(entry[18]));
+            offset += recordLength;
+        }
+    }
+    ::close(directory);
+#else
+    DIR* stream = ::fdopendir(directory);
+    if (!stream) {
+        ::close(directory);
+        return false;
+    }
+    while (dirent* entry = ::readdir(stream)) addEntry(entry->d_name, entry->d_type);
+    ::closedir(stream); // closes the descriptor too
+#endif
+#endif
+
+    std::sort(record.files.begin(), record.files.end(), NameLess<FileRecord>);
+    std::sort(record.subdirectories.begin(), record.subdirectories.end());
+    return true;
+}
+
+bool FileIndex::CheckDirectory(const std::string& relativeDir, const DirectoryRecord& record, bool statFiles) const {
+#if defined(_WIN32)
+    bool isDirectory;
+    uint64_t size;
+    int64_t modifiedTime;
+    if (!StatPath(relativeDir, isDirectory, size, modifiedTime) || !isDirectory || modifiedTime != record.modifiedTime) return false;
+
+    if (statFiles) {
+        for (const FileRecord& file : record.files) {
+            if (!StatPath(JoinPath(relativeDir, file.name), isDirectory, size, modifiedTime) || isDirectory ||
+                size != file.size || modifiedTime != file.modifiedTime) {
+                return false;
+            }
+        }
+    }
+    return true;
+#else
+    int directory = OpenDirectoryAt(rootDescriptor, relativeDir);
+    if (directory < 0) return false;
+
+    struct stat info;
+    bool unchanged = ::fstat(directory, &info) == 0 && ToNanoseconds(info) == record.modifiedTime;
+
+    // Files through the directory's descriptor - no walking the whole path again for each one
+    for (size_t i = 0; unchanged && statFiles && i < record.files.size(); ++i) {
+        const FileRecord& file = record.files[i];
+        unchanged = ::fstatat(directory, file.name.c_str(), &info, 0) == 0 && S_ISREG(info.st_mode) &&
+                    static_cast<uint64_t>(info.st_size) == file.size && ToNanoseconds(info) == file.modifiedTime;
+    }
+
+    ::close(directory);
+    return unchanged;
+#endif
+}
+
+bool FileIndex::StatPath(const std::string& relativePath, bool& isDirectory, uint64_t& size, int64_t& modifiedTime) const {
+#if defined(_WIN32)
+    std::string fullPath = relativePath.empty() ? rootPath : rootPath + "/" + relativePath;
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!::GetFileAttributesExA(fullPath.c_str(), GetFileExInfoStandard, &info)) return false;
+
+    isDirectory = (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    size = (static_cast<uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    modifiedTime = ToNanoseconds(info.ftLastWriteTime);
+    return true;
+#else
+    struct stat info;
+    if (::fstatat(rootDescriptor, relativePath.empty() ? "." : relativePath.c_str(), &info, 0) != 0) return false;
+
+    isDirectory = S_ISDIR(info.st_mode);
+    size = static_cast<uint64_t>(info.st_size);
+    modifiedTime = ToNanoseconds(info);
+    return S_ISDIR(info.st_mode) || S_ISREG(info.st_mode);
+#endif
+}
+
+void FileIndex::ScanTrees(const std::vector<std::string>& roots, DirectoryMap& output) {
+    std::mutex outputMutex;
+    bool watch = IsWatching();
+
+    auto scanOne = [&](const std::string& relative, std::vector<std::string>& children) {
+        // Watch before listing, so nothing created in between slips past us
+        if (watch) AddWatch(relative);
+
+        children.clear();
+        DirectoryRecord record;
+        if (!ListDirectory(relative, record)) return;
+
+        for (const std::string& subdirectory : record.subdirectories) children.push_back(JoinPath(relative, subdirectory));
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        output[relative] = std::move(record);
+    };
+
+    if (!jobSystem || jobSystem->GetWorkerCount() == 0) {
+        // Explicit stack - deep trees shouldn't mean a deep call stack
+        std::vector<std::string> pending(roots.rbegin(), roots.rend());
+        std::vector<std::string> children;
+        while (!pending.empty()) {
+            std::string relative = std::move(pending.back());
+            pending.pop_back();
+            scanOne(relative, children);
+            pending.insert(pending.end(), children.rbegin(), children.rend());
+        }
+        return;
+    }
+
+    // One job per directory - each one queues its children, the counter covers them all
+    JobCounter counter;
+    std::function<void(std::string)> submit = [&](std::string relative) {
+        jobSystem->Submit([&scanOne, &submit, relative]() {
+            std::vector<std::string> children;
+            scanOne(relative, children);
+            for (std::string& child : children) submit(std::move(child));
+        }, JobPriority::High, &counter);
+    };
+    for (const std::string& root : roots) submit(root);
+    jobSystem->Wait(counter);
+}
+
+size_t FileIndex::RefreshDirectories(const std::vector<std::string>& relativeDirs) {
+    if (relativeDirs.empty()) return 0;
+
+    std::vector<DirectoryRecord> listings(relativeDirs.size());
+    std::vector<uint8_t> listed(relativeDirs.size(), 0);
+    auto list = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) listed[i] = ListDirectory(relativeDirs[i], listings[i]) ? 1 : 0;
+    };
+    if (jobSystem) jobSystem->ParallelFor(relativeDirs.size(), 8, list, JobPriority::High);
+    else list(0, relativeDirs.size());
+
+    std::vector<std::string> newDirectories;
+    std::vector<std::string> erased;
+    {
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        for (size_t i = 0; i < relativeDirs.size(); ++i) {
+            const std::string& relative = relativeDirs[i];
+            if (!listed[i]) {
+                EraseSubtree(relative, erased); // gone, or we can't get in any more
+                continue;
+            }
+
+            // Both lists are sorted - walk them side by side to see what came and went
+            std::vector<std::string> oldSubdirectories;
+            auto it = directories.find(relative);
+            if (it != directories.end()) oldSubdirectories = std::move(it->second.subdirectories);
+            const std::vector<std::string>& newSubdirectories = listings[i].subdirectories;
+
+            std::vector<std::string> removed;
+            std::set_difference(oldSubdirectories.begin(), oldSubdirectories.end(),
+                                newSubdirectories.begin(), newSubdirectories.end(), std::back_inserter(removed));
+            for (const std::string& name : removed) EraseSubtree(JoinPath(relative, name), erased);
+
+            for (const std::string& name : newSubdirectories) {
+                std::string child = JoinPath(relative, name);
+                if (directories.find(child) == directories.end()) newDirectories.push_back(std::move(child));
+            }
+
+            directories[relative] = std::move(listings[i]);
+        }
+    }
+
+    if (IsWatching()) {
+        for (const std::string& relative : erased) RemoveWatch(relative);
+    }
+
+    if (!newDirectories.empty()) {
+        DirectoryMap scanned;
+        ScanTrees(newDirectories, scanned);
+
+        std::unique_lock<std::shared_mutex> lock(indexMutex);
+        for (auto& [relative, record] : scanned) directories[relative] = std::move(record);
+    }
+
+    return relativeDirs.size();
+}
+
+bool FileIndex::RefreshFile(const std::string& relativePath) {
+    size_t slash = relativePath.rfind('/');
+    std::string directory = slash == std::string::npos ? std::string() : relativePath.substr(0, slash);
+
+    FileRecord updated;
+    updated.name = slash == std::string::npos ? relativePath : relativePath.substr(slash + 1);
+
+    bool isDirectory = false;
+    bool exists = StatPath(relativePath, isDirectory, updated.size, updated.modifiedTime) && !isDirectory;
+
+    // Created and deleted files move the directory's time too - keep it current for the next Validate
+    bool directoryIsDirectory = false;
+    uint64_t directorySize = 0;
+    int64_t directoryTime = 0;
+    bool directoryExists = StatPath(directory, directoryIsDirectory, directorySize, directoryTime);
+
+    std::unique_lock<std::shared_mutex> lock(indexMutex);
+    auto it = directories.find(directory);
+    if (it == directories.end()) return false;
+    if (directoryExists) it->second.modifiedTime = directoryTime;
+
+    auto& files = it->second.files;
+    auto file = std::lower_bound(files.begin(), files.end(), updated, NameLess<FileRecord>);
+    bool found = file != files.end() && file->name == updated.name;
+
+    if (!exists) {
+        if (!found) return false;
+        files.erase(file);
+        return true;
+    }
+
+    if (found) {
+        if (file->size == updated.size && file->modifiedTime == updated.modifiedTime) return false;
+        *file = std::move(updated);
+    } else {
+        files.insert(file, std::move(updated));
+    }
+    return true;
+}
+
+void FileIndex::EraseSubtree(const std::string& relativeDir, std::vector<std::string>& erased) {
+    auto it = directories.find(relativeDir);
+    if (it == directories.end()) return;
+
+    std::vector<std::string> subdirectories = std::move(it->second.subdirectories);
+    directories.erase(it);
+    erased.push_back(relativeDir);
+
+    for (const std::string& name : subdirectories) EraseSubtree(JoinPath(relativeDir, name), erased);
+}
+
+bool FileIndex::AddWatch(const std::string& relativeDir) {
+#if defined(__linux__)
+    if (watchDescriptor < 0) return false;
+
+    std::string fullPath = relativeDir.empty() ? rootPath : rootPath + "/" + relativeDir;
+    constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB |
+                              IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+    int watch = ::inotify_add_watch(watchDescriptor, fullPath.c_str(), mask);
+    if (watch < 0) {
+        if (errno == ENOENT || errno == ENOTDIR) return true; // already gone - its parent's events cover that
+        watchFailed = true; // ENOSPC: out of watches
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(watchMutex);
+    watchedDirectories[watch] = relativeDir;
+    directoryWatches[relativeDir] = watch;
+    return true;
+#else
+    (void)relativeDir;
+    return false;
+#endif
+}
+
+void FileIndex::RemoveWatch(const std::string& relativeDir) {
+#if defined(__linux__)
+    std::lock_guard<std::mutex> lock(watchMutex);
+    auto it = directoryWatches.find(relativeDir);
+    if (it == directoryWatches.end()) return;
+
+    // Deleted directories lose their watch on their own - this only matters for ones moved out of the tree
+    if (watchDescriptor >= 0) ::inotify_rm_watch(watchDescriptor, it->second);
+    watchedDirectories.erase(it->second);
+    directoryWatches.erase(it);
+#else
+    (void)relativeDir;
+#endif
+}
@@ -0,0 +1,121 @@
+// FileIndex.h - The card catalogue
+// Knows every file under a folder, its size and age, without asking the disk every time
+
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadManager;
+
+// One file in the index - paths are relative to the root, '/' separated
+struct FileIndexEntry {
+    std::string path;
+    uint64_t size = 0;
+    int64_t modifiedTime = 0; // nanoseconds since the Unix epoch
+};
+
+// The FileIndex class - one parallel walk up front, then only what changed
+class FileIndex {
+public:
+    FileIndex();
+    ~FileIndex();
+
+    // Job system - directories are listed in parallel when there are workers
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    // Building - walk the whole tree from scratch
+    bool Build(const std::string& rootPath);
+    void Clear();
+
+    // Persistence - start from the last run's index instead of walking again. Load only fails on
+    // a missing/corrupt file or a different root; call Validate afterwards to catch up with the disk.
+    bool Save(const std::string& indexPath) const;
+    bool Load(const std::string& indexPath, const std::string& rootPath);
+
+    // Validation - directories whose modification time moved are listed again, which is enough to
+    // see every file that came or went. statFiles also re-stats every file to catch edits made in
+    // place (those don't touch the directory) - about as slow as a Build, so only when sizes matter.
+    // Returns the number of directories that had changed.
+    size_t Validate(bool statFiles = false);
+
+    // Live updates - inotify on Linux. Returns false where that's not available or the watch
+    // limit is too low for the tree (raise fs.inotify.max_user_watches), call Validate instead.
+    bool StartWatching();
+    void StopWatching();
+    bool IsWatching() const { return watchDescriptor >= 0; }
+    size_t Poll(); // apply queued change events - returns how many paths changed
+
+    // Queries - paths can be absolute or relative to the working directory, as long as they're inside the root
+    bool Covers(const std::string& path) const;
+    bool GetEntry(const std::string& path, FileIndexEntry& entry) const;
+    bool FileExists(const std::string& path) const;
+    bool DirectoryExists(const std::string& path) const;
+
+    // Listings - results start with the directory string you passed in, like FileSystem::GetFiles.
+    // extension matches with or without the dot, ignoring case.
+    std::vector<std::string> GetFiles(const std::string& directory, const std::string& extension = "", bool recursive = false) const;
+    std::vector<std::string> GetDirectories(const std::string& directory, bool recursive = false) const;
+    void ForEachFile(const std::function<void(const FileIndexEntry&)>& visitor) const;
+
+    const std::string& GetRootPath() const { return rootPath; }
+    static bool MatchesExtension(const std::string& fileName, const std::string& extension);
+    size_t GetFileCount() const;
+    size_t GetDirectoryCount() const;
+
+private:
+    // Prevent copying - one catalogue per tree is enough
+    FileIndex(const FileIndex&) = delete;
+    FileIndex& operator=(const FileIndex&) = delete;
+
+    struct FileRecord {
+        std::string name;
+        uint64_t size = 0;
+        int64_t modifiedTime = 0;
+    };
+
+    // One listing per directory - files and subdirectories sorted by name
+    struct DirectoryRecord {
+        int64_t modifiedTime = 0;
+        std::vector<FileRecord> files;
+        std::vector<std::string> subdirectories;
+    };
+
+    using DirectoryMap = std::unordered_map<std::string, DirectoryRecord>;
+
+    bool ToRelative(const std::string& path, std::string& relative) const;
+    bool OpenRoot(const std::string& path);
+    bool ListDirectory(const std::string& relativeDir, DirectoryRecord& record) const;
+    bool CheckDirectory(const std::string& relativeDir, const DirectoryRecord& record, bool statFiles) const;
+    bool StatPath(const std::string& relativePath, bool& isDirectory, uint64_t& size, int64_t& modifiedTime) const;
+    void ScanTrees(const std::vector<std::string>& roots, DirectoryMap& output);
+    size_t RefreshDirectories(const std::vector<std::string>& relativeDirs);
+    bool RefreshFile(const std::string& relativePath);
+    void EraseSubtree(const std::string& relativeDir, std::vector<std::string>& erased);
+
+    bool AddWatch(const std::string& relativeDir);
+    void RemoveWatch(const std::string& relativeDir);
+
+    std::string rootPath; // absolute, normalized, '/' separated
+    DirectoryMap directories;
+    mutable std::shared_mutex indexMutex;
+    ThreadManager* jobSystem;
+    int rootDescriptor; // directories are opened relative to this - shorter lookups than full paths
+
+    // inotify state - descriptor per watched directory, both ways round
+    int watchDescriptor;
+    std::atomic<bool> watchFailed;
+    bool rescanNeeded;
+    std::unordered_map<int, std::string> watchedDirectories;
+    std::unordered_map<std::string, int> directoryWatches;
+    std::mutex watchMutex;
+};
+
+#endif // FILEINDEX_H
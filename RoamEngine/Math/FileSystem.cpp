@@ -0,0 +1,260 @@
+// FileSystem.cpp - Implementation of the file system guru
+// Where bytes come from, ideally without being copied three times on the way
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+// windows.h turns these into macros and would rename our FileSystem members - no thanks
+#undef GetCurrentDirectory
+#undef SetCurrentDirectory
+#undef CreateDirectory
+#undef RemoveDirectory
+#undef CopyFile
+#undef MoveFile
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FileSystem.h"
+#include "AsyncFileIO.h"
+#include "FileIndex.h"
+#include <algorithm>
+
+namespace {
+    size_t GetPageSize() {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+#else
+        static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return pageSize;
+#endif
+    }
+}
+
+MappedFile::MappedFile() : data(nullptr), size(0), mode(MapMode::ReadOnly), opened(false)
+#if defined(_WIN32)
+    , fileHandle(nullptr), mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(other.data), size(other.size), mode(other.mode), opened(other.opened), path(std::move(other.path))
+#if defined(_WIN32)
+    , fileHandle(other.fileHandle), mappingHandle(other.mappingHandle)
+#endif
+{
+    other.data = nullptr;
+    other.size = 0;
+    other.opened = false;
+#if defined(_WIN32)
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#endif
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        data = other.data;
+        size = other.size;
+        mode = other.mode;
+        opened = other.opened;
+        path = std::move(other.path);
+        other.data = nullptr;
+        other.size = 0;
+        other.opened = false;
+#if defined(_WIN32)
+        fileHandle = other.fileHandle;
+        mappingHandle = other.mappingHandle;
+        other.fileHandle = nullptr;
+        other.mappingHandle = nullptr;
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& filePath, MapMode mapMode) {
+    Close();
+    mode = mapMode;
+
+#if defined(_WIN32)
+    std::wstring widePath = std::filesystem::path(filePath).wstring();
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Empty files can't be mapped, but they're still perfectly valid files
+    if (fileSize.QuadPart > 0) {
+        DWORD protection = mapMode == MapMode::CopyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY;
+        HANDLE mapping = CreateFileMappingW(file, nullptr, protection, 0, 0, nullptr);
+        if (!mapping) {
+            CloseHandle(file);
+            return false;
+        }
+
+        DWORD access = mapMode == MapMode::CopyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ;
+        void* view = MapViewOfFile(mapping, access, 0, 0, 0);
+        if (!view) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        mappingHandle = mapping;
+        data = view;
+        size = static_cast<size_t>(fileSize.QuadPart);
+    }
+    fileHandle = file;
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    if (info.st_size > 0) {
+        int protection = mapMode == MapMode::CopyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        int flags = mapMode == MapMode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+        void* view = mmap(nullptr, static_cast<size_t>(info.st_size), protection, flags, fd, 0);
+        if (view == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        data = view;
+        size = static_cast<size_t>(info.st_size);
+    }
+
+    // The mapping keeps the file alive on its own - no need to hold the descriptor
+    ::close(fd);
+#endif
+
+    path = filePath;
+    opened = true;
+    return true;
+}
+
+void MappedFile::Close() {
+#if defined(_WIN32)
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(static_cast<HANDLE>(mappingHandle));
+    if (fileHandle) CloseHandle(static_cast<HANDLE>(fileHandle));
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) munmap(data, size);
+#endif
+    data = nullptr;
+    size = 0;
+    opened = false;
+    path.clear();
+}
+
+std::span<std::byte> MappedFile::GetWritableData() {
+    if (mode != MapMode::CopyOnWrite) return std::span<std::byte>();
+    return std::span<std::byte>(static_cast<std::byte*>(data), size);
+}
+
+bool MappedFile::Advise(MapAccessHint hint, size_t offset, size_t length) {
+    if (!data || offset >= size) return false;
+    length = std::min(length, size - offset);
+
+    // Round out to whole pages - the kernel doesn't do partial pages
+    size_t pageSize = GetPageSize();
+    size_t alignedOffset = offset - (offset % pageSize);
+    length += offset - alignedOffset;
+    char* start = static_cast<char*>(data) + alignedOffset;
+
+#if defined(_WIN32)
+    // Windows only takes the "page it in now" hint, the rest is up to the memory manager
+    if (hint == MapAccessHint::WillNeed) {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = start;
+        range.NumberOfBytes = length;
+        return PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+    }
+    return true;
+#else
+    int advice = MADV_NORMAL;
+    switch (hint) {
+        case MapAccessHint::Normal: advice = MADV_NORMAL; break;
+        case MapAccessHint::Sequential: advice = MADV_SEQUENTIAL; break;
+        case MapAccessHint::Random: advice = MADV_RANDOM; break;
+        case MapAccessHint::WillNeed: advice = MADV_WILLNEED; break;
+        case MapAccessHint::DontNeed: advice = MADV_DONTNEED; break;
+    }
+    // DONTNEED on a private mapping throws away our writes - only allow it on read-only views
+    if (hint == MapAccessHint::DontNeed && mode == MapMode::CopyOnWrite) return false;
+    return madvise(start, length, advice) == 0;
+#endif
+}
+
+std::shared_ptr<MappedFile> FileSystem::MapFile(const std::string& path, MapMode mode) {
+    auto mapping = std::make_shared<MappedFile>();
+    if (!mapping->Open(path, mode)) {
+        return nullptr;
+    }
+    return mapping;
+}
+
+AsyncFileIO& FileSystem::GetAsyncIO() {
+    static AsyncFileIO asyncIO;
+    return asyncIO;
+}
+
+FileIndex& FileSystem::GetFileIndex() {
+    static FileIndex fileIndex;
+    return fileIndex;
+}
+
+std::vector<std::string> FileSystem::GetDirectories(const std::string& path) {
+    const FileIndex& index = GetFileIndex();
+    if (index.Covers(path)) return index.GetDirectories(path);
+
+    // Outside the index - ask the disk
+    std::vector<std::string> result;
+    std::string prefix = path.empty() || path.back() == '/' || path.back() == '\\' ? path : path + "/";
+    std::error_code error;
+    for (auto it = std::filesystem::directory_iterator(path, error);
+         !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        std::error_code entryError;
+        if (it->is_directory(entryError)) result.push_back(prefix + it->path().filename().string());
+    }
+    return result;
+}
+
+std::vector<std::string> FileSystem::GetFiles(const std::string& path, const std::string& extension) {
+    const FileIndex& index = GetFileIndex();
+    if (index.Covers(path)) return index.GetFiles(path, extension);
+
+    std::vector<std::string> result;
+    std::string prefix = path.empty() || path.back() == '/' || path.back() == '\\' ? path : path + "/";
+    std::error_code error;
+    for (auto it = std::filesystem::directory_iterator(path, error);
+         !error && it != std::filesystem::directory_iterator(); it.increment(error)) {
+        std::error_code entryError;
+        if (!it->is_regular_file(entryError)) continue;
+        std::string name = it->path().filename().string();
+        if (FileIndex::MatchesExtension(name, extension)) result.push_back(prefix + name);
+    }
+    return result;
+}
@@ -5,9 +5,85 @@
 #define FILESYSTEM_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <span>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
 #include <filesystem>
 
+class AsyncFileIO;
+class FileIndex;
+
+// Mapping modes - how much can we touch?
+enum class MapMode {
+    ReadOnly,     // shared view of the file - writing to it is a crash, by design
+    CopyOnWrite   // private view - writes stay in our process, the file never finds out
+};
+
+// Access hints - tell the OS how we plan to read, so it can read ahead (or not)
+enum class MapAccessHint {
+    Normal,
+    Sequential,   // front to back, like a parser
+    Random,       // jumping around, like a pack file lookup
+    WillNeed,     // start paging it in now, we'll be there soon
+    DontNeed      // we're done, feel free to drop the pages
+};
+
+// Memory-mapped file - the file's bytes without copying them into a vector first
+// RAII: the view lives exactly as long as the object (or the last shared_ptr to it)
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Move only - two owners of one mapping is one unmap too many
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Open/close the mapping - empty files open fine and give an empty span
+    bool Open(const std::string& path, MapMode mode = MapMode::ReadOnly);
+    void Close();
+    bool IsOpen() const { return opened; }
+
+    // Data access - valid until Close() or destruction
+    std::span<const std::byte> GetData() const { return std::span<const std::byte>(static_cast<const std::byte*>(data), size); }
+    std::span<std::byte> GetWritableData(); // CopyOnWrite only, empty otherwise
+    std::string_view GetText() const { return std::string_view(static_cast<const char*>(data), size); }
+    size_t GetSize() const { return size; }
+    MapMode GetMode() const { return mode; }
+    const std::string& GetPath() const { return path; }
+
+    // Paging hints - offset/length are clamped to the mapping and rounded out to pages
+    bool Advise(MapAccessHint hint, size_t offset = 0, size_t length = SIZE_MAX);
+
+private:
+    void* data;
+    size_t size;
+    MapMode mode;
+    bool opened;
+    std::string path;
+#if defined(_WIN32)
+    void* fileHandle;    // HANDLE, kept opaque so windows.h stays out of every header
+    void* mappingHandle; // HANDLE
+#endif
+};
+
+// File view - a read-only window onto a file's bytes, wherever they live (loose file or pack entry)
+// Copies share the mapping (or the decode buffer), so the bytes stay valid as long as any copy is around
+struct FileView {
+    std::span<const std::byte> data;
+    std::shared_ptr<const MappedFile> mapping;
+    std::shared_ptr<const std::vector<std::byte>> decoded; // compressed pack entries decode into this instead
+
+    bool IsValid() const { return mapping != nullptr || decoded != nullptr; }
+    bool IsWholeFile() const { return mapping && data.data() == mapping->GetData().data() && data.size() == mapping->GetSize(); }
+    std::string_view GetText() const { return std::string_view(reinterpret_cast<const char*>(data.data()), data.size()); }
+};
+
 // The FileSystem class - our file system guru
 class FileSystem {
 public:
@@ -27,6 +103,10 @@ public:
     static std::vector<std::string> GetDirectories(const std::string& path);
     static std::vector<std::string> GetFiles(const std::string& path, const std::string& extension = "");
 
+    // File index - the shared in-memory listing of the asset tree. GetFiles and GetDirectories
+    // answer from it for anything under its root, without touching the disk.
+    static FileIndex& GetFileIndex();
+
     // File operations
     static bool FileExists(const std::string& path);
     static bool RemoveFile(const std::string& path);
@@ -44,6 +124,12 @@ public:
     static bool ReadBinaryFile(const std::string& path, std::vector<char>& data);
     static bool WriteBinaryFile(const std::string& path, const std::vector<char>& data);
 
+    // Memory mapping - for big meshes, animation banks and pack files, skip the copy entirely
+    static std::shared_ptr<MappedFile> MapFile(const std::string& path, MapMode mode = MapMode::ReadOnly);
+
+    // Async reads - the shared background reader for streaming, started by the Engine
+    static AsyncFileIO& GetAsyncIO();
+
     // Path utilities
     static std::string CombinePath(const std::string& path1, const std::string& path2);
     static std::string NormalizePath(const std::string& path);
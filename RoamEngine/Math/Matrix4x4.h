@@ -0,0 +1,125 @@
+// Matrix4x4.h - The four-by-four
+// Transforms points from one space to another - world, view, projection, and everything in between
+
+#ifndef MATRIX4X4_H
+#define MATRIX4X4_H
+
+#include <cmath>
+#include <iostream>
+#include "Math/Vector3.h"
+
+// The Matrix4x4 class - row-major storage, column vectors: a point p goes to M * p, translation sits
+// in the last column, and A * B applies B first. So a world-view-projection is projection * view * world.
+class Matrix4x4 {
+public:
+    // Elements - m[row][column]
+    float m[4][4];
+
+    // Constructors - identity by default, or every element row by row
+    Matrix4x4() : m{ { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f } } {}
+    Matrix4x4(float m00, float m01, float m02, float m03,
+              float m10, float m11, float m12, float m13,
+              float m20, float m21, float m22, float m23,
+              float m30, float m31, float m32, float m33)
+        : m{ { m00, m01, m02, m03 }, { m10, m11, m12, m13 }, { m20, m21, m22, m23 }, { m30, m31, m32, m33 } } {}
+
+    // Multiplication - this applied after other
+    Matrix4x4 operator*(const Matrix4x4& other) const {
+        Matrix4x4 result;
+        for (int row = 0; row < 4; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                result.m[row][column] = m[row][0] * other.m[0][column] + m[row][1] * other.m[1][column] +
+                                        m[row][2] * other.m[2][column] + m[row][3] * other.m[3][column];
+            }
+        }
+        return result;
+    }
+    Matrix4x4& operator*=(const Matrix4x4& other) { *this = *this * other; return *this; }
+
+    bool operator==(const Matrix4x4& other) const {
+        for (int row = 0; row < 4; ++row) {
+            for (int column = 0; column < 4; ++column) {
+                if (m[row][column] != other.m[row][column]) return false;
+            }
+        }
+        return true;
+    }
+    bool operator!=(const Matrix4x4& other) const { return !(*this == other); }
+
+    // Transforming - points get the translation, directions don't
+    Vector3 TransformPoint(const Vector3& point) const {
+        return Vector3(m[0][0] * point.x + m[0][1] * point.y + m[0][2] * point.z + m[0][3],
+                       m[1][0] * point.x + m[1][1] * point.y + m[1][2] * point.z + m[1][3],
+                       m[2][0] * point.x + m[2][1] * point.y + m[2][2] * point.z + m[2][3]);
+    }
+    Vector3 TransformDirection(const Vector3& direction) const {
+        return Vector3(m[0][0] * direction.x + m[0][1] * direction.y + m[0][2] * direction.z,
+                       m[1][0] * direction.x + m[1][1] * direction.y + m[1][2] * direction.z,
+                       m[2][0] * direction.x + m[2][1] * direction.y + m[2][2] * direction.z);
+    }
+
+    Vector3 GetTranslation() const { return Vector3(m[0][3], m[1][3], m[2][3]); }
+
+    Matrix4x4 Transposed() const {
+        return Matrix4x4(m[0][0], m[1][0], m[2][0], m[3][0],
+                         m[0][1], m[1][1], m[2][1], m[3][1],
+                         m[0][2], m[1][2], m[2][2], m[3][2],
+                         m[0][3], m[1][3], m[2][3], m[3][3]);
+    }
+
+    // Inverse of a rotation/scale/translation matrix - cheaper than a general inverse, and all a
+    // transform ever is. Zero scale gives back identity.
+    Matrix4x4 InvertedAffine() const {
+        float c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+        float c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+        float c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+        float determinant = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+        if (determinant == 0.0f) return Matrix4x4();
+        float inverse = 1.0f / determinant;
+
+        Matrix4x4 result;
+        result.m[0][0] = c00 * inverse;
+        result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inverse;
+        result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inverse;
+        result.m[1][0] = c01 * inverse;
+        result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inverse;
+        result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inverse;
+        result.m[2][0] = c02 * inverse;
+        result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inverse;
+        result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inverse;
+        for (int row = 0; row < 3; ++row) {
+            result.m[row][3] = -(result.m[row][0] * m[0][3] + result.m[row][1] * m[1][3] + result.m[row][2] * m[2][3]);
+        }
+        return result;
+    }
+
+    // Building blocks
+    static Matrix4x4 Translation(const Vector3& offset) {
+        return Matrix4x4(1.0f, 0.0f, 0.0f, offset.x,
+                         0.0f, 1.0f, 0.0f, offset.y,
+                         0.0f, 0.0f, 1.0f, offset.z,
+                         0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    static Matrix4x4 Scale(const Vector3& scale) {
+        return Matrix4x4(scale.x, 0.0f, 0.0f, 0.0f,
+                         0.0f, scale.y, 0.0f, 0.0f,
+                         0.0f, 0.0f, scale.z, 0.0f,
+                         0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    // Output operator - for debugging
+    friend std::ostream& operator<<(std::ostream& os, const Matrix4x4& matrix) {
+        for (int row = 0; row < 4; ++row) {
+            os << (row == 0 ? "[" : " ") << matrix.m[row][0] << ", " << matrix.m[row][1] << ", " << matrix.m[row][2] << ", " << matrix.m[row][3]
+               << (row == 3 ? "]" : "\n");
+        }
+        return os;
+    }
+
+    static const Matrix4x4 Identity;
+};
+
+// Static constants
+inline const Matrix4x4 Matrix4x4::Identity;
+
+#endif // MATRIX4X4_H
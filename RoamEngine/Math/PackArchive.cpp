@@ -0,0 +1,537 @@
+// PackArchive.cpp - Implementation of the suitcase
+// Packing is slow and careful so that opening is fast and trusting
+
+#include "PackArchive.h"
+#include "Core/ThreadManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+    bool EntryLess(const PackEntry& entry, uint64_t hash) {
+        return entry.pathHash < hash;
+    }
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // Block offsets sit right after an arbitrary-length entry, so no alignment guarantees
+    uint64_t LoadOffset(const std::byte* offsets, size_t index) {
+        uint64_t value;
+        std::memcpy(&value, offsets + index * sizeof(uint64_t), sizeof(value));
+        return value;
+    }
+
+    uint64_t BlockCountFor(uint64_t size, uint32_t blockSize) {
+        return (size + blockSize - 1) / blockSize;
+    }
+
+    // Enough blocks per job that the job overhead disappears next to the decode
+    constexpr size_t BytesPerDecodeJob = 256 * 1024;
+
+    void SetError(std::string* error, const std::string& message) {
+        if (error) *error = message;
+    }
+
+    // Pad the stream out to the next multiple of alignment
+    void WritePadding(std::ofstream& out, uint64_t& position, uint64_t alignment) {
+        static const char zeros[4096] = {};
+        uint64_t target = AlignUp(position, alignment);
+        while (position < target) {
+            uint64_t chunk = std::min<uint64_t>(target - position, sizeof(zeros));
+            out.write(zeros, static_cast<std::streamsize>(chunk));
+            position += chunk;
+        }
+    }
+}
+
+PackArchive::PackArchive()
+    : entries(nullptr), names(nullptr), entryCount(0),
+      statBlocks(0), statBytesDecoded(0), statBytesStored(0), statDecodeNanoseconds(0) {
+}
+
+PackArchive::~PackArchive() {
+    Close();
+}
+
+bool PackArchive::Open(const std::string& packPath) {
+    Close();
+
+    std::shared_ptr<MappedFile> file = FileSystem::MapFile(packPath);
+    if (!file) return false;
+
+    std::span<const std::byte> bytes = file->GetData();
+    if (bytes.size() < sizeof(PackHeader)) return false;
+
+    PackHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, PackMagic, sizeof(PackMagic)) != 0 ||
+        header.version < PackMinimumVersion || header.version > PackVersion) {
+        return false;
+    }
+
+    // Everything the header points at has to actually be inside the file
+    uint64_t fileSize = bytes.size();
+    uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(PackEntry);
+    if (header.tocOffset % alignof(PackEntry) != 0 ||
+        header.tocOffset > fileSize || tocSize > fileSize - header.tocOffset ||
+        header.namesOffset > fileSize || header.namesSize > fileSize - header.namesOffset) {
+        return false;
+    }
+
+    const auto* toc = reinterpret_cast<const PackEntry*>(bytes.data() + header.tocOffset);
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        const PackEntry& entry = toc[i];
+        if (entry.offset > fileSize) return false;
+        // zstd entries in a build without ROAM_HAS_ZSTD - refuse the pack now rather than fail its reads later
+        if (!Compression::IsSupported(GetCompression(entry))) return false;
+
+        if (GetCompression(entry) == CompressionMethod::None) {
+            if (entry.size > fileSize - entry.offset) return false;
+        } else {
+            // Block table, offsets and blocks all inside the file, offsets in order
+            if (sizeof(PackBlockTable) > fileSize - entry.offset) return false;
+            PackBlockTable table;
+            std::memcpy(&table, bytes.data() + entry.offset, sizeof(table));
+            if (table.blockSize == 0 || table.blockCount != BlockCountFor(entry.size, table.blockSize)) return false;
+
+            uint64_t offsetsStart = entry.offset + sizeof(PackBlockTable);
+            uint64_t offsetsSize = (static_cast<uint64_t>(table.blockCount) + 1) * sizeof(uint64_t);
+            if (offsetsSize > fileSize - offsetsStart) return false;
+
+            const std::byte* offsets = bytes.data() + offsetsStart;
+            uint64_t blocksStart = offsetsStart + offsetsSize;
+            if (LoadOffset(offsets, 0) != 0) return false;
+            for (uint32_t b = 0; b < table.blockCount; ++b) {
+                if (LoadOffset(offsets, b + 1) < LoadOffset(offsets, b)) return false;
+            }
+            if (LoadOffset(offsets, table.blockCount) > fileSize - blocksStart) return false;
+        }
+
+        if (entry.nameOffset > header.namesSize || entry.nameLength > header.namesSize - entry.nameOffset) return false;
+        if (i > 0 && toc[i - 1].pathHash > entry.pathHash) return false; // unsorted - lookups would lie
+    }
+
+    // Lookups jump around the TOC - let the kernel know not to bother reading ahead
+    file->Advise(MapAccessHint::Random);
+
+    mapping = std::move(file);
+    entries = toc;
+    names = reinterpret_cast<const char*>(bytes.data() + header.namesOffset);
+    entryCount = header.entryCount;
+    path = packPath;
+    return true;
+}
+
+void PackArchive::Close() {
+    mapping.reset();
+    entries = nullptr;
+    names = nullptr;
+    entryCount = 0;
+    path.clear();
+}
+
+const PackEntry* PackArchive::Find(std::string_view lookupPath) const {
+    if (!mapping || entryCount == 0) return nullptr;
+
+    std::string normalized = NormalizePath(lookupPath);
+    uint64_t hash = HashPath(normalized);
+
+    const PackEntry* end = entries + entryCount;
+    for (const PackEntry* it = std::lower_bound(entries, end, hash, EntryLess);
+         it != end && it->pathHash == hash; ++it) {
+        if (GetEntryPath(*it) == normalized) return it;
+    }
+    return nullptr;
+}
+
+std::span<const std::byte> PackArchive::GetData(const PackEntry& entry) const {
+    if (!mapping || GetCompression(entry) != CompressionMethod::None) return std::span<const std::byte>();
+    return mapping->GetData().subspan(static_cast<size_t>(entry.offset), static_cast<size_t>(entry.size));
+}
+
+uint64_t PackArchive::GetStoredSize(const PackEntry& entry) const {
+    PackBlockTable table;
+    const std::byte* offsets = nullptr;
+    const std::byte* blocks = nullptr;
+    if (GetCompression(entry) == CompressionMethod::None || !GetBlockTable(entry, table, offsets, blocks)) {
+        return entry.size;
+    }
+    return static_cast<uint64_t>(blocks - (mapping->GetData().data() + entry.offset)) + LoadOffset(offsets, table.blockCount);
+}
+
+bool PackArchive::Read(const PackEntry& entry, uint64_t offset, std::span<std::byte> output, ThreadManager* jobSystem) const {
+    if (!mapping || offset > entry.size || output.size() > entry.size - offset) return false;
+    if (output.empty()) return true;
+
+    CompressionMethod method = GetCompression(entry);
+    if (method == CompressionMethod::None) {
+        std::memcpy(output.data(), GetData(entry).data() + offset, output.size());
+        return true;
+    }
+
+    PackBlockTable table;
+    const std::byte* offsets = nullptr;
+    const std::byte* blocks = nullptr;
+    if (!Compression::IsSupported(method) || !GetBlockTable(entry, table, offsets, blocks)) return false;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Only the blocks the range touches
+    uint64_t rangeEnd = offset + output.size();
+    size_t firstBlock = static_cast<size_t>(offset / table.blockSize);
+    size_t lastBlock = static_cast<size_t>((rangeEnd - 1) / table.blockSize);
+    size_t blockCount = lastBlock - firstBlock + 1;
+
+    std::atomic<bool> ok(true);
+    std::atomic<uint64_t> storedBytes(0);
+    auto decodeBlocks = [&](size_t begin, size_t end) {
+        thread_local std::vector<std::byte> scratch;
+        for (size_t b = firstBlock + begin; b < firstBlock + end && ok.load(std::memory_order_relaxed); ++b) {
+            uint64_t rawStart = static_cast<uint64_t>(b) * table.blockSize;
+            uint64_t rawSize = std::min<uint64_t>(table.blockSize, entry.size - rawStart);
+            uint64_t storedStart = LoadOffset(offsets, b);
+            uint64_t storedSize = LoadOffset(offsets, b + 1) - storedStart;
+            std::span<const std::byte> stored(blocks + storedStart, static_cast<size_t>(storedSize));
+
+            // Whole block wanted? Decode straight into the caller's buffer, otherwise via scratch
+            uint64_t sliceStart = std::max(rawStart, offset);
+            uint64_t sliceEnd = std::min(rawStart + rawSize, rangeEnd);
+            bool wholeBlock = sliceStart == rawStart && sliceEnd == rawStart + rawSize;
+            std::span<std::byte> target;
+            if (wholeBlock) {
+                target = output.subspan(static_cast<size_t>(rawStart - offset), static_cast<size_t>(rawSize));
+            } else {
+                scratch.resize(static_cast<size_t>(rawSize));
+                target = std::span<std::byte>(scratch.data(), scratch.size());
+            }
+
+            // Stored size == raw size means the block didn't compress and went in as-is
+            bool decoded = storedSize == rawSize ? Compression::Decompress(CompressionMethod::None, stored, target)
+                                                 : Compression::Decompress(method, stored, target);
+            if (!decoded) {
+                ok = false;
+                return;
+            }
+            if (!wholeBlock) {
+                std::memcpy(output.data() + (sliceStart - offset), scratch.data() + (sliceStart - rawStart),
+                            static_cast<size_t>(sliceEnd - sliceStart));
+            }
+            storedBytes.fetch_add(storedSize, std::memory_order_relaxed);
+        }
+    };
+
+    if (jobSystem && blockCount > 1) {
+        size_t grain = std::max<size_t>(1, BytesPerDecodeJob / table.blockSize);
+        jobSystem->ParallelFor(blockCount, grain, decodeBlocks, JobPriority::High);
+    } else {
+        decodeBlocks(0, blockCount);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    statBlocks += blockCount;
+    statBytesDecoded += output.size();
+    statBytesStored += storedBytes.load();
+    statDecodeNanoseconds += static_cast<uint64_t>(elapsed.count());
+    return ok.load();
+}
+
+bool PackArchive::ReadAll(const PackEntry& entry, std::vector<std::byte>& output, ThreadManager* jobSystem) const {
+    output.resize(static_cast<size_t>(entry.size));
+    return Read(entry, 0, output, jobSystem);
+}
+
+PackArchive::DecodeStats PackArchive::GetDecodeStats() const {
+    DecodeStats stats;
+    stats.blocksDecoded = statBlocks.load();
+    stats.bytesDecoded = statBytesDecoded.load();
+    stats.bytesStored = statBytesStored.load();
+    stats.decodeSeconds = static_cast<double>(statDecodeNanoseconds.load()) * 1e-9;
+    return stats;
+}
+
+void PackArchive::ResetDecodeStats() {
+    statBlocks = 0;
+    statBytesDecoded = 0;
+    statBytesStored = 0;
+    statDecodeNanoseconds = 0;
+}
+
+bool PackArchive::GetBlockTable(const PackEntry& entry, PackBlockTable& table, const std::byte*& offsets,
+                                const std::byte*& blocks) const {
+    if (!mapping) return false;
+    const std::byte* base = mapping->GetData().data() + entry.offset;
+    std::memcpy(&table, base, sizeof(table));
+    offsets = base + sizeof(PackBlockTable);
+    blocks = offsets + (static_cast<size_t>(table.blockCount) + 1) * sizeof(uint64_t);
+    return true;
+}
+
+std::string_view PackArchive::GetEntryPath(const PackEntry& entry) const {
+    return std::string_view(names + entry.nameOffset, entry.nameLength);
+}
+
+std::string PackArchive::NormalizePath(std::string_view input) {
+    std::vector<std::string_view> segments;
+    bool absolute = !input.empty() && (input[0] == '/' || input[0] == '\\');
+
+    size_t start = 0;
+    while (start <= input.size()) {
+        size_t end = input.find_first_of("/\\", start);
+        if (end == std::string_view::npos) end = input.size();
+        std::string_view segment = input.substr(start, end - start);
+
+        if (segment == "..") {
+            if (!segments.empty() && segments.back() != "..") {
+                segments.pop_back();
+            } else if (!absolute) {
+                segments.push_back(segment); // above the root of a relative path - keep it, it won't match anything
+            }
+        } else if (!segment.empty() && segment != ".") {
+            segments.push_back(segment);
+        }
+        start = end + 1;
+    }
+
+    std::string result = absolute ? "/" : "";
+    for (size_t i = 0; i < segments.size(); ++i) {
+        if (i > 0) result += '/';
+        result.append(segments[i]);
+    }
+    return result;
+}
+
+uint64_t PackArchive::HashPath(std::string_view normalizedPath) {
+    // FNV-1a - simple, fast on short strings, and stable across compilers (unlike std::hash)
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : normalizedPath) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+PackWriter::PackWriter(uint32_t packAlignment, CompressionMethod method, uint32_t packBlockSize)
+    : alignment(std::max<uint32_t>(1, packAlignment)), compression(method),
+      blockSize(std::max<uint32_t>(4096, packBlockSize)), compressionLevel(0), minimumSavings(0.05),
+      jobSystem(nullptr) {
+}
+
+bool PackWriter::AddFile(const std::string& packPath, const std::string& sourcePath) {
+    std::string normalized = PackArchive::NormalizePath(packPath);
+    std::error_code error;
+    if (normalized.empty() || !std::filesystem::is_regular_file(sourcePath, error)) return false;
+
+    pending[normalized] = PendingEntry{ sourcePath, {}, true };
+    return true;
+}
+
+bool PackWriter::AddData(const std::string& packPath, std::vector<std::byte> data) {
+    std::string normalized = PackArchive::NormalizePath(packPath);
+    if (normalized.empty()) return false;
+
+    pending[normalized] = PendingEntry{ std::string(), std::move(data), false };
+    return true;
+}
+
+bool PackWriter::Write(const std::string& outputPath, std::string* error) const {
+    if (pending.size() > UINT32_MAX) {
+        SetError(error, "too many entries for one pack");
+        return false;
+    }
+
+    std::string tempPath = outputPath + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        SetError(error, "cannot create " + tempPath);
+        return false;
+    }
+
+    // Header goes in last, once we know where everything ended up
+    PackHeader header = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t position = sizeof(header);
+
+    std::vector<PackEntry> toc;
+    std::string namesBlock;
+    toc.reserve(pending.size());
+
+    std::vector<char> buffer(1 << 20);
+    std::vector<std::byte> contents;
+    std::vector<std::byte> stored;
+    for (const auto& [packPath, source] : pending) {
+        WritePadding(out, position, alignment);
+
+        PackEntry entry = {};
+        entry.pathHash = PackArchive::HashPath(packPath);
+        entry.offset = position;
+        entry.nameOffset = static_cast<uint32_t>(namesBlock.size());
+        entry.nameLength = static_cast<uint32_t>(packPath.size());
+        namesBlock += packPath;
+
+        if (compression != CompressionMethod::None) {
+            // Compressed packs need the whole entry in hand to build its block table
+            const std::vector<std::byte>* data = &source.data;
+            if (source.fromFile) {
+                std::ifstream in(source.sourcePath, std::ios::binary | std::ios::ate);
+                if (!in) {
+                    SetError(error, "cannot read " + source.sourcePath);
+                    out.close();
+                    std::filesystem::remove(tempPath);
+                    return false;
+                }
+                std::streamoff length = in.tellg();
+                contents.resize(length > 0 ? static_cast<size_t>(length) : 0);
+                in.seekg(0);
+                in.read(reinterpret_cast<char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+                if (length < 0 || !in || in.gcount() != static_cast<std::streamsize>(contents.size())) {
+                    SetError(error, "short read from " + source.sourcePath);
+                    out.close();
+                    std::filesystem::remove(tempPath);
+                    return false;
+                }
+                data = &contents;
+            }
+
+            entry.size = data->size();
+            if (CompressEntry(*data, stored)) {
+                entry.flags = static_cast<uint32_t>(compression);
+                out.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+                position += stored.size();
+            } else {
+                out.write(reinterpret_cast<const char*>(data->data()), static_cast<std::streamsize>(data->size()));
+                position += data->size();
+            }
+            toc.push_back(entry);
+            continue;
+        }
+
+        if (source.fromFile) {
+            std::ifstream in(source.sourcePath, std::ios::binary);
+            if (!in) {
+                SetError(error, "cannot read " + source.sourcePath);
+                out.close();
+                std::filesystem::remove(tempPath);
+                return false;
+            }
+            while (in) {
+                in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+                std::streamsize got = in.gcount();
+                if (got <= 0) break;
+                out.write(buffer.data(), got);
+                entry.size += static_cast<uint64_t>(got);
+            }
+            if (in.bad()) {
+                SetError(error, "short read from " + source.sourcePath);
+                out.close();
+                std::filesystem::remove(tempPath);
+                return false;
+            }
+        } else {
+            out.write(reinterpret_cast<const char*>(source.data.data()), static_cast<std::streamsize>(source.data.size()));
+            entry.size = source.data.size();
+        }
+
+        position += entry.size;
+        toc.push_back(entry);
+    }
+
+    if (namesBlock.size() > UINT32_MAX) {
+        SetError(error, "path table too large for one pack");
+        out.close();
+        std::filesystem::remove(tempPath);
+        return false;
+    }
+
+    // Sorted by hash so the reader can binary search - ties by path keep the output deterministic
+    std::sort(toc.begin(), toc.end(), [&namesBlock](const PackEntry& a, const PackEntry& b) {
+        if (a.pathHash != b.pathHash) return a.pathHash < b.pathHash;
+        return namesBlock.compare(a.nameOffset, a.nameLength, namesBlock, b.nameOffset, b.nameLength) < 0;
+    });
+
+    WritePadding(out, position, alignof(PackEntry));
+    header.tocOffset = position;
+    out.write(reinterpret_cast<const char*>(toc.data()), static_cast<std::streamsize>(toc.size() * sizeof(PackEntry)));
+    position += toc.size() * sizeof(PackEntry);
+
+    header.namesOffset = position;
+    header.namesSize = namesBlock.size();
+    out.write(namesBlock.data(), static_cast<std::streamsize>(namesBlock.size()));
+
+    std::memcpy(header.magic, PackMagic, sizeof(PackMagic));
+    header.version = PackVersion;
+    header.entryCount = static_cast<uint32_t>(toc.size());
+    header.alignment = alignment;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+
+    if (!out) {
+        SetError(error, "write failed for " + tempPath);
+        std::filesystem::remove(tempPath);
+        return false;
+    }
+
+    std::error_code renameError;
+    std::filesystem::rename(tempPath, outputPath, renameError);
+    if (renameError) {
+        SetError(error, "cannot move " + tempPath + " into place: " + renameError.message());
+        std::filesystem::remove(tempPath);
+        return false;
+    }
+    return true;
+}
+
+bool PackWriter::CompressEntry(std::span<const std::byte> data, std::vector<std::byte>& stored) const {
+    if (compression == CompressionMethod::None || data.empty() || !Compression::IsSupported(compression)) return false;
+
+    size_t blockCount = static_cast<size_t>(BlockCountFor(data.size(), blockSize));
+    if (blockCount > UINT32_MAX) return false;
+    std::vector<std::vector<std::byte>> compressedBlocks(blockCount);
+
+    auto compressBlocks = [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            std::span<const std::byte> raw = data.subspan(b * blockSize, std::min<size_t>(blockSize, data.size() - b * blockSize));
+            std::vector<std::byte>& block = compressedBlocks[b];
+            block.resize(Compression::GetMaxCompressedSize(compression, raw.size()));
+            size_t size = Compression::Compress(compression, raw, block, compressionLevel);
+
+            // Didn't shrink - store it raw, the reader spots that by the size alone
+            if (size == 0 || size >= raw.size()) {
+                block.assign(raw.begin(), raw.end());
+            } else {
+                block.resize(size);
+            }
+        }
+    };
+
+    if (jobSystem && blockCount > 1) {
+        jobSystem->ParallelFor(blockCount, 1, compressBlocks);
+    } else {
+        compressBlocks(0, blockCount);
+    }
+
+    // Block table + offsets + blocks, and only if the whole thing is actually worth decoding
+    uint64_t tableSize = sizeof(PackBlockTable) + (blockCount + 1) * sizeof(uint64_t);
+    uint64_t total = tableSize;
+    for (const auto& block : compressedBlocks) total += block.size();
+    if (static_cast<double>(total) > static_cast<double>(data.size()) * (1.0 - minimumSavings)) return false;
+
+    stored.resize(static_cast<size_t>(total));
+    PackBlockTable table = { blockSize, static_cast<uint32_t>(blockCount) };
+    std::memcpy(stored.data(), &table, sizeof(table));
+
+    std::byte* offsets = stored.data() + sizeof(PackBlockTable);
+    std::byte* blocks = stored.data() + tableSize;
+    uint64_t blockOffset = 0;
+    for (size_t b = 0; b <= blockCount; ++b) {
+        std::memcpy(offsets + b * sizeof(uint64_t), &blockOffset, sizeof(blockOffset));
+        if (b == blockCount) break;
+        std::memcpy(blocks + blockOffset, compressedBlocks[b].data(), compressedBlocks[b].size());
+        blockOffset += compressedBlocks[b].size();
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+// PackArchive.h - The suitcase
+// Thousands of little files packed into one big one, with a table of contents up front
+
+#ifndef PACKARCHIVE_H
+#define PACKARCHIVE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Math/FileSystem.h"
+#include "Math/Compression.h"
+
+class ThreadManager;
+
+// On-disk layout (little-endian, everything read straight out of the mapping):
+//   PackHeader
+//   file data, each entry aligned to header.alignment
+//   PackEntry[entryCount], sorted by (pathHash, path)
+//   path strings, not null-terminated
+// A compressed entry's data starts with a PackBlockTable, then blockCount + 1 offsets (relative to the
+// end of that offset array) bracketing each compressed block. A block whose stored size equals its raw
+// size didn't compress and is stored as-is.
+constexpr char PackMagic[8] = { 'R', 'O', 'A', 'M', 'P', 'A', 'K', '\0' };
+constexpr uint32_t PackVersion = 2;        // 2 added compressed entries
+constexpr uint32_t PackMinimumVersion = 1;
+
+struct PackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t entryCount;
+    uint64_t tocOffset;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+    uint32_t alignment;
+    uint32_t flags;
+    uint64_t reserved[2];
+};
+static_assert(sizeof(PackHeader) == 64, "PackHeader is an on-disk format");
+
+struct PackEntry {
+    uint64_t pathHash;    // HashPath() of the normalized path
+    uint64_t offset;      // from the start of the pack
+    uint64_t size;
+    uint32_t nameOffset;  // into the names block
+    uint32_t nameLength;
+    uint32_t flags;       // low 8 bits: CompressionMethod
+    uint32_t reserved;
+};
+static_assert(sizeof(PackEntry) == 40, "PackEntry is an on-disk format");
+
+struct PackBlockTable {
+    uint32_t blockSize;   // uncompressed bytes per block, the last one may be shorter
+    uint32_t blockCount;
+};
+static_assert(sizeof(PackBlockTable) == 8, "PackBlockTable is an on-disk format");
+
+// Read side - open a pack and look things up without copying anything
+class PackArchive {
+public:
+    PackArchive();
+    ~PackArchive();
+
+    PackArchive(const PackArchive&) = delete;
+    PackArchive& operator=(const PackArchive&) = delete;
+
+    // Open/close - Open validates the header and every entry once (including that this build can
+    // decode its compression), lookups trust it afterwards
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return mapping != nullptr; }
+    const std::string& GetPath() const { return path; }
+
+    // Lookup - binary search on the hash, path compare only to rule out collisions
+    const PackEntry* Find(std::string_view path) const;
+    bool Contains(std::string_view path) const { return Find(path) != nullptr; }
+
+    // Entry access - spans point into the mapping and live as long as it does.
+    // GetData is empty for compressed entries, go through Read for those.
+    std::span<const std::byte> GetData(const PackEntry& entry) const;
+    static CompressionMethod GetCompression(const PackEntry& entry) { return static_cast<CompressionMethod>(entry.flags & 0xFF); }
+    uint64_t GetStoredSize(const PackEntry& entry) const;
+
+    // Read uncompressed bytes [offset, offset + output.size()) of an entry - only the blocks that range
+    // touches get decoded, spread across the job system when one is given
+    bool Read(const PackEntry& entry, uint64_t offset, std::span<std::byte> output, ThreadManager* jobSystem = nullptr) const;
+    bool ReadAll(const PackEntry& entry, std::vector<std::byte>& output, ThreadManager* jobSystem = nullptr) const;
+
+    // Decode stats - totals since Open, for the streaming overlay and PackTool stats
+    struct DecodeStats {
+        uint64_t blocksDecoded = 0;
+        uint64_t bytesDecoded = 0;
+        uint64_t bytesStored = 0;     // compressed bytes that went in
+        double decodeSeconds = 0.0;   // wall time spent in Read, all threads together count once
+    };
+    DecodeStats GetDecodeStats() const;
+    void ResetDecodeStats();
+    std::string_view GetEntryPath(const PackEntry& entry) const;
+    size_t GetEntryCount() const { return entryCount; }
+    const PackEntry& GetEntry(size_t index) const { return entries[index]; }
+    std::shared_ptr<const MappedFile> GetMapping() const { return mapping; }
+
+    // Path helpers - packs store forward slashes, no "." or ".." segments, no leading "./"
+    static std::string NormalizePath(std::string_view path);
+    static uint64_t HashPath(std::string_view normalizedPath);
+
+private:
+    // Block table of a compressed entry - offsets are validated at Open
+    // (offsets may be unaligned in the file, so they're handed back as bytes)
+    bool GetBlockTable(const PackEntry& entry, PackBlockTable& table, const std::byte*& offsets, const std::byte*& blocks) const;
+
+    std::shared_ptr<MappedFile> mapping;
+    const PackEntry* entries;
+    const char* names;
+    size_t entryCount;
+    std::string path;
+
+    mutable std::atomic<uint64_t> statBlocks;
+    mutable std::atomic<uint64_t> statBytesDecoded;
+    mutable std::atomic<uint64_t> statBytesStored;
+    mutable std::atomic<uint64_t> statDecodeNanoseconds;
+};
+
+// Write side - collect files, then write the whole pack in one go
+class PackWriter {
+public:
+    explicit PackWriter(uint32_t alignment = 16, CompressionMethod compression = CompressionMethod::None,
+                        uint32_t blockSize = 64 * 1024);
+
+    // Compression settings - entries that don't shrink by at least minimumSavings are stored raw
+    void SetCompressionLevel(int level) { compressionLevel = level; }
+    void SetMinimumSavings(double fraction) { minimumSavings = fraction; }
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; } // blocks compress in parallel when set
+
+    // Add entries - a second add with the same path replaces the first
+    bool AddFile(const std::string& packPath, const std::string& sourcePath);
+    bool AddData(const std::string& packPath, std::vector<std::byte> data);
+    size_t GetEntryCount() const { return pending.size(); }
+
+    // Write the pack - goes to a temp file first and is renamed into place, so readers never see half a pack
+    bool Write(const std::string& outputPath, std::string* error = nullptr) const;
+
+private:
+    // Files are read at Write() time so packing a big tree doesn't hold it all in memory
+    struct PendingEntry {
+        std::string sourcePath;
+        std::vector<std::byte> data;
+        bool fromFile;
+    };
+
+    // Compress one entry into its block table + blocks - false if it isn't worth it
+    bool CompressEntry(std::span<const std::byte> data, std::vector<std::byte>& stored) const;
+
+    std::map<std::string, PendingEntry> pending; // normalized path -> source
+    uint32_t alignment;
+    CompressionMethod compression;
+    uint32_t blockSize;
+    int compressionLevel;
+    double minimumSavings;
+    ThreadManager* jobSystem;
+};
+
+#endif // PACKARCHIVE_H
@@ -0,0 +1,208 @@
+// Profiler.cpp - Implementation of the performance detective
+// Every microsecond we spend in here is a microsecond we can't blame on the renderer
+
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+    // Per-thread bookkeeping - each thread keeps its own nesting so they don't trip over each other
+    thread_local uint32_t threadDepth = 0;
+    thread_local uint32_t threadSkippedDepth = 0;
+
+    // Capture file header - bump the version if the columns change
+    const char* const CAPTURE_HEADER = "# RoamEngine profile capture v1";
+
+    int64_t ToMicroseconds(std::chrono::high_resolution_clock::time_point time) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    std::chrono::high_resolution_clock::time_point FromMicroseconds(int64_t micros) {
+        return std::chrono::high_resolution_clock::time_point(
+            std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::microseconds(micros)));
+    }
+}
+
+Profiler& Profiler::GetInstance() {
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler() : isEnabled(true), maxDepth(64), currentDepth(0) {
+}
+
+Profiler::~Profiler() {
+}
+
+uint32_t Profiler::GetCurrentThreadId() {
+    // Small sequential ids read better in reports than hashed std::thread::id soup
+    static std::atomic<uint32_t> nextThreadId{1};
+    thread_local uint32_t threadId = nextThreadId.fetch_add(1, std::memory_order_relaxed);
+    return threadId;
+}
+
+void Profiler::BeginSample(const std::string& name) {
+    if (!isEnabled) return;
+
+    // Too deep - remember we skipped so EndSample stays balanced
+    if (threadDepth >= maxDepth || threadSkippedDepth > 0) {
+        ++threadSkippedDepth;
+        return;
+    }
+
+    ProfileSample sample;
+    sample.name = name;
+    sample.threadId = GetCurrentThreadId();
+    sample.depth = threadDepth++;
+    sample.duration = std::chrono::microseconds(0);
+
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    sample.startTime = std::chrono::high_resolution_clock::now();
+    currentSamples.push_back(std::move(sample));
+    ++currentDepth;
+}
+
+void Profiler::EndSample() {
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    if (threadSkippedDepth > 0) {
+        --threadSkippedDepth;
+        return;
+    }
+    if (threadDepth == 0) return;
+    --threadDepth;
+
+    uint32_t threadId = GetCurrentThreadId();
+    std::lock_guard<std::mutex> lock(profilerMutex);
+
+    // Find this thread's innermost open sample - other threads may have pushed after us
+    for (auto it = currentSamples.rbegin(); it != currentSamples.rend(); ++it) {
+        if (it->threadId == threadId) {
+            ProfileSample sample = std::move(*it);
+            currentSamples.erase(std::next(it).base());
+            sample.endTime = endTime;
+            sample.duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - sample.startTime);
+            completedSamples.push_back(std::move(sample));
+            --currentDepth;
+            return;
+        }
+    }
+}
+
+std::vector<ProfileResult> Profiler::GetResults() {
+    std::lock_guard<std::mutex> lock(profilerMutex);
+
+    std::unordered_map<std::string, ProfileResult> aggregated;
+    std::vector<std::string> order;
+
+    for (const ProfileSample& sample : completedSamples) {
+        auto it = aggregated.find(sample.name);
+        if (it == aggregated.end()) {
+            ProfileResult result;
+            result.name = sample.name;
+            result.callCount = 0;
+            result.totalTime = std::chrono::microseconds(0);
+            result.minTime = sample.duration;
+            result.maxTime = sample.duration;
+            result.depth = sample.depth;
+            it = aggregated.emplace(sample.name, result).first;
+            order.push_back(sample.name);
+        }
+
+        ProfileResult& result = it->second;
+        ++result.callCount;
+        result.totalTime += sample.duration;
+        result.minTime = std::min(result.minTime, sample.duration);
+        result.maxTime = std::max(result.maxTime, sample.duration);
+        result.depth = std::min(result.depth, sample.depth);
+    }
+
+    std::vector<ProfileResult> results;
+    results.reserve(order.size());
+    for (const std::string& name : order) {
+        ProfileResult& result = aggregated[name];
+        result.averageTime = std::chrono::microseconds(result.totalTime.count() / static_cast<int64_t>(result.callCount));
+        results.push_back(result);
+    }
+    return results;
+}
+
+std::vector<ProfileSample> Profiler::GetCompletedSamples() {
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    return completedSamples;
+}
+
+void Profiler::Clear() {
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    currentSamples.clear();
+    completedSamples.clear();
+    currentDepth = 0;
+}
+
+bool Profiler::SaveToFile(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    std::lock_guard<std::mutex> lock(profilerMutex);
+
+    // One sample per line, tab separated - easy to diff, easy to grep, easy to load
+    file << CAPTURE_HEADER << "\n";
+    file << "# name\tthread\tdepth\tstart_us\tduration_us\n";
+    for (const ProfileSample& sample : completedSamples) {
+        std::string name = sample.name;
+        std::replace(name.begin(), name.end(), '\t', ' ');
+        std::replace(name.begin(), name.end(), '\n', ' ');
+        file << name << '\t' << sample.threadId << '\t' << sample.depth << '\t'
+             << ToMicroseconds(sample.startTime) << '\t' << sample.duration.count() << '\n';
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool Profiler::LoadFromFile(const std::string& filename) {
+    std::vector<ProfileSample> samples;
+    if (!ReadCapture(filename, samples)) return false;
+
+    std::lock_guard<std::mutex> lock(profilerMutex);
+    completedSamples = std::move(samples);
+    return true;
+}
+
+bool Profiler::ReadCapture(const std::string& filename, std::vector<ProfileSample>& samples) {
+    std::ifstream file(filename);
+    if (!file) return false;
+
+    std::string line;
+    if (!std::getline(file, line) || line.compare(0, std::char_traits<char>::length(CAPTURE_HEADER), CAPTURE_HEADER) != 0) {
+        return false; // Not ours - refuse rather than guess
+    }
+
+    samples.clear();
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t nameEnd = line.find('\t');
+        if (nameEnd == std::string::npos) return false;
+
+        ProfileSample sample;
+        sample.name = line.substr(0, nameEnd);
+
+        std::istringstream fields(line.substr(nameEnd + 1));
+        int64_t startMicros = 0;
+        int64_t durationMicros = 0;
+        if (!(fields >> sample.threadId >> sample.depth >> startMicros >> durationMicros)) {
+            return false;
+        }
+
+        sample.startTime = FromMicroseconds(startMicros);
+        sample.duration = std::chrono::microseconds(durationMicros);
+        sample.endTime = sample.startTime + sample.duration;
+        samples.push_back(std::move(sample));
+    }
+
+    return true;
+}
@@ -62,6 +62,15 @@ public:
     // Load results from file - review past performance
     bool LoadFromFile(const std::string& filename);
 
+    // Read a saved capture without touching the live profiler - for offline tools
+    static bool ReadCapture(const std::string& filename, std::vector<ProfileSample>& samples);
+
+    // Completed samples - the raw timeline, for anyone who wants more than averages
+    std::vector<ProfileSample> GetCompletedSamples();
+
+    // Stable id for the calling thread - matches ProfileSample::threadId
+    static uint32_t GetCurrentThreadId();
+
 private:
     Profiler();
     ~Profiler();
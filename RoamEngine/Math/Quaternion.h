@@ -28,19 +28,9 @@ public:
         Normalize();
     }
 
-    // Copy constructor
-    Quaternion(const Quaternion& other) : x(other.x), y(other.y), z(other.z), w(other.w) {}
-
-    // Assignment operator
-    Quaternion& operator=(const Quaternion& other) {
-        if (this != &other) {
-            x = other.x;
-            y = other.y;
-            z = other.z;
-            w = other.w;
-        }
-        return *this;
-    }
+    // Copy and assignment - left to the compiler, so a Quaternion stays trivially copyable
+    Quaternion(const Quaternion& other) = default;
+    Quaternion& operator=(const Quaternion& other) = default;
 
     // Arithmetic operators
     Quaternion operator*(const Quaternion& other) const {
@@ -206,6 +196,6 @@ public:
 };
 
 // Static constants
-const Quaternion Quaternion::Identity(0.0f, 0.0f, 0.0f, 1.0f);
+inline const Quaternion Quaternion::Identity(0.0f, 0.0f, 0.0f, 1.0f);
 
 #endif // QUATERNION_H
@@ -0,0 +1,567 @@
+// SamplingProfiler.cpp - Implementation of the eavesdropper
+// Half of this runs inside a signal handler, so no malloc, no locks, no printf, no fun
+
+#include "SamplingProfiler.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+
+#if defined(__linux__)
+#define ROAM_SAMPLING_SUPPORTED 1
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <pthread.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#if defined(ROAM_HAS_LIBUNWIND)
+#define UNW_LOCAL_ONLY
+#include <libunwind.h>
+#endif
+// Older glibc only spells this the long way
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#else
+#define ROAM_SAMPLING_SUPPORTED 0
+#endif
+
+// Per-thread buffer - single producer (the signal handler on that thread), single consumer (Drain)
+struct SamplingProfiler::ThreadBuffer {
+    std::vector<StackSample> ring;
+    std::atomic<uint64_t> writeIndex;
+    std::atomic<uint64_t> readIndex;
+    std::atomic<uint64_t> dropped;
+    uint32_t threadId;
+    uintptr_t stackLow;
+    uintptr_t stackHigh;
+    bool active;
+#if ROAM_SAMPLING_SUPPORTED
+    pthread_t thread;
+    pid_t kernelThreadId;
+    timer_t timer;
+    bool timerArmed;
+#endif
+
+    explicit ThreadBuffer(size_t capacity) : ring(capacity), writeIndex(0), readIndex(0), dropped(0),
+                                             threadId(0), stackLow(0), stackHigh(0), active(true) {
+#if ROAM_SAMPLING_SUPPORTED
+        timerArmed = false;
+#endif
+    }
+};
+
+namespace {
+#if ROAM_SAMPLING_SUPPORTED
+    // initial-exec so touching it from the signal handler never allocates
+    thread_local SamplingProfiler::ThreadBuffer* currentThreadBuffer __attribute__((tls_model("initial-exec"))) = nullptr;
+
+    // Stamp samples with the clock the instrumented Profiler uses, so the timelines line up
+    const clockid_t TIMESTAMP_CLOCK =
+        std::is_same<std::chrono::high_resolution_clock, std::chrono::system_clock>::value ? CLOCK_REALTIME : CLOCK_MONOTONIC;
+
+    uint64_t NowMicros() {
+        timespec now;
+        clock_gettime(TIMESTAMP_CLOCK, &now); // async-signal-safe, unlike chrono
+        return static_cast<uint64_t>(now.tv_sec) * 1000000u + static_cast<uint64_t>(now.tv_nsec) / 1000u;
+    }
+
+    uint32_t WalkStack(void* context, const SamplingProfiler::ThreadBuffer& buffer, uintptr_t* frames) {
+#if defined(ROAM_HAS_LIBUNWIND)
+        (void)buffer;
+        unw_cursor_t cursor;
+        if (unw_init_local2(&cursor, static_cast<unw_context_t*>(context), UNW_INIT_SIGNAL_FRAME) != 0) return 0;
+        uint32_t count = 0;
+        do {
+            unw_word_t ip = 0;
+            unw_get_reg(&cursor, UNW_REG_IP, &ip);
+            frames[count++] = static_cast<uintptr_t>(ip);
+        } while (count < StackSample::MAX_FRAMES && unw_step(&cursor) > 0);
+        return count;
+#else
+        const ucontext_t* uc = static_cast<const ucontext_t*>(context);
+#if defined(__x86_64__)
+        uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+        uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.gregs[REG_RBP]);
+#elif defined(__aarch64__)
+        uintptr_t pc = static_cast<uintptr_t>(uc->uc_mcontext.pc);
+        uintptr_t fp = static_cast<uintptr_t>(uc->uc_mcontext.regs[29]);
+#else
+        (void)uc;
+        (void)buffer;
+        (void)frames;
+        return 0;
+#endif
+#if defined(__x86_64__) || defined(__aarch64__)
+        uint32_t count = 0;
+        frames[count++] = pc;
+
+        // Frame-pointer chain: [fp] = caller's fp, [fp + 8] = return address.
+        // Only follow pointers that stay inside this thread's stack and keep climbing.
+        while (count < StackSample::MAX_FRAMES &&
+               fp >= buffer.stackLow && fp + 2 * sizeof(uintptr_t) <= buffer.stackHigh &&
+               (fp % sizeof(uintptr_t)) == 0) {
+            const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+            uintptr_t nextFp = frame[0];
+            uintptr_t returnAddress = frame[1];
+            if (returnAddress == 0) break;
+            frames[count++] = returnAddress;
+            if (nextFp <= fp) break;
+            fp = nextFp;
+        }
+        return count;
+#endif
+#endif
+    }
+
+    void SignalHandler(int, siginfo_t*, void* context) {
+        int savedErrno = errno;
+        SamplingProfiler::ThreadBuffer* buffer = currentThreadBuffer;
+        if (buffer && SamplingProfiler::GetInstance().IsRunning()) {
+            uint64_t write = buffer->writeIndex.load(std::memory_order_relaxed);
+            if (write - buffer->readIndex.load(std::memory_order_acquire) >= buffer->ring.size()) {
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                StackSample& sample = buffer->ring[write % buffer->ring.size()];
+                sample.timestampMicros = NowMicros();
+                sample.threadId = buffer->threadId;
+                sample.frameCount = WalkStack(context, *buffer, sample.frames);
+                buffer->writeIndex.store(write + 1, std::memory_order_release);
+            }
+        }
+        errno = savedErrno;
+    }
+#endif
+
+    const char* const RAW_CAPTURE_HEADER = "# RoamEngine sampling capture v1";
+
+    // Loaded module - where code lived in the sampled process
+    struct ModuleMapping {
+        uintptr_t start;
+        uintptr_t end;
+        uintptr_t fileOffset;
+        std::string path;
+    };
+
+    std::string HexAddress(uintptr_t address) {
+        char text[2 + sizeof(uintptr_t) * 2 + 1];
+        std::snprintf(text, sizeof(text), "0x%llx", static_cast<unsigned long long>(address));
+        return text;
+    }
+
+    // Non-PIE executables keep absolute addresses, everything else is relative to its load base
+    bool IsFixedAddressElf(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        unsigned char header[18];
+        if (!file.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+        if (std::memcmp(header, "\x7f" "ELF", 4) != 0) return false;
+        uint16_t type = static_cast<uint16_t>(header[16] | (header[17] << 8));
+        return type == 2; // ET_EXEC
+    }
+
+    std::string ShellQuote(const std::string& text) {
+        std::string quoted = "'";
+        for (char c : text) {
+            if (c == '\'') quoted += "'\\''";
+            else quoted += c;
+        }
+        return quoted + "'";
+    }
+
+    // Folded stack frames can't contain the separator
+    std::string CleanFrameName(std::string name) {
+        std::replace(name.begin(), name.end(), ';', ':');
+        std::replace(name.begin(), name.end(), '\n', ' ');
+        return name;
+    }
+
+    // Resolve addresses of one module with addr2line - batched, because spawning is slow
+    void SymbolizeModule(const ModuleMapping& module, const std::vector<std::pair<uintptr_t, uintptr_t>>& addresses,
+                         std::unordered_map<uintptr_t, std::string>& symbols) {
+        std::string moduleName = module.path.substr(module.path.find_last_of('/') + 1);
+        for (const auto& entry : addresses) {
+            symbols[entry.first] = moduleName + "+" + HexAddress(entry.second);
+        }
+
+#if ROAM_SAMPLING_SUPPORTED
+        const size_t BATCH = 256;
+        for (size_t first = 0; first < addresses.size(); first += BATCH) {
+            size_t last = std::min(addresses.size(), first + BATCH);
+            std::string command = "addr2line -f -C -e " + ShellQuote(module.path);
+            for (size_t i = first; i < last; ++i) command += " " + HexAddress(addresses[i].second);
+            command += " 2>/dev/null";
+
+            FILE* pipe = popen(command.c_str(), "r");
+            if (!pipe) return;
+
+            char line[4096];
+            for (size_t i = first; i < last; ++i) {
+                if (!std::fgets(line, sizeof(line), pipe)) break;
+                std::string function = line;
+                while (!function.empty() && (function.back() == '\n' || function.back() == '\r')) function.pop_back();
+                if (!std::fgets(line, sizeof(line), pipe)) break; // file:line - not needed for folding
+                if (!function.empty() && function != "??") symbols[addresses[i].first] = function;
+            }
+            pclose(pipe);
+        }
+#endif
+    }
+
+    // Instrumented scope - one interval on the Profiler timeline
+    struct ScopeInterval {
+        uint64_t start;
+        uint64_t end;
+        std::string name;
+    };
+}
+
+SamplingProfiler& SamplingProfiler::GetInstance() {
+    static SamplingProfiler instance;
+    return instance;
+}
+
+SamplingProfiler::SamplingProfiler() : running(false), frequency(1000), samplingClock(SamplingClock::ThreadCpu),
+                                       bufferCapacity(4096), handlerInstalled(false) {
+}
+
+SamplingProfiler::~SamplingProfiler() {
+    Stop();
+}
+
+bool SamplingProfiler::IsSupported() {
+    return ROAM_SAMPLING_SUPPORTED != 0;
+}
+
+bool SamplingProfiler::Start(uint32_t frequencyHz, SamplingClock clock) {
+#if ROAM_SAMPLING_SUPPORTED
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (running.load()) return true;
+
+    if (!handlerInstalled) {
+        struct sigaction action;
+        std::memset(&action, 0, sizeof(action));
+        action.sa_sigaction = SignalHandler;
+        action.sa_flags = SA_SIGINFO | SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        if (sigaction(SIGPROF, &action, nullptr) != 0) return false;
+        handlerInstalled = true;
+    }
+
+    frequency = std::max(1u, frequencyHz);
+    samplingClock = clock;
+    running.store(true);
+
+    for (auto& buffer : threadBuffers) {
+        if (buffer->active) ArmTimer(*buffer);
+    }
+    return true;
+#else
+    (void)frequencyHz;
+    (void)clock;
+    return false;
+#endif
+}
+
+void SamplingProfiler::Stop() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (!running.load()) return;
+
+    running.store(false);
+    for (auto& buffer : threadBuffers) {
+        DisarmTimer(*buffer);
+        Drain(*buffer);
+    }
+}
+
+bool SamplingProfiler::RegisterThread() {
+#if ROAM_SAMPLING_SUPPORTED
+    if (currentThreadBuffer) return true;
+
+    auto buffer = std::make_unique<ThreadBuffer>(std::max<size_t>(16, bufferCapacity));
+    buffer->threadId = Profiler::GetCurrentThreadId();
+    buffer->thread = pthread_self();
+    buffer->kernelThreadId = static_cast<pid_t>(syscall(SYS_gettid));
+
+    // Stack bounds - the frame walker refuses to leave them
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(buffer->thread, &attributes) == 0) {
+        void* stackAddress = nullptr;
+        size_t stackSize = 0;
+        if (pthread_attr_getstack(&attributes, &stackAddress, &stackSize) == 0) {
+            buffer->stackLow = reinterpret_cast<uintptr_t>(stackAddress);
+            buffer->stackHigh = buffer->stackLow + stackSize;
+        }
+        pthread_attr_destroy(&attributes);
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    currentThreadBuffer = buffer.get();
+    if (running.load()) ArmTimer(*buffer);
+    threadBuffers.push_back(std::move(buffer));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SamplingProfiler::UnregisterThread() {
+#if ROAM_SAMPLING_SUPPORTED
+    ThreadBuffer* buffer = currentThreadBuffer;
+    if (!buffer) return;
+
+    // Detach first - a signal that sneaks in now finds nothing and leaves
+    currentThreadBuffer = nullptr;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    DisarmTimer(*buffer);
+    Drain(*buffer);
+    buffer->active = false;
+#endif
+}
+
+bool SamplingProfiler::ArmTimer(ThreadBuffer& buffer) {
+#if ROAM_SAMPLING_SUPPORTED
+    if (buffer.timerArmed) return true;
+
+    clockid_t clockId = CLOCK_MONOTONIC;
+    if (samplingClock == SamplingClock::ThreadCpu && pthread_getcpuclockid(buffer.thread, &clockId) != 0) {
+        return false;
+    }
+
+    // Deliver to this exact thread - a process-wide SIGPROF would land wherever the kernel likes
+    sigevent event;
+    std::memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event.sigev_notify_thread_id = buffer.kernelThreadId;
+    if (timer_create(clockId, &event, &buffer.timer) != 0) return false;
+
+    long intervalNanos = static_cast<long>(1000000000ull / frequency);
+    itimerspec spec;
+    spec.it_interval.tv_sec = intervalNanos / 1000000000L;
+    spec.it_interval.tv_nsec = intervalNanos % 1000000000L;
+    spec.it_value = spec.it_interval;
+    if (timer_settime(buffer.timer, 0, &spec, nullptr) != 0) {
+        timer_delete(buffer.timer);
+        return false;
+    }
+
+    buffer.timerArmed = true;
+    return true;
+#else
+    (void)buffer;
+    return false;
+#endif
+}
+
+void SamplingProfiler::DisarmTimer(ThreadBuffer& buffer) {
+#if ROAM_SAMPLING_SUPPORTED
+    if (!buffer.timerArmed) return;
+    timer_delete(buffer.timer);
+    buffer.timerArmed = false;
+#else
+    (void)buffer;
+#endif
+}
+
+void SamplingProfiler::Drain(ThreadBuffer& buffer) {
+    uint64_t read = buffer.readIndex.load(std::memory_order_relaxed);
+    uint64_t write = buffer.writeIndex.load(std::memory_order_acquire);
+    for (; read < write; ++read) {
+        samples.push_back(buffer.ring[read % buffer.ring.size()]);
+    }
+    buffer.readIndex.store(read, std::memory_order_release);
+}
+
+void SamplingProfiler::Flush() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : threadBuffers) {
+        Drain(*buffer);
+    }
+}
+
+size_t SamplingProfiler::GetSampleCount() {
+    Flush();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return samples.size();
+}
+
+uint64_t SamplingProfiler::GetDroppedSampleCount() const {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t dropped = 0;
+    for (const auto& buffer : threadBuffers) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void SamplingProfiler::Clear() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto& buffer : threadBuffers) {
+        Drain(*buffer);
+        buffer->dropped.store(0);
+    }
+    samples.clear();
+
+    // Unregistered threads can't be signalled any more, so their buffers can finally go
+    threadBuffers.erase(std::remove_if(threadBuffers.begin(), threadBuffers.end(),
+        [](const std::unique_ptr<ThreadBuffer>& buffer) { return !buffer->active; }), threadBuffers.end());
+}
+
+bool SamplingProfiler::SaveRawCapture(const std::string& filename) {
+    Flush();
+
+    std::ofstream file(filename);
+    if (!file) return false;
+
+    file << RAW_CAPTURE_HEADER << "\n";
+
+    // Module map - executable mappings only, that's where return addresses point
+    std::ifstream maps("/proc/self/maps");
+    std::string line;
+    while (std::getline(maps, line)) {
+        std::istringstream fields(line);
+        std::string range, permissions, offset, device, inode, path;
+        if (!(fields >> range >> permissions >> offset >> device >> inode)) continue;
+        std::getline(fields >> std::ws, path);
+        if (permissions.size() < 3 || permissions[2] != 'x' || path.empty() || path[0] != '/') continue;
+
+        size_t dash = range.find('-');
+        file << "module " << range.substr(0, dash) << ' ' << range.substr(dash + 1) << ' ' << offset << ' ' << path << "\n";
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    file << std::hex;
+    for (const StackSample& sample : samples) {
+        file << "sample " << std::dec << sample.timestampMicros << ' ' << sample.threadId << std::hex;
+        for (uint32_t i = 0; i < sample.frameCount; ++i) file << ' ' << sample.frames[i];
+        file << "\n";
+    }
+
+    return static_cast<bool>(file);
+}
+
+bool SamplingProfiler::WriteFoldedStacks(const std::string& rawCaptureFile, const std::string& foldedFile,
+                                         const std::string& profilerCaptureFile) {
+    std::ifstream raw(rawCaptureFile);
+    std::string line;
+    if (!raw || !std::getline(raw, line) || line.compare(0, std::strlen(RAW_CAPTURE_HEADER), RAW_CAPTURE_HEADER) != 0) {
+        return false;
+    }
+
+    std::vector<ModuleMapping> modules;
+    std::vector<StackSample> stacks;
+    while (std::getline(raw, line)) {
+        std::istringstream fields(line);
+        std::string kind;
+        fields >> kind;
+        if (kind == "module") {
+            ModuleMapping module;
+            fields >> std::hex >> module.start >> module.end >> module.fileOffset;
+            std::getline(fields >> std::ws, module.path);
+            modules.push_back(module);
+        } else if (kind == "sample") {
+            StackSample sample;
+            fields >> std::dec >> sample.timestampMicros >> sample.threadId >> std::hex;
+            sample.frameCount = 0;
+            uintptr_t address;
+            while (sample.frameCount < StackSample::MAX_FRAMES && fields >> address) {
+                sample.frames[sample.frameCount++] = address;
+            }
+            stacks.push_back(sample);
+        }
+    }
+    std::sort(modules.begin(), modules.end(), [](const ModuleMapping& a, const ModuleMapping& b) { return a.start < b.start; });
+
+    // Return addresses point just past the call - step back one byte so we land in the caller's line
+    auto lookupAddress = [](const StackSample& sample, uint32_t frame) {
+        return frame == 0 ? sample.frames[0] : sample.frames[frame] - 1;
+    };
+
+    // Group unique addresses by module, translated to what addr2line expects
+    std::map<size_t, std::vector<std::pair<uintptr_t, uintptr_t>>> addressesByModule;
+    std::unordered_map<uintptr_t, std::string> symbols;
+    std::unordered_map<std::string, bool> fixedAddressModules;
+    for (const StackSample& sample : stacks) {
+        for (uint32_t f = 0; f < sample.frameCount; ++f) {
+            uintptr_t address = lookupAddress(sample, f);
+            if (symbols.count(address)) continue;
+            symbols[address] = HexAddress(address);
+
+            auto it = std::upper_bound(modules.begin(), modules.end(), address,
+                [](uintptr_t value, const ModuleMapping& module) { return value < module.start; });
+            if (it == modules.begin()) continue;
+            --it;
+            if (address >= it->end) continue;
+
+            auto fixed = fixedAddressModules.find(it->path);
+            if (fixed == fixedAddressModules.end()) {
+                fixed = fixedAddressModules.emplace(it->path, IsFixedAddressElf(it->path)).first;
+            }
+            uintptr_t moduleAddress = fixed->second ? address : address - it->start + it->fileOffset;
+            addressesByModule[static_cast<size_t>(it - modules.begin())].push_back({ address, moduleAddress });
+        }
+    }
+    for (const auto& entry : addressesByModule) {
+        SymbolizeModule(modules[entry.first], entry.second, symbols);
+    }
+
+    // Instrumented timeline - per thread, per depth; scopes at one depth never overlap on one thread
+    std::unordered_map<uint32_t, std::vector<std::vector<ScopeInterval>>> scopes;
+    if (!profilerCaptureFile.empty()) {
+        std::vector<ProfileSample> profileSamples;
+        if (!Profiler::ReadCapture(profilerCaptureFile, profileSamples)) return false;
+
+        for (const ProfileSample& sample : profileSamples) {
+            auto& levels = scopes[sample.threadId];
+            if (levels.size() <= sample.depth) levels.resize(sample.depth + 1);
+            uint64_t start = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(sample.startTime.time_since_epoch()).count());
+            levels[sample.depth].push_back({ start, start + static_cast<uint64_t>(sample.duration.count()), sample.name });
+        }
+        for (auto& thread : scopes) {
+            for (auto& level : thread.second) {
+                std::sort(level.begin(), level.end(), [](const ScopeInterval& a, const ScopeInterval& b) { return a.start < b.start; });
+            }
+        }
+    }
+
+    std::map<std::string, uint64_t> folded;
+    for (const StackSample& sample : stacks) {
+        std::string stack;
+
+        auto thread = scopes.find(sample.threadId);
+        if (thread != scopes.end()) {
+            for (const auto& level : thread->second) {
+                auto it = std::upper_bound(level.begin(), level.end(), sample.timestampMicros,
+                    [](uint64_t time, const ScopeInterval& scope) { return time < scope.start; });
+                if (it == level.begin()) break;
+                --it;
+                if (sample.timestampMicros > it->end) break; // no scope open at this depth, so none deeper either
+                stack += "[" + CleanFrameName(it->name) + "];";
+            }
+        }
+
+        for (uint32_t f = sample.frameCount; f-- > 0;) {
+            stack += CleanFrameName(symbols[lookupAddress(sample, f)]);
+            if (f > 0) stack += ';';
+        }
+        if (!stack.empty() && stack.back() == ';') stack.pop_back();
+        if (!stack.empty()) ++folded[stack];
+    }
+
+    std::ofstream out(foldedFile);
+    if (!out) return false;
+    for (const auto& entry : folded) {
+        out << entry.first << ' ' << entry.second << "\n";
+    }
+    return static_cast<bool>(out);
+}
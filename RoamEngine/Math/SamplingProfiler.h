@@ -0,0 +1,101 @@
+// SamplingProfiler.h - The eavesdropper
+// Interrupts threads a thousand times a second and writes down where they were caught
+
+#ifndef SAMPLINGPROFILER_H
+#define SAMPLINGPROFILER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+// Stack sample - one interrupted moment in one thread's life
+struct StackSample {
+    static const uint32_t MAX_FRAMES = 64;
+
+    uint64_t timestampMicros; // same clock and epoch as the instrumented Profiler
+    uint32_t threadId;        // Profiler::GetCurrentThreadId() of the sampled thread
+    uint32_t frameCount;
+    uintptr_t frames[MAX_FRAMES]; // leaf first, frames[0] is the interrupted pc
+};
+
+// Sampling clock - what counts as "time passing" for a thread
+enum class SamplingClock {
+    ThreadCpu, // only while the thread is running - where the CPU goes
+    Wall       // also while blocked - where the frame time goes
+};
+
+// The SamplingProfiler class - catches the code nobody wrapped in PROFILE_SCOPE
+// POSIX only: a per-thread SIGPROF timer and a frame-pointer walk (or libunwind with
+// ROAM_HAS_LIBUNWIND) into a lock-free buffer per thread. Build with -fno-omit-frame-pointer
+// or the stacks will be one frame deep. Symbolization happens offline in WriteFoldedStacks.
+class SamplingProfiler {
+public:
+    static SamplingProfiler& GetInstance();
+
+    // Can this platform do it at all?
+    static bool IsSupported();
+
+    // Start/stop sampling every registered thread
+    bool Start(uint32_t frequencyHz = 1000, SamplingClock clock = SamplingClock::ThreadCpu);
+    void Stop();
+    bool IsRunning() const { return running.load(std::memory_order_relaxed); }
+
+    // Thread registration - only registered threads get sampled, call from the thread itself
+    bool RegisterThread();
+    void UnregisterThread();
+
+    // Per-thread buffer size in samples - set before threads register
+    void SetBufferCapacity(size_t samples) { bufferCapacity = samples; }
+
+    // Drain per-thread buffers into the capture - call once a frame on long runs so nothing is dropped
+    void Flush();
+
+    // Statistics - how much did we see, how much did we miss?
+    size_t GetSampleCount();
+    uint64_t GetDroppedSampleCount() const;
+
+    // Save raw addresses plus the module map - symbolize later, somewhere with time to spare
+    bool SaveRawCapture(const std::string& filename);
+
+    // Clear all captured samples - start fresh
+    void Clear();
+
+    // Offline: symbolize a raw capture and write folded stacks for flamegraph.pl / speedscope.
+    // With a Profiler capture from the same run, each stack is prefixed with the instrumented
+    // scopes that were open on that thread at that moment, e.g. "[Frame];[Physics];main;...".
+    static bool WriteFoldedStacks(const std::string& rawCaptureFile, const std::string& foldedFile,
+                                  const std::string& profilerCaptureFile = "");
+
+    struct ThreadBuffer;
+
+private:
+    SamplingProfiler();
+    ~SamplingProfiler();
+
+    // Prevent copying
+    SamplingProfiler(const SamplingProfiler&) = delete;
+    SamplingProfiler& operator=(const SamplingProfiler&) = delete;
+
+    bool ArmTimer(ThreadBuffer& buffer);
+    void DisarmTimer(ThreadBuffer& buffer);
+    void Drain(ThreadBuffer& buffer);
+
+    // Registered threads - buffers live until Clear() so a late signal never hits freed memory
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+    mutable std::mutex registryMutex;
+
+    // Drained samples
+    std::vector<StackSample> samples;
+
+    // Configuration
+    std::atomic<bool> running;
+    uint32_t frequency;
+    SamplingClock samplingClock;
+    size_t bufferCapacity;
+    bool handlerInstalled;
+};
+
+#endif // SAMPLINGPROFILER_H
@@ -18,18 +18,10 @@ public:
     Vector3(float x, float y, float z) : x(x), y(y), z(z) {}
     Vector3(float value) : x(value), y(value), z(value) {}
 
-    // Copy constructor
-    Vector3(const Vector3& other) : x(other.x), y(other.y), z(other.z) {}
-
-    // Assignment operator
-    Vector3& operator=(const Vector3& other) {
-        if (this != &other) {
-            x = other.x;
-            y = other.y;
-            z = other.z;
-        }
-        return *this;
-    }
+    // Copy and assignment - left to the compiler, so a Vector3 stays trivially copyable and
+    // arrays of them can be memcpy'd
+    Vector3(const Vector3& other) = default;
+    Vector3& operator=(const Vector3& other) = default;
 
     // Arithmetic operators
     Vector3 operator+(const Vector3& other) const { return Vector3(x + other.x, y + other.y, z + other.z); }
@@ -88,16 +80,16 @@ public:
 };
 
 // Static constants
-const Vector3 Vector3::Zero(0.0f, 0.0f, 0.0f);
-const Vector3 Vector3::One(1.0f, 1.0f, 1.0f);
-const Vector3 Vector3::UnitX(1.0f, 0.0f, 0.0f);
-const Vector3 Vector3::UnitY(0.0f, 1.0f, 0.0f);
-const Vector3 Vector3::UnitZ(0.0f, 0.0f, 1.0f);
-const Vector3 Vector3::Up(0.0f, 1.0f, 0.0f);
-const Vector3 Vector3::Down(0.0f, -1.0f, 0.0f);
-const Vector3 Vector3::Left(-1.0f, 0.0f, 0.0f);
-const Vector3 Vector3::Right(1.0f, 0.0f, 0.0f);
-const Vector3 Vector3::Forward(0.0f, 0.0f, 1.0f);
-const Vector3 Vector3::Back(0.0f, 0.0f, -1.0f);
+inline const Vector3 Vector3::Zero(0.0f, 0.0f, 0.0f);
+inline const Vector3 Vector3::One(1.0f, 1.0f, 1.0f);
+inline const Vector3 Vector3::UnitX(1.0f, 0.0f, 0.0f);
+inline const Vector3 Vector3::UnitY(0.0f, 1.0f, 0.0f);
+inline const Vector3 Vector3::UnitZ(0.0f, 0.0f, 1.0f);
+inline const Vector3 Vector3::Up(0.0f, 1.0f, 0.0f);
+inline const Vector3 Vector3::Down(0.0f, -1.0f, 0.0f);
+inline const Vector3 Vector3::Left(-1.0f, 0.0f, 0.0f);
+inline const Vector3 Vector3::Right(1.0f, 0.0f, 0.0f);
+inline const Vector3 Vector3::Forward(0.0f, 0.0f, 1.0f);
+inline const Vector3 Vector3::Back(0.0f, 0.0f, -1.0f);
 
 #endif // VECTOR3_H
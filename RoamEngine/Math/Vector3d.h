@@ -0,0 +1,60 @@
+// Vector3d.h - The long-distance vector
+// A Vector3 in doubles, for where things are in a world too big for floats to place them to the millimetre
+
+#ifndef VECTOR3D_H
+#define VECTOR3D_H
+
+#include <cmath>
+#include <iostream>
+#include "Math/Vector3.h"
+
+// The Vector3d class - world positions. Floats run out of millimetres about 16km from the origin, doubles
+// don't until the far side of the solar system. Anything simulated or drawn still works in Vector3, relative
+// to a FloatingOrigin - Vector3d is for placing things, not for doing maths on them every frame.
+class Vector3d {
+public:
+    // Components
+    double x, y, z;
+
+    // Constructors - a Vector3 widens without asking, going the other way is ToVector3
+    Vector3d() : x(0.0), y(0.0), z(0.0) {}
+    Vector3d(double x, double y, double z) : x(x), y(y), z(z) {}
+    Vector3d(const Vector3& other) : x(other.x), y(other.y), z(other.z) {}
+
+    // Narrowing - only sensible for something already near the origin
+    Vector3 ToVector3() const { return Vector3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)); }
+
+    // Arithmetic operators
+    Vector3d operator+(const Vector3d& other) const { return Vector3d(x + other.x, y + other.y, z + other.z); }
+    Vector3d operator-(const Vector3d& other) const { return Vector3d(x - other.x, y - other.y, z - other.z); }
+    Vector3d operator*(double scalar) const { return Vector3d(x * scalar, y * scalar, z * scalar); }
+    Vector3d operator/(double scalar) const { return Vector3d(x / scalar, y / scalar, z / scalar); }
+
+    // Compound assignment operators
+    Vector3d& operator+=(const Vector3d& other) { x += other.x; y += other.y; z += other.z; return *this; }
+    Vector3d& operator-=(const Vector3d& other) { x -= other.x; y -= other.y; z -= other.z; return *this; }
+    Vector3d& operator*=(double scalar) { x *= scalar; y *= scalar; z *= scalar; return *this; }
+    Vector3d& operator/=(double scalar) { x /= scalar; y /= scalar; z /= scalar; return *this; }
+
+    // Comparison operators
+    bool operator==(const Vector3d& other) const { return x == other.x && y == other.y && z == other.z; }
+    bool operator!=(const Vector3d& other) const { return !(*this == other); }
+
+    // Vector operations
+    double Length() const { return std::sqrt(x * x + y * y + z * z); }
+    double LengthSquared() const { return x * x + y * y + z * z; }
+
+    // Distance between points
+    static double Distance(const Vector3d& a, const Vector3d& b) { return (a - b).Length(); }
+
+    // Linear interpolation
+    static Vector3d Lerp(const Vector3d& a, const Vector3d& b, double t) { return a + (b - a) * t; }
+
+    // Output operator - for debugging
+    friend std::ostream& operator<<(std::ostream& os, const Vector3d& v) {
+        os << "(" << v.x << ", " << v.y << ", " << v.z << ")";
+        return os;
+    }
+};
+
+#endif // VECTOR3D_H
@@ -0,0 +1,210 @@
+// VirtualFileSystem.cpp - Implementation of the mail sorter
+// One hash lookup per pack beats one stat per loose file, every single time
+
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <set>
+
+VirtualFileSystem& VirtualFileSystem::GetInstance() {
+    static VirtualFileSystem instance;
+    return instance;
+}
+
+VirtualFileSystem::VirtualFileSystem() : nextOrder(0), looseFileFallback(true), jobSystem(nullptr) {
+}
+
+VirtualFileSystem::~VirtualFileSystem() {
+    UnmountAll();
+}
+
+bool VirtualFileSystem::Mount(const std::string& source, int priority, const std::string& mountPoint) {
+    MountEntry entry;
+    entry.source = source;
+    entry.mountPoint = PackArchive::NormalizePath(mountPoint);
+    entry.priority = priority;
+
+    std::error_code error;
+    if (std::filesystem::is_directory(source, error)) {
+        entry.type = MountType::Directory;
+    } else {
+        auto pack = std::make_shared<PackArchive>();
+        if (!pack->Open(source)) return false;
+        entry.type = MountType::Pack;
+        entry.pack = std::move(pack);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    entry.order = nextOrder++;
+    mounts.push_back(std::move(entry));
+    std::stable_sort(mounts.begin(), mounts.end(), [](const MountEntry& a, const MountEntry& b) {
+        if (a.priority != b.priority) return a.priority > b.priority;
+        return a.order > b.order;
+    });
+    return true;
+}
+
+bool VirtualFileSystem::Unmount(const std::string& source) {
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    auto it = std::find_if(mounts.begin(), mounts.end(),
+                           [&source](const MountEntry& entry) { return entry.source == source; });
+    if (it == mounts.end()) return false;
+
+    // Views handed out earlier keep the pack mapping alive on their own
+    mounts.erase(it);
+    return true;
+}
+
+void VirtualFileSystem::UnmountAll() {
+    std::unique_lock<std::shared_mutex> lock(mountMutex);
+    mounts.clear();
+}
+
+bool VirtualFileSystem::Exists(const std::string& path) const {
+    std::shared_ptr<PackArchive> pack;
+    const PackEntry* entry = nullptr;
+    std::string diskPath;
+    return Resolve(path, pack, entry, diskPath);
+}
+
+bool VirtualFileSystem::Open(const std::string& path, FileView& view) const {
+    std::shared_ptr<PackArchive> pack;
+    const PackEntry* entry = nullptr;
+    std::string diskPath;
+    if (!Resolve(path, pack, entry, diskPath)) return false;
+
+    if (pack) {
+        if (PackArchive::GetCompression(*entry) != CompressionMethod::None) {
+            auto buffer = std::make_shared<std::vector<std::byte>>();
+            if (!pack->ReadAll(*entry, *buffer, jobSystem)) return false;
+            view.mapping.reset();
+            view.data = std::span<const std::byte>(buffer->data(), buffer->size());
+            view.decoded = std::move(buffer);
+            return true;
+        }
+        view.mapping = pack->GetMapping();
+        view.decoded.reset();
+        view.data = pack->GetData(*entry);
+        return true;
+    }
+
+    std::shared_ptr<MappedFile> mapping = FileSystem::MapFile(diskPath);
+    if (!mapping) return false;
+    mapping->Advise(MapAccessHint::Sequential); // loaders parse front to back
+    view.decoded.reset();
+    view.data = mapping->GetData();
+    view.mapping = std::move(mapping);
+    return true;
+}
+
+bool VirtualFileSystem::ReadFile(const std::string& path, std::vector<char>& data) const {
+    FileView view;
+    if (!Open(path, view)) return false;
+
+    const char* bytes = reinterpret_cast<const char*>(view.data.data());
+    data.assign(bytes, bytes + view.data.size());
+    return true;
+}
+
+std::string VirtualFileSystem::ResolveLoosePath(const std::string& path) const {
+    std::shared_ptr<PackArchive> pack;
+    const PackEntry* entry = nullptr;
+    std::string diskPath;
+    if (!Resolve(path, pack, entry, diskPath) || pack) return std::string();
+    return diskPath;
+}
+
+std::vector<std::string> VirtualFileSystem::ListFiles(const std::string& prefix) const {
+    std::string normalizedPrefix = PackArchive::NormalizePath(prefix);
+    std::set<std::string> files;
+
+    std::shared_lock<std::shared_mutex> lock(mountMutex);
+    for (const auto& mount : mounts) {
+        std::string base = mount.mountPoint.empty() ? "" : mount.mountPoint + "/";
+
+        if (mount.type == MountType::Pack) {
+            for (size_t i = 0; i < mount.pack->GetEntryCount(); ++i) {
+                std::string fullPath = base + std::string(mount.pack->GetEntryPath(mount.pack->GetEntry(i)));
+                if (fullPath.compare(0, normalizedPrefix.size(), normalizedPrefix) == 0) files.insert(std::move(fullPath));
+            }
+            continue;
+        }
+
+        std::error_code error;
+        for (auto it = std::filesystem::recursive_directory_iterator(mount.source, error);
+             !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (!it->is_regular_file(error)) continue;
+            std::string relative = std::filesystem::relative(it->path(), mount.source, error).generic_string();
+            std::string fullPath = PackArchive::NormalizePath(base + relative);
+            if (fullPath.compare(0, normalizedPrefix.size(), normalizedPrefix) == 0) files.insert(std::move(fullPath));
+        }
+    }
+
+    return std::vector<std::string>(files.begin(), files.end());
+}
+
+std::vector<VirtualFileSystem::MountInfo> VirtualFileSystem::GetMounts() const {
+    std::shared_lock<std::shared_mutex> lock(mountMutex);
+    std::vector<MountInfo> result;
+    result.reserve(mounts.size());
+    for (const auto& mount : mounts) {
+        result.push_back(MountInfo{ mount.source, mount.mountPoint, mount.priority, mount.type,
+                                    mount.pack ? mount.pack->GetEntryCount() : 0 });
+    }
+    return result;
+}
+
+bool VirtualFileSystem::Resolve(const std::string& path, std::shared_ptr<PackArchive>& pack, const PackEntry*& entry,
+                                std::string& diskPath) const {
+    std::string normalized = PackArchive::NormalizePath(path);
+
+    {
+        std::shared_lock<std::shared_mutex> lock(mountMutex);
+        std::string relative;
+        for (const auto& mount : mounts) {
+            if (!MakeRelative(mount.mountPoint, normalized, relative)) continue;
+
+            if (mount.type == MountType::Pack) {
+                if (const PackEntry* found = mount.pack->Find(relative)) {
+                    pack = mount.pack;
+                    entry = found;
+                    return true;
+                }
+            } else {
+                // Never let a path climb out of the mounted folder
+                if (relative.empty() || relative[0] == '/' || relative.compare(0, 2, "..") == 0) continue;
+
+                // Loose files cost a stat each - fine for development, which is what directory mounts are for
+                std::string candidate = (std::filesystem::path(mount.source) / relative).string();
+                std::error_code error;
+                if (std::filesystem::is_regular_file(candidate, error)) {
+                    diskPath = std::move(candidate);
+                    return true;
+                }
+            }
+        }
+    }
+
+    if (looseFileFallback) {
+        std::error_code error;
+        if (std::filesystem::is_regular_file(normalized, error)) {
+            diskPath = normalized;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool VirtualFileSystem::MakeRelative(const std::string& mountPoint, const std::string& path, std::string& relative) {
+    if (mountPoint.empty()) {
+        relative = path;
+        return true;
+    }
+    if (path.size() <= mountPoint.size() || path.compare(0, mountPoint.size(), mountPoint) != 0 ||
+        path[mountPoint.size()] != '/') {
+        return false;
+    }
+    relative = path.substr(mountPoint.size() + 1);
+    return true;
+}
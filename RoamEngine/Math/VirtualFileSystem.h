@@ -0,0 +1,93 @@
+// VirtualFileSystem.h - The mail sorter
+// Asks every mounted pack and folder "do you have this one?", highest priority first
+
+#ifndef VIRTUALFILESYSTEM_H
+#define VIRTUALFILESYSTEM_H
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include "Math/FileSystem.h"
+#include "Math/PackArchive.h"
+
+class ThreadManager;
+
+// What kind of thing is mounted
+enum class MountType {
+    Directory,  // loose files on disk - development, mods
+    Pack        // a PackArchive - shipping builds, patches
+};
+
+// The VirtualFileSystem class - one namespace over packs and folders
+class VirtualFileSystem {
+public:
+    static VirtualFileSystem& GetInstance();
+
+    // Mounting - higher priority wins, and on a tie the later mount wins, so a patch mounted
+    // after the base pack overrides it. mountPoint is the virtual prefix the contents appear under.
+    bool Mount(const std::string& source, int priority = 0, const std::string& mountPoint = "");
+    bool Unmount(const std::string& source);
+    void UnmountAll();
+
+    // Loose-file fallback - paths nothing mounted knows about are tried on disk as-is (on by default)
+    void SetLooseFileFallback(bool enable) { looseFileFallback = enable; }
+    bool GetLooseFileFallback() const { return looseFileFallback; }
+
+    // Job system for decoding compressed pack entries in parallel - decoding stays on the caller without one
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    // Lookup - paths use forward or back slashes, "." and ".." are resolved
+    bool Exists(const std::string& path) const;
+    bool Open(const std::string& path, FileView& view) const;          // zero-copy unless the entry is compressed
+    bool ReadFile(const std::string& path, std::vector<char>& data) const; // copy, for APIs that want a buffer
+
+    // Where a path resolves to on disk - empty if it lives in a pack (or nowhere)
+    std::string ResolveLoosePath(const std::string& path) const;
+
+    // Every file visible under a virtual prefix, each listed once
+    std::vector<std::string> ListFiles(const std::string& prefix = "") const;
+
+    // Mount info - for debug overlays and the console
+    struct MountInfo {
+        std::string source;
+        std::string mountPoint;
+        int priority;
+        MountType type;
+        size_t fileCount; // packs only, 0 for directories
+    };
+    std::vector<MountInfo> GetMounts() const;
+
+private:
+    VirtualFileSystem();
+    ~VirtualFileSystem();
+
+    // Prevent copying - one namespace is enough
+    VirtualFileSystem(const VirtualFileSystem&) = delete;
+    VirtualFileSystem& operator=(const VirtualFileSystem&) = delete;
+
+    struct MountEntry {
+        std::string source;
+        std::string mountPoint;              // normalized, no trailing slash
+        int priority;
+        uint64_t order;
+        MountType type;
+        std::shared_ptr<PackArchive> pack;   // shared so lookups can finish while someone unmounts
+    };
+
+    // Find the winning mount for a normalized path - either a pack entry or a file on disk
+    bool Resolve(const std::string& path, std::shared_ptr<PackArchive>& pack, const PackEntry*& entry,
+                 std::string& diskPath) const;
+
+    // Strip the mount point off a normalized path - false if the path isn't under it
+    static bool MakeRelative(const std::string& mountPoint, const std::string& path, std::string& relative);
+
+    std::vector<MountEntry> mounts; // sorted - highest priority, then newest, first
+    mutable std::shared_mutex mountMutex;
+    uint64_t nextOrder;
+    bool looseFileFallback;
+    ThreadManager* jobSystem;
+};
+
+#endif // VIRTUALFILESYSTEM_H
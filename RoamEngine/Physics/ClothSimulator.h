@@ -118,6 +118,18 @@ public:
     void ClearWindForces() { windForces.clear(); }
     void ApplyForce(int particleIndex, const Vector3& force);
 
+    // Floating origin rebase - previousPosition too, or Verlet reads the shift as a huge velocity
+    void ShiftOrigin(const Vector3& shift) {
+        for (ClothParticle& particle : particles) {
+            particle.position -= shift;
+            particle.previousPosition -= shift;
+        }
+        for (CollisionObject& object : collisionObjects) {
+            object.position -= shift;
+            for (Vector3& vertex : object.vertices) vertex -= shift;
+        }
+    }
+
     // Material properties
     void SetStiffness(float stiffness) { this->stiffness = stiffness; }
     void SetDamping(float damping) { this->damping = damping; }
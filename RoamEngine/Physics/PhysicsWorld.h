@@ -45,6 +45,9 @@ public:
     // Raycasting - shoot rays through space
     bool Raycast(const Vector3& origin, const Vector3& direction, float maxDistance, ContactInfo& hitInfo);
 
+    // Floating origin rebase - moves every body, and the cached contacts with them, without waking anything
+    void ShiftOrigin(const Vector3& shift);
+
     // Gravity control - change the rules
     void SetGravity(const Vector3& gravity) { this->gravity = gravity; }
     const Vector3& GetGravity() const { return gravity; }
@@ -7,6 +7,7 @@
 #include <memory>
 #include "Math/Vector3.h"
 #include "Math/Matrix4x4.h"
+#include "Math/Bounds.h"
 
 // Camera types - perspective or orthographic
 enum class CameraType {
@@ -21,23 +22,31 @@ public:
     ~Camera();
 
     // Set camera type - perspective or ortho
-    void SetType(CameraType type) { cameraType = type; UpdateProjectionMatrix(); }
+    void SetType(CameraType type) { cameraType = type; projectionDirty = true; }
     CameraType GetType() const { return cameraType; }
 
     // Perspective settings - for 3D views
-    void SetFieldOfView(float fovDegrees) { fieldOfView = fovDegrees; UpdateProjectionMatrix(); }
-    void SetAspectRatio(float aspect) { aspectRatio = aspect; UpdateProjectionMatrix(); }
-    void SetNearClip(float nearClip) { this->nearClip = nearClip; UpdateProjectionMatrix(); }
-    void SetFarClip(float farClip) { this->farClip = farClip; UpdateProjectionMatrix(); }
+    void SetFieldOfView(float fovDegrees) { fieldOfView = fovDegrees; projectionDirty = true; }
+    void SetAspectRatio(float aspect) { aspectRatio = aspect; projectionDirty = true; }
+    void SetNearClip(float nearClip) { this->nearClip = nearClip; projectionDirty = true; }
+    void SetFarClip(float farClip) { this->farClip = farClip; projectionDirty = true; }
+    float GetFieldOfView() const { return fieldOfView; }
+    float GetAspectRatio() const { return aspectRatio; }
+    float GetNearClip() const { return nearClip; }
+    float GetFarClip() const { return farClip; }
 
     // Orthographic settings - for 2D views
-    void SetOrthoSize(float size) { orthoSize = size; UpdateProjectionMatrix(); }
+    void SetOrthoSize(float size) { orthoSize = size; projectionDirty = true; }
+    float GetOrthoSize() const { return orthoSize; }
 
     // Position and orientation - where and how we look
-    void SetPosition(const Vector3& position) { this->position = position; UpdateViewMatrix(); }
-    void SetRotation(const Vector3& rotation) { this->rotation = rotation; UpdateViewMatrix(); }
+    void SetPosition(const Vector3& position) { this->position = position; viewDirty = true; }
+    void SetRotation(const Vector3& rotation) { this->rotation = rotation; viewDirty = true; }
     void LookAt(const Vector3& target, const Vector3& up = Vector3(0, 1, 0));
 
+    // Floating origin rebase - the world moved under us, so we move the other way
+    void ShiftOrigin(const Vector3& shift) { SetPosition(position - shift); }
+
     // Movement - fly around
     void MoveForward(float distance);
     void MoveRight(float distance);
@@ -46,10 +55,17 @@ public:
     // Rotation - look around
     void Rotate(float yaw, float pitch);
 
-    // Get matrices - for rendering
-    const Matrix4x4& GetViewMatrix() const { return viewMatrix; }
-    const Matrix4x4& GetProjectionMatrix() const { return projectionMatrix; }
-    Matrix4x4 GetViewProjectionMatrix() const { return viewMatrix * projectionMatrix; }
+    // Get matrices - for rendering. Rebuilt here if anything changed since, so a frame of setter calls
+    // costs one rebuild, not one each.
+    const Matrix4x4& GetViewMatrix() const {
+        if (viewDirty) { UpdateViewMatrix(); viewDirty = false; }
+        return viewMatrix;
+    }
+    const Matrix4x4& GetProjectionMatrix() const {
+        if (projectionDirty) { UpdateProjectionMatrix(); projectionDirty = false; }
+        return projectionMatrix;
+    }
+    Matrix4x4 GetViewProjectionMatrix() const { return GetProjectionMatrix() * GetViewMatrix(); } // column vectors - view first
 
     // Get vectors - for calculations
     Vector3 GetForward() const;
@@ -59,8 +75,8 @@ public:
     // Get position - where are we?
     const Vector3& GetPosition() const { return position; }
 
-    // Get frustum - for culling
-    void GetFrustumPlanes(std::vector<Vector4>& planes) const;
+    // Get frustum - for culling, straight into SpatialIndex::QueryFrustum
+    Frustum GetFrustum() const { return Frustum::FromMatrix(GetViewProjectionMatrix()); }
 
     // World to screen - project points
     Vector3 WorldToScreen(const Vector3& worldPoint) const;
@@ -69,9 +85,9 @@ public:
     Vector3 ScreenToWorld(const Vector3& screenPoint) const;
 
 private:
-    // Update matrices - recalculate when settings change
-    void UpdateViewMatrix();
-    void UpdateProjectionMatrix();
+    // Update matrices - recalculate after settings change, the first time they're asked for
+    void UpdateViewMatrix() const;
+    void UpdateProjectionMatrix() const;
 
     // Camera type
     CameraType cameraType;
@@ -90,8 +106,10 @@ private:
     Vector3 rotation;
 
     // Matrices
-    Matrix4x4 viewMatrix;
-    Matrix4x4 projectionMatrix;
+    mutable Matrix4x4 viewMatrix;
+    mutable Matrix4x4 projectionMatrix;
+    mutable bool viewDirty = true;
+    mutable bool projectionDirty = true;
 };
 
 #endif // CAMERA_H
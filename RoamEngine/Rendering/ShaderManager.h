@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include "Core/StringId.h"
 
 // Shader types - vertex, fragment, etc.
 enum class ShaderType {
@@ -40,6 +41,13 @@ public:
     void SetUniform(const std::string& name, const Vector3& value);
     void SetUniform(const std::string& name, const Matrix4x4& value);
 
+    // The same by ID - each uniform's location is looked up once and cached against its ID. The
+    // invalid ID sets nothing; a uniform whose name collided goes through the string overloads.
+    void SetUniform(StringId name, int value);
+    void SetUniform(StringId name, float value);
+    void SetUniform(StringId name, const Vector3& value);
+    void SetUniform(StringId name, const Matrix4x4& value);
+
     // Get program ID - the magical identifier
     unsigned int GetProgramID() const { return programID; }
 
@@ -53,12 +61,19 @@ private:
     // Link program - combine the components
     bool LinkProgram(unsigned int vertexShader, unsigned int fragmentShader);
 
+    // Uniform location by ID, from the cache or the driver - -1 if the program has no such uniform,
+    // or for the invalid ID, which is never cached
+    int GetUniformLocation(StringId name);
+
     // Program ID - the heart of the magic
     unsigned int programID;
 
     // Shader IDs - the components
     unsigned int vertexShaderID;
     unsigned int fragmentShaderID;
+
+    // Uniform locations - cleared whenever the program is relinked
+    std::unordered_map<StringId, int> uniformLocations;
 };
 
 // The ShaderManager class - our shader librarian
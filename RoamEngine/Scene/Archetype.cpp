@@ -0,0 +1,138 @@
+// Archetype.cpp - Implementation of the filing cabinet
+// Layout once, then it's all pointer arithmetic
+
+#include "Archetype.h"
+#include <algorithm>
+#include <new>
+
+namespace {
+    size_t AlignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+Archetype::Archetype(const ComponentMask& mask)
+    : mask(mask), chunkBytes(ChunkBytes), chunkAlignment(ChunkAlignment), chunkCapacity(0), spareChunk(nullptr), entityCount(0) {
+    columns.fill(-1);
+    size_t rowBytes = sizeof(Entity);
+    for (size_t type = 0; type < MaxComponentTypes; ++type) {
+        if (!mask.test(type)) continue;
+        columns[type] = static_cast<int16_t>(types.size());
+        types.push_back(static_cast<ComponentTypeId>(type));
+        infos.push_back(&ComponentRegistry::GetInfo(static_cast<ComponentTypeId>(type)));
+        rowBytes += infos.back()->size;
+        chunkAlignment = std::max(chunkAlignment, infos.back()->alignment);
+    }
+
+    // As many rows as fit once each column is padded to its alignment - at least one, even if that
+    // takes a bigger chunk
+    auto layout = [&](uint32_t capacity) {
+        size_t offset = sizeof(Entity) * capacity;
+        offsets.clear();
+        for (const ComponentInfo* info : infos) {
+            offset = AlignUp(offset, std::max(info->alignment, size_t(16)));
+            offsets.push_back(offset);
+            offset += info->size * capacity;
+        }
+        return offset;
+    };
+    uint32_t capacity = static_cast<uint32_t>(std::max<size_t>(ChunkBytes / rowBytes, 1));
+    while (capacity > 1 && layout(capacity) > ChunkBytes) capacity--;
+    chunkCapacity = capacity;
+    chunkBytes = AlignUp(std::max(layout(capacity), ChunkBytes), chunkAlignment);
+}
+
+Archetype::~Archetype() {
+    Clear();
+    if (spareChunk) FreeChunk(spareChunk);
+}
+
+void Archetype::Clear() {
+    for (Chunk& chunk : chunks) {
+        for (size_t column = 0; column < types.size(); ++column) {
+            if (!infos[column]->destroy) continue;
+            for (uint32_t row = 0; row < chunk.count; ++row) {
+                infos[column]->destroy(chunk.data + offsets[column] + infos[column]->size * row);
+            }
+        }
+        if (spareChunk) FreeChunk(spareChunk);
+        spareChunk = chunk.data;
+    }
+    chunks.clear();
+    entityCount = 0;
+}
+
+void* Archetype::GetColumn(size_t chunk, ComponentTypeId type) const {
+    if (type >= MaxComponentTypes || columns[type] < 0) return nullptr;
+    return chunks[chunk].data + offsets[columns[type]];
+}
+
+void* Archetype::GetComponent(const ArchetypeLocation& location, ComponentTypeId type) const {
+    if (type >= MaxComponentTypes || columns[type] < 0) return nullptr;
+    size_t column = static_cast<size_t>(columns[type]);
+    return chunks[location.chunk].data + offsets[column] + infos[column]->size * location.row;
+}
+
+ArchetypeLocation Archetype::Allocate(Entity entity) {
+    if (chunks.empty() || chunks.back().count == chunkCapacity) {
+        Chunk chunk;
+        chunk.data = spareChunk ? spareChunk : AllocateChunk();
+        spareChunk = nullptr;
+        chunks.push_back(chunk);
+    }
+    Chunk& chunk = chunks.back();
+    ArchetypeLocation location{ static_cast<uint32_t>(chunks.size() - 1), chunk.count++ };
+    GetEntities(location.chunk)[location.row] = entity;
+    entityCount++;
+    return location;
+}
+
+Entity Archetype::RemoveRow(const ArchetypeLocation& location, bool destroyComponents) {
+    Chunk& chunk = chunks[location.chunk];
+    if (destroyComponents) {
+        for (size_t column = 0; column < types.size(); ++column) {
+            DestroyComponent(*infos[column], chunk.data + offsets[column] + infos[column]->size * location.row);
+        }
+    }
+
+    // The last row fills the hole, so the chunks stay packed
+    Chunk& last = chunks.back();
+    uint32_t lastRow = last.count - 1;
+    Entity moved = InvalidEntity;
+    if (&last != &chunk || lastRow != location.row) {
+        for (size_t column = 0; column < types.size(); ++column) {
+            size_t size = infos[column]->size;
+            RelocateComponent(*infos[column], chunk.data + offsets[column] + size * location.row,
+                              last.data + offsets[column] + size * lastRow);
+        }
+        moved = reinterpret_cast<Entity*>(last.data)[lastRow];
+        reinterpret_cast<Entity*>(chunk.data)[location.row] = moved;
+    }
+
+    last.count--;
+    entityCount--;
+    if (last.count == 0) {
+        if (spareChunk) FreeChunk(spareChunk);
+        spareChunk = last.data;
+        chunks.pop_back();
+    }
+    return moved;
+}
+
+Archetype* Archetype::GetAddEdge(ComponentTypeId type) const {
+    auto it = addEdges.find(type);
+    return it != addEdges.end() ? it->second : nullptr;
+}
+
+Archetype* Archetype::GetRemoveEdge(ComponentTypeId type) const {
+    auto it = removeEdges.find(type);
+    return it != removeEdges.end() ? it->second : nullptr;
+}
+
+std::byte* Archetype::AllocateChunk() {
+    return static_cast<std::byte*>(::operator new(chunkBytes, std::align_val_t(chunkAlignment)));
+}
+
+void Archetype::FreeChunk(std::byte* data) {
+    ::operator delete(data, std::align_val_t(chunkAlignment));
+}
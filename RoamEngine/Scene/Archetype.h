@@ -0,0 +1,94 @@
+// Archetype.h - The filing cabinet
+// Every entity with exactly the same set of components, packed column by column into fixed-size chunks
+
+#ifndef ARCHETYPE_H
+#define ARCHETYPE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+
+// Where an entity's row is
+struct ArchetypeLocation {
+    uint32_t chunk = 0;
+    uint32_t row = 0;
+};
+
+// The Archetype class - storage for one combination of components. Each chunk is one allocation
+// holding a column of entity handles and then a column per component, so a system walking two
+// components reads two dense arrays and nothing else. Rows are kept packed: every chunk is full
+// except the last, and removing a row moves the very last one into the hole. Owned and changed by
+// EntityWorld only; anyone can read the columns.
+class Archetype {
+public:
+    static constexpr size_t ChunkBytes = 16 * 1024; // fits L1 with room to spare, holds plenty of rows
+    static constexpr size_t ChunkAlignment = 64;    // columns start on cache lines
+
+    explicit Archetype(const ComponentMask& mask);
+    ~Archetype(); // destroys every component still stored
+
+    const ComponentMask& GetMask() const { return mask; }
+    const std::vector<ComponentTypeId>& GetTypes() const { return types; }
+    bool HasComponent(ComponentTypeId type) const { return type < MaxComponentTypes && columns[type] >= 0; }
+
+    // Chunks
+    size_t GetChunkCount() const { return chunks.size(); }
+    uint32_t GetChunkCapacity() const { return chunkCapacity; }
+    uint32_t GetChunkSize(size_t chunk) const { return chunks[chunk].count; }
+    size_t GetEntityCount() const { return entityCount; }
+
+    // Columns - null if the component isn't in this archetype
+    Entity* GetEntities(size_t chunk) const { return reinterpret_cast<Entity*>(chunks[chunk].data); }
+    void* GetColumn(size_t chunk, ComponentTypeId type) const;
+    template<typename T>
+    T* GetColumn(size_t chunk) const { return static_cast<T*>(GetColumn(chunk, ComponentRegistry::GetId<std::remove_const_t<T>>())); }
+    void* GetComponent(const ArchetypeLocation& location, ComponentTypeId type) const;
+
+    // Rows - for EntityWorld. Allocate leaves the components unconstructed. RemoveRow fills the hole
+    // from the end and returns whoever was moved (InvalidEntity if nobody); with destroyComponents
+    // false the caller has already moved or destroyed the row's components.
+    ArchetypeLocation Allocate(Entity entity);
+    Entity RemoveRow(const ArchetypeLocation& location, bool destroyComponents);
+    void Clear();
+
+    // Cached neighbours - the archetype with one more or one fewer component
+    Archetype* GetAddEdge(ComponentTypeId type) const;
+    Archetype* GetRemoveEdge(ComponentTypeId type) const;
+    void SetAddEdge(ComponentTypeId type, Archetype* archetype) { addEdges[type] = archetype; }
+    void SetRemoveEdge(ComponentTypeId type, Archetype* archetype) { removeEdges[type] = archetype; }
+
+private:
+    // Prevent copying - chunks are owned
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    struct Chunk {
+        std::byte* data = nullptr;
+        uint32_t count = 0;
+    };
+
+    std::byte* AllocateChunk();
+    void FreeChunk(std::byte* data);
+
+    ComponentMask mask;
+    std::vector<ComponentTypeId> types;        // ascending
+    std::vector<const ComponentInfo*> infos;   // same order as types
+    std::vector<size_t> offsets;               // byte offset of each column in a chunk
+    std::array<int16_t, MaxComponentTypes> columns; // type -> index into types, -1 if absent
+    size_t chunkBytes;
+    size_t chunkAlignment;
+    uint32_t chunkCapacity;
+
+    std::vector<Chunk> chunks;
+    std::byte* spareChunk; // the last one emptied - kept so an entity bouncing on a chunk boundary doesn't allocate
+    size_t entityCount;
+
+    std::unordered_map<ComponentTypeId, Archetype*> addEdges;
+    std::unordered_map<ComponentTypeId, Archetype*> removeEdges;
+};
+
+#endif // ARCHETYPE_H
@@ -0,0 +1,26 @@
+// Component.cpp - Implementation of the parts bin
+// Handing out numbers - rare, so a lock is fine
+
+#include "Component.h"
+#include <atomic>
+#include <mutex>
+
+namespace {
+    std::mutex registryMutex;
+    std::atomic<size_t> registeredCount{ 0 };
+}
+
+ComponentInfo ComponentRegistry::infos[MaxComponentTypes];
+
+ComponentTypeId ComponentRegistry::Register(const ComponentInfo& info) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t id = registeredCount.load(std::memory_order_relaxed);
+    if (id >= MaxComponentTypes) return InvalidComponentTypeId;
+    infos[id] = info;
+    registeredCount.store(id + 1, std::memory_order_release);
+    return static_cast<ComponentTypeId>(id);
+}
+
+size_t ComponentRegistry::GetCount() {
+    return registeredCount.load(std::memory_order_acquire);
+}
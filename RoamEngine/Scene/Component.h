@@ -0,0 +1,84 @@
+// Component.h - The parts bin
+// Gives every component type a small number and remembers how to move and destroy one
+
+#ifndef COMPONENT_H
+#define COMPONENT_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+using ComponentTypeId = uint32_t;
+constexpr ComponentTypeId InvalidComponentTypeId = UINT32_MAX;
+
+// Enough for a whole game - a type registered past this gets InvalidComponentTypeId, and anything
+// done with it fails
+constexpr size_t MaxComponentTypes = 128;
+using ComponentMask = std::bitset<MaxComponentTypes>;
+
+// How to handle a component without knowing its type - null functions mean memcpy will do, or
+// there's nothing to destroy
+struct ComponentInfo {
+    size_t size = 0;
+    size_t alignment = 1;
+    void (*relocate)(void* destination, void* source) = nullptr; // move-construct, then destroy the source
+    void (*destroy)(void* component) = nullptr;
+};
+
+// The ComponentRegistry class - a type is registered the first time anything asks for its id, from
+// any thread. Components can be any movable type; plain data is moved with memcpy.
+class ComponentRegistry {
+public:
+    template<typename T>
+    static ComponentTypeId GetId() {
+        static_assert(std::is_same_v<T, std::remove_cv_t<std::remove_reference_t<T>>>, "Ask for the plain component type");
+        static_assert(std::is_move_constructible_v<T>, "Components have to be movable - they change chunks");
+        static const ComponentTypeId id = Register(MakeInfo<T>());
+        return id;
+    }
+
+    static const ComponentInfo& GetInfo(ComponentTypeId id) { return infos[id]; }
+    static size_t GetCount();
+
+private:
+    template<typename T>
+    static ComponentInfo MakeInfo() {
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        if constexpr (!std::is_trivially_copyable_v<T>) {
+            info.relocate = [](void* destination, void* source) {
+                T* from = static_cast<T*>(source);
+                new (destination) T(std::move(*from));
+                from->~T();
+            };
+        }
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            info.destroy = [](void* component) { static_cast<T*>(component)->~T(); };
+        }
+        return info;
+    }
+
+    static ComponentTypeId Register(const ComponentInfo& info);
+
+    static ComponentInfo infos[MaxComponentTypes];
+};
+
+// Moving one component to uninitialized memory - the source is left destroyed
+inline void RelocateComponent(const ComponentInfo& info, void* destination, void* source) {
+    if (info.relocate) {
+        info.relocate(destination, source);
+    } else {
+        std::memcpy(destination, source, info.size);
+    }
+}
+
+inline void DestroyComponent(const ComponentInfo& info, void* component) {
+    if (info.destroy) info.destroy(component);
+}
+
+#endif // COMPONENT_H
@@ -0,0 +1,29 @@
+// Entity.h - The name tag
+// An entity is nothing but a number - its components live in the EntityWorld
+
+#ifndef ENTITY_H
+#define ENTITY_H
+
+#include <cstddef>
+#include <cstdint>
+
+// An entity handle - index into the world's records, plus a generation so a handle to a destroyed
+// entity doesn't quietly point at whatever reused its slot. Generation 0 is never alive.
+struct Entity {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+    bool operator==(const Entity& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+constexpr Entity InvalidEntity{};
+
+struct EntityHash {
+    size_t operator()(const Entity& entity) const {
+        return static_cast<size_t>((static_cast<uint64_t>(entity.generation) << 32 | entity.index) * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+#endif // ENTITY_H
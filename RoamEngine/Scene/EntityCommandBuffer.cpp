@@ -0,0 +1,118 @@
+// EntityCommandBuffer.cpp - Implementation of the to-do list
+// Commands in a vector, component values in a bump allocator beside them
+
+#include "EntityCommandBuffer.h"
+#include "Scene/EntityWorld.h"
+#include <algorithm>
+
+EntityCommandBuffer::EntityCommandBuffer() : blockUsed(0), blockSize(0), placeholders(0) {
+}
+
+EntityCommandBuffer::~EntityCommandBuffer() {
+    DestroyValues();
+}
+
+Entity EntityCommandBuffer::CreateEntity() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entity placeholder{ placeholders++, PlaceholderGeneration };
+    commands.push_back(Command{ CommandType::Create, InvalidComponentTypeId, placeholder, nullptr });
+    return placeholder;
+}
+
+void EntityCommandBuffer::DestroyEntity(Entity entity) {
+    Record(CommandType::Destroy, entity, InvalidComponentTypeId, nullptr);
+}
+
+void EntityCommandBuffer::Record(CommandType type, Entity entity, ComponentTypeId component, void* value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(Command{ type, component, entity, value });
+}
+
+bool EntityCommandBuffer::Playback(EntityWorld& world) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (world.IsIterating()) return false;
+
+    // Placeholders are numbered in the order they were made, so their real entities go in a vector
+    std::vector<Entity> created(placeholders, InvalidEntity);
+    auto resolve = [&](Entity entity) {
+        if (entity.generation != PlaceholderGeneration || !entity.IsValid()) return entity;
+        return entity.index < created.size() ? created[entity.index] : InvalidEntity;
+    };
+
+    bool allApplied = true;
+    for (Command& command : commands) {
+        Entity entity = resolve(command.entity);
+        switch (command.type) {
+        case CommandType::Create:
+            created[command.entity.index] = world.CreateEntity();
+            break;
+        case CommandType::Destroy:
+            allApplied = world.DestroyEntity(entity) && allApplied;
+            break;
+        case CommandType::Add:
+            if (world.AddComponent(entity, command.component, command.value)) {
+                command.value = nullptr;
+            } else {
+                allApplied = false;
+            }
+            break;
+        case CommandType::Remove:
+            allApplied = world.RemoveComponent(entity, command.component) && allApplied;
+            break;
+        }
+    }
+
+    DestroyValues();
+    commands.clear();
+    placeholders = 0;
+    // The last block is kept for next time - a buffer is usually refilled every frame
+    if (blocks.size() > 1) blocks.erase(blocks.begin(), blocks.end() - 1);
+    blockUsed = 0;
+    return allApplied;
+}
+
+void EntityCommandBuffer::Clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    DestroyValues();
+    commands.clear();
+    placeholders = 0;
+    blocks.clear();
+    blockUsed = 0;
+    blockSize = 0;
+}
+
+bool EntityCommandBuffer::IsEmpty() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commands.empty();
+}
+
+size_t EntityCommandBuffer::GetCommandCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return commands.size();
+}
+
+void* EntityCommandBuffer::Allocate(size_t size, size_t alignment) {
+    // Bump along the current block - values never move once placed, so anything can live here.
+    // Aligned by address, since the block itself may be less aligned than the value wants.
+    auto place = [&]() -> size_t {
+        uintptr_t base = reinterpret_cast<uintptr_t>(blocks.back().get());
+        return static_cast<size_t>(((base + blockUsed + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base);
+    };
+    if (blocks.empty() || place() + size > blockSize) {
+        blockSize = std::max(BlockBytes, size + alignment);
+        blocks.push_back(std::make_unique<std::byte[]>(blockSize));
+        blockUsed = 0;
+    }
+    size_t offset = place();
+    blockUsed = offset + size;
+    return blocks.back().get() + offset;
+}
+
+void EntityCommandBuffer::DestroyValues() {
+    for (Command& command : commands) {
+        if (command.type == CommandType::Add && command.value) {
+            DestroyComponent(ComponentRegistry::GetInfo(command.component), command.value);
+            command.value = nullptr;
+        }
+    }
+}
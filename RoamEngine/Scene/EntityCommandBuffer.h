@@ -0,0 +1,82 @@
+// EntityCommandBuffer.h - The to-do list
+// Structural changes written down during iteration and carried out once it's safe
+
+#ifndef ENTITYCOMMANDBUFFER_H
+#define ENTITYCOMMANDBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+
+class EntityWorld;
+
+// The EntityCommandBuffer class - records creates, destroys, adds and removes, and plays them back
+// in order on the main thread once nothing is iterating. Safe to record into from several jobs at
+// once (a ParallelForEach, say); the order between jobs is whatever order they got there in.
+// Components are moved into the buffer when recorded and moved again into the world on playback.
+class EntityCommandBuffer {
+public:
+    EntityCommandBuffer();
+    ~EntityCommandBuffer(); // destroys anything never played back
+
+    // A placeholder entity - usable in this buffer's other commands, becomes real on playback
+    Entity CreateEntity();
+    void DestroyEntity(Entity entity);
+    template<typename T>
+    void AddComponent(Entity entity, T component);
+    template<typename T>
+    void RemoveComponent(Entity entity) { Record(CommandType::Remove, entity, ComponentRegistry::GetId<T>(), nullptr); }
+
+    // Carry it all out, then empty the buffer. Commands aimed at entities that are gone by then are
+    // skipped. Returns false if any were, or if the world is mid-iteration (then nothing happens).
+    bool Playback(EntityWorld& world);
+
+    void Clear();
+    bool IsEmpty() const;
+    size_t GetCommandCount() const;
+
+private:
+    // Prevent copying - component values are owned
+    EntityCommandBuffer(const EntityCommandBuffer&) = delete;
+    EntityCommandBuffer& operator=(const EntityCommandBuffer&) = delete;
+
+    enum class CommandType : uint8_t { Create, Destroy, Add, Remove };
+
+    struct Command {
+        CommandType type;
+        ComponentTypeId component;
+        Entity entity;
+        void* value; // Add only - constructed in our blocks, null once it's been moved out
+    };
+
+    static constexpr uint32_t PlaceholderGeneration = 0; // never alive in a world
+    static constexpr size_t BlockBytes = 64 * 1024;
+
+    void Record(CommandType type, Entity entity, ComponentTypeId component, void* value);
+    void* Allocate(size_t size, size_t alignment); // call with the lock held
+    void DestroyValues();
+
+    mutable std::mutex mutex;
+    std::vector<Command> commands;
+    std::vector<std::unique_ptr<std::byte[]>> blocks; // never moved, so values can live in them
+    size_t blockUsed;
+    size_t blockSize;
+    uint32_t placeholders;
+};
+
+template<typename T>
+void EntityCommandBuffer::AddComponent(Entity entity, T component) {
+    ComponentTypeId type = ComponentRegistry::GetId<T>();
+    if (type == InvalidComponentTypeId) return; // too many component types - the world would refuse it anyway
+    std::lock_guard<std::mutex> lock(mutex);
+    void* value = new (Allocate(sizeof(T), alignof(T))) T(std::move(component));
+    commands.push_back(Command{ CommandType::Add, type, entity, value });
+}
+
+#endif // ENTITYCOMMANDBUFFER_H
@@ -0,0 +1,162 @@
+// EntityWorld.cpp - Implementation of the census office
+// Records point at rows, rows point back at entities - every move keeps both sides straight
+
+#include "EntityWorld.h"
+
+EntityWorld::EntityWorld() : entityCount(0), iterating(0), jobSystem(nullptr) {
+    FindOrCreateArchetype(ComponentMask()); // the empty archetype - where CreateEntity() puts things
+}
+
+EntityWorld::~EntityWorld() {
+}
+
+Entity EntityWorld::CreateEntity() {
+    if (iterating) return InvalidEntity;
+    return Spawn(FindOrCreateArchetype(ComponentMask()));
+}
+
+bool EntityWorld::DestroyEntity(Entity entity) {
+    if (iterating || !GetRecord(entity)) return false;
+    Record& record = records[entity.index];
+    Entity moved = record.archetype->RemoveRow(record.location, true);
+    if (moved.IsValid()) records[moved.index].location = record.location;
+
+    record.archetype = nullptr;
+    record.generation = record.generation == UINT32_MAX ? 1 : record.generation + 1;
+    freeRecords.push_back(entity.index);
+    entityCount--;
+    return true;
+}
+
+Archetype* EntityWorld::CreateEntities(const ComponentMask& mask, size_t count, Entity* entities) {
+    if (iterating) return nullptr;
+    Archetype* archetype = FindOrCreateArchetype(mask);
+    records.reserve(records.size() + (count > freeRecords.size() ? count - freeRecords.size() : 0));
+    for (size_t i = 0; i < count; ++i) entities[i] = Spawn(archetype);
+    return archetype;
+}
+
+bool EntityWorld::IsAlive(Entity entity) const {
+    return GetRecord(entity) != nullptr;
+}
+
+void* EntityWorld::AddComponent(Entity entity, ComponentTypeId type, void* value) {
+    void* slot = EmplaceComponent(entity, type);
+    if (slot) RelocateComponent(ComponentRegistry::GetInfo(type), slot, value);
+    return slot;
+}
+
+bool EntityWorld::RemoveComponent(Entity entity, ComponentTypeId type) {
+    const Record* record = GetRecord(entity);
+    if (iterating || !record || !record->archetype->HasComponent(type)) return false;
+    MoveEntity(entity, GetArchetypeWithout(record->archetype, type));
+    return true;
+}
+
+void* EntityWorld::GetComponent(Entity entity, ComponentTypeId type) const {
+    const Record* record = GetRecord(entity);
+    return record ? record->archetype->GetComponent(record->location, type) : nullptr;
+}
+
+void EntityWorld::Clear() {
+    if (iterating) return;
+    // The archetypes stay - queries hold on to them - just emptied
+    for (auto& archetype : archetypes) archetype->Clear();
+    freeRecords.clear();
+    for (uint32_t index = static_cast<uint32_t>(records.size()); index-- > 0;) {
+        Record& record = records[index];
+        if (record.archetype) {
+            record.archetype = nullptr;
+            record.generation = record.generation == UINT32_MAX ? 1 : record.generation + 1;
+        }
+        freeRecords.push_back(index);
+    }
+    entityCount = 0;
+}
+
+Entity EntityWorld::Spawn(Archetype* archetype) {
+    uint32_t index;
+    if (!freeRecords.empty()) {
+        index = freeRecords.back();
+        freeRecords.pop_back();
+    } else {
+        index = static_cast<uint32_t>(records.size());
+        records.emplace_back();
+    }
+    Record& record = records[index];
+    Entity entity{ index, record.generation };
+    record.archetype = archetype;
+    record.location = archetype->Allocate(entity);
+    entityCount++;
+    return entity;
+}
+
+void* EntityWorld::EmplaceComponent(Entity entity, ComponentTypeId type) {
+    const Record* record = GetRecord(entity);
+    if (iterating || !record || type >= MaxComponentTypes) return nullptr;
+
+    if (record->archetype->HasComponent(type)) {
+        void* slot = record->archetype->GetComponent(record->location, type);
+        DestroyComponent(ComponentRegistry::GetInfo(type), slot);
+        return slot;
+    }
+    MoveEntity(entity, GetArchetypeWith(record->archetype, type));
+    return record->archetype->GetComponent(record->location, type);
+}
+
+Archetype* EntityWorld::FindOrCreateArchetype(const ComponentMask& mask) {
+    auto it = archetypesByMask.find(mask);
+    if (it != archetypesByMask.end()) return it->second;
+    archetypes.push_back(std::make_unique<Archetype>(mask));
+    archetypesByMask.emplace(mask, archetypes.back().get());
+    return archetypes.back().get();
+}
+
+Archetype* EntityWorld::GetArchetypeWith(Archetype* from, ComponentTypeId type) {
+    if (Archetype* to = from->GetAddEdge(type)) return to;
+    ComponentMask mask = from->GetMask();
+    mask.set(type);
+    Archetype* to = FindOrCreateArchetype(mask);
+    from->SetAddEdge(type, to);
+    to->SetRemoveEdge(type, from);
+    return to;
+}
+
+Archetype* EntityWorld::GetArchetypeWithout(Archetype* from, ComponentTypeId type) {
+    if (Archetype* to = from->GetRemoveEdge(type)) return to;
+    ComponentMask mask = from->GetMask();
+    mask.reset(type);
+    Archetype* to = FindOrCreateArchetype(mask);
+    from->SetRemoveEdge(type, to);
+    to->SetAddEdge(type, from);
+    return to;
+}
+
+void EntityWorld::MoveEntity(Entity entity, Archetype* to) {
+    Record& record = records[entity.index];
+    Archetype* from = record.archetype;
+    ArchetypeLocation oldLocation = record.location;
+    ArchetypeLocation newLocation = to->Allocate(entity);
+
+    // Whatever both have moves across, whatever the new one lacks is destroyed
+    for (ComponentTypeId type : from->GetTypes()) {
+        const ComponentInfo& info = ComponentRegistry::GetInfo(type);
+        void* source = from->GetComponent(oldLocation, type);
+        if (to->HasComponent(type)) {
+            RelocateComponent(info, to->GetComponent(newLocation, type), source);
+        } else {
+            DestroyComponent(info, source);
+        }
+    }
+    Entity moved = from->RemoveRow(oldLocation, false);
+    if (moved.IsValid()) records[moved.index].location = oldLocation;
+
+    record.archetype = to;
+    record.location = newLocation;
+}
+
+const EntityWorld::Record* EntityWorld::GetRecord(Entity entity) const {
+    if (entity.index >= records.size()) return nullptr;
+    const Record& record = records[entity.index];
+    return record.archetype && record.generation == entity.generation ? &record : nullptr;
+}
@@ -0,0 +1,292 @@
+// EntityWorld.h - The census office
+// Every entity in a scene and every component they have, stored by archetype and walked by query
+
+#ifndef ENTITYWORLD_H
+#define ENTITYWORLD_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Core/ThreadManager.h"
+#include "Scene/Archetype.h"
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+
+template<typename... Components>
+class EntityQuery;
+
+// The EntityWorld class - entities are handles, components are plain structs stored per archetype in
+// packed chunks (see Archetype). Adding or removing a component moves the entity to the archetype
+// for its new set, so those are the expensive calls; reading and writing components in place is cheap.
+// Structural changes - create, destroy, add, remove - are main thread only and fail while a query is
+// iterating; record them in an EntityCommandBuffer instead and play it back afterwards.
+class EntityWorld {
+public:
+    EntityWorld();
+    ~EntityWorld();
+
+    // Job system - ParallelForEach spreads chunks over it; without one it runs inline
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+    ThreadManager* GetJobSystem() const { return jobSystem; }
+
+    // Entities
+    Entity CreateEntity();
+    template<typename... Components>
+    Entity CreateEntity(Components&&... components);
+    bool DestroyEntity(Entity entity);
+    bool IsAlive(Entity entity) const;
+
+    // Bulk creation for loaders - count entities with exactly the components in mask, handles written
+    // to entities. They're the last count rows of the returned archetype and their components are
+    // left unconstructed: construct every one, through the archetype's columns, before anything else
+    // touches the world. Null while iterating.
+    Archetype* CreateEntities(const ComponentMask& mask, size_t count, Entity* entities);
+    size_t GetEntityCount() const { return entityCount; }
+
+    // Components - AddComponent replaces one that's already there. Pointers are good until the next
+    // structural change to any entity in the same archetype.
+    template<typename T>
+    T* AddComponent(Entity entity, T component);
+    template<typename T>
+    bool RemoveComponent(Entity entity) { return RemoveComponent(entity, ComponentRegistry::GetId<T>()); }
+    template<typename T>
+    T* GetComponent(Entity entity) const { return static_cast<T*>(GetComponent(entity, ComponentRegistry::GetId<std::remove_const_t<T>>())); }
+    template<typename T>
+    bool HasComponent(Entity entity) const { return GetComponent<T>(entity) != nullptr; }
+
+    // The same, by id - for code that doesn't know the type. AddComponent moves from value and
+    // destroys it on success, and leaves it alone on failure.
+    void* AddComponent(Entity entity, ComponentTypeId type, void* value);
+    bool RemoveComponent(Entity entity, ComponentTypeId type);
+    void* GetComponent(Entity entity, ComponentTypeId type) const;
+
+    // Queries - EntityQuery<Position, const Velocity> visits every entity with both. Marking a
+    // component const says the system only reads it.
+    template<typename... Components>
+    EntityQuery<Components...> Query() { return EntityQuery<Components...>(*this); }
+    template<typename... Components, typename Function>
+    void ForEach(Function&& function) { Query<Components...>().ForEach(std::forward<Function>(function)); }
+    template<typename... Components, typename Function>
+    void ParallelForEach(Function&& function) { Query<Components...>().ParallelForEach(std::forward<Function>(function)); }
+
+    // Archetypes - only ever added to, so an index stays good
+    size_t GetArchetypeCount() const { return archetypes.size(); }
+    const Archetype& GetArchetype(size_t index) const { return *archetypes[index]; }
+    bool IsIterating() const { return iterating != 0; }
+
+    // Destroy everything
+    void Clear();
+
+private:
+    template<typename... Components>
+    friend class EntityQuery;
+
+    // Prevent copying - handles and component pointers point in here
+    EntityWorld(const EntityWorld&) = delete;
+    EntityWorld& operator=(const EntityWorld&) = delete;
+
+    struct Record {
+        Archetype* archetype = nullptr; // null for a free slot
+        ArchetypeLocation location;
+        uint32_t generation = 1;
+    };
+
+    Entity Spawn(Archetype* archetype);
+    void* EmplaceComponent(Entity entity, ComponentTypeId type); // room for it, unconstructed - null on failure
+    Archetype* FindOrCreateArchetype(const ComponentMask& mask);
+    Archetype* GetArchetypeWith(Archetype* from, ComponentTypeId type);
+    Archetype* GetArchetypeWithout(Archetype* from, ComponentTypeId type);
+    void MoveEntity(Entity entity, Archetype* to);
+    const Record* GetRecord(Entity entity) const;
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> archetypesByMask;
+    std::vector<Record> records;
+    std::vector<uint32_t> freeRecords;
+    size_t entityCount;
+    uint32_t iterating;
+    ThreadManager* jobSystem;
+};
+
+// The EntityQuery class - a typed view over every archetype that has all of Components and none of
+// the excluded ones. The matching archetypes are cached and topped up as new ones appear, so keep a
+// query around in a system rather than making one per frame. Functions take the components by
+// reference, optionally after the Entity:
+//
+//   world.Query<Position, const Velocity>().ForEach([&](Position& p, const Velocity& v) { p += v * dt; });
+//
+template<typename... Components>
+class EntityQuery {
+public:
+    explicit EntityQuery(EntityWorld& world);
+
+    // Skip entities that have any of these
+    template<typename... Excluded>
+    EntityQuery& Without();
+
+    // Every entity, on this thread
+    template<typename Function>
+    void ForEach(Function&& function);
+
+    // Every chunk, on this thread - function(count, entities, column pointers...)
+    template<typename Function>
+    void ForEachChunk(Function&& function);
+
+    // Every entity, chunks spread over the job system - the function has to be safe to run on
+    // several chunks at once, and structural changes go through an EntityCommandBuffer
+    template<typename Function>
+    void ParallelForEach(Function&& function);
+
+    size_t Count();
+    const std::vector<Archetype*>& GetArchetypes() { Refresh(); return matches; }
+
+private:
+    void Refresh();
+    template<typename Function>
+    void RunChunk(Archetype& archetype, size_t chunk, Function& function);
+
+    EntityWorld& world;
+    ComponentMask required;
+    ComponentMask excluded;
+    bool valid; // false if a component type couldn't be registered - then nothing matches
+    std::vector<Archetype*> matches;
+    size_t archetypesSeen;
+};
+
+// Templates
+
+template<typename... Components>
+Entity EntityWorld::CreateEntity(Components&&... components) {
+    if (iterating) return InvalidEntity;
+    std::array<ComponentTypeId, sizeof...(Components)> types{ ComponentRegistry::GetId<std::decay_t<Components>>()... };
+    ComponentMask mask;
+    for (ComponentTypeId type : types) {
+        if (type == InvalidComponentTypeId || mask.test(type)) return InvalidEntity; // unregistered, or the same type twice
+        mask.set(type);
+    }
+
+    Archetype* archetype = FindOrCreateArchetype(mask);
+    Entity entity = Spawn(archetype);
+    const ArchetypeLocation& location = records[entity.index].location;
+    (new (archetype->GetComponent(location, ComponentRegistry::GetId<std::decay_t<Components>>()))
+        std::decay_t<Components>(std::forward<Components>(components)), ...);
+    return entity;
+}
+
+template<typename T>
+T* EntityWorld::AddComponent(Entity entity, T component) {
+    void* slot = EmplaceComponent(entity, ComponentRegistry::GetId<T>());
+    return slot ? new (slot) T(std::move(component)) : nullptr;
+}
+
+template<typename... Components>
+EntityQuery<Components...>::EntityQuery(EntityWorld& world) : world(world), valid(true), archetypesSeen(0) {
+    std::array<ComponentTypeId, sizeof...(Components)> types{ ComponentRegistry::GetId<std::remove_const_t<Components>>()... };
+    for (ComponentTypeId type : types) {
+        if (type == InvalidComponentTypeId) valid = false;
+        else required.set(type);
+    }
+}
+
+template<typename... Components>
+template<typename... Excluded>
+EntityQuery<Components...>& EntityQuery<Components...>::Without() {
+    std::array<ComponentTypeId, sizeof...(Excluded)> types{ ComponentRegistry::GetId<std::remove_const_t<Excluded>>()... };
+    for (ComponentTypeId type : types) {
+        if (type != InvalidComponentTypeId) excluded.set(type);
+    }
+    matches.clear();
+    archetypesSeen = 0;
+    return *this;
+}
+
+template<typename... Components>
+void EntityQuery<Components...>::Refresh() {
+    if (!valid) return;
+    for (; archetypesSeen < world.archetypes.size(); ++archetypesSeen) {
+        Archetype* archetype = world.archetypes[archetypesSeen].get();
+        const ComponentMask& mask = archetype->GetMask();
+        if ((mask & required) == required && (mask & excluded).none()) matches.push_back(archetype);
+    }
+}
+
+template<typename... Components>
+template<typename Function>
+void EntityQuery<Components...>::RunChunk(Archetype& archetype, size_t chunk, Function& function) {
+    uint32_t count = archetype.GetChunkSize(chunk);
+    const Entity* entities = archetype.GetEntities(chunk);
+    std::tuple<Components*...> columns{ archetype.template GetColumn<Components>(chunk)... };
+    std::apply([&](Components*... column) {
+        if constexpr (std::is_invocable_v<Function&, Entity, Components&...>) {
+            for (uint32_t row = 0; row < count; ++row) function(entities[row], column[row]...);
+        } else {
+            for (uint32_t row = 0; row < count; ++row) function(column[row]...);
+        }
+    }, columns);
+}
+
+template<typename... Components>
+template<typename Function>
+void EntityQuery<Components...>::ForEach(Function&& function) {
+    Refresh();
+    world.iterating++;
+    for (Archetype* archetype : matches) {
+        for (size_t chunk = 0; chunk < archetype->GetChunkCount(); ++chunk) RunChunk(*archetype, chunk, function);
+    }
+    world.iterating--;
+}
+
+template<typename... Components>
+template<typename Function>
+void EntityQuery<Components...>::ForEachChunk(Function&& function) {
+    Refresh();
+    world.iterating++;
+    for (Archetype* archetype : matches) {
+        for (size_t chunk = 0; chunk < archetype->GetChunkCount(); ++chunk) {
+            function(static_cast<size_t>(archetype->GetChunkSize(chunk)), static_cast<const Entity*>(archetype->GetEntities(chunk)),
+                     archetype->template GetColumn<Components>(chunk)...);
+        }
+    }
+    world.iterating--;
+}
+
+template<typename... Components>
+template<typename Function>
+void EntityQuery<Components...>::ParallelForEach(Function&& function) {
+    ThreadManager* jobSystem = world.jobSystem;
+    if (!jobSystem || !jobSystem->IsInitialized()) {
+        ForEach(function);
+        return;
+    }
+
+    // A few jobs per thread, each a run of whole chunks - enough to balance uneven chunks without
+    // paying for a job per chunk
+    Refresh();
+    std::vector<std::pair<Archetype*, size_t>> work;
+    for (Archetype* archetype : matches) {
+        for (size_t chunk = 0; chunk < archetype->GetChunkCount(); ++chunk) work.emplace_back(archetype, chunk);
+    }
+    world.iterating++;
+    size_t grain = std::max<size_t>(1, work.size() / ((jobSystem->GetWorkerCount() + 1) * 4));
+    jobSystem->ParallelFor(work.size(), grain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) RunChunk(*work[i].first, work[i].second, function);
+    });
+    world.iterating--;
+}
+
+template<typename... Components>
+size_t EntityQuery<Components...>::Count() {
+    Refresh();
+    size_t count = 0;
+    for (Archetype* archetype : matches) count += archetype->GetEntityCount();
+    return count;
+}
+
+#endif // ENTITYWORLD_H
@@ -0,0 +1,173 @@
+// SceneSerializer.cpp - Implementation of the photo album
+// Columns out, columns in - the format is the storage, near enough
+
+#include "SceneSerializer.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include "Scene/EntityWorld.h"
+
+SceneSerializer::SceneSerializer() {
+}
+
+SceneSerializer::~SceneSerializer() {
+}
+
+bool SceneSerializer::Save(const EntityWorld& world, BinaryWriter& writer, std::vector<Entity>* saved) const {
+    if (world.IsIterating()) return false;
+
+    // Header - the versions of everything that follows, then the component names
+    SchemaTable schema;
+    for (const ComponentSerializer& component : components) component.describe(schema);
+    writer.Write(Magic);
+    writer.Write(FormatVersion);
+    schema.Write(writer);
+    writer.Write(static_cast<uint32_t>(components.size()));
+    for (const ComponentSerializer& component : components) writer.WriteString(component.name);
+
+    // Archetypes - which components, how many entities, then each component's column with its
+    // length up front so a loader that doesn't know it can step over it
+    size_t countOffset = writer.GetSize();
+    writer.Write(static_cast<uint32_t>(0));
+    uint32_t archetypeCount = 0;
+    std::vector<uint32_t> present;
+    for (size_t a = 0; a < world.GetArchetypeCount(); ++a) {
+        const Archetype& archetype = world.GetArchetype(a);
+        if (archetype.GetEntityCount() == 0) continue;
+        present.clear();
+        for (ComponentTypeId type : archetype.GetTypes()) {
+            auto it = byType.find(type);
+            if (it != byType.end()) present.push_back(static_cast<uint32_t>(it->second));
+        }
+        if (present.empty()) continue; // nothing here we know how to save
+
+        writer.Write(static_cast<uint32_t>(present.size()));
+        for (uint32_t index : present) writer.Write(index);
+        writer.Write(static_cast<uint32_t>(archetype.GetEntityCount()));
+        if (saved) {
+            for (size_t chunk = 0; chunk < archetype.GetChunkCount(); ++chunk) {
+                const Entity* entities = archetype.GetEntities(chunk);
+                saved->insert(saved->end(), entities, entities + archetype.GetChunkSize(chunk));
+            }
+        }
+
+        for (uint32_t index : present) {
+            const ComponentSerializer& component = components[index];
+            size_t sizeOffset = writer.GetSize();
+            writer.Write(static_cast<uint64_t>(0));
+            for (size_t chunk = 0; chunk < archetype.GetChunkCount(); ++chunk) {
+                component.write(writer, archetype.GetColumn(chunk, component.type), archetype.GetChunkSize(chunk));
+            }
+            writer.Patch(sizeOffset, static_cast<uint64_t>(writer.GetSize() - sizeOffset - sizeof(uint64_t)));
+        }
+        archetypeCount++;
+    }
+    writer.Patch(countOffset, archetypeCount);
+    return true;
+}
+
+bool SceneSerializer::Load(EntityWorld& world, BinaryReader& reader, std::vector<Entity>* loaded) const {
+    if (world.IsIterating()) return false;
+    if (reader.Read<uint32_t>() != Magic || reader.Read<uint32_t>() != FormatVersion) return false;
+    SchemaTable schema;
+    if (!schema.Read(reader)) return false;
+
+    // The file's components, matched to ours by name - null for ones we don't have
+    uint32_t nameCount = reader.Read<uint32_t>();
+    if (!reader.IsOk() || nameCount > reader.GetRemaining() / sizeof(uint32_t)) return false;
+    std::vector<const ComponentSerializer*> fileComponents(nameCount, nullptr);
+    for (uint32_t i = 0; i < nameCount; ++i) {
+        auto it = byName.find(reader.ReadString());
+        if (it != byName.end()) fileComponents[i] = &components[it->second];
+    }
+
+    std::vector<Entity> created;
+    std::vector<uint32_t> indices;
+    uint32_t archetypeCount = reader.Read<uint32_t>();
+    bool ok = reader.IsOk();
+    for (uint32_t a = 0; a < archetypeCount && ok; ++a) {
+        uint32_t present = reader.Read<uint32_t>();
+        if (!reader.IsOk() || present == 0 || present > nameCount) { ok = false; break; }
+        indices.resize(present);
+        ComponentMask mask;
+        for (uint32_t& index : indices) {
+            index = reader.Read<uint32_t>();
+            if (index >= nameCount) { ok = false; break; }
+            if (const ComponentSerializer* component = fileComponents[index]) {
+                if (mask.test(component->type)) { ok = false; break; } // listed twice
+                mask.set(component->type);
+            }
+        }
+        uint32_t entityCount = reader.Read<uint32_t>();
+        if (!ok || !reader.IsOk() || entityCount > reader.GetRemaining()) { ok = false; break; }
+
+        // Nothing we know - step over the lot
+        if (mask.none()) {
+            for (size_t i = 0; i < indices.size() && ok; ++i) ok = reader.Skip(static_cast<size_t>(reader.Read<uint64_t>()));
+            continue;
+        }
+
+        // All the entities at once, then each column straight into the chunks they landed in. Every
+        // component gets constructed whatever happens, so a failed load can destroy them cleanly.
+        size_t first = created.size();
+        created.resize(first + entityCount);
+        Archetype* archetype = world.CreateEntities(mask, entityCount, created.data() + first);
+        if (!archetype) { created.resize(first); ok = false; break; }
+        size_t capacity = archetype->GetChunkCapacity();
+        size_t startRow = archetype->GetEntityCount() - entityCount;
+        auto forEachSegment = [&](ComponentTypeId type, auto&& function) {
+            size_t componentSize = ComponentRegistry::GetInfo(type).size;
+            for (size_t row = startRow; row < startRow + entityCount;) {
+                size_t chunk = row / capacity;
+                size_t offset = row % capacity;
+                size_t count = std::min(capacity - offset, startRow + entityCount - row);
+                function(static_cast<std::byte*>(archetype->GetColumn(chunk, type)) + offset * componentSize, count);
+                row += count;
+            }
+        };
+
+        for (uint32_t index : indices) {
+            const ComponentSerializer* component = fileComponents[index];
+            uint64_t size = reader.Read<uint64_t>();
+            if (!component) {
+                ok = ok && reader.Skip(static_cast<size_t>(size));
+                continue;
+            }
+            const std::byte* bytes = ok && size <= reader.GetRemaining() ? reader.Take(static_cast<size_t>(size)) : nullptr;
+            BinaryReader column(bytes, bytes ? static_cast<size_t>(size) : 0);
+            bool columnOk = bytes != nullptr;
+            forEachSegment(component->type, [&](void* rows, size_t count) {
+                if (columnOk) {
+                    columnOk = component->read(column, rows, count, schema);
+                } else {
+                    component->construct(rows, count);
+                }
+            });
+            ok = ok && columnOk && column.GetRemaining() == 0;
+        }
+    }
+
+    if (!ok || !reader.IsOk()) {
+        for (Entity entity : created) world.DestroyEntity(entity);
+        return false;
+    }
+    if (loaded) loaded->insert(loaded->end(), created.begin(), created.end());
+    return true;
+}
+
+bool SceneSerializer::SaveFile(const EntityWorld& world, const std::string& path, std::vector<Entity>* saved) const {
+    BinaryWriter writer;
+    if (!Save(world, writer, saved)) return false;
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(writer.GetData()), static_cast<std::streamsize>(writer.GetSize()));
+    return static_cast<bool>(file);
+}
+
+bool SceneSerializer::LoadFile(EntityWorld& world, const std::string& path, std::vector<Entity>* loaded) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (file.bad()) return false;
+    BinaryReader reader(data.data(), data.size());
+    return Load(world, reader, loaded);
+}
@@ -0,0 +1,110 @@
+// SceneSerializer.h - The photo album
+// A whole EntityWorld to bytes and back, one archetype column at a time
+
+#ifndef SCENESERIALIZER_H
+#define SCENESERIALIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include "Core/BinaryStream.h"
+#include "Core/Reflection.h"
+#include "Core/Serializer.h"
+#include "Scene/Component.h"
+#include "Scene/Entity.h"
+
+class EntityWorld;
+
+// The SceneSerializer class - saves the registered components of every entity in a world. Data goes
+// out the way the world stores it: per archetype, then per component, then every row, so a block
+// component (see Serializer) is one memcpy per chunk each way and loading makes each archetype's
+// entities in one go. Components are found by their reflected name, so the set of registered
+// components can change between saving and loading - ones the loader doesn't know are skipped, and
+// entities left with none it knows aren't created. Entity handles aren't saved; Save and Load both
+// list the entities in file order, for anything that needs to remap references.
+class SceneSerializer {
+public:
+    SceneSerializer();
+    ~SceneSerializer();
+
+    // Components to save - reflected, default-constructible. False if the component registry is
+    // full or the name is taken.
+    template<Reflected T>
+    bool RegisterComponent();
+
+    // Save appends to writer. Load adds to whatever the world already holds; on failure it adds
+    // nothing. Both fail while the world is iterating.
+    bool Save(const EntityWorld& world, BinaryWriter& writer, std::vector<Entity>* saved = nullptr) const;
+    bool Load(EntityWorld& world, BinaryReader& reader, std::vector<Entity>* loaded = nullptr) const;
+
+    bool SaveFile(const EntityWorld& world, const std::string& path, std::vector<Entity>* saved = nullptr) const;
+    bool LoadFile(EntityWorld& world, const std::string& path, std::vector<Entity>* loaded = nullptr) const;
+
+private:
+    // Prevent copying - nothing to gain from two
+    SceneSerializer(const SceneSerializer&) = delete;
+    SceneSerializer& operator=(const SceneSerializer&) = delete;
+
+    static constexpr uint32_t Magic = 0x4E435352; // "RSCN"
+    static constexpr uint32_t FormatVersion = 1;
+
+    // One registered component, type-erased. Read and construct work on unconstructed rows and
+    // leave them all constructed, whatever happens.
+    struct ComponentSerializer {
+        std::string_view name;
+        ComponentTypeId type;
+        void (*describe)(SchemaTable& schema);
+        void (*write)(BinaryWriter& writer, const void* values, size_t count);
+        bool (*read)(BinaryReader& reader, void* values, size_t count, const SchemaTable& schema);
+        void (*construct)(void* values, size_t count);
+    };
+
+    std::vector<ComponentSerializer> components;
+    std::unordered_map<ComponentTypeId, size_t> byType;
+    std::unordered_map<std::string_view, size_t> byName;
+};
+
+template<Reflected T>
+bool SceneSerializer::RegisterComponent() {
+    static_assert(std::is_default_constructible_v<T>, "Loaded components start out default-constructed");
+    ComponentTypeId type = ComponentRegistry::GetId<T>();
+    if (type == InvalidComponentTypeId || byName.count(Reflect<T>::Name) || byType.count(type)) return false;
+
+    ComponentSerializer component;
+    component.name = Reflect<T>::Name;
+    component.type = type;
+    component.describe = [](SchemaTable& schema) { schema.Add<T>(); };
+    component.write = [](BinaryWriter& writer, const void* values, size_t count) {
+        Serializer::WriteArray(writer, static_cast<const T*>(values), count);
+    };
+    component.read = [](BinaryReader& reader, void* values, size_t count, const SchemaTable& schema) {
+        T* rows = static_cast<T*>(values);
+        if (Serializer::IsBlock<T>() && Serializer::IsCurrent<T>(&schema)) {
+            return reader.ReadBytes(rows, count * sizeof(T)); // trivially copyable - the bytes are the objects, zeros if it fails
+        }
+        size_t done = 0;
+        bool ok = true;
+        for (; done < count && ok; ++done) {
+            new (rows + done) T();
+            ok = Serializer::Read(reader, rows[done], &schema);
+        }
+        for (; done < count; ++done) new (rows + done) T();
+        return ok;
+    };
+    component.construct = [](void* values, size_t count) {
+        T* rows = static_cast<T*>(values);
+        for (size_t i = 0; i < count; ++i) new (rows + i) T();
+    };
+
+    byType.emplace(type, components.size());
+    byName.emplace(component.name, components.size());
+    components.push_back(component);
+    return true;
+}
+
+#endif // SCENESERIALIZER_H
@@ -0,0 +1,449 @@
+// SpatialIndex.cpp - Implementation of the map of where everything is
+// Boxes in boxes in boxes - every query throws away whole branches at a time
+
+#include "SpatialIndex.h"
+#include <algorithm>
+
+namespace {
+    // Keep the closest capacity hits, sorted - capacity is small, so shuffling up is cheapest
+    void InsertHit(SpatialHit* hits, size_t& count, size_t capacity, SpatialProxyId proxy, float distance) {
+        size_t position = count < capacity ? count++ : capacity - 1;
+        while (position > 0 && hits[position - 1].distance > distance) {
+            hits[position] = hits[position - 1];
+            position--;
+        }
+        hits[position] = SpatialHit{ proxy, distance };
+    }
+
+    // Past this, anything further away can't make the list
+    float GetLimit(const SpatialHit* hits, size_t count, size_t capacity, float limit) {
+        return count == capacity ? std::min(limit, hits[count - 1].distance) : limit;
+    }
+}
+
+SpatialIndex::SpatialIndex() : SpatialIndex(SpatialIndexSettings()) {
+}
+
+SpatialIndex::SpatialIndex(const SpatialIndexSettings& settings)
+    : settings(settings), root(None), freeList(None), proxyCount(0), moves(0), refits(0), reinserts(0), rotations(0) {
+}
+
+SpatialIndex::~SpatialIndex() {
+}
+
+SpatialProxyId SpatialIndex::CreateProxy(const Aabb& bounds, uint32_t layers, uint64_t userData) {
+    uint32_t leaf = AllocateNode();
+    Node& node = nodes[leaf];
+    node.bounds = bounds;
+    node.box = Fatten(bounds, Vector3());
+    node.height = 0;
+    node.layers = layers;
+    node.userData = userData;
+    InsertLeaf(leaf);
+    proxyCount++;
+    return leaf;
+}
+
+void SpatialIndex::DestroyProxy(SpatialProxyId proxy) {
+    if (!IsValid(proxy)) return;
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    proxyCount--;
+}
+
+bool SpatialIndex::MoveProxy(SpatialProxyId proxy, const Aabb& bounds, const Vector3& displacement) {
+    if (!IsValid(proxy)) return false;
+    moves++;
+    nodes[proxy].bounds = bounds;
+
+    // Still inside the fat box, and the fat box hasn't ended up far too big for it - nothing to do
+    Aabb fat = Fatten(bounds, displacement);
+    Aabb huge = fat.Expanded(Vector3(4.0f * settings.margin));
+    if (nodes[proxy].box.Contains(bounds) && huge.Contains(nodes[proxy].box)) return false;
+
+    // Still inside the parent - every box above already covers it, so only the leaf changes
+    uint32_t parent = nodes[proxy].parent;
+    if (parent != None && nodes[parent].box.Contains(fat)) {
+        nodes[proxy].box = fat;
+        refits++;
+        return true;
+    }
+
+    RemoveLeaf(proxy);
+    nodes[proxy].box = fat;
+    InsertLeaf(proxy);
+    reinserts++;
+    return true;
+}
+
+void SpatialIndex::SetLayers(SpatialProxyId proxy, uint32_t layers) {
+    if (!IsValid(proxy) || nodes[proxy].layers == layers) return;
+    nodes[proxy].layers = layers;
+    for (uint32_t node = nodes[proxy].parent; node != None; node = nodes[node].parent) {
+        nodes[node].layers = nodes[nodes[node].child1].layers | nodes[nodes[node].child2].layers;
+    }
+}
+
+uint32_t SpatialIndex::GetLayers(SpatialProxyId proxy) const {
+    return IsValid(proxy) ? nodes[proxy].layers : 0;
+}
+
+uint64_t SpatialIndex::GetUserData(SpatialProxyId proxy) const {
+    return IsValid(proxy) ? nodes[proxy].userData : 0;
+}
+
+const Aabb& SpatialIndex::GetBounds(SpatialProxyId proxy) const {
+    static const Aabb empty;
+    return IsValid(proxy) ? nodes[proxy].bounds : empty;
+}
+
+bool SpatialIndex::IsValid(SpatialProxyId proxy) const {
+    return proxy < nodes.size() && nodes[proxy].height == 0;
+}
+
+void SpatialIndex::Clear() {
+    nodes.clear();
+    root = None;
+    freeList = None;
+    proxyCount = 0;
+}
+
+size_t SpatialIndex::QueryAabb(const Aabb& box, SpatialProxyId* results, size_t capacity, uint32_t layers) const {
+    if (root == None) return 0;
+    uint32_t stack[StackSize];
+    size_t top = 0;
+    size_t found = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (!(node.layers & layers) || !node.box.Overlaps(box)) continue;
+        if (node.IsLeaf()) {
+            if (!node.bounds.Overlaps(box)) continue;
+            if (found < capacity) results[found] = index;
+            found++;
+        } else if (top + 2 <= StackSize) {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+    return found;
+}
+
+size_t SpatialIndex::QuerySphere(const Vector3& center, float radius, SpatialProxyId* results, size_t capacity, uint32_t layers) const {
+    if (root == None) return 0;
+    float radiusSquared = radius * radius;
+    uint32_t stack[StackSize];
+    size_t top = 0;
+    size_t found = 0;
+    stack[top++] = root;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const Node& node = nodes[index];
+        if (!(node.layers & layers) || node.box.DistanceSquared(center) > radiusSquared) continue;
+        if (node.IsLeaf()) {
+            if (node.bounds.DistanceSquared(center) > radiusSquared) continue;
+            if (found < capacity) results[found] = index;
+            found++;
+        } else if (top + 2 <= StackSize) {
+            stack[top++] = node.child1;
+            stack[top++] = node.child2;
+        }
+    }
+    return found;
+}
+
+size_t SpatialIndex::QueryFrustum(const Frustum& frustum, SpatialProxyId* results, size_t capacity, uint32_t layers) const {
+    if (root == None) return 0;
+
+    // Each entry carries the planes its box still straddles - once a box is inside a plane, nothing
+    // under it needs testing against that plane again, and once it's inside all six its leaves are
+    // simply collected
+    struct Entry { uint32_t node; uint32_t planes; };
+    constexpr uint32_t AllPlanes = (1u << Frustum::SideCount) - 1;
+    Entry stack[StackSize];
+    size_t top = 0;
+    size_t found = 0;
+    stack[top++] = Entry{ root, AllPlanes };
+    while (top > 0) {
+        Entry entry = stack[--top];
+        const Node& node = nodes[entry.node];
+        if (!(node.layers & layers)) continue;
+
+        const Aabb& box = node.IsLeaf() ? node.bounds : node.box;
+        bool outside = false;
+        for (int side = 0; side < Frustum::SideCount && entry.planes; ++side) {
+            uint32_t bit = 1u << side;
+            if (!(entry.planes & bit)) continue;
+            const Plane& plane = frustum.planes[side];
+            if (Frustum::IsOutside(plane, box)) { outside = true; break; }
+            if (Frustum::IsInside(plane, box)) entry.planes &= ~bit;
+        }
+        if (outside) continue;
+
+        if (node.IsLeaf()) {
+            if (found < capacity) results[found] = entry.node;
+            found++;
+        } else if (top + 2 <= StackSize) {
+            stack[top++] = Entry{ node.child1, entry.planes };
+            stack[top++] = Entry{ node.child2, entry.planes };
+        }
+    }
+    return found;
+}
+
+size_t SpatialIndex::Raycast(const Vector3& origin, const Vector3& direction, float maxDistance, SpatialHit* hits, size_t capacity, uint32_t layers) const {
+    if (root == None || capacity == 0) return 0;
+    Vector3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+    // Nearer child on top, so the list fills with close hits early and the limit comes down fast
+    struct Entry { uint32_t node; float distance; };
+    Entry stack[StackSize];
+    size_t top = 0;
+    size_t count = 0;
+    float distance;
+    if (!nodes[root].box.IntersectRay(origin, inverseDirection, maxDistance, distance)) return 0;
+    stack[top++] = Entry{ root, distance };
+    while (top > 0) {
+        Entry entry = stack[--top];
+        float limit = GetLimit(hits, count, capacity, maxDistance);
+        if (entry.distance > limit) continue;
+        const Node& node = nodes[entry.node];
+        if (!(node.layers & layers)) continue;
+
+        if (node.IsLeaf()) {
+            if (node.bounds.IntersectRay(origin, inverseDirection, limit, distance)) InsertHit(hits, count, capacity, entry.node, distance);
+            continue;
+        }
+        float distance1, distance2;
+        bool hit1 = nodes[node.child1].box.IntersectRay(origin, inverseDirection, limit, distance1);
+        bool hit2 = nodes[node.child2].box.IntersectRay(origin, inverseDirection, limit, distance2);
+        if (top + 2 > StackSize) continue;
+        if (hit1 && hit2) {
+            bool firstNearer = distance1 <= distance2;
+            stack[top++] = firstNearer ? Entry{ node.child2, distance2 } : Entry{ node.child1, distance1 };
+            stack[top++] = firstNearer ? Entry{ node.child1, distance1 } : Entry{ node.child2, distance2 };
+        } else if (hit1) {
+            stack[top++] = Entry{ node.child1, distance1 };
+        } else if (hit2) {
+            stack[top++] = Entry{ node.child2, distance2 };
+        }
+    }
+    return count;
+}
+
+size_t SpatialIndex::QueryNearest(const Vector3& point, float maxDistance, SpatialHit* results, size_t capacity, uint32_t layers) const {
+    if (root == None || capacity == 0) return 0;
+
+    // Squared distances until the end
+    struct Entry { uint32_t node; float distance; };
+    Entry stack[StackSize];
+    size_t top = 0;
+    size_t count = 0;
+    float maxSquared = maxDistance * maxDistance;
+    stack[top++] = Entry{ root, nodes[root].box.DistanceSquared(point) };
+    while (top > 0) {
+        Entry entry = stack[--top];
+        float limit = GetLimit(results, count, capacity, maxSquared);
+        if (entry.distance > limit) continue;
+        const Node& node = nodes[entry.node];
+        if (!(node.layers & layers)) continue;
+
+        if (node.IsLeaf()) {
+            float distance = node.bounds.DistanceSquared(point);
+            if (distance <= limit) InsertHit(results, count, capacity, entry.node, distance);
+            continue;
+        }
+        if (top + 2 > StackSize) continue;
+        float distance1 = nodes[node.child1].box.DistanceSquared(point);
+        float distance2 = nodes[node.child2].box.DistanceSquared(point);
+        bool firstNearer = distance1 <= distance2;
+        stack[top++] = firstNearer ? Entry{ node.child2, distance2 } : Entry{ node.child1, distance1 };
+        stack[top++] = firstNearer ? Entry{ node.child1, distance1 } : Entry{ node.child2, distance2 };
+    }
+    for (size_t i = 0; i < count; ++i) results[i].distance = std::sqrt(results[i].distance);
+    return count;
+}
+
+void SpatialIndex::ShiftOrigin(const Vector3& shift) {
+    Vector3 offset = Vector3() - shift;
+    for (Node& node : nodes) {
+        if (node.height < 0) continue;
+        node.box = node.box.Translated(offset);
+        if (node.IsLeaf()) node.bounds = node.bounds.Translated(offset);
+    }
+}
+
+SpatialIndexStats SpatialIndex::GetStats() const {
+    SpatialIndexStats stats;
+    stats.proxies = proxyCount;
+    stats.nodes = proxyCount == 0 ? 0 : proxyCount * 2 - 1;
+    stats.height = root == None ? 0 : static_cast<uint32_t>(nodes[root].height) + 1;
+    stats.moves = moves;
+    stats.refits = refits;
+    stats.reinserts = reinserts;
+    stats.rotations = rotations;
+    return stats;
+}
+
+uint32_t SpatialIndex::AllocateNode() {
+    uint32_t node;
+    if (freeList != None) {
+        node = freeList;
+        freeList = nodes[node].parent;
+        nodes[node] = Node();
+    } else {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    return node;
+}
+
+void SpatialIndex::FreeNode(uint32_t node) {
+    nodes[node] = Node();
+    nodes[node].parent = freeList;
+    freeList = node;
+}
+
+Aabb SpatialIndex::Fatten(const Aabb& bounds, const Vector3& displacement) const {
+    Aabb fat = bounds.Expanded(Vector3(settings.margin));
+    Vector3 ahead = displacement * settings.displacementScale;
+    (ahead.x < 0.0f ? fat.min.x : fat.max.x) += ahead.x;
+    (ahead.y < 0.0f ? fat.min.y : fat.max.y) += ahead.y;
+    (ahead.z < 0.0f ? fat.min.z : fat.max.z) += ahead.z;
+    return fat;
+}
+
+void SpatialIndex::InsertLeaf(uint32_t leaf) {
+    if (root == None) {
+        root = leaf;
+        nodes[leaf].parent = None;
+        return;
+    }
+
+    // Down to the sibling that makes the tree cheapest - the surface area added here, plus what
+    // every box above would grow by
+    Aabb leafBox = nodes[leaf].box;
+    uint32_t index = root;
+    while (!nodes[index].IsLeaf()) {
+        const Node& node = nodes[index];
+        float area = node.box.GetSurfaceArea();
+        float combinedArea = Aabb::Merge(node.box, leafBox).GetSurfaceArea();
+        float cost = 2.0f * combinedArea;
+        float inheritance = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](uint32_t child) {
+            const Node& candidate = nodes[child];
+            float merged = Aabb::Merge(leafBox, candidate.box).GetSurfaceArea();
+            return (candidate.IsLeaf() ? merged : merged - candidate.box.GetSurfaceArea()) + inheritance;
+        };
+        float cost1 = descendCost(node.child1);
+        float cost2 = descendCost(node.child2);
+        if (cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node.child1 : node.child2;
+    }
+
+    // A new parent for the sibling and the leaf
+    uint32_t sibling = index;
+    uint32_t newParent = AllocateNode();
+    uint32_t oldParent = nodes[sibling].parent;
+    Node& parent = nodes[newParent];
+    parent.parent = oldParent;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    parent.box = Aabb::Merge(leafBox, nodes[sibling].box);
+    parent.height = nodes[sibling].height + 1;
+    parent.layers = nodes[sibling].layers | nodes[leaf].layers;
+    if (oldParent == None) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    FixUpwards(newParent);
+}
+
+void SpatialIndex::RemoveLeaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = None;
+        return;
+    }
+
+    // The parent goes, the sibling takes its place
+    uint32_t parent = nodes[leaf].parent;
+    uint32_t grandParent = nodes[parent].parent;
+    uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+    nodes[sibling].parent = grandParent;
+    if (grandParent == None) {
+        root = sibling;
+    } else if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    FreeNode(parent);
+    nodes[leaf].parent = None;
+    FixUpwards(grandParent);
+}
+
+void SpatialIndex::FixUpwards(uint32_t node) {
+    while (node != None) {
+        node = Balance(node);
+        Node& current = nodes[node];
+        const Node& child1 = nodes[current.child1];
+        const Node& child2 = nodes[current.child2];
+        current.box = Aabb::Merge(child1.box, child2.box);
+        current.height = 1 + std::max(child1.height, child2.height);
+        current.layers = child1.layers | child2.layers;
+        node = current.parent;
+    }
+}
+
+uint32_t SpatialIndex::Balance(uint32_t a) {
+    // If one child of a is more than a level deeper than the other, that child is rotated up into
+    // a's place, and a takes the shallower of its children
+    if (nodes[a].IsLeaf() || nodes[a].height < 2) return a;
+    int32_t balance = nodes[nodes[a].child2].height - nodes[nodes[a].child1].height;
+    if (balance >= -1 && balance <= 1) return a;
+
+    bool rightHeavy = balance > 1;
+    uint32_t up = rightHeavy ? nodes[a].child2 : nodes[a].child1;
+    uint32_t stay = rightHeavy ? nodes[a].child1 : nodes[a].child2;
+    uint32_t f = nodes[up].child1;
+    uint32_t g = nodes[up].child2;
+
+    // up takes a's place under a's parent
+    nodes[up].child1 = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+    uint32_t upParent = nodes[up].parent;
+    if (upParent == None) {
+        root = up;
+    } else if (nodes[upParent].child1 == a) {
+        nodes[upParent].child1 = up;
+    } else {
+        nodes[upParent].child2 = up;
+    }
+
+    // up keeps its deeper child, a gets the other in place of up
+    uint32_t keep = nodes[f].height > nodes[g].height ? f : g;
+    uint32_t give = keep == f ? g : f;
+    nodes[up].child2 = keep;
+    (rightHeavy ? nodes[a].child2 : nodes[a].child1) = give;
+    nodes[give].parent = a;
+
+    Node& lower = nodes[a];
+    lower.box = Aabb::Merge(nodes[stay].box, nodes[give].box);
+    lower.height = 1 + std::max(nodes[stay].height, nodes[give].height);
+    lower.layers = nodes[stay].layers | nodes[give].layers;
+    Node& upper = nodes[up];
+    upper.box = Aabb::Merge(lower.box, nodes[keep].box);
+    upper.height = 1 + std::max(lower.height, nodes[keep].height);
+    upper.layers = lower.layers | nodes[keep].layers;
+    rotations++;
+    return up;
+}
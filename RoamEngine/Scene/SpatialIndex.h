@@ -0,0 +1,141 @@
+// SpatialIndex.h - The map of where everything is
+// One tree of boxes for the whole engine, so nobody has to ask every object whether it's nearby
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Math/Bounds.h"
+#include "Math/Vector3.h"
+
+// A proxy handle - the index of its leaf. Reused after DestroyProxy.
+using SpatialProxyId = uint32_t;
+constexpr SpatialProxyId InvalidSpatialProxy = UINT32_MAX;
+
+// Layers - which subsystem put a proxy in. Every query takes a mask, so each one only walks the
+// parts of the tree holding what it cares about.
+namespace SpatialLayer {
+    constexpr uint32_t Physics = 1u << 0;
+    constexpr uint32_t Perception = 1u << 1; // things AI can see or hear
+    constexpr uint32_t Audio = 1u << 2;      // occluders
+    constexpr uint32_t Render = 1u << 3;
+    constexpr uint32_t Editor = 1u << 4;     // pickable
+    constexpr uint32_t All = UINT32_MAX;
+}
+
+// A ray or nearest-neighbour result - distance along the ray, or from the point
+struct SpatialHit {
+    SpatialProxyId proxy;
+    float distance;
+};
+
+struct SpatialIndexSettings {
+    float margin = 0.1f;            // fattening on every side, so small moves don't touch the tree
+    float displacementScale = 2.0f; // how far ahead of a moving proxy to stretch its fat box
+};
+
+struct SpatialIndexStats {
+    uint32_t proxies = 0;
+    uint32_t nodes = 0;
+    uint32_t height = 0;
+    uint64_t moves = 0;       // MoveProxy calls
+    uint64_t refits = 0;      // moves out of the fat box that still fit inside the parent - only the leaf changed
+    uint64_t reinserts = 0;   // moves out of the parent too - taken out and put back in
+    uint64_t rotations = 0;   // balancing
+};
+
+// The SpatialIndex class - a dynamic bounding volume hierarchy. Each proxy is a leaf with its real
+// box plus a fat box a little bigger; moves that stay inside the fat box cost nothing, moves that
+// stay inside the parent only grow the leaf, and only the rest are taken out and put back in.
+// Insertion picks the cheapest sibling by surface area and the tree is kept balanced by rotations.
+// Internal nodes also hold the union of their leaves' layers, so a query for one layer skips
+// subtrees with none of it.
+//
+// Queries write into the caller's buffer and allocate nothing. Overlap queries return how many
+// proxies matched - anything past capacity isn't written, so a return above capacity means the
+// buffer was too small. Raycast and QueryNearest keep the closest capacity results, nearest first.
+// Results are tested against the real boxes, not the fat ones.
+//
+// Not thread-safe for changes. Queries are const and touch nothing shared, so any number of them
+// can run at once on any threads while nothing is changing the index.
+class SpatialIndex {
+public:
+    SpatialIndex();
+    explicit SpatialIndex(const SpatialIndexSettings& settings);
+    ~SpatialIndex();
+
+    // Proxies - userData is the caller's, handed back by GetUserData
+    SpatialProxyId CreateProxy(const Aabb& bounds, uint32_t layers, uint64_t userData = 0);
+    void DestroyProxy(SpatialProxyId proxy);
+    // displacement is how far it moved since last time - used to stretch the fat box ahead of it.
+    // Returns true if the tree had to change.
+    bool MoveProxy(SpatialProxyId proxy, const Aabb& bounds, const Vector3& displacement = Vector3());
+    void SetLayers(SpatialProxyId proxy, uint32_t layers);
+    uint32_t GetLayers(SpatialProxyId proxy) const;
+    uint64_t GetUserData(SpatialProxyId proxy) const;
+    const Aabb& GetBounds(SpatialProxyId proxy) const;
+    bool IsValid(SpatialProxyId proxy) const;
+    void Clear();
+
+    // Overlap queries - return the number matched
+    size_t QueryAabb(const Aabb& box, SpatialProxyId* results, size_t capacity, uint32_t layers = SpatialLayer::All) const;
+    size_t QuerySphere(const Vector3& center, float radius, SpatialProxyId* results, size_t capacity, uint32_t layers = SpatialLayer::All) const;
+    size_t QueryFrustum(const Frustum& frustum, SpatialProxyId* results, size_t capacity, uint32_t layers = SpatialLayer::All) const;
+
+    // Closest-first queries - return the number written, at most capacity. direction needn't be
+    // unit length; distances are in units of it.
+    size_t Raycast(const Vector3& origin, const Vector3& direction, float maxDistance, SpatialHit* hits, size_t capacity, uint32_t layers = SpatialLayer::All) const;
+    size_t QueryNearest(const Vector3& point, float maxDistance, SpatialHit* results, size_t capacity, uint32_t layers = SpatialLayer::All) const;
+
+    // Floating origin rebase - every box moves, the tree's shape doesn't
+    void ShiftOrigin(const Vector3& shift);
+
+    // Settings - a new margin applies to boxes as they're next fattened
+    void SetSettings(const SpatialIndexSettings& settings) { this->settings = settings; }
+    const SpatialIndexSettings& GetSettings() const { return settings; }
+
+    SpatialIndexStats GetStats() const;
+
+private:
+    // Prevent copying - proxy ids would mean two things
+    SpatialIndex(const SpatialIndex&) = delete;
+    SpatialIndex& operator=(const SpatialIndex&) = delete;
+
+    static constexpr uint32_t None = UINT32_MAX;
+    static constexpr size_t StackSize = 128; // balanced, so depth stays near 1.44 * log2(n)
+
+    struct Node {
+        Aabb box;                   // fat for leaves
+        Aabb bounds;                // leaves only - the real box
+        uint32_t parent = None;     // next free node while on the free list
+        uint32_t child1 = None;     // None for leaves
+        uint32_t child2 = None;
+        int32_t height = -1;        // 0 for leaves, -1 while free
+        uint32_t layers = 0;        // leaves - their own, internal nodes - the union below
+        uint64_t userData = 0;
+
+        bool IsLeaf() const { return child1 == None; }
+    };
+
+    uint32_t AllocateNode();
+    void FreeNode(uint32_t node);
+    Aabb Fatten(const Aabb& bounds, const Vector3& displacement) const;
+    void InsertLeaf(uint32_t leaf);
+    void RemoveLeaf(uint32_t leaf);
+    void FixUpwards(uint32_t node); // boxes, heights and layers from here to the root, balancing on the way
+    uint32_t Balance(uint32_t node);
+
+    SpatialIndexSettings settings;
+    std::vector<Node> nodes;
+    uint32_t root;
+    uint32_t freeList;
+    uint32_t proxyCount;
+    uint64_t moves;
+    uint64_t refits;
+    uint64_t reinserts;
+    uint64_t rotations;
+};
+
+#endif // SPATIALINDEX_H
@@ -0,0 +1,345 @@
+// TransformHierarchy.cpp - Implementation of the family tree
+// Breadth-first storage, so parents always come before their children and one pass down is enough
+
+#include "TransformHierarchy.h"
+#include <algorithm>
+
+namespace {
+    constexpr float IdentityRows[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+
+    template<typename T>
+    void Gather(std::vector<T>& values, const std::vector<uint32_t>& from, size_t stride) {
+        std::vector<T> sorted(from.size() * stride);
+        for (size_t i = 0; i < from.size(); ++i) {
+            std::copy_n(values.begin() + from[i] * stride, stride, sorted.begin() + i * stride);
+        }
+        values.swap(sorted);
+    }
+}
+
+TransformHierarchy::TransformHierarchy() : firstRoot(None), liveCount(0), orderStale(false) {
+}
+
+TransformHierarchy::~TransformHierarchy() {
+}
+
+TransformId TransformHierarchy::Create(TransformId parent) {
+    uint32_t parentHandle = None;
+    if (parent.IsValid()) {
+        if (!IsAlive(parent)) return InvalidTransformId;
+        parentHandle = parent.index;
+    }
+
+    uint32_t handle;
+    if (!freeNodes.empty()) {
+        handle = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        handle = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    Node& node = nodes[handle];
+    node.alive = true;
+    node.dirty = false;
+    node.firstChild = None;
+    Link(handle, parentHandle);
+
+    // A new slot on the end - the order is put right at the next Update
+    node.slot = static_cast<uint32_t>(slotHandle.size());
+    slotHandle.push_back(handle);
+    slotParent.push_back(None);
+    slotFirstChild.push_back(0);
+    slotChildCount.push_back(0);
+    positionX.push_back(0.0f); positionY.push_back(0.0f); positionZ.push_back(0.0f);
+    rotationX.push_back(0.0f); rotationY.push_back(0.0f); rotationZ.push_back(0.0f); rotationW.push_back(1.0f);
+    scaleX.push_back(1.0f); scaleY.push_back(1.0f); scaleZ.push_back(1.0f);
+    world.insert(world.end(), std::begin(IdentityRows), std::end(IdentityRows));
+    orderStale = true;
+    liveCount++;
+
+    MarkDirty(handle);
+    return TransformId{ handle, node.generation };
+}
+
+bool TransformHierarchy::Destroy(TransformId id) {
+    if (!IsAlive(id)) return false;
+    Unlink(id.index);
+
+    // The whole subtree - its slots are dropped at the next reorder
+    std::vector<uint32_t> stack{ id.index };
+    while (!stack.empty()) {
+        uint32_t handle = stack.back();
+        stack.pop_back();
+        Node& node = nodes[handle];
+        for (uint32_t child = node.firstChild; child != None; child = nodes[child].nextSibling) stack.push_back(child);
+        node.alive = false;
+        node.dirty = false;
+        node.generation = node.generation == UINT32_MAX ? 1 : node.generation + 1;
+        node.parent = node.firstChild = node.nextSibling = node.previousSibling = None;
+        freeNodes.push_back(handle);
+        liveCount--;
+    }
+    orderStale = true;
+    return true;
+}
+
+bool TransformHierarchy::IsAlive(TransformId id) const {
+    return id.index < nodes.size() && nodes[id.index].alive && nodes[id.index].generation == id.generation;
+}
+
+bool TransformHierarchy::SetParent(TransformId id, TransformId parent) {
+    if (!IsAlive(id) || (parent.IsValid() && !IsAlive(parent))) return false;
+    uint32_t parentHandle = parent.IsValid() ? parent.index : None;
+    if (nodes[id.index].parent == parentHandle) return true;
+    for (uint32_t ancestor = parentHandle; ancestor != None; ancestor = nodes[ancestor].parent) {
+        if (ancestor == id.index) return false; // it would end up its own grandparent
+    }
+
+    Unlink(id.index);
+    Link(id.index, parentHandle);
+    orderStale = true;
+    MarkDirty(id.index);
+    return true;
+}
+
+TransformId TransformHierarchy::GetParent(TransformId id) const {
+    if (!IsAlive(id) || nodes[id.index].parent == None) return InvalidTransformId;
+    uint32_t parent = nodes[id.index].parent;
+    return TransformId{ parent, nodes[parent].generation };
+}
+
+void TransformHierarchy::SetLocalPosition(TransformId id, const Vector3& position) {
+    uint32_t slot = GetSlot(id);
+    if (slot == None) return;
+    positionX[slot] = position.x;
+    positionY[slot] = position.y;
+    positionZ[slot] = position.z;
+    MarkDirty(id.index);
+}
+
+void TransformHierarchy::SetLocalRotation(TransformId id, const Quaternion& rotation) {
+    uint32_t slot = GetSlot(id);
+    if (slot == None) return;
+    Quaternion unit = rotation.Normalized();
+    rotationX[slot] = unit.x;
+    rotationY[slot] = unit.y;
+    rotationZ[slot] = unit.z;
+    rotationW[slot] = unit.w;
+    MarkDirty(id.index);
+}
+
+void TransformHierarchy::SetLocalScale(TransformId id, const Vector3& scale) {
+    uint32_t slot = GetSlot(id);
+    if (slot == None) return;
+    scaleX[slot] = scale.x;
+    scaleY[slot] = scale.y;
+    scaleZ[slot] = scale.z;
+    MarkDirty(id.index);
+}
+
+void TransformHierarchy::SetLocal(TransformId id, const Vector3& position, const Quaternion& rotation, const Vector3& scale) {
+    SetLocalPosition(id, position);
+    SetLocalRotation(id, rotation);
+    SetLocalScale(id, scale);
+}
+
+Vector3 TransformHierarchy::GetLocalPosition(TransformId id) const {
+    uint32_t slot = GetSlot(id);
+    return slot == None ? Vector3() : Vector3(positionX[slot], positionY[slot], positionZ[slot]);
+}
+
+Quaternion TransformHierarchy::GetLocalRotation(TransformId id) const {
+    uint32_t slot = GetSlot(id);
+    return slot == None ? Quaternion() : Quaternion(rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot]);
+}
+
+Vector3 TransformHierarchy::GetLocalScale(TransformId id) const {
+    uint32_t slot = GetSlot(id);
+    return slot == None ? Vector3(1.0f) : Vector3(scaleX[slot], scaleY[slot], scaleZ[slot]);
+}
+
+void TransformHierarchy::Update() {
+    if (orderStale) Reorder();
+    updated.clear();
+    stats.changed = 0;
+    stats.updated = 0;
+    stats.batches = 0;
+
+    // What was touched, bucketed by depth
+    levels.resize(stats.levels + 1);
+    for (uint32_t handle : dirty) {
+        Node& node = nodes[handle];
+        if (!node.alive || !node.dirty) continue; // destroyed since, or already seen
+        node.dirty = false;
+        if (visited[node.slot]) continue;
+        visited[node.slot] = 1;
+        levels[slotDepth[node.slot]].push_back(node.slot);
+        stats.changed++;
+    }
+    dirty.clear();
+
+    // Down the tree a level at a time - each level's children join the next one
+    for (size_t depth = 0; depth + 1 < levels.size(); ++depth) {
+        if (levels[depth].empty()) continue;
+        UpdateLevel(levels[depth], levels[depth + 1]);
+        levels[depth].clear();
+        stats.batches++;
+    }
+
+    for (const TransformId& id : updated) visited[nodes[id.index].slot] = 0;
+    stats.updated = static_cast<uint32_t>(updated.size());
+}
+
+void TransformHierarchy::UpdateLevel(std::vector<uint32_t>& level, std::vector<uint32_t>& next) {
+    std::sort(level.begin(), level.end()); // walk memory forwards
+    size_t count = level.size();
+    local.resize(count * 12);
+
+    // Local matrices from position, rotation and scale - straight-line maths over the SoA arrays,
+    // no branches, so the compiler is free to vectorize it
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t slot = level[i];
+        float x = rotationX[slot], y = rotationY[slot], z = rotationZ[slot], w = rotationW[slot];
+        float sx = scaleX[slot], sy = scaleY[slot], sz = scaleZ[slot];
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+        float* out = &local[i * 12];
+        out[0] = (1.0f - 2.0f * (yy + zz)) * sx; out[1] = 2.0f * (xy - wz) * sy;          out[2] = 2.0f * (xz + wy) * sz;          out[3] = positionX[slot];
+        out[4] = 2.0f * (xy + wz) * sx;          out[5] = (1.0f - 2.0f * (xx + zz)) * sy; out[6] = 2.0f * (yz - wx) * sz;          out[7] = positionY[slot];
+        out[8] = 2.0f * (xz - wy) * sx;          out[9] = 2.0f * (yz + wx) * sy;          out[10] = (1.0f - 2.0f * (xx + yy)) * sz; out[11] = positionZ[slot];
+    }
+
+    // World = parent world * local - parents are a level up, already done
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t slot = level[i];
+        const float* in = &local[i * 12];
+        float* out = &world[slot * 12];
+        uint32_t parent = slotParent[slot];
+        if (parent == None) {
+            std::copy_n(in, 12, out);
+        } else {
+            const float* p = &world[parent * 12];
+            for (int row = 0; row < 3; ++row) {
+                const float* r = p + row * 4;
+                out[row * 4 + 0] = r[0] * in[0] + r[1] * in[4] + r[2] * in[8];
+                out[row * 4 + 1] = r[0] * in[1] + r[1] * in[5] + r[2] * in[9];
+                out[row * 4 + 2] = r[0] * in[2] + r[1] * in[6] + r[2] * in[10];
+                out[row * 4 + 3] = r[0] * in[3] + r[1] * in[7] + r[2] * in[11] + r[3];
+            }
+        }
+
+        uint32_t handle = slotHandle[slot];
+        updated.push_back(TransformId{ handle, nodes[handle].generation });
+        uint32_t first = slotFirstChild[slot];
+        for (uint32_t child = first; child < first + slotChildCount[slot]; ++child) {
+            if (visited[child]) continue;
+            visited[child] = 1;
+            next.push_back(child);
+        }
+    }
+}
+
+Matrix4x4 TransformHierarchy::GetWorldMatrix(TransformId id) const {
+    uint32_t slot = GetSlot(id);
+    if (slot == None) return Matrix4x4();
+    const float* m = &world[slot * 12];
+    return Matrix4x4(m[0], m[1], m[2], m[3],
+                     m[4], m[5], m[6], m[7],
+                     m[8], m[9], m[10], m[11],
+                     0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+Vector3 TransformHierarchy::GetWorldPosition(TransformId id) const {
+    uint32_t slot = GetSlot(id);
+    if (slot == None) return Vector3();
+    return Vector3(world[slot * 12 + 3], world[slot * 12 + 7], world[slot * 12 + 11]);
+}
+
+void TransformHierarchy::ShiftOrigin(const Vector3& shift) {
+    for (uint32_t root = firstRoot; root != None; root = nodes[root].nextSibling) {
+        uint32_t slot = nodes[root].slot;
+        positionX[slot] -= shift.x;
+        positionY[slot] -= shift.y;
+        positionZ[slot] -= shift.z;
+        MarkDirty(root);
+    }
+}
+
+uint32_t TransformHierarchy::GetSlot(TransformId id) const {
+    return IsAlive(id) ? nodes[id.index].slot : None;
+}
+
+void TransformHierarchy::MarkDirty(uint32_t handle) {
+    Node& node = nodes[handle];
+    if (node.dirty) return;
+    node.dirty = true;
+    dirty.push_back(handle);
+}
+
+void TransformHierarchy::Link(uint32_t handle, uint32_t parent) {
+    Node& node = nodes[handle];
+    uint32_t& head = parent == None ? firstRoot : nodes[parent].firstChild;
+    node.parent = parent;
+    node.previousSibling = None;
+    node.nextSibling = head;
+    if (head != None) nodes[head].previousSibling = handle;
+    head = handle;
+}
+
+void TransformHierarchy::Unlink(uint32_t handle) {
+    Node& node = nodes[handle];
+    if (node.previousSibling != None) {
+        nodes[node.previousSibling].nextSibling = node.nextSibling;
+    } else {
+        (node.parent == None ? firstRoot : nodes[node.parent].firstChild) = node.nextSibling;
+    }
+    if (node.nextSibling != None) nodes[node.nextSibling].previousSibling = node.previousSibling;
+    node.parent = node.nextSibling = node.previousSibling = None;
+}
+
+void TransformHierarchy::Reorder() {
+    // Breadth first from the roots - that's sorted by depth, and each parent's children come out
+    // next to each other. Slots of destroyed transforms simply aren't reached.
+    std::vector<uint32_t> order;
+    order.reserve(liveCount);
+    for (uint32_t root = firstRoot; root != None; root = nodes[root].nextSibling) order.push_back(root);
+
+    std::vector<uint32_t> parents(order.size(), None);
+    std::vector<uint32_t> depths(order.size(), 0);
+    std::vector<uint32_t> firstChildren;
+    std::vector<uint32_t> childCounts;
+    firstChildren.reserve(liveCount);
+    childCounts.reserve(liveCount);
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint32_t first = static_cast<uint32_t>(order.size());
+        for (uint32_t child = nodes[order[i]].firstChild; child != None; child = nodes[child].nextSibling) {
+            order.push_back(child);
+            parents.push_back(static_cast<uint32_t>(i));
+            depths.push_back(depths[i] + 1);
+        }
+        firstChildren.push_back(first);
+        childCounts.push_back(static_cast<uint32_t>(order.size()) - first);
+    }
+
+    // Old slot of each new one, then everything moved across in one go
+    std::vector<uint32_t> from(order.size());
+    for (size_t i = 0; i < order.size(); ++i) from[i] = nodes[order[i]].slot;
+    for (std::vector<float>* values : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ }) {
+        Gather(*values, from, 1);
+    }
+    Gather(world, from, 12);
+
+    for (size_t i = 0; i < order.size(); ++i) nodes[order[i]].slot = static_cast<uint32_t>(i);
+    slotHandle = std::move(order);
+    slotParent = std::move(parents);
+    slotDepth = std::move(depths);
+    slotFirstChild = std::move(firstChildren);
+    slotChildCount = std::move(childCounts);
+    visited.assign(slotHandle.size(), 0);
+
+    stats.transforms = static_cast<uint32_t>(slotHandle.size());
+    stats.levels = slotDepth.empty() ? 0 : slotDepth.back() + 1;
+    stats.reorders++;
+    orderStale = false;
+}
@@ -0,0 +1,137 @@
+// TransformHierarchy.h - The family tree
+// Where everything is relative to whatever it's attached to, worked out once a frame for whatever moved
+
+#ifndef TRANSFORMHIERARCHY_H
+#define TRANSFORMHIERARCHY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Math/Matrix4x4.h"
+#include "Math/Quaternion.h"
+#include "Math/Vector3.h"
+
+// A transform handle - stays good while the transform lives, however the storage is shuffled
+struct TransformId {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+    bool operator==(const TransformId& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const TransformId& other) const { return !(*this == other); }
+};
+
+constexpr TransformId InvalidTransformId{};
+
+struct TransformStats {
+    uint32_t transforms = 0;
+    uint32_t levels = 0;        // deepest chain, roots included
+    uint32_t changed = 0;       // last Update - transforms that were set directly
+    uint32_t updated = 0;       // last Update - world matrices recomputed, children of changed ones included
+    uint32_t batches = 0;       // last Update - one per depth level that had anything to do
+    uint32_t reorders = 0;      // total - storage rebuilt after the tree's shape changed
+};
+
+// The TransformHierarchy class - local position, rotation and scale for every transform, in SoA arrays
+// sorted by depth: roots first, then their children, then theirs, with each parent's children side by
+// side. Setters only mark a transform dirty. Update then walks the depths in order, recomputing the
+// world matrices of the dirty transforms and everything under them one depth level at a time - so a
+// vehicle with 200 attached parts moved this frame is one matrix, then one batch of 200, however many
+// times it was touched. Reparenting, creating and destroying mark the order stale and it's rebuilt at
+// the next Update (linear in the number of transforms). Main thread only; world results are as of the
+// last Update.
+class TransformHierarchy {
+public:
+    TransformHierarchy();
+    ~TransformHierarchy();
+
+    // Transforms - a new one is at the origin, unrotated, unit scale
+    TransformId Create(TransformId parent = InvalidTransformId);
+    bool Destroy(TransformId id); // and everything under it
+    bool IsAlive(TransformId id) const;
+    size_t GetCount() const { return liveCount; }
+
+    // Hierarchy - the local transform is kept, so a reparented transform jumps to the same offset
+    // from its new parent. Fails if it would make a loop.
+    bool SetParent(TransformId id, TransformId parent);
+    TransformId GetParent(TransformId id) const;
+
+    // Local transform - relative to the parent
+    void SetLocalPosition(TransformId id, const Vector3& position);
+    void SetLocalRotation(TransformId id, const Quaternion& rotation);
+    void SetLocalScale(TransformId id, const Vector3& scale);
+    void SetLocal(TransformId id, const Vector3& position, const Quaternion& rotation, const Vector3& scale);
+    Vector3 GetLocalPosition(TransformId id) const;
+    Quaternion GetLocalRotation(TransformId id) const;
+    Vector3 GetLocalScale(TransformId id) const;
+
+    // Per frame - before anything reads world matrices
+    void Update();
+
+    // World transform - as of the last Update
+    Matrix4x4 GetWorldMatrix(TransformId id) const;
+    Vector3 GetWorldPosition(TransformId id) const;
+
+    // Everything whose world matrix changed in the last Update - what a renderer needs to re-upload
+    const std::vector<TransformId>& GetUpdated() const { return updated; }
+
+    // Floating origin rebase - the roots move, everything else follows at the next Update
+    void ShiftOrigin(const Vector3& shift);
+
+    const TransformStats& GetStats() const { return stats; }
+
+private:
+    // Prevent copying - handles are only good for the hierarchy that made them
+    TransformHierarchy(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+
+    static constexpr uint32_t None = UINT32_MAX;
+
+    // Per handle - the tree itself, as links, so it's right whatever order the slots are in
+    struct Node {
+        uint32_t slot = None;
+        uint32_t generation = 1;
+        uint32_t parent = None;     // handle index
+        uint32_t firstChild = None;
+        uint32_t nextSibling = None;
+        uint32_t previousSibling = None;
+        bool alive = false;
+        bool dirty = false;         // queued for the next Update
+    };
+
+    uint32_t GetSlot(TransformId id) const;
+    void MarkDirty(uint32_t handle);
+    void Link(uint32_t handle, uint32_t parent);
+    void Unlink(uint32_t handle);
+    void Reorder();
+    void UpdateLevel(std::vector<uint32_t>& level, std::vector<uint32_t>& next);
+
+    // Handles
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    uint32_t firstRoot;
+    size_t liveCount;
+
+    // Slots, sorted by depth - parallel arrays, one entry per slot
+    std::vector<uint32_t> slotHandle;
+    std::vector<uint32_t> slotParent;     // slot, None for roots
+    std::vector<uint32_t> slotDepth;
+    std::vector<uint32_t> slotFirstChild; // children are the slots [first, first + count)
+    std::vector<uint32_t> slotChildCount;
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<float> world;             // 12 floats a slot - the top three rows of the world matrix
+    std::vector<uint8_t> visited;         // this Update
+    bool orderStale;
+
+    // Update scratch - kept to save allocating every frame
+    std::vector<uint32_t> dirty;          // handles
+    std::vector<std::vector<uint32_t>> levels;
+    std::vector<float> local;             // 12 floats per entry in the level being done
+    std::vector<TransformId> updated;
+
+    TransformStats stats;
+};
+
+#endif // TRANSFORMHIERARCHY_H
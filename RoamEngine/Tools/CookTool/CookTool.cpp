@@ -0,0 +1,156 @@
+// CookTool.cpp - The line cook
+// Cooks a source tree into runtime blobs, builds HLOD proxies, and tells you what's inside a blob
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Assets/AssetCooker.h"
+#include "Assets/CookedFormats.h"
+#include "Core/ThreadManager.h"
+#include "Math/FileSystem.h"
+#include "World/HlodBuilder.h"
+
+namespace {
+    void PrintUsage() {
+        std::cout << "Usage:\n"
+                     "  CookTool cook <source directory> <output directory> [options]\n"
+                     "  CookTool hlod <cell directory> <cooked directory> <output directory> [options]\n"
+                     "  CookTool info <cooked file>\n"
+                     "Cook options:\n"
+                     "  --force            cook everything, ignoring what the manifest says is up to date\n"
+                     "HLOD options:\n"
+                     "  --levels n         proxy levels, each covering 2x2 of the one below (default: 3)\n"
+                     "  --cell-size s      world cell size in metres (default: 128)\n"
+                     "  --error e          clustering grid of the finest level in metres (default: 1)\n"
+                     "Both:\n"
+                     "  --threads n        worker threads (default: all cores)\n";
+    }
+
+    int Cook(const std::string& sourceDir, const std::string& outputDir, bool force, ThreadManager& jobs) {
+        AssetCooker cooker;
+        cooker.SetJobSystem(jobs.IsInitialized() ? &jobs : nullptr);
+
+        AssetCooker::Report report;
+        bool ok = cooker.CookDirectory(sourceDir, outputDir, report, force);
+        for (const std::string& error : report.errors) std::cerr << error << std::endl;
+
+        std::cout << report.cooked << " cooked, " << report.skipped << " up to date, " << report.failed << " failed, "
+                  << report.removed << " removed (" << report.bytesRead / 1024 << " KB read, "
+                  << report.bytesWritten / 1024 << " KB written) in " << report.seconds << "s" << std::endl;
+        return ok ? 0 : 1;
+    }
+
+    int BuildHlod(const std::string& cellDir, const std::string& cookedDir, const std::string& outputDir,
+                  const HlodBuildSettings& settings, ThreadManager& jobs) {
+        HlodBuilder builder;
+        builder.SetJobSystem(jobs.IsInitialized() ? &jobs : nullptr);
+        builder.SetSettings(settings);
+
+        std::string error;
+        if (!builder.AddCellDirectory(cellDir, error)) {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+
+        HlodBuilder::Report report;
+        bool ok = builder.Build(cookedDir, outputDir, report);
+        for (const std::string& message : report.errors) std::cerr << message << std::endl;
+
+        std::cout << report.cells << " cells, " << report.objects << " objects merged, " << report.skipped << " skipped, "
+                  << report.proxies << " proxies (" << report.trianglesIn << " triangles in, " << report.trianglesOut
+                  << " out, " << report.bytesWritten / 1024 << " KB written) in " << report.seconds << "s" << std::endl;
+        return ok ? 0 : 1;
+    }
+
+    int Info(const std::string& path) {
+        std::shared_ptr<MappedFile> mapping = FileSystem::MapFile(path);
+        if (!mapping) {
+            std::cerr << "Can't open " << path << std::endl;
+            return 1;
+        }
+        std::span<const std::byte> data = mapping->GetData();
+
+        if (const CookedMesh* mesh = GetCooked<CookedMesh>(data)) {
+            std::cout << "Mesh: " << mesh->vertexCount << " vertices (" << mesh->vertexStride << " bytes each), "
+                      << mesh->indexCount << " indices (" << mesh->indexSize * 8 << "-bit), "
+                      << mesh->submeshes.size() << " submeshes\n";
+            for (const CookedSubmesh& submesh : mesh->submeshes) {
+                std::cout << "  " << submesh.indexCount / 3 << " triangles, material '"
+                          << mesh->materials[submesh.materialIndex].View() << "'\n";
+            }
+            for (size_t i = 0; i < mesh->lods.size(); ++i) {
+                const CookedMeshLod& lod = mesh->lods[i];
+                std::cout << "  LOD " << i + 1 << ": " << lod.vertexCount << " vertices, " << lod.indexCount / 3
+                          << " triangles, error " << lod.error << "\n";
+            }
+        } else if (const CookedTexture* texture = GetCooked<CookedTexture>(data)) {
+            std::cout << "Texture: " << texture->width << "x" << texture->height << ", "
+                      << CookedTexture::GetPixelSize(texture->format) << " bytes per pixel, " << texture->mips.size() << " mips\n";
+        } else if (const CookedAnimation* animation = GetCooked<CookedAnimation>(data)) {
+            std::cout << "Animation: " << animation->duration << "s, " << animation->keyCount << " keys\n";
+            for (const CookedCurve& curve : animation->curves) std::cout << "  " << curve.name.View() << "\n";
+        } else if (const CookedAudio* audio = GetCooked<CookedAudio>(data)) {
+            std::cout << "Audio: " << audio->frameCount << " frames, " << audio->channels << " channels at " << audio->sampleRate
+                      << " Hz, " << (audio->format == CookedSampleFormat::Int16 ? "16-bit" : "float") << "\n";
+        } else if (const CookedConfig* config = GetCooked<CookedConfig>(data)) {
+            std::cout << "Config: " << config->entries.size() << " entries\n";
+            for (const CookedConfigEntry& entry : config->entries) {
+                std::cout << "  " << entry.key.View() << " = " << entry.text.View() << "\n";
+            }
+        } else {
+            std::cerr << path << " isn't a cooked asset this build understands (wrong version, or corrupt)" << std::endl;
+            return 1;
+        }
+
+        // All of them start with the header, so any of them will do for the common bits
+        const CookedHeader& header = reinterpret_cast<const CookedHeader&>(*data.data());
+        std::cout << "Version " << header.version << ", " << header.size << " bytes, source hash " << std::hex
+                  << header.sourceHash << std::dec << std::endl;
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::string command = argv[1];
+    if (command == "info" && argc == 3) return Info(argv[2]);
+    bool hlod = command == "hlod";
+    if ((command != "cook" || argc < 4) && (!hlod || argc < 5)) {
+        PrintUsage();
+        return 2;
+    }
+
+    bool force = false;
+    uint32_t threads = 0;
+    HlodBuildSettings hlodSettings;
+    for (int i = hlod ? 5 : 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--force" && !hlod) {
+            force = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--levels" && hlod && i + 1 < argc) {
+            hlodSettings.levels = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--cell-size" && hlod && i + 1 < argc) {
+            hlodSettings.cellSize = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--error" && hlod && i + 1 < argc) {
+            hlodSettings.baseError = std::strtof(argv[++i], nullptr);
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    // The calling thread works too, so n threads means n - 1 workers (and 1 means none at all)
+    ThreadManager jobs;
+    if (threads != 1) jobs.Initialize(threads > 1 ? threads - 1 : 0);
+
+    if (hlod) return BuildHlod(argv[2], argv[3], argv[4], hlodSettings, jobs);
+    return Cook(argv[2], argv[3], force, jobs);
+}
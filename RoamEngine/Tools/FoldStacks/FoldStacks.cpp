@@ -0,0 +1,29 @@
+// FoldStacks.cpp - The flame starter
+// Turns a raw sampling capture into folded stacks that flame graph tools can set on fire
+
+#include <iostream>
+#include <string>
+
+#include "Math/SamplingProfiler.h"
+
+// Main - raw addresses in, folded stacks out
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cout << "Usage: FoldStacks <raw-capture> <folded-output> [profiler-capture]\n"
+                     "  raw-capture       written by SamplingProfiler::SaveRawCapture\n"
+                     "  folded-output     one 'frame;frame;frame count' line per unique stack\n"
+                     "  profiler-capture  Profiler::SaveToFile output from the same run - prefixes\n"
+                     "                    each stack with the PROFILE_SCOPEs open at that moment\n"
+                     "Symbolization uses addr2line, so run it on a machine with the same binaries.\n";
+        return 2;
+    }
+
+    std::string profilerCapture = argc == 4 ? argv[3] : "";
+    if (!SamplingProfiler::WriteFoldedStacks(argv[1], argv[2], profilerCapture)) {
+        std::cerr << "Failed to fold " << argv[1] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Folded stacks written to " << argv[2] << std::endl;
+    return 0;
+}
@@ -0,0 +1,271 @@
+// PackTool.cpp - The suitcase packer
+// Folds an asset tree into a single pack, and unfolds it again when you need to look inside
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Core/ThreadManager.h"
+#include "Math/PackArchive.h"
+
+namespace {
+    void PrintUsage() {
+        std::cout << "Usage:\n"
+                     "  PackTool create <output.pak> <directory> [options]\n"
+                     "  PackTool list <input.pak>\n"
+                     "  PackTool extract <input.pak> <directory>\n"
+                     "  PackTool stats <input.pak> [--threads n]\n"
+                     "Create options:\n"
+                     "  --prefix path      virtual folder the files appear under inside the pack (default: none)\n"
+                     "  --align bytes      data alignment (default: 16; 4096 for page-aligned entries)\n"
+                     "  --compress method  none, lz4 or zstd - zstd only in ROAM_HAS_ZSTD builds (default: none)\n"
+                     "  --block-size kb    uncompressed block size for random access (default: 64)\n"
+                     "  --level n          zstd compression level (default: zstd's own)\n"
+                     "  --threads n        worker threads for compressing/decoding (default: all cores)\n";
+    }
+
+    struct CreateOptions {
+        std::string prefix;
+        uint32_t alignment = 16;
+        CompressionMethod compression = CompressionMethod::None;
+        uint32_t blockSize = 64 * 1024;
+        int level = 0;
+    };
+
+    // Asset type for the stats table - the extension is what the AssetManager goes by too
+    std::string GetTypeName(std::string_view path) {
+        std::string extension = std::filesystem::path(std::string(path)).extension().string();
+        if (extension.empty()) return "(none)";
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    int Create(const std::string& output, const std::string& directory, const CreateOptions& options, ThreadManager& jobs) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(directory, error)) {
+            std::cerr << directory << " is not a directory" << std::endl;
+            return 2;
+        }
+
+        // Sorted walk so the same tree always produces the same pack
+        std::vector<std::filesystem::path> files;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, error);
+             !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            if (it->is_regular_file(error)) files.push_back(it->path());
+        }
+        if (error) {
+            std::cerr << "Failed to walk " << directory << ": " << error.message() << std::endl;
+            return 1;
+        }
+        std::sort(files.begin(), files.end());
+
+        PackWriter writer(options.alignment, options.compression, options.blockSize);
+        writer.SetCompressionLevel(options.level);
+        writer.SetJobSystem(&jobs);
+
+        uint64_t totalBytes = 0;
+        for (const auto& file : files) {
+            std::string relative = std::filesystem::relative(file, directory, error).generic_string();
+            std::string packPath = options.prefix.empty() ? relative : options.prefix + "/" + relative;
+            if (!writer.AddFile(packPath, file.string())) {
+                std::cerr << "Skipping " << file.string() << std::endl;
+                continue;
+            }
+            totalBytes += std::filesystem::file_size(file, error);
+        }
+
+        std::string message;
+        if (!writer.Write(output, &message)) {
+            std::cerr << "Failed to write " << output << ": " << message << std::endl;
+            return 1;
+        }
+
+        std::cout << "Packed " << writer.GetEntryCount() << " files (" << totalBytes << " bytes) into "
+                  << output << " (" << std::filesystem::file_size(output, error) << " bytes, "
+                  << Compression::GetName(options.compression) << ")" << std::endl;
+        return 0;
+    }
+
+    int List(const std::string& input) {
+        PackArchive pack;
+        if (!pack.Open(input)) {
+            std::cerr << "Not a valid pack, or it uses compression this build can't decode: " << input << std::endl;
+            return 1;
+        }
+
+        for (size_t i = 0; i < pack.GetEntryCount(); ++i) {
+            const PackEntry& entry = pack.GetEntry(i);
+            std::cout << entry.size << "\t" << pack.GetStoredSize(entry) << "\t"
+                      << Compression::GetName(PackArchive::GetCompression(entry)) << "\t"
+                      << pack.GetEntryPath(entry) << "\n";
+        }
+        std::cout << pack.GetEntryCount() << " files (size, stored, method, path)" << std::endl;
+        return 0;
+    }
+
+    int Extract(const std::string& input, const std::string& directory, ThreadManager& jobs) {
+        PackArchive pack;
+        if (!pack.Open(input)) {
+            std::cerr << "Not a valid pack, or it uses compression this build can't decode: " << input << std::endl;
+            return 1;
+        }
+
+        std::vector<std::byte> data;
+        for (size_t i = 0; i < pack.GetEntryCount(); ++i) {
+            const PackEntry& entry = pack.GetEntry(i);
+            std::string packPath(pack.GetEntryPath(entry));
+            if (packPath.empty() || packPath[0] == '/' || packPath.compare(0, 2, "..") == 0) {
+                std::cerr << "Refusing to extract " << packPath << " outside " << directory << std::endl;
+                continue;
+            }
+
+            if (!pack.ReadAll(entry, data, &jobs)) {
+                std::cerr << "Failed to decode " << packPath << std::endl;
+                return 1;
+            }
+
+            std::filesystem::path target = std::filesystem::path(directory) / packPath;
+            std::error_code error;
+            std::filesystem::create_directories(target.parent_path(), error);
+
+            std::ofstream out(target, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!out) {
+                std::cerr << "Failed to write " << target.string() << std::endl;
+                return 1;
+            }
+        }
+
+        std::cout << "Extracted " << pack.GetEntryCount() << " files to " << directory << std::endl;
+        return 0;
+    }
+
+    // Compression ratio and decode throughput per asset type - decodes every entry once, across the workers
+    int Stats(const std::string& input, ThreadManager& jobs) {
+        PackArchive pack;
+        if (!pack.Open(input)) {
+            std::cerr << "Not a valid pack, or it uses compression this build can't decode: " << input << std::endl;
+            return 1;
+        }
+
+        struct TypeStats {
+            size_t files = 0;
+            size_t compressedFiles = 0;
+            uint64_t rawBytes = 0;
+            uint64_t storedBytes = 0;
+            double decodeSeconds = 0.0;
+        };
+        std::map<std::string, TypeStats> types;
+        TypeStats total;
+
+        std::vector<std::byte> data;
+        for (size_t i = 0; i < pack.GetEntryCount(); ++i) {
+            const PackEntry& entry = pack.GetEntry(i);
+            TypeStats& stats = types[GetTypeName(pack.GetEntryPath(entry))];
+
+            auto start = std::chrono::steady_clock::now();
+            if (!pack.ReadAll(entry, data, &jobs)) {
+                std::cerr << "Failed to decode " << pack.GetEntryPath(entry) << std::endl;
+                return 1;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            for (TypeStats* target : { &stats, &total }) {
+                target->files++;
+                target->compressedFiles += PackArchive::GetCompression(entry) != CompressionMethod::None ? 1 : 0;
+                target->rawBytes += entry.size;
+                target->storedBytes += pack.GetStoredSize(entry);
+                target->decodeSeconds += seconds;
+            }
+        }
+
+        auto printRow = [](const std::string& name, const TypeStats& stats) {
+            double ratio = stats.storedBytes > 0 ? static_cast<double>(stats.rawBytes) / static_cast<double>(stats.storedBytes) : 1.0;
+            double throughput = stats.decodeSeconds > 0.0 ? static_cast<double>(stats.rawBytes) / (1024.0 * 1024.0) / stats.decodeSeconds : 0.0;
+            std::printf("%-12s %7zu %7zu %12.2f %12.2f %7.2fx %12.1f\n", name.c_str(), stats.files, stats.compressedFiles,
+                        static_cast<double>(stats.rawBytes) / (1024.0 * 1024.0),
+                        static_cast<double>(stats.storedBytes) / (1024.0 * 1024.0), ratio, throughput);
+        };
+
+        std::printf("%-12s %7s %7s %12s %12s %8s %12s\n", "type", "files", "packed", "raw MB", "stored MB", "ratio", "decode MB/s");
+        for (const auto& [name, stats] : types) printRow(name, stats);
+        printRow("total", total);
+        std::printf("(%u decode threads, decode time includes copying uncompressed entries)\n", jobs.GetWorkerCount() + 1);
+        return 0;
+    }
+}
+
+// Main - pick a verb
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::string command = argv[1];
+    size_t firstOption = command == "create" || command == "extract" ? 4 : 3;
+    if (static_cast<size_t>(argc) < firstOption) {
+        PrintUsage();
+        return 2;
+    }
+
+    CreateOptions options;
+    uint32_t threads = 0;
+    for (int i = static_cast<int>(firstOption); i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--prefix" && hasValue && command == "create") {
+            options.prefix = PackArchive::NormalizePath(argv[++i]);
+        } else if (arg == "--align" && hasValue && command == "create") {
+            options.alignment = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--compress" && hasValue && command == "create") {
+            std::string method = argv[++i];
+            if (method == "none") options.compression = CompressionMethod::None;
+            else if (method == "lz4") options.compression = CompressionMethod::LZ4;
+            else if (method == "zstd") options.compression = CompressionMethod::Zstd;
+            else {
+                std::cerr << "Unknown compression method: " << method << std::endl;
+                return 2;
+            }
+            if (!Compression::IsSupported(options.compression)) {
+                std::cerr << method << " support isn't compiled in (build with ROAM_HAS_ZSTD and link libzstd)" << std::endl;
+                return 2;
+            }
+        } else if (arg == "--block-size" && hasValue && command == "create") {
+            options.blockSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)) * 1024;
+        } else if (arg == "--level" && hasValue && command == "create") {
+            options.level = std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (options.alignment == 0 || (options.alignment & (options.alignment - 1)) != 0) {
+        std::cerr << "--align must be a power of two" << std::endl;
+        return 2;
+    }
+
+    // The calling thread works too, so n threads means n - 1 workers (and 1 means none at all)
+    ThreadManager jobs;
+    if (threads != 1) jobs.Initialize(threads > 1 ? threads - 1 : 0);
+
+    if (command == "create") return Create(argv[2], argv[3], options, jobs);
+    if (command == "list" && argc == 3) return List(argv[2]);
+    if (command == "extract") return Extract(argv[2], argv[3], jobs);
+    if (command == "stats") return Stats(argv[2], jobs);
+
+    PrintUsage();
+    return 2;
+}
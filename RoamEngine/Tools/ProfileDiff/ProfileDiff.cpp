@@ -0,0 +1,278 @@
+// ProfileDiff.cpp - The performance snitch
+// Compares two profiler captures and tells on whoever made things slower
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "Math/Profiler.h"
+
+namespace {
+
+// Metrics we can gate on - per-call numbers survive runs of different length, totals don't
+enum class DiffMetric {
+    Calls,
+    Total,
+    Mean,
+    P99
+};
+
+const char* MetricName(DiffMetric metric) {
+    switch (metric) {
+        case DiffMetric::Calls: return "calls";
+        case DiffMetric::Total: return "total";
+        case DiffMetric::Mean: return "mean";
+        case DiffMetric::P99: return "p99";
+    }
+    return "?";
+}
+
+bool ParseMetric(const std::string& text, DiffMetric& metric) {
+    if (text == "calls") metric = DiffMetric::Calls;
+    else if (text == "total") metric = DiffMetric::Total;
+    else if (text == "mean") metric = DiffMetric::Mean;
+    else if (text == "p99") metric = DiffMetric::P99;
+    else return false;
+    return true;
+}
+
+// Per-name statistics for one capture
+struct SampleStats {
+    uint64_t callCount;
+    double totalMicros;
+    double meanMicros;
+    double p99Micros;
+
+    SampleStats() : callCount(0), totalMicros(0), meanMicros(0), p99Micros(0) {}
+
+    double Get(DiffMetric metric) const {
+        switch (metric) {
+            case DiffMetric::Calls: return static_cast<double>(callCount);
+            case DiffMetric::Total: return totalMicros;
+            case DiffMetric::Mean: return meanMicros;
+            case DiffMetric::P99: return p99Micros;
+        }
+        return 0.0;
+    }
+};
+
+std::unordered_map<std::string, SampleStats> Summarize(const std::vector<ProfileSample>& samples) {
+    std::unordered_map<std::string, std::vector<double>> durations;
+    for (const ProfileSample& sample : samples) {
+        durations[sample.name].push_back(static_cast<double>(sample.duration.count()));
+    }
+
+    std::unordered_map<std::string, SampleStats> stats;
+    for (auto& entry : durations) {
+        std::vector<double>& values = entry.second;
+        SampleStats s;
+        s.callCount = values.size();
+        for (double v : values) s.totalMicros += v;
+        s.meanMicros = s.totalMicros / values.size();
+
+        size_t index = static_cast<size_t>(std::ceil(0.99 * values.size())) - 1;
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        s.p99Micros = values[index];
+
+        stats[entry.first] = s;
+    }
+    return stats;
+}
+
+// One line of the report
+struct DiffRow {
+    std::string name;
+    SampleStats baseline;
+    SampleStats candidate;
+    bool inBaseline;
+    bool inCandidate;
+    double worstChange; // largest relative increase across gated metrics, 0.25 == +25%
+    bool regressed;
+};
+
+double RelativeChange(double before, double after) {
+    if (before <= 0.0) return after > 0.0 ? INFINITY : 0.0;
+    return (after - before) / before;
+}
+
+std::string FormatChange(double change) {
+    if (std::isinf(change)) return "new";
+    std::ostringstream out;
+    out << std::showpos << std::fixed << std::setprecision(1) << change * 100.0 << "%";
+    return out.str();
+}
+
+void PrintUsage() {
+    std::cout << "Usage: ProfileDiff <baseline.prof> <candidate.prof> [options]\n"
+                 "  --threshold P     fail when a gated metric regresses by more than P percent (default 10)\n"
+                 "  --metric a,b      metrics to gate on: calls,total,mean,p99 (default mean,p99)\n"
+                 "  --min-time US     ignore samples whose baseline and candidate gated values are below US microseconds (default 50)\n"
+                 "  --min-calls N     ignore samples called fewer than N times in either capture (default 1)\n"
+                 "  --top N           only print the N worst rows (default all)\n"
+                 "Exit codes: 0 = within threshold, 1 = regression found, 2 = bad input\n";
+}
+
+} // namespace
+
+// Main - load, compare, judge
+int main(int argc, char* argv[]) {
+    std::vector<std::string> files;
+    double thresholdPercent = 10.0;
+    double minTimeMicros = 50.0;
+    uint64_t minCalls = 1;
+    size_t topRows = 0;
+    std::vector<DiffMetric> gatedMetrics = { DiffMetric::Mean, DiffMetric::P99 };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            files.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return 2;
+        }
+
+        std::string value = argv[++i];
+        if (arg == "--threshold") thresholdPercent = std::atof(value.c_str());
+        else if (arg == "--min-time") minTimeMicros = std::atof(value.c_str());
+        else if (arg == "--min-calls") minCalls = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--top") topRows = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--metric") {
+            gatedMetrics.clear();
+            std::stringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                DiffMetric metric;
+                if (!ParseMetric(item, metric)) {
+                    std::cerr << "Unknown metric '" << item << "'" << std::endl;
+                    return 2;
+                }
+                gatedMetrics.push_back(metric);
+            }
+        }
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            return 2;
+        }
+    }
+
+    if (files.size() != 2) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<ProfileSample> baselineSamples;
+    std::vector<ProfileSample> candidateSamples;
+    if (!Profiler::ReadCapture(files[0], baselineSamples)) {
+        std::cerr << "Failed to read baseline capture " << files[0] << std::endl;
+        return 2;
+    }
+    if (!Profiler::ReadCapture(files[1], candidateSamples)) {
+        std::cerr << "Failed to read candidate capture " << files[1] << std::endl;
+        return 2;
+    }
+
+    auto baseline = Summarize(baselineSamples);
+    auto candidate = Summarize(candidateSamples);
+
+    // Union of names - samples that appeared or vanished are news too
+    std::vector<DiffRow> rows;
+    auto addRow = [&](const std::string& name) {
+        DiffRow row;
+        row.name = name;
+        auto b = baseline.find(name);
+        auto c = candidate.find(name);
+        row.inBaseline = b != baseline.end();
+        row.inCandidate = c != candidate.end();
+        if (row.inBaseline) row.baseline = b->second;
+        if (row.inCandidate) row.candidate = c->second;
+        row.worstChange = -INFINITY;
+        row.regressed = false;
+
+        bool enoughCalls = row.baseline.callCount >= minCalls && row.candidate.callCount >= minCalls;
+        for (DiffMetric metric : gatedMetrics) {
+            double before = row.baseline.Get(metric);
+            double after = row.candidate.Get(metric);
+            double change = RelativeChange(before, after);
+            row.worstChange = std::max(row.worstChange, change);
+
+            // Timing noise floor - a 2us scope going to 3us is not a headline
+            bool timeMetric = metric != DiffMetric::Calls;
+            bool aboveNoise = !timeMetric || std::max(before, after) >= minTimeMicros;
+            if (row.inBaseline && row.inCandidate && enoughCalls && aboveNoise &&
+                change * 100.0 > thresholdPercent) {
+                row.regressed = true;
+            }
+        }
+        rows.push_back(row);
+    };
+    for (const auto& entry : baseline) addRow(entry.first);
+    for (const auto& entry : candidate) {
+        if (baseline.find(entry.first) == baseline.end()) addRow(entry.first);
+    }
+
+    // Worst first, so the culprit is at the top of the CI log
+    std::sort(rows.begin(), rows.end(), [](const DiffRow& a, const DiffRow& b) {
+        if (a.regressed != b.regressed) return a.regressed;
+        if (a.worstChange != b.worstChange) return a.worstChange > b.worstChange;
+        return a.name < b.name;
+    });
+
+    size_t regressions = 0;
+    for (const DiffRow& row : rows) {
+        if (row.regressed) ++regressions;
+    }
+
+    std::cout << "Baseline:  " << files[0] << " (" << baselineSamples.size() << " samples)" << std::endl;
+    std::cout << "Candidate: " << files[1] << " (" << candidateSamples.size() << " samples)" << std::endl;
+    std::cout << "Gate: ";
+    for (size_t i = 0; i < gatedMetrics.size(); ++i) std::cout << (i ? "," : "") << MetricName(gatedMetrics[i]);
+    std::cout << " > +" << thresholdPercent << "% (noise floor " << minTimeMicros << "us)" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(40) << "sample"
+              << std::right << std::setw(18) << "calls"
+              << std::setw(22) << "total us"
+              << std::setw(22) << "mean us"
+              << std::setw(22) << "p99 us"
+              << std::setw(10) << "worst" << std::endl;
+
+    auto pair = [](double before, double after, int precision) {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(precision) << before << " -> " << after;
+        return out.str();
+    };
+
+    size_t printed = 0;
+    for (const DiffRow& row : rows) {
+        if (topRows && printed++ >= topRows) break;
+
+        std::string status = !row.inBaseline ? "added" : !row.inCandidate ? "removed" : FormatChange(row.worstChange);
+        std::cout << std::left << std::setw(40) << (row.regressed ? "! " : "  ") + row.name
+                  << std::right << std::setw(18) << pair(row.baseline.Get(DiffMetric::Calls), row.candidate.Get(DiffMetric::Calls), 0)
+                  << std::setw(22) << pair(row.baseline.totalMicros, row.candidate.totalMicros, 0)
+                  << std::setw(22) << pair(row.baseline.meanMicros, row.candidate.meanMicros, 1)
+                  << std::setw(22) << pair(row.baseline.p99Micros, row.candidate.p99Micros, 1)
+                  << std::setw(10) << status << std::endl;
+    }
+
+    std::cout << std::endl;
+    if (regressions > 0) {
+        std::cout << regressions << " sample(s) regressed past the threshold" << std::endl;
+        return 1;
+    }
+
+    std::cout << "No regressions past the threshold" << std::endl;
+    return 0;
+}
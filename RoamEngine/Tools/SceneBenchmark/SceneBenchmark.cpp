@@ -0,0 +1,807 @@
+// SceneBenchmark.cpp - The stress test
+// Throws a whole city district at the engine and writes down how long it takes to cry
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "Core/ThreadManager.h"
+#include "Math/Vector3.h"
+#include "Particles/ParticleModules.h"
+
+// Physics, cloth, animation and AI are declared but none of them has a .cpp yet, so each one is
+// behind a switch - define ROAM_BENCH_<SYSTEM>=1 and add its .cpp to the project once it lands.
+// Switched-off systems stay in the report, marked as skipped.
+#ifndef ROAM_BENCH_PHYSICS
+#define ROAM_BENCH_PHYSICS 0
+#endif
+#ifndef ROAM_BENCH_CLOTH
+#define ROAM_BENCH_CLOTH 0
+#endif
+#ifndef ROAM_BENCH_ANIMATION
+#define ROAM_BENCH_ANIMATION 0
+#endif
+#ifndef ROAM_BENCH_AI
+#define ROAM_BENCH_AI 0
+#endif
+
+#if ROAM_BENCH_PHYSICS
+#include "Physics/PhysicsWorld.h"
+#endif
+#if ROAM_BENCH_CLOTH
+#include "Physics/ClothSimulator.h"
+#endif
+#if ROAM_BENCH_ANIMATION
+#include "Animation/Animator.h"
+#endif
+#if ROAM_BENCH_AI
+#include "AI/AIController.h"
+#endif
+
+// RigidBody is still on the TODO list - the physics scene gets bodies once it lands
+#if ROAM_BENCH_PHYSICS && __has_include("Physics/RigidBody.h")
+#include "Physics/RigidBody.h"
+#define ROAM_BENCH_HAS_RIGIDBODY 1
+#else
+#define ROAM_BENCH_HAS_RIGIDBODY 0
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Systems we time - one column each in the report
+enum BenchSystem {
+    SystemPhysics,
+    SystemCloth,
+    SystemParticles,
+    SystemAnimation,
+    SystemAI,
+    SystemCount
+};
+
+const char* const SYSTEM_NAMES[SystemCount] = { "physics", "cloth", "particles", "animation", "ai" };
+const bool SYSTEM_ENABLED[SystemCount] = {
+    ROAM_BENCH_PHYSICS != 0, ROAM_BENCH_CLOTH != 0, true, ROAM_BENCH_ANIMATION != 0, ROAM_BENCH_AI != 0
+};
+
+// Scene config - how big is the party?
+struct SceneConfig {
+    std::string name;
+    int rigidBodies;
+    int clothPatches;
+    int clothResolution;
+    int particleEmitters;
+    int particlesPerEmitter;
+    int characters;
+    int bonesPerCharacter;
+    int agents;
+    int pathQueryInterval; // frames between FindPath calls per agent
+    int frames;
+    int warmupFrames;
+    float deltaTime;
+    std::vector<int> threadCounts;
+
+    SceneConfig() : name("custom"), rigidBodies(0), clothPatches(0), clothResolution(32),
+                    particleEmitters(0), particlesPerEmitter(500), characters(0), bonesPerCharacter(64),
+                    agents(0), pathQueryInterval(30), frames(300), warmupFrames(30),
+                    deltaTime(1.0f / 60.0f) {}
+};
+
+// Presets - from "does it even run" to "can we ship a city district"
+bool ApplyPreset(const std::string& preset, SceneConfig& config) {
+    if (preset == "smoke") {
+        config.rigidBodies = 64;    config.clothPatches = 2;   config.particleEmitters = 8;
+        config.characters = 8;      config.agents = 16;        config.frames = 60;
+        config.warmupFrames = 5;
+    } else if (preset == "block") {
+        config.rigidBodies = 1000;  config.clothPatches = 16;  config.particleEmitters = 64;
+        config.characters = 100;    config.agents = 250;
+    } else if (preset == "district") {
+        config.rigidBodies = 10000; config.clothPatches = 64;  config.particleEmitters = 512;
+        config.characters = 1000;   config.agents = 2500;
+    } else {
+        return false;
+    }
+    config.name = preset;
+    return true;
+}
+
+// Timing sample set - per-frame milliseconds for one system
+struct FrameTimes {
+    std::vector<double> samples;
+
+    double Mean() const {
+        if (samples.empty()) return 0.0;
+        double total = 0.0;
+        for (double s : samples) total += s;
+        return total / samples.size();
+    }
+
+    double Percentile(double p) const {
+        if (samples.empty()) return 0.0;
+        std::vector<double> sorted = samples;
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        return sorted[index];
+    }
+
+    double Max() const {
+        return samples.empty() ? 0.0 : *std::max_element(samples.begin(), samples.end());
+    }
+};
+
+// Memory probes - how much did the city eat?
+size_t GetPeakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#elif defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return static_cast<size_t>(std::strtoull(line.c_str() + 6, nullptr, 10)) * 1024;
+        }
+    }
+    return 0;
+#elif defined(__APPLE__)
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return 0;
+#endif
+}
+
+// Reset the high-water mark so each scene reports its own peak (Linux only, others report process peak)
+void ResetPeakResident() {
+#if defined(__linux__)
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs) clearRefs << "5";
+#endif
+}
+
+// Worker group - persistent threads so we time the systems, not thread creation
+class WorkerGroup {
+public:
+    explicit WorkerGroup(int count) : threadCount(std::max(1, count)), currentTask(nullptr),
+                                      generation(0), pending(0), stopping(false) {
+        for (int i = 1; i < threadCount; ++i) {
+            threads.emplace_back(&WorkerGroup::WorkerLoop, this, i);
+        }
+    }
+
+    ~WorkerGroup() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        startSignal.notify_all();
+        for (auto& thread : threads) thread.join();
+    }
+
+    int GetThreadCount() const { return threadCount; }
+
+    // Run task(shard) for every shard and wait - the calling thread takes shard 0
+    void Run(const std::function<void(int)>& task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentTask = &task;
+            pending = threadCount - 1;
+            ++generation;
+        }
+        startSignal.notify_all();
+
+        task(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        doneSignal.wait(lock, [this]() { return pending == 0; });
+        currentTask = nullptr;
+    }
+
+private:
+    void WorkerLoop(int index) {
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            const std::function<void(int)>* task = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                startSignal.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                task = currentTask;
+            }
+
+            (*task)(index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) doneSignal.notify_one();
+        }
+    }
+
+    int threadCount;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable startSignal;
+    std::condition_variable doneSignal;
+    const std::function<void(int)>* currentTask;
+    uint64_t generation;
+    int pending;
+    bool stopping;
+};
+
+// Bench particle - the minimum state a CPU particle needs
+struct BenchParticle {
+    Vector3 position;
+    Vector3 velocity;
+    float age;
+    float lifetime;
+    float size;
+    float rotation;
+    uint32_t color;
+};
+
+// Bench emitter - simulates the modules of a ParticleModuleCollection on the CPU
+// There is no ParticleSystem yet, so this stands in with the same per-particle work one would do
+class BenchEmitter {
+public:
+    BenchEmitter(const ParticleModuleCollection& collection, uint32_t seed)
+        : modules(collection), emitAccumulator(0.0f), rng(seed) {
+        particles.reserve(modules.main.maxParticles);
+    }
+
+    void Update(float deltaTime) {
+        float dt = deltaTime * modules.main.simulationSpeed;
+        Emit(dt);
+
+        Vector3 gravityStep = modules.main.gravity * (modules.main.gravityModifier * dt);
+        for (size_t i = 0; i < particles.size();) {
+            BenchParticle& p = particles[i];
+            p.age += dt;
+            if (p.age >= p.lifetime) {
+                p = particles.back();
+                particles.pop_back();
+                continue;
+            }
+
+            float t = p.age / p.lifetime;
+            p.velocity += gravityStep;
+            p.velocity += Vector3(modules.velocity.velocityCurveX.Evaluate(t),
+                                  modules.velocity.velocityCurveY.Evaluate(t),
+                                  modules.velocity.velocityCurveZ.Evaluate(t)) * dt;
+            p.position += p.velocity * (dt * modules.velocity.speedModifier.Evaluate(t));
+            p.size = modules.size.startSize + (modules.size.endSize - modules.size.startSize) * modules.size.sizeCurve.Evaluate(t);
+            p.rotation += modules.rotation.angularVelocity.Evaluate(t) * dt;
+            p.color = PackColor(modules.color.colorCurveR.Evaluate(t), modules.color.colorCurveG.Evaluate(t),
+                                modules.color.colorCurveB.Evaluate(t), modules.color.colorCurveA.Evaluate(t));
+            ++i;
+        }
+    }
+
+    size_t GetParticleCount() const { return particles.size(); }
+
+private:
+    void Emit(float dt) {
+        emitAccumulator += modules.emission.emissionRate * dt;
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        while (emitAccumulator >= 1.0f && particles.size() < static_cast<size_t>(modules.main.maxParticles)) {
+            emitAccumulator -= 1.0f;
+            BenchParticle p;
+            p.position = modules.shape.position + Vector3(unit(rng), unit(rng), unit(rng)) * modules.shape.radius;
+            p.velocity = modules.velocity.linearVelocity + Vector3(unit(rng), 1.0f, unit(rng));
+            p.age = 0.0f;
+            p.lifetime = modules.main.duration * (0.5f + 0.5f * (unit(rng) * 0.5f + 0.5f));
+            p.size = modules.size.startSize;
+            p.rotation = modules.rotation.startRotation;
+            p.color = modules.color.startColor;
+            particles.push_back(p);
+        }
+        if (emitAccumulator > 1.0f) emitAccumulator = 1.0f;
+    }
+
+    static uint32_t PackColor(float r, float g, float b, float a) {
+        auto channel = [](float v) { return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f); };
+        return (channel(r) << 24) | (channel(g) << 16) | (channel(b) << 8) | channel(a);
+    }
+
+    ParticleModuleCollection modules;
+    std::vector<BenchParticle> particles;
+    float emitAccumulator;
+    std::mt19937 rng;
+};
+
+// Scene shard - everything one worker thread owns, nothing shared
+struct SceneShard {
+#if ROAM_BENCH_PHYSICS
+    std::unique_ptr<PhysicsWorld> physics;
+#endif
+#if ROAM_BENCH_CLOTH
+    std::vector<std::unique_ptr<ClothSimulator>> cloths;
+#endif
+    std::vector<std::unique_ptr<BenchEmitter>> emitters;
+#if ROAM_BENCH_ANIMATION
+    std::vector<std::shared_ptr<AnimationClip>> clips;
+    std::vector<std::unique_ptr<Animator>> animators;
+#endif
+#if ROAM_BENCH_AI
+    std::vector<std::unique_ptr<AIController>> agents;
+    std::vector<Vector3> agentGoals;
+#endif
+    std::mt19937 rng;
+
+    SceneShard() : rng(1337) {}
+};
+
+// Split count items across shards - the first shards take the leftovers
+int ShareOf(int total, int shard, int shardCount) {
+    return total / shardCount + (shard < total % shardCount ? 1 : 0);
+}
+
+ParticleModuleCollection MakeEmitterModules(int maxParticles) {
+    ParticleModuleCollection modules;
+    modules.main.maxParticles = maxParticles;
+    modules.main.duration = 3.0f;
+    modules.main.looping = true;
+    modules.emission.emissionRate = maxParticles / modules.main.duration;
+    modules.shape.shape = ShapeModuleSettings::ShapeType::Sphere;
+    modules.shape.radius = 0.5f;
+    modules.velocity.speedModifier.type = Curve::CurveType::EaseOut;
+    modules.velocity.speedModifier.startValue = 1.0f;
+    modules.velocity.speedModifier.endValue = 0.2f;
+    modules.size.sizeCurve.type = Curve::CurveType::Linear;
+    modules.color.colorCurveA.type = Curve::CurveType::EaseIn;
+    modules.color.colorCurveA.startValue = 1.0f;
+    modules.color.colorCurveA.endValue = 0.0f;
+    modules.rotation.angularVelocity.type = Curve::CurveType::Constant;
+    modules.rotation.angularVelocity.startValue = 1.5f;
+    return modules;
+}
+
+#if ROAM_BENCH_ANIMATION
+std::shared_ptr<AnimationClip> MakeClip(const std::string& name, int bones, float duration, std::mt19937& rng) {
+    auto clip = std::make_shared<AnimationClip>(name);
+    clip->SetDuration(duration);
+    clip->SetLoopMode(LoopMode::Loop);
+
+    std::vector<StringId> boneNames;
+    for (int b = 0; b < bones; ++b) boneNames.push_back(StringInterner::GetInstance().Intern("bone" + std::to_string(b)));
+
+    std::uniform_real_distribution<float> angle(-1.0f, 1.0f);
+    const int keyCount = 16;
+    for (int k = 0; k <= keyCount; ++k) {
+        Keyframe key;
+        key.time = duration * k / keyCount;
+        key.interpolation = InterpolationType::Linear;
+        for (StringId bone : boneNames) {
+            key.values[bone] = angle(rng);
+        }
+        clip->AddKeyframe(key);
+    }
+    return clip;
+}
+#endif
+
+void BuildShard(const SceneConfig& config, int shard, int shardCount, SceneShard& out) {
+    out.rng.seed(1337u + shard);
+
+#if ROAM_BENCH_PHYSICS
+    // Physics - one world per shard, so this measures throughput rather than a parallel solver
+    out.physics = std::make_unique<PhysicsWorld>();
+    out.physics->Initialize();
+#if ROAM_BENCH_HAS_RIGIDBODY
+    for (int i = 0; i < ShareOf(config.rigidBodies, shard, shardCount); ++i) {
+        out.physics->AddRigidBody(std::make_shared<RigidBody>());
+    }
+#endif
+#endif
+
+#if ROAM_BENCH_CLOTH
+    // Cloth - flags pinned along the top edge with a bit of wind
+    for (int i = 0; i < ShareOf(config.clothPatches, shard, shardCount); ++i) {
+        auto cloth = std::make_unique<ClothSimulator>();
+        cloth->Initialize(config.clothResolution, config.clothResolution, 0.1f);
+        for (int x = 0; x < config.clothResolution; ++x) {
+            cloth->SetParticleFixed(x, 0, true);
+        }
+        cloth->AddWindForce(WindForce());
+        out.cloths.push_back(std::move(cloth));
+    }
+#endif
+
+    // Particles
+    ParticleModuleCollection modules = MakeEmitterModules(config.particlesPerEmitter);
+    for (int i = 0; i < ShareOf(config.particleEmitters, shard, shardCount); ++i) {
+        out.emitters.push_back(std::make_unique<BenchEmitter>(modules, out.rng()));
+    }
+
+#if ROAM_BENCH_ANIMATION
+    // Animation - characters share a small clip set like a real crowd would
+    if (config.characters > 0) {
+        out.clips.push_back(MakeClip("idle", config.bonesPerCharacter, 2.0f, out.rng));
+        out.clips.push_back(MakeClip("walk", config.bonesPerCharacter, 1.0f, out.rng));
+        out.clips.push_back(MakeClip("run", config.bonesPerCharacter, 0.6f, out.rng));
+    }
+    for (int i = 0; i < ShareOf(config.characters, shard, shardCount); ++i) {
+        auto animator = std::make_unique<Animator>();
+        for (const auto& clip : out.clips) {
+            animator->AddClip(clip);
+            animator->AddState(clip->GetName(), clip);
+        }
+        const auto& startClip = out.clips[i % out.clips.size()];
+        animator->SetCurrentState(startClip->GetName());
+        animator->Play(startClip->GetName());
+        out.animators.push_back(std::move(animator));
+    }
+#endif
+
+#if ROAM_BENCH_AI
+    // AI - agents wandering a 1km square
+    std::uniform_real_distribution<float> coord(-500.0f, 500.0f);
+    for (int i = 0; i < ShareOf(config.agents, shard, shardCount); ++i) {
+        auto agent = std::make_unique<AIController>();
+        agent->Initialize();
+        agent->SetBehavior(static_cast<AIBehavior>(i % 6));
+
+        AISensorData sensors;
+        sensors.position = Vector3(coord(out.rng), 0.0f, coord(out.rng));
+        sensors.velocity = Vector3(0.0f);
+        sensors.health = 100.0f;
+        sensors.canSeePlayer = (i % 4) == 0;
+        sensors.canHearPlayer = (i % 3) == 0;
+        sensors.lastKnownPlayerPosition = Vector3(0.0f);
+        sensors.distanceToPlayer = sensors.position.Length();
+        agent->UpdateSensorData(sensors);
+
+        out.agents.push_back(std::move(agent));
+        out.agentGoals.push_back(Vector3(coord(out.rng), 0.0f, coord(out.rng)));
+    }
+#endif
+}
+
+void UpdateShardSystem(BenchSystem system, SceneShard& shard, const SceneConfig& config, int frame) {
+    float dt = config.deltaTime;
+    (void)frame;
+    switch (system) {
+#if ROAM_BENCH_PHYSICS
+        case SystemPhysics:
+            shard.physics->Update(dt);
+            break;
+#endif
+#if ROAM_BENCH_CLOTH
+        case SystemCloth:
+            for (auto& cloth : shard.cloths) cloth->Update(dt);
+            break;
+#endif
+        case SystemParticles:
+            for (auto& emitter : shard.emitters) emitter->Update(dt);
+            break;
+#if ROAM_BENCH_ANIMATION
+        case SystemAnimation:
+            for (auto& animator : shard.animators) {
+                animator->Update(dt);
+                animator->GetCurrentValues();
+            }
+            break;
+#endif
+#if ROAM_BENCH_AI
+        case SystemAI:
+            for (size_t i = 0; i < shard.agents.size(); ++i) {
+                AIController& agent = *shard.agents[i];
+                agent.Update(dt);
+                // Stagger path queries so every frame gets its fair share
+                if (config.pathQueryInterval > 0 &&
+                    (frame + static_cast<int>(i)) % config.pathQueryInterval == 0) {
+                    agent.FindPath(agent.GetSensorData().position, shard.agentGoals[i]);
+                }
+            }
+            break;
+#endif
+        default:
+            break;
+    }
+}
+
+// Result of one scene at one thread count
+struct RunResult {
+    int threads;
+    FrameTimes systemTimes[SystemCount];
+    FrameTimes frameTimes;
+    size_t peakResidentBytes;
+    double buildSeconds;
+};
+
+RunResult RunScene(const SceneConfig& config, int threadCount) {
+    RunResult result;
+    result.threads = threadCount;
+
+    ResetPeakResident();
+    auto buildStart = Clock::now();
+
+    WorkerGroup workers(threadCount);
+    std::vector<SceneShard> shards(workers.GetThreadCount());
+    // Build on the owning thread so first-touch memory lands where it will be used
+    workers.Run([&](int shard) { BuildShard(config, shard, workers.GetThreadCount(), shards[shard]); });
+
+    result.buildSeconds = std::chrono::duration<double>(Clock::now() - buildStart).count();
+
+    for (int frame = 0; frame < config.warmupFrames + config.frames; ++frame) {
+        bool measured = frame >= config.warmupFrames;
+        auto frameStart = Clock::now();
+
+        for (int s = 0; s < SystemCount; ++s) {
+            if (!SYSTEM_ENABLED[s]) continue;
+            BenchSystem system = static_cast<BenchSystem>(s);
+            auto start = Clock::now();
+            workers.Run([&](int shard) { UpdateShardSystem(system, shards[shard], config, frame); });
+            if (measured) {
+                result.systemTimes[s].samples.push_back(
+                    std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+        }
+
+        if (measured) {
+            result.frameTimes.samples.push_back(
+                std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+        }
+    }
+
+    result.peakResidentBytes = GetPeakResidentBytes();
+    return result;
+}
+
+// Fork/join through the job system - every node submits its two halves and waits on them, so there's
+// a Wait at every level of a deep tree. With fibers each one parks a fiber; past the pool's cap the
+// workers have to carry on on their own stacks, which is what this is here to catch.
+uint64_t ForkJoin(ThreadManager& jobs, int depth) {
+    if (depth < 2) return static_cast<uint64_t>(depth);
+    uint64_t left = 0;
+    uint64_t right = 0;
+    JobCounter counter;
+    jobs.Submit([&]() { left = ForkJoin(jobs, depth - 1); }, JobPriority::Normal, &counter);
+    jobs.Submit([&]() { right = ForkJoin(jobs, depth - 2); }, JobPriority::Normal, &counter);
+    jobs.Wait(counter);
+    return left + right;
+}
+
+// Fibers on, every other setting at its default - false if the tree added up wrong
+bool RunForkJoinCheck(int depth, int threadCount) {
+    ThreadManager jobs;
+    FiberSettings fibers;
+    fibers.enabled = true;
+    jobs.Initialize(threadCount, fibers);
+
+    auto start = Clock::now();
+    uint64_t result = 0;
+    JobCounter done;
+    jobs.Submit([&]() { result = ForkJoin(jobs, depth); }, JobPriority::Normal, &done);
+    jobs.Wait(done);
+    double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // It's Fibonacci
+    uint64_t expected = 0;
+    uint64_t next = 1;
+    for (int i = 0; i < depth; ++i) {
+        uint64_t sum = expected + next;
+        expected = next;
+        next = sum;
+    }
+
+    ThreadManager::FiberStats stats = jobs.GetFiberStats();
+    std::cout << "Fork/join depth " << depth << " on " << threadCount << " worker(s): " << milliseconds << " ms, ";
+    if (jobs.IsUsingFibers()) std::cout << stats.fibers << " fibers";
+    else std::cout << "no fibers on this platform";
+    std::cout << (result == expected ? "" : " - WRONG RESULT") << std::endl;
+    jobs.Shutdown();
+    return result == expected;
+}
+
+const char* SkippedNote(BenchSystem system) {
+    return SYSTEM_ENABLED[system] ? "" : " (skipped - not built in)";
+}
+
+void PrintSceneHeader(const SceneConfig& config) {
+    std::cout << "Scene '" << config.name << "': "
+              << config.rigidBodies << " rigid bodies"
+              << (!SYSTEM_ENABLED[SystemPhysics] ? SkippedNote(SystemPhysics)
+                  : ROAM_BENCH_HAS_RIGIDBODY ? "" : " (skipped - no RigidBody yet)") << ", "
+              << config.clothPatches << " cloth patches (" << config.clothResolution << "x" << config.clothResolution << ")"
+              << SkippedNote(SystemCloth) << ", "
+              << config.particleEmitters << " emitters (" << config.particlesPerEmitter << " max particles), "
+              << config.characters << " characters (" << config.bonesPerCharacter << " bones)"
+              << SkippedNote(SystemAnimation) << ", "
+              << config.agents << " agents" << SkippedNote(SystemAI) << std::endl;
+    std::cout << "Frames: " << config.frames << " measured after " << config.warmupFrames
+              << " warmup, dt " << config.deltaTime << "s" << std::endl << std::endl;
+}
+
+void PrintResults(const std::vector<RunResult>& results) {
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << std::left << std::setw(9) << "threads";
+    for (int s = 0; s < SystemCount; ++s) std::cout << std::setw(12) << SYSTEM_NAMES[s];
+    std::cout << std::setw(12) << "frame" << std::setw(12) << "frame p99" << std::setw(10) << "speedup"
+              << std::setw(10) << "peak MB" << std::endl;
+
+    double baseline = results.empty() ? 0.0 : results.front().frameTimes.Mean();
+    for (const RunResult& r : results) {
+        std::cout << std::setw(9) << r.threads;
+        for (int s = 0; s < SystemCount; ++s) {
+            if (SYSTEM_ENABLED[s]) {
+                std::cout << std::setw(12) << r.systemTimes[s].Mean();
+            } else {
+                std::cout << std::setw(12) << "-";
+            }
+        }
+        double frame = r.frameTimes.Mean();
+        std::cout << std::setw(12) << frame << std::setw(12) << r.frameTimes.Percentile(0.99)
+                  << std::setw(10) << (frame > 0.0 ? baseline / frame : 0.0)
+                  << std::setw(10) << r.peakResidentBytes / (1024.0 * 1024.0) << std::endl;
+    }
+    std::cout << "(per-system columns are mean ms/frame, - for systems not built in)" << std::endl;
+}
+
+bool WriteCsv(const std::string& filename, const SceneConfig& config, const std::vector<RunResult>& results) {
+    std::ofstream out(filename);
+    if (!out) return false;
+
+    out << "scene,threads,system,mean_ms,p95_ms,p99_ms,max_ms,peak_resident_bytes,build_seconds\n";
+    for (const RunResult& r : results) {
+        for (int s = 0; s <= SystemCount; ++s) {
+            if (s < SystemCount && !SYSTEM_ENABLED[s]) continue;
+            const FrameTimes& times = s < SystemCount ? r.systemTimes[s] : r.frameTimes;
+            out << config.name << ',' << r.threads << ',' << (s < SystemCount ? SYSTEM_NAMES[s] : "frame") << ','
+                << times.Mean() << ',' << times.Percentile(0.95) << ',' << times.Percentile(0.99) << ','
+                << times.Max() << ',' << r.peakResidentBytes << ',' << r.buildSeconds << '\n';
+        }
+    }
+    return true;
+}
+
+std::vector<int> ParseThreadList(const std::string& text) {
+    std::vector<int> counts;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        int value = std::atoi(item.c_str());
+        if (value > 0) counts.push_back(value);
+    }
+    return counts;
+}
+
+std::vector<int> DefaultThreadCounts() {
+    int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> counts;
+    for (int t = 1; t < hardware; t *= 2) counts.push_back(t);
+    counts.push_back(hardware);
+    return counts;
+}
+
+void PrintUsage() {
+    std::cout << "Usage: SceneBenchmark [options]\n"
+                 "  --scene <smoke|block|district>  start from a preset (default: block)\n"
+                 "  --bodies N        rigid bodies in the PhysicsWorld\n"
+                 "  --cloth N         cloth patches\n"
+                 "  --cloth-res N     particles per cloth edge\n"
+                 "  --emitters N      particle emitters\n"
+                 "  --particles N     max particles per emitter\n"
+                 "  --characters N    animated characters\n"
+                 "  --bones N         animated properties per character\n"
+                 "  --agents N        AI agents\n"
+                 "  --path-every N    frames between FindPath calls per agent (0 = never)\n"
+                 "  --frames N        measured frames\n"
+                 "  --warmup N        unmeasured warmup frames\n"
+                 "  --threads a,b,c   thread counts for the scaling curve (default: 1,2,4..cores)\n"
+                 "  --csv file        also write results as CSV\n"
+                 "  --fork-join N     depth of the job system fork/join check, fibers on (default: 22, 0 = skip)\n";
+}
+
+} // namespace
+
+// Main - build the city, run the city, judge the city
+int main(int argc, char* argv[]) {
+    SceneConfig config;
+    ApplyPreset("block", config);
+    std::string csvFile;
+    int forkJoinDepth = 22;
+
+    // Preset first, wherever it is on the command line, so the counts given alongside it win
+    for (int i = 1; i + 1 < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") continue;
+        std::string value = argv[++i];
+        if (arg == "--scene" && !ApplyPreset(value, config)) {
+            std::cerr << "Unknown scene preset '" << value << "'" << std::endl;
+            return 2;
+        }
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            PrintUsage();
+            return 2;
+        }
+
+        std::string value = argv[++i];
+        int number = std::atoi(value.c_str());
+        if (arg == "--scene") continue; // already applied
+        else if (arg == "--bodies") config.rigidBodies = number;
+        else if (arg == "--cloth") config.clothPatches = number;
+        else if (arg == "--cloth-res") config.clothResolution = std::max(2, number);
+        else if (arg == "--emitters") config.particleEmitters = number;
+        else if (arg == "--particles") config.particlesPerEmitter = std::max(1, number);
+        else if (arg == "--characters") config.characters = number;
+        else if (arg == "--bones") config.bonesPerCharacter = std::max(1, number);
+        else if (arg == "--agents") config.agents = number;
+        else if (arg == "--path-every") config.pathQueryInterval = number;
+        else if (arg == "--frames") config.frames = std::max(1, number);
+        else if (arg == "--warmup") config.warmupFrames = std::max(0, number);
+        else if (arg == "--threads") config.threadCounts = ParseThreadList(value);
+        else if (arg == "--csv") csvFile = value;
+        else if (arg == "--fork-join") forkJoinDepth = std::clamp(number, 0, 40);
+        else {
+            std::cerr << "Unknown option " << arg << std::endl;
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (config.threadCounts.empty()) {
+        config.threadCounts = DefaultThreadCounts();
+    }
+
+    PrintSceneHeader(config);
+
+    std::vector<RunResult> results;
+    for (int threads : config.threadCounts) {
+        std::cout << "Running with " << threads << " thread(s)..." << std::endl;
+        results.push_back(RunScene(config, threads));
+    }
+
+    std::cout << std::endl;
+    PrintResults(results);
+
+    bool jobsOk = true;
+    if (forkJoinDepth > 0) {
+        std::cout << std::endl;
+        for (int threads : config.threadCounts) {
+            jobsOk = RunForkJoinCheck(forkJoinDepth, threads) && jobsOk;
+        }
+    }
+
+    if (!csvFile.empty() && !WriteCsv(csvFile, config, results)) {
+        std::cerr << "Failed to write CSV to " << csvFile << std::endl;
+        return 1;
+    }
+
+    return jobsOk ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+// FloatingOrigin.cpp - Implementation of the moving centre of the universe
+// Snap, shift, tell everyone
+
+#include "FloatingOrigin.h"
+#include <algorithm>
+#include <cmath>
+
+FloatingOrigin::FloatingOrigin() : nextListenerId(1) {
+}
+
+FloatingOrigin::~FloatingOrigin() {
+}
+
+uint32_t FloatingOrigin::AddListener(ShiftCallback callback) {
+    uint32_t id = nextListenerId++;
+    listeners.emplace_back(id, std::move(callback));
+    return id;
+}
+
+void FloatingOrigin::RemoveListener(uint32_t id) {
+    listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+        [id](const auto& listener) { return listener.first == id; }), listeners.end());
+}
+
+bool FloatingOrigin::Update(const Vector3& focus) {
+    double dx = focus.x;
+    double dy = settings.includeHeight ? focus.y : 0.0;
+    double dz = focus.z;
+    if (dx * dx + dy * dy + dz * dz <= settings.rebaseDistance * settings.rebaseDistance) return false;
+
+    Vector3d target = ToWorld(focus);
+    if (!settings.includeHeight) target.y = origin.y;
+    Vector3d before = origin;
+    Rebase(target);
+    return origin != before;
+}
+
+void FloatingOrigin::Rebase(const Vector3d& newOrigin) {
+    Vector3d snapped = Snap(newOrigin);
+    if (snapped == origin) return;
+
+    // Both origins are on the snap grid, so the difference is exact - and it stays exact as a float
+    // as long as it's under 2^24 snaps, which no single rebase comes near
+    Vector3 shift = (snapped - origin).ToVector3();
+    origin = snapped;
+    stats.rebases++;
+    stats.lastShift = shift;
+
+    // A listener removing itself mid-rebase is fine - copy first
+    auto current = listeners;
+    for (auto& [id, callback] : current) callback(shift);
+}
+
+Vector3d FloatingOrigin::Snap(const Vector3d& position) const {
+    if (settings.snap <= 0.0) return position;
+    return Vector3d(std::round(position.x / settings.snap) * settings.snap,
+                    std::round(position.y / settings.snap) * settings.snap,
+                    std::round(position.z / settings.snap) * settings.snap);
+}
@@ -0,0 +1,76 @@
+// FloatingOrigin.h - The moving centre of the universe
+// Keeps everything that simulates or draws in floats close to zero by dragging zero along with the player
+
+#ifndef FLOATINGORIGIN_H
+#define FLOATINGORIGIN_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+
+// Tuning
+struct FloatingOriginSettings {
+    double rebaseDistance = 2048.0; // how far the focus can wander from the origin before it moves
+    double snap = 128.0;            // the origin only sits on multiples of this - keep it the cell size so shifts are exact in floats
+    bool includeHeight = false;     // y too - only worth it for worlds that go very high or very deep
+};
+
+struct FloatingOriginStats {
+    uint32_t rebases = 0;
+    Vector3 lastShift;
+};
+
+// The FloatingOrigin class - world positions are Vector3d, everything per frame (physics, audio, particles,
+// the camera, render transforms) is Vector3 relative to GetOrigin. When the focus - the player, usually -
+// strays past rebaseDistance, the origin jumps to the snapped point under it and every listener is told
+// to subtract the shift from whatever float positions it holds. Because the origin is always on the snap
+// grid the shift is a whole multiple of it, so subtracting it loses nothing. Main thread only, between
+// simulation steps - listeners run right there inside Update.
+class FloatingOrigin {
+public:
+    using ShiftCallback = std::function<void(const Vector3& shift)>;
+
+    FloatingOrigin();
+    ~FloatingOrigin();
+
+    void SetSettings(const FloatingOriginSettings& newSettings) { settings = newSettings; }
+    const FloatingOriginSettings& GetSettings() const { return settings; }
+
+    // Where local zero is in the world
+    const Vector3d& GetOrigin() const { return origin; }
+
+    // World <-> local
+    Vector3 ToLocal(const Vector3d& world) const { return (world - origin).ToVector3(); }
+    Vector3d ToWorld(const Vector3& local) const { return origin + Vector3d(local); }
+
+    // Told the shift on every rebase - Camera, AudioEngine, PhysicsWorld, ClothSimulator and AIController
+    // all have a ShiftOrigin to hook up. Returns an id for RemoveListener.
+    uint32_t AddListener(ShiftCallback callback);
+    void RemoveListener(uint32_t id);
+
+    // Per frame, with the focus in local space - returns true if the origin moved
+    bool Update(const Vector3& focus);
+
+    // Move the origin now - a teleport, or loading a save. Snapped like any other rebase.
+    void Rebase(const Vector3d& newOrigin);
+
+    const FloatingOriginStats& GetStats() const { return stats; }
+
+private:
+    // Prevent copying - the listeners point back at whoever registered them
+    FloatingOrigin(const FloatingOrigin&) = delete;
+    FloatingOrigin& operator=(const FloatingOrigin&) = delete;
+
+    Vector3d Snap(const Vector3d& position) const;
+
+    FloatingOriginSettings settings;
+    FloatingOriginStats stats;
+    Vector3d origin;
+    std::vector<std::pair<uint32_t, ShiftCallback>> listeners;
+    uint32_t nextListenerId;
+};
+
+#endif // FLOATINGORIGIN_H
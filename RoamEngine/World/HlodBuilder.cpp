@@ -0,0 +1,350 @@
+// HlodBuilder.cpp - Implementation of the model railway
+// Merge, cluster, repeat - each level a quarter of the nodes and half the detail of the one below
+
+#include "HlodBuilder.h"
+#include "Assets/AssetCooker.h"
+#include "Assets/AssetManager.h"
+#include "Assets/CookedFormats.h"
+#include "Core/ThreadManager.h"
+#include "Math/FileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <span>
+#include <unordered_map>
+
+namespace {
+    constexpr float DegreesToRadians = 3.14159265358979f / 180.0f;
+
+    // While merging every vertex has all three attributes - the ones nobody used are trimmed at the end
+    constexpr size_t MergeStride = 8;
+
+    struct MergedMesh {
+        uint32_t attributes = CookedVertexPosition;
+        std::vector<float> vertices;
+        std::map<std::string, std::vector<uint32_t>> triangles; // by material, so each stays one submesh
+    };
+
+    // One node on one level, and what came of it
+    struct Node {
+        WorldCell cell;
+        AssetCooker::MeshData mesh;     // in the node's space, empty if there's nothing to draw
+        float error = 0.0f;
+        std::vector<size_t> children;   // into the level below
+        std::vector<size_t> objects;    // level 0 - into the cell's manifest
+        size_t source = 0;              // level 0 - which cell
+    };
+
+    // Euler angles in degrees - roll about Z, then pitch about X, then yaw about Y
+    struct Rotation {
+        Vector3 rows[3] = { Vector3(1, 0, 0), Vector3(0, 1, 0), Vector3(0, 0, 1) };
+
+        Rotation() = default;
+        explicit Rotation(const Vector3& degrees) {
+            float cx = std::cos(degrees.x * DegreesToRadians), sx = std::sin(degrees.x * DegreesToRadians);
+            float cy = std::cos(degrees.y * DegreesToRadians), sy = std::sin(degrees.y * DegreesToRadians);
+            float cz = std::cos(degrees.z * DegreesToRadians), sz = std::sin(degrees.z * DegreesToRadians);
+            rows[0] = Vector3(cy * cz + sy * sx * sz, -cy * sz + sy * sx * cz, sy * cx);
+            rows[1] = Vector3(cx * sz, cx * cz, -sx);
+            rows[2] = Vector3(-sy * cz + cy * sx * sz, sy * sz + cy * sx * cz, cy * cx);
+        }
+
+        Vector3 Apply(const Vector3& vector) const {
+            return Vector3(Vector3::Dot(rows[0], vector), Vector3::Dot(rows[1], vector), Vector3::Dot(rows[2], vector));
+        }
+    };
+
+    void Append(MergedMesh& merged, const AssetCooker::MeshData& mesh, const Vector3& offset, const Rotation& rotation, const Vector3& scale) {
+        size_t stride = mesh.GetStride();
+        bool hasNormals = (mesh.attributes & CookedVertexNormal) != 0;
+        bool hasTexCoords = (mesh.attributes & CookedVertexTexCoord) != 0;
+        merged.attributes |= mesh.attributes;
+
+        uint32_t base = static_cast<uint32_t>(merged.vertices.size() / MergeStride);
+        for (size_t i = 0; i + stride <= mesh.vertices.size(); i += stride) {
+            const float* vertex = mesh.vertices.data() + i;
+            Vector3 position = rotation.Apply(Vector3(vertex[0] * scale.x, vertex[1] * scale.y, vertex[2] * scale.z)) + offset;
+            merged.vertices.insert(merged.vertices.end(), { position.x, position.y, position.z });
+
+            // Normals take the inverse scale, so squashed things still light right
+            Vector3 normal;
+            if (hasNormals) {
+                const float* source = vertex + 3;
+                normal = Vector3(scale.x != 0.0f ? source[0] / scale.x : 0.0f,
+                                 scale.y != 0.0f ? source[1] / scale.y : 0.0f,
+                                 scale.z != 0.0f ? source[2] / scale.z : 0.0f);
+                normal = rotation.Apply(normal).Normalized();
+            }
+            merged.vertices.insert(merged.vertices.end(), { normal.x, normal.y, normal.z });
+
+            const float* texCoord = vertex + (hasNormals ? 6 : 3);
+            merged.vertices.push_back(hasTexCoords ? texCoord[0] : 0.0f);
+            merged.vertices.push_back(hasTexCoords ? texCoord[1] : 0.0f);
+        }
+
+        for (const CookedSubmesh& submesh : mesh.submeshes) {
+            std::vector<uint32_t>& target = merged.triangles[mesh.materials[submesh.materialIndex]];
+            for (uint32_t i = submesh.firstIndex; i < submesh.firstIndex + submesh.indexCount; ++i) target.push_back(base + mesh.indices[i]);
+        }
+    }
+
+    AssetCooker::MeshData Finish(MergedMesh& merged) {
+        AssetCooker::MeshData mesh;
+        mesh.attributes = merged.attributes;
+        bool keepNormals = (mesh.attributes & CookedVertexNormal) != 0;
+        bool keepTexCoords = (mesh.attributes & CookedVertexTexCoord) != 0;
+        mesh.vertices.reserve(merged.vertices.size() / MergeStride * mesh.GetStride());
+        for (size_t i = 0; i + MergeStride <= merged.vertices.size(); i += MergeStride) {
+            const float* vertex = merged.vertices.data() + i;
+            mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + 3);
+            if (keepNormals) mesh.vertices.insert(mesh.vertices.end(), vertex + 3, vertex + 6);
+            if (keepTexCoords) mesh.vertices.insert(mesh.vertices.end(), vertex + 6, vertex + 8);
+        }
+
+        for (auto& [material, indices] : merged.triangles) {
+            if (indices.empty()) continue;
+            CookedSubmesh submesh{};
+            submesh.firstIndex = static_cast<uint32_t>(mesh.indices.size());
+            submesh.indexCount = static_cast<uint32_t>(indices.size());
+            submesh.materialIndex = static_cast<uint32_t>(mesh.materials.size());
+            mesh.materials.push_back(material);
+            mesh.submeshes.push_back(submesh);
+            mesh.indices.insert(mesh.indices.end(), indices.begin(), indices.end());
+        }
+        merged = MergedMesh();
+        return mesh;
+    }
+
+    // LOD 0 of a cooked mesh, widened back out to 32-bit indices
+    bool ReadCookedMesh(const std::string& path, AssetCooker::MeshData& mesh, std::string& error) {
+        std::shared_ptr<MappedFile> mapping = FileSystem::MapFile(path);
+        const CookedMesh* cooked = mapping ? GetCooked<CookedMesh>(mapping->GetData()) : nullptr;
+        if (!cooked) {
+            error = mapping ? path + " isn't a cooked mesh this build understands" : "can't open " + path;
+            return false;
+        }
+
+        mesh.attributes = cooked->attributes;
+        const float* vertices = reinterpret_cast<const float*>(cooked->vertices.data());
+        mesh.vertices.assign(vertices, vertices + cooked->vertices.size() / sizeof(float));
+        mesh.indices.resize(cooked->indexCount);
+        for (uint32_t i = 0; i < cooked->indexCount; ++i) {
+            if (cooked->indexSize == 2) {
+                mesh.indices[i] = reinterpret_cast<const uint16_t*>(cooked->indices.data())[i];
+            } else {
+                mesh.indices[i] = reinterpret_cast<const uint32_t*>(cooked->indices.data())[i];
+            }
+        }
+        mesh.submeshes.assign(cooked->submeshes.begin(), cooked->submeshes.end());
+        for (const CookedString& material : cooked->materials) mesh.materials.emplace_back(material.View());
+        return true;
+    }
+
+    uint64_t HashMesh(const AssetCooker::MeshData& mesh) {
+        uint64_t hash = AssetCooker::HashSource(std::as_bytes(std::span<const float>(mesh.vertices)));
+        return hash * 0x9E3779B97F4A7C15ull ^ AssetCooker::HashSource(std::as_bytes(std::span<const uint32_t>(mesh.indices)));
+    }
+}
+
+HlodBuilder::HlodBuilder() : jobSystem(nullptr) {
+}
+
+HlodBuilder::~HlodBuilder() {
+}
+
+bool HlodBuilder::AddCellDirectory(const std::string& directory, std::string& error) {
+    std::error_code code;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, code)) {
+        std::string name = entry.path().filename().string();
+        if (!entry.is_regular_file() || name.rfind("cell_", 0) != 0 || entry.path().extension() != ".cell") continue;
+
+        std::ifstream file(entry.path(), std::ios::binary);
+        if (!file) {
+            error = "can't read " + entry.path().string();
+            return false;
+        }
+        std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        WorldCellManifest manifest;
+        if (!manifest.Parse(text, error)) {
+            error = entry.path().string() + ": " + error;
+            return false;
+        }
+        cells.push_back(std::move(manifest));
+    }
+    if (code) {
+        error = "can't list " + directory + ": " + code.message();
+        return false;
+    }
+    return true;
+}
+
+bool HlodBuilder::Build(const std::string& cookedDir, const std::string& outputDir, Report& report) {
+    auto start = std::chrono::steady_clock::now();
+    report = Report();
+    report.cells = cells.size();
+
+    auto parallelFor = [this](size_t count, const std::function<void(size_t)>& body) {
+        if (jobSystem && jobSystem->IsInitialized()) {
+            jobSystem->ParallelFor(count, 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) body(i);
+            });
+        } else {
+            for (size_t i = 0; i < count; ++i) body(i);
+        }
+    };
+
+    // Every static mesh object, and every mesh they use - each read once, however many cells share it
+    std::vector<std::string> meshPaths;
+    std::unordered_map<std::string, size_t> meshIndex;
+    std::vector<Node> level;
+    std::vector<std::vector<size_t>> objectMeshes(cells.size());
+    for (size_t cell = 0; cell < cells.size(); ++cell) {
+        const WorldCellManifest& manifest = cells[cell];
+        Node node;
+        node.cell = manifest.cell;
+        node.source = cell;
+        for (size_t object = 0; object < manifest.objects.size(); ++object) {
+            const WorldCellObject& placed = manifest.objects[object];
+            auto asset = std::find_if(manifest.assets.begin(), manifest.assets.end(),
+                                      [&](const AssetDependency& dependency) { return dependency.name == placed.asset; });
+            if (placed.dynamic || asset == manifest.assets.end() || asset->type != AssetType::Mesh) {
+                report.skipped++;
+                continue;
+            }
+            std::string path = (std::filesystem::path(cookedDir) / GetCookedMeshPath(*asset)).generic_string();
+            auto [it, inserted] = meshIndex.emplace(path, meshPaths.size());
+            if (inserted) meshPaths.push_back(path);
+            node.objects.push_back(object);
+            objectMeshes[cell].push_back(it->second);
+        }
+        if (!node.objects.empty()) level.push_back(std::move(node));
+    }
+
+    std::vector<AssetCooker::MeshData> meshes(meshPaths.size());
+    std::vector<std::string> meshErrors(meshPaths.size());
+    std::vector<uint8_t> meshLoaded(meshPaths.size(), 0);
+    parallelFor(meshPaths.size(), [&](size_t i) {
+        meshLoaded[i] = ReadCookedMesh(meshPaths[i], meshes[i], meshErrors[i]) ? 1 : 0;
+    });
+    for (size_t i = 0; i < meshPaths.size(); ++i) {
+        if (!meshLoaded[i]) report.errors.push_back(meshErrors[i]);
+    }
+
+    // Level 0 - each cell's objects placed and merged, then clustered on the finest grid
+    std::vector<size_t> nodeObjects(level.size());
+    std::vector<uint64_t> nodeTriangles(level.size());
+    parallelFor(level.size(), [&](size_t i) {
+        Node& node = level[i];
+        const WorldCellManifest& manifest = cells[node.source];
+        Vector3d origin = GetProxyOrigin(0, node.cell, settings.cellSize);
+        MergedMesh merged;
+        for (size_t object = 0; object < node.objects.size(); ++object) {
+            size_t mesh = objectMeshes[node.source][object];
+            if (!meshLoaded[mesh]) continue;
+            const WorldCellObject& placed = manifest.objects[node.objects[object]];
+            Append(merged, meshes[mesh], (placed.position - origin).ToVector3(), Rotation(placed.rotation), placed.scale);
+            nodeObjects[i]++;
+            nodeTriangles[i] += meshes[mesh].indices.size() / 3;
+        }
+        node.mesh = AssetCooker::SimplifyMesh(Finish(merged), settings.baseError, node.error);
+    });
+    for (size_t i = 0; i < level.size(); ++i) {
+        report.objects += nodeObjects[i];
+        report.skipped += level[i].objects.size() - nodeObjects[i];
+        report.trianglesIn += nodeTriangles[i];
+    }
+
+    // Clear out the last build first - a node that's gone empty mustn't leave its old proxy behind
+    std::error_code code;
+    std::filesystem::create_directories(outputDir, code);
+    for (const auto& entry : std::filesystem::directory_iterator(outputDir, code)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file() && name.rfind("hlod_", 0) == 0 && entry.path().extension() == ".rmesh") {
+            std::filesystem::remove(entry.path(), code);
+        }
+    }
+
+    uint32_t levelCount = std::max(settings.levels, 1u);
+    for (uint32_t levelIndex = 0; levelIndex < levelCount; ++levelIndex) {
+        // Write this level out
+        std::vector<std::string> errors(level.size());
+        std::vector<uint64_t> written(level.size());
+        parallelFor(level.size(), [&](size_t i) {
+            const Node& node = level[i];
+            if (node.mesh.indices.empty()) return;
+            std::vector<std::byte> cooked;
+            std::string path = (std::filesystem::path(outputDir) / GetProxyName(levelIndex, node.cell)).string();
+            if (!AssetCooker::CookMeshData(node.mesh, HashMesh(node.mesh), cooked, errors[i])) {
+                errors[i] = path + ": " + errors[i];
+                return;
+            }
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(cooked.data()), static_cast<std::streamsize>(cooked.size()));
+            if (!file) {
+                errors[i] = "can't write " + path;
+                return;
+            }
+            written[i] = cooked.size();
+        });
+        for (size_t i = 0; i < level.size(); ++i) {
+            if (!errors[i].empty()) {
+                report.errors.push_back(errors[i]);
+            } else if (written[i]) {
+                report.proxies++;
+                report.bytesWritten += written[i];
+                report.trianglesOut += level[i].mesh.indices.size() / 3;
+            }
+        }
+        if (levelIndex + 1 == levelCount) break;
+
+        // The level above - children merged in their parent's space, then clustered twice as coarse
+        std::vector<Node> parents;
+        std::unordered_map<WorldCell, size_t, WorldCellHash> parentIndex;
+        for (size_t i = 0; i < level.size(); ++i) {
+            if (level[i].mesh.indices.empty()) continue;
+            auto [it, inserted] = parentIndex.emplace(GetParent(level[i].cell), parents.size());
+            if (inserted) {
+                parents.emplace_back();
+                parents.back().cell = it->first;
+            }
+            parents[it->second].children.push_back(i);
+        }
+
+        float gridSize = settings.baseError * static_cast<float>(1u << (levelIndex + 1));
+        parallelFor(parents.size(), [&](size_t i) {
+            Node& parent = parents[i];
+            Vector3d origin = GetProxyOrigin(levelIndex + 1, parent.cell, settings.cellSize);
+            MergedMesh merged;
+            float childError = 0.0f;
+            for (size_t child : parent.children) {
+                const Node& node = level[child];
+                Append(merged, node.mesh, (GetProxyOrigin(levelIndex, node.cell, settings.cellSize) - origin).ToVector3(), Rotation(), Vector3(1.0f));
+                childError = std::max(childError, node.error);
+            }
+            parent.mesh = AssetCooker::SimplifyMesh(Finish(merged), gridSize, parent.error);
+            parent.error += childError;
+        });
+        level = std::move(parents);
+    }
+
+    report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report.errors.empty();
+}
+
+std::string HlodBuilder::GetProxyName(uint32_t level, const WorldCell& node) {
+    return "hlod_" + std::to_string(level) + "_" + std::to_string(node.x) + "_" + std::to_string(node.z) + ".rmesh";
+}
+
+Vector3d HlodBuilder::GetProxyOrigin(uint32_t level, const WorldCell& node, double cellSize) {
+    double size = GetNodeSize(level, cellSize);
+    return Vector3d(node.x * size, 0.0, node.z * size);
+}
+
+std::string HlodBuilder::GetCookedMeshPath(const AssetDependency& asset) {
+    std::filesystem::path path(asset.path.empty() ? asset.name : asset.path);
+    return path.replace_extension(".rmesh").generic_string();
+}
@@ -0,0 +1,78 @@
+// HlodBuilder.h - The model railway
+// Glues each cell's static objects into one rough mesh for looking at from far away
+
+#ifndef HLODBUILDER_H
+#define HLODBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Assets/AssetGraph.h"
+#include "World/WorldCell.h"
+#include "World/WorldCellManifest.h"
+
+class ThreadManager;
+
+// Tuning - has to agree with what the game streams with
+struct HlodBuildSettings {
+    float cellSize = 128.0f;  // WorldStreamingSettings::cellSize
+    uint32_t levels = 3;      // level 0 proxies cover one cell, each level up covers 2x2 of the one below
+    float baseError = 1.0f;   // world units - level 0 is clustered on a grid this fine, twice as coarse per level up
+};
+
+// The HlodBuilder class - offline, for the cook step. Every static object in every cell is merged into
+// a level 0 proxy for its cell, then proxies are merged four at a time into the level above, getting
+// coarser each time. Proxies are ordinary cooked meshes (with their own LOD chains), one submesh per
+// material, vertices relative to the node's corner - see GetProxyOrigin.
+class HlodBuilder {
+public:
+    HlodBuilder();
+    ~HlodBuilder();
+
+    // Job system - meshes are read and nodes merged in parallel when there are workers
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    void SetSettings(const HlodBuildSettings& newSettings) { settings = newSettings; }
+    const HlodBuildSettings& GetSettings() const { return settings; }
+
+    // The cells - manifests from code, or every cell_<x>_<z>.cell in a directory
+    void AddCell(const WorldCellManifest& manifest) { cells.push_back(manifest); }
+    bool AddCellDirectory(const std::string& directory, std::string& error);
+    size_t GetCellCount() const { return cells.size(); }
+
+    // Mesh assets are read as cooked .rmesh files under cookedDir - the manifest path if there is one,
+    // the asset name if not, with the extension swapped for .rmesh either way. Proxies go in outputDir
+    // as hlod_<level>_<x>_<z>.rmesh, and old ones there are deleted first; a node with nothing static
+    // in it gets no file at all.
+    struct Report {
+        size_t cells = 0;
+        size_t objects = 0;          // static objects merged
+        size_t skipped = 0;          // objects left out - dynamic, not meshes, or the mesh couldn't be read
+        size_t proxies = 0;
+        uint64_t trianglesIn = 0;    // in the placed objects
+        uint64_t trianglesOut = 0;   // in the proxies, every level
+        uint64_t bytesWritten = 0;
+        double seconds = 0.0;
+        std::vector<std::string> errors;
+    };
+    bool Build(const std::string& cookedDir, const std::string& outputDir, Report& report);
+
+    // Nodes - a level n node covers 2^n x 2^n cells and is numbered like a cell on a grid that much coarser
+    static std::string GetProxyName(uint32_t level, const WorldCell& node);
+    static WorldCell GetParent(const WorldCell& node) { return WorldCell{ node.x >> 1, node.z >> 1 }; }
+    static double GetNodeSize(uint32_t level, double cellSize) { return cellSize * static_cast<double>(1ull << level); }
+    static Vector3d GetProxyOrigin(uint32_t level, const WorldCell& node, double cellSize);
+    static std::string GetCookedMeshPath(const AssetDependency& asset);
+
+private:
+    // Prevent copying - nothing worth sharing
+    HlodBuilder(const HlodBuilder&) = delete;
+    HlodBuilder& operator=(const HlodBuilder&) = delete;
+
+    ThreadManager* jobSystem;
+    HlodBuildSettings settings;
+    std::vector<WorldCellManifest> cells;
+};
+
+#endif // HLODBUILDER_H
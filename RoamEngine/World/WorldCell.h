@@ -0,0 +1,53 @@
+// WorldCell.h - The map grid
+// The ground (x/z) cut into squares - what streaming, prefetching and HLOD all count in
+
+#ifndef WORLDCELL_H
+#define WORLDCELL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// A world cell - which square of cellSize a point falls in is up to whoever owns the grid
+struct WorldCell {
+    int32_t x = 0;
+    int32_t z = 0;
+
+    bool operator==(const WorldCell& other) const { return x == other.x && z == other.z; }
+    bool operator!=(const WorldCell& other) const { return !(*this == other); }
+
+    static WorldCell FromPosition(double x, double z, double cellSize) {
+        return WorldCell{ static_cast<int32_t>(std::floor(x / cellSize)), static_cast<int32_t>(std::floor(z / cellSize)) };
+    }
+};
+
+struct WorldCellHash {
+    size_t operator()(const WorldCell& cell) const {
+        return static_cast<size_t>((static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32 | static_cast<uint32_t>(cell.z)) * 0x9E3779B97F4A7C15ull);
+    }
+};
+
+// Closest distance from a point to a cell's square, on the ground - 0 inside it
+inline double GetDistanceToCell(double x, double z, const WorldCell& cell, double cellSize) {
+    double minX = cell.x * cellSize;
+    double minZ = cell.z * cellSize;
+    double dx = std::max({ minX - x, 0.0, x - (minX + cellSize) });
+    double dz = std::max({ minZ - z, 0.0, z - (minZ + cellSize) });
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+// Every cell touching the circle
+template<typename Visitor>
+void ForEachCellInRadius(double x, double z, double radius, double cellSize, Visitor&& visit) {
+    WorldCell min = WorldCell::FromPosition(x - radius, z - radius, cellSize);
+    WorldCell max = WorldCell::FromPosition(x + radius, z + radius, cellSize);
+    for (int32_t cellZ = min.z; cellZ <= max.z; ++cellZ) {
+        for (int32_t cellX = min.x; cellX <= max.x; ++cellX) {
+            WorldCell cell{ cellX, cellZ };
+            if (GetDistanceToCell(x, z, cell, cellSize) <= radius) visit(cell);
+        }
+    }
+}
+
+#endif // WORLDCELL_H
@@ -0,0 +1,137 @@
+// WorldCellManifest.cpp - Implementation of the packing list
+// Plain text, one line per thing - easy to diff, easy for the editor to write
+
+#include "WorldCellManifest.h"
+#include "Assets/AssetManager.h"
+#include "Math/VirtualFileSystem.h"
+#include <charconv>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    constexpr const char* AssetTypeNames[] = {
+        "Texture", "Mesh", "Audio", "Script", "Font", "Material", "Shader", "Animation", "Prefab", "Scene", "Custom"
+    };
+
+    bool ParseAssetType(std::string_view name, AssetType& type) {
+        for (size_t i = 0; i < std::size(AssetTypeNames); ++i) {
+            if (name == AssetTypeNames[i]) {
+                type = static_cast<AssetType>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template<typename T>
+    bool ParseNumber(std::string_view text, T& value) {
+        if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    std::vector<std::string_view> SplitTokens(std::string_view line) {
+        std::vector<std::string_view> tokens;
+        size_t position = 0;
+        while (position < line.size()) {
+            size_t start = line.find_first_not_of(" \t\r", position);
+            if (start == std::string_view::npos) break;
+            size_t end = line.find_first_of(" \t\r", start);
+            if (end == std::string_view::npos) end = line.size();
+            tokens.push_back(line.substr(start, end - start));
+            position = end;
+        }
+        return tokens;
+    }
+
+    // Shortest text that reads back as exactly the same double - positions are far too big for setprecision(9)
+    std::string FormatPosition(double value) {
+        char buffer[32];
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        return std::string(buffer, result.ptr);
+    }
+
+    template<typename Vector>
+    bool ParseVector(const std::vector<std::string_view>& tokens, size_t first, Vector& value) {
+        return ParseNumber(tokens[first], value.x) && ParseNumber(tokens[first + 1], value.y) && ParseNumber(tokens[first + 2], value.z);
+    }
+}
+
+bool WorldCellManifest::Parse(std::string_view text, std::string& error) {
+    assets.clear();
+    objects.clear();
+
+    size_t lineNumber = 0;
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t end = text.find('\n', position);
+        if (end == std::string_view::npos) end = text.size();
+        std::vector<std::string_view> tokens = SplitTokens(text.substr(position, end - position));
+        position = end + 1;
+        lineNumber++;
+        if (tokens.empty() || tokens[0][0] == '#') continue;
+
+        auto fail = [&](const char* message) {
+            error = "line " + std::to_string(lineNumber) + ": " + message;
+            return false;
+        };
+
+        if (tokens[0] == "cell") {
+            if (tokens.size() != 3 || !ParseNumber(tokens[1], cell.x) || !ParseNumber(tokens[2], cell.z)) return fail("expected 'cell x z'");
+        } else if (tokens[0] == "asset") {
+            AssetDependency asset;
+            if (tokens.size() < 3 || tokens.size() > 4) return fail("expected 'asset type name [path]'");
+            if (!ParseAssetType(tokens[1], asset.type)) return fail("unknown asset type");
+            asset.name = std::string(tokens[2]);
+            if (tokens.size() == 4) asset.path = std::string(tokens[3]);
+            assets.push_back(std::move(asset));
+        } else if (tokens[0] == "object" || tokens[0] == "dynamic") {
+            // name and position, then optionally rotation, then optionally scale
+            WorldCellObject object;
+            if (tokens.size() != 5 && tokens.size() != 8 && tokens.size() != 11) return fail("expected 'object asset x y z [rx ry rz [sx sy sz]]'");
+            object.asset = std::string(tokens[1]);
+            object.dynamic = tokens[0] == "dynamic";
+            if (!ParseVector(tokens, 2, object.position) ||
+                (tokens.size() >= 8 && !ParseVector(tokens, 5, object.rotation)) ||
+                (tokens.size() == 11 && !ParseVector(tokens, 8, object.scale))) return fail("bad number");
+            objects.push_back(std::move(object));
+        } else {
+            return fail("unknown command");
+        }
+    }
+    return true;
+}
+
+std::string WorldCellManifest::Serialize() const {
+    std::ostringstream out;
+    out << std::setprecision(9); // enough for a float to come back exactly - positions are doubles, see FormatPosition
+    out << "cell " << cell.x << " " << cell.z << "\n";
+    for (const AssetDependency& asset : assets) {
+        out << "asset " << AssetTypeNames[static_cast<size_t>(asset.type)] << " " << asset.name;
+        if (!asset.path.empty()) out << " " << asset.path;
+        out << "\n";
+    }
+    for (const WorldCellObject& object : objects) {
+        out << (object.dynamic ? "dynamic " : "object ") << object.asset << " " << FormatPosition(object.position.x) << " " << FormatPosition(object.position.y) << " " << FormatPosition(object.position.z)
+            << " " << object.rotation.x << " " << object.rotation.y << " " << object.rotation.z
+            << " " << object.scale.x << " " << object.scale.y << " " << object.scale.z << "\n";
+    }
+    return out.str();
+}
+
+bool WorldCellManifest::LoadFromFile(const std::string& path, std::string& error) {
+    FileView view;
+    if (!VirtualFileSystem::GetInstance().Open(path, view)) {
+        error = "can't open " + path;
+        return false;
+    }
+    return Parse(view.GetText(), error);
+}
+
+bool WorldCellManifest::SaveToFile(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file << Serialize();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,45 @@
+// WorldCellManifest.h - The packing list
+// What a world cell needs loaded, and where its objects go once it is
+
+#ifndef WORLDCELLMANIFEST_H
+#define WORLDCELLMANIFEST_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Assets/AssetGraph.h"
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+#include "World/WorldCell.h"
+
+// One placed thing - what the activation callback gets
+struct WorldCellObject {
+    std::string asset;             // one of the cell's assets, by name
+    Vector3d position;             // world space - doubles, so the far corners of a big map place as well as the middle
+    Vector3 rotation;              // euler angles, degrees
+    Vector3 scale = Vector3(1.0f);
+    bool dynamic = false;          // moves, or can be picked up - left out of HLOD proxies
+};
+
+// The WorldCellManifest struct - one per cell, usually a text file next to the cooked assets:
+//
+//   cell 3 -2
+//   asset Mesh rock Meshes/rock.rmesh
+//   object rock 400 12 -250 0 90 0 1 1 1
+//   dynamic crate 410 12 -248
+//
+// The asset path is optional, and so are rotation and scale. dynamic is object for things that
+// won't stay put. Names can't have spaces.
+struct WorldCellManifest {
+    WorldCell cell;
+    std::vector<AssetDependency> assets;
+    std::vector<WorldCellObject> objects;
+
+    bool Parse(std::string_view text, std::string& error);
+    std::string Serialize() const;
+
+    bool LoadFromFile(const std::string& path, std::string& error); // through the VFS
+    bool SaveToFile(const std::string& path) const;
+};
+
+#endif // WORLDCELLMANIFEST_H
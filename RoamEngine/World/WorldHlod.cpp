@@ -0,0 +1,150 @@
+// WorldHlod.cpp - Implementation of the painted backdrop
+// A quadtree cut, redone every frame - cheap, the tree is only as deep as the HLOD levels
+
+#include "WorldHlod.h"
+#include "World/FloatingOrigin.h"
+#include "World/HlodBuilder.h"
+#include "World/WorldStreamer.h"
+#include <algorithm>
+#include <filesystem>
+
+WorldHlod::WorldHlod(const WorldStreamer& world, AssetStreamer& streamer)
+    : world(world), streamer(streamer), floatingOrigin(nullptr) {
+}
+
+WorldHlod::~WorldHlod() {
+    Clear();
+}
+
+void WorldHlod::Update(const Vector3d& viewer) {
+    uint32_t levelCount = std::max(settings.levels, 1u);
+    if (nodes.size() != levelCount) {
+        Clear();
+        nodes.resize(levelCount);
+    }
+    visible.clear();
+    fullDetailList.clear();
+    fullDetail.clear();
+    stats.proxiesDrawn = 0;
+    stats.cellsFullDetail = 0;
+    stats.fallbacks = 0;
+
+    // Let go of proxies well out of the range they're used at - they come back with a fresh AddMesh
+    for (uint32_t level = 0; level < levelCount; ++level) {
+        double size = GetNodeSize(level);
+        double keep = GetKeepDistance(level);
+        for (auto it = nodes[level].begin(); it != nodes[level].end();) {
+            if (GetDistanceToCell(viewer.x, viewer.z, it->first, size) > keep) {
+                if (it->second.mesh != InvalidStreamingId) streamer.Remove(it->second.mesh);
+                it = nodes[level].erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Top-level nodes out to the horizon, each refined as far as distance and streaming allow
+    uint32_t top = levelCount - 1;
+    ForEachCellInRadius(viewer.x, viewer.z, settings.viewDistance, GetNodeSize(top), [&](const WorldCell& node) {
+        Select(top, node, viewer);
+    });
+
+    fullDetail.insert(fullDetailList.begin(), fullDetailList.end());
+    stats.proxiesDrawn = static_cast<uint32_t>(visible.size());
+    stats.cellsFullDetail = static_cast<uint32_t>(fullDetailList.size());
+    stats.proxiesLoaded = 0;
+    for (const auto& level : nodes) {
+        for (const auto& [cell, node] : level) stats.proxiesLoaded += node.mesh != InvalidStreamingId ? 1 : 0;
+    }
+}
+
+bool WorldHlod::Select(uint32_t level, const WorldCell& node, const Vector3d& viewer) {
+    double distance = GetDistanceToCell(viewer.x, viewer.z, node, GetNodeSize(level));
+    if (distance > settings.viewDistance) return true; // past the horizon - nothing to draw, nothing missing
+
+    if (level == 0) {
+        if (distance < settings.fullDetailDistance) {
+            if (world.IsCellActive(node)) {
+                fullDetailList.push_back(node);
+                return true;
+            }
+            stats.fallbacks++; // still streaming - the proxy stands in for now
+        }
+        return Draw(0, node);
+    }
+
+    // Far enough for this level to do
+    if (distance >= settings.levelDistance * static_cast<double>(1ull << (level - 1))) return Draw(level, node);
+
+    // Closer - the four children, unless one of them leaves a hole, in which case this node covers the lot.
+    // All four are visited either way so their proxies get asked for.
+    size_t visibleMark = visible.size();
+    size_t fullDetailMark = fullDetailList.size();
+    bool complete = true;
+    for (int child = 0; child < 4; ++child) {
+        WorldCell childNode{ node.x * 2 + (child & 1), node.z * 2 + (child >> 1) };
+        complete = Select(level - 1, childNode, viewer) && complete;
+    }
+    if (complete) return true;
+
+    Node& self = GetNode(level, node);
+    if (!self.empty && streamer.GetResidentLevel(self.mesh) >= streamer.GetLevelCount(self.mesh)) return false;
+    visible.resize(visibleMark);
+    fullDetailList.resize(fullDetailMark);
+    stats.fallbacks++;
+    return Draw(level, node);
+}
+
+bool WorldHlod::Draw(uint32_t level, const WorldCell& node) {
+    Node& proxy = GetNode(level, node);
+    if (proxy.empty) return true;
+    if (streamer.GetResidentLevel(proxy.mesh) >= streamer.GetLevelCount(proxy.mesh)) return false; // nothing in yet
+
+    double size = GetNodeSize(level);
+    HlodProxy drawn;
+    drawn.level = level;
+    drawn.node = node;
+    drawn.mesh = proxy.mesh;
+    drawn.origin = HlodBuilder::GetProxyOrigin(level, node, settings.cellSize);
+    visible.push_back(drawn);
+
+    Vector3d center = drawn.origin + Vector3d(size * 0.5, 0.0, size * 0.5);
+    Vector3 local = floatingOrigin ? floatingOrigin->ToLocal(center) : center.ToVector3();
+    streamer.Touch(proxy.mesh, local, static_cast<float>(size * 0.5 * 1.4142136));
+    return true;
+}
+
+WorldHlod::Node& WorldHlod::GetNode(uint32_t level, const WorldCell& node) {
+    auto [it, inserted] = nodes[level].try_emplace(node);
+    if (inserted) {
+        // No file is a node with nothing static in it, same as a cell with no manifest
+        std::string path = (std::filesystem::path(proxyDirectory) / HlodBuilder::GetProxyName(level, node)).generic_string();
+        it->second.mesh = streamer.AddMesh(path);
+        it->second.empty = it->second.mesh == InvalidStreamingId;
+    }
+    return it->second;
+}
+
+double WorldHlod::GetNodeSize(uint32_t level) const {
+    return HlodBuilder::GetNodeSize(level, settings.cellSize);
+}
+
+double WorldHlod::GetKeepDistance(uint32_t level) const {
+    // A node is visited while its parent is closer than the range, and it can sit a parent's diagonal
+    // further off than that - keep a bit beyond so nothing is dropped and asked for again every frame
+    if (level + 1 >= nodes.size()) return settings.viewDistance + GetNodeSize(level);
+    return settings.levelDistance * static_cast<double>(1ull << level) + GetNodeSize(level + 1) * 1.5;
+}
+
+void WorldHlod::Clear() {
+    for (auto& level : nodes) {
+        for (auto& [cell, node] : level) {
+            if (node.mesh != InvalidStreamingId) streamer.Remove(node.mesh);
+        }
+    }
+    nodes.clear();
+    visible.clear();
+    fullDetailList.clear();
+    fullDetail.clear();
+    stats = HlodStats();
+}
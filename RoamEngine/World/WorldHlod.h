@@ -0,0 +1,106 @@
+// WorldHlod.h - The painted backdrop
+// Far-off parts of the world drawn as a handful of merged proxies instead of every last rock
+
+#ifndef WORLDHLOD_H
+#define WORLDHLOD_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Assets/AssetStreamer.h"
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+#include "World/WorldCell.h"
+
+class FloatingOrigin;
+class WorldStreamer;
+
+// Tuning - cellSize and levels have to match what HlodBuilder was run with
+struct HlodSettings {
+    float cellSize = 128.0f;
+    uint32_t levels = 3;
+    float fullDetailDistance = 384.0f; // cells nearer than this show their own objects, once the streamer has them active
+    float levelDistance = 1024.0f;     // level 0 proxies out to here, level 1 out to twice this, and so on up
+    float viewDistance = 8192.0f;      // nothing past this - the top level covers the rest
+};
+
+struct HlodStats {
+    uint32_t proxiesDrawn = 0;    // this frame
+    uint32_t cellsFullDetail = 0; // this frame
+    uint32_t fallbacks = 0;       // this frame - coarser proxies standing in for finer ones (or cells) that weren't ready
+    uint32_t proxiesLoaded = 0;   // registered with the streamer right now
+};
+
+// One thing to draw - the mesh comes from AssetStreamer::GetMesh, its vertices are relative to origin.
+// origin is in world space; draw at FloatingOrigin::ToLocal(origin).
+struct HlodProxy {
+    uint32_t level = 0;
+    WorldCell node;
+    StreamingId mesh = InvalidStreamingId;
+    Vector3d origin;
+};
+
+// The WorldHlod class - each frame, picks the cheapest set of proxies and full-detail cells that covers
+// the ground out to viewDistance with no holes and no overlaps. Near cells show their real objects when
+// WorldStreamer has them active; further out, or while a cell is still loading, its proxy stands in,
+// and a proxy that hasn't streamed in yet is covered by its parent. However big the map, what's on
+// screen is bounded by viewDistance and the node sizes. Main thread only.
+class WorldHlod {
+public:
+    WorldHlod(const WorldStreamer& world, AssetStreamer& streamer);
+    ~WorldHlod(); // takes its proxies back out of the streamer
+
+    void SetSettings(const HlodSettings& newSettings) { settings = newSettings; }
+    const HlodSettings& GetSettings() const { return settings; }
+
+    // Where the builder put hlod_<level>_<x>_<z>.rmesh - through the VFS, so packs work
+    void SetProxyDirectory(const std::string& directory) { proxyDirectory = directory; }
+
+    // Proxies are touched at local positions, to match the camera the streamer is given - leave unset
+    // without a floating origin
+    void SetFloatingOrigin(const FloatingOrigin* origin) { floatingOrigin = origin; }
+
+    // Per frame, with the viewer in world space - after WorldStreamer::Update, before AssetStreamer::Update
+    // (the proxies it picks are touched)
+    void Update(const Vector3d& viewer);
+
+    // This frame's picks
+    const std::vector<HlodProxy>& GetVisibleProxies() const { return visible; }
+    bool IsCellFullDetail(const WorldCell& cell) const { return fullDetail.count(cell) != 0; } // draw its objects - otherwise a proxy has it covered
+
+    const HlodStats& GetStats() const { return stats; }
+
+    // Drop every proxy - for a new world, or a new proxy directory
+    void Clear();
+
+private:
+    // Prevent copying - the proxies are registered in our name
+    WorldHlod(const WorldHlod&) = delete;
+    WorldHlod& operator=(const WorldHlod&) = delete;
+
+    struct Node {
+        StreamingId mesh = InvalidStreamingId; // InvalidStreamingId and no file means nothing static there
+        bool empty = false;
+    };
+
+    bool Select(uint32_t level, const WorldCell& node, const Vector3d& viewer);
+    bool Draw(uint32_t level, const WorldCell& node);
+    Node& GetNode(uint32_t level, const WorldCell& node);
+    double GetNodeSize(uint32_t level) const;
+    double GetKeepDistance(uint32_t level) const;
+
+    const WorldStreamer& world;
+    AssetStreamer& streamer;
+    const FloatingOrigin* floatingOrigin;
+    HlodSettings settings;
+    HlodStats stats;
+    std::string proxyDirectory;
+    std::vector<std::unordered_map<WorldCell, Node, WorldCellHash>> nodes; // by level
+    std::vector<HlodProxy> visible;
+    std::vector<WorldCell> fullDetailList; // the same cells as fullDetail, in the order picked - for rolling back
+    std::unordered_set<WorldCell, WorldCellHash> fullDetail;
+};
+
+#endif // WORLDHLOD_H
@@ -0,0 +1,366 @@
+// WorldStreamer.cpp - Implementation of the conveyor belt
+// Reads and loads happen off the main thread; the only main-thread cost is the callbacks, and those are budgeted
+
+#include "WorldStreamer.h"
+#include "Math/VirtualFileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+
+namespace {
+    constexpr float VelocitySmoothing = 0.25f; // seconds - for velocities worked out from positions
+    constexpr size_t MaxPathSamples = 64;       // caps the look-ahead work at silly speeds
+
+    double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+WorldStreamer::WorldStreamer(AssetGraph& graph)
+    : graph(graph), jobSystem(nullptr), nextGeneration(1), readsInFlight(0) {
+}
+
+WorldStreamer::~WorldStreamer() {
+    if (jobSystem) jobSystem->Wait(outstanding);
+    Clear();
+}
+
+void WorldStreamer::SetManifest(const WorldCell& cell, WorldCellManifest manifest) {
+    manifest.cell = cell;
+    manifests[cell] = std::make_shared<const WorldCellManifest>(std::move(manifest));
+}
+
+std::string WorldStreamer::GetManifestName(const WorldCell& cell) {
+    return "cell_" + std::to_string(cell.x) + "_" + std::to_string(cell.z) + ".cell";
+}
+
+WorldCell WorldStreamer::GetCell(const Vector3d& position) const {
+    return WorldCell::FromPosition(position.x, position.z, settings.cellSize);
+}
+
+void WorldStreamer::SetObjectCallbacks(ObjectCallback onActivate, ObjectCallback onDeactivate) {
+    activateCallback = std::move(onActivate);
+    deactivateCallback = std::move(onDeactivate);
+}
+
+void WorldStreamer::SetCellCallbacks(CellCallback onActivated, CellCallback onDeactivated) {
+    activatedCallback = std::move(onActivated);
+    deactivatedCallback = std::move(onDeactivated);
+}
+
+void WorldStreamer::UpdateSource(uint32_t id, const Vector3d& position) {
+    Source& source = sources[id];
+    source.position = position;
+    source.explicitVelocity = false;
+    source.moved = true;
+}
+
+void WorldStreamer::UpdateSource(uint32_t id, const Vector3d& position, const Vector3& velocity) {
+    Source& source = sources[id];
+    source.position = position;
+    source.velocity = velocity;
+    source.explicitVelocity = true;
+    source.moved = true;
+}
+
+void WorldStreamer::RemoveSource(uint32_t id) {
+    sources.erase(id);
+}
+
+void WorldStreamer::Update(float deltaTime) {
+    UpdateSources(deltaTime);
+    PublishManifests();
+
+    // Around each source and along where it's going - inside loadRadius a cell is requested, inside
+    // unloadRadius one that's already here is kept
+    for (auto& [cell, state] : cells) {
+        state.wanted = false;
+        state.requested = false;
+    }
+    for (const auto& [id, source] : sources) {
+        std::vector<Vector3d> points{ source.position };
+        Vector3d travel(source.velocity.x * settings.lookAheadTime, 0.0, source.velocity.z * settings.lookAheadTime);
+        double distance = travel.Length();
+        if (distance > settings.cellSize * 0.25f) {
+            size_t samples = std::min(MaxPathSamples, static_cast<size_t>(std::ceil(distance / (settings.cellSize * 0.5f))));
+            for (size_t i = 1; i <= samples; ++i) points.push_back(source.position + travel * (static_cast<double>(i) / samples));
+        }
+
+        for (const Vector3d& point : points) {
+            ForEachCellInRadius(point.x, point.z, settings.unloadRadius, settings.cellSize, [&](const WorldCell& cell) {
+                auto it = cells.find(cell);
+                if (it != cells.end()) it->second.wanted = true;
+            });
+            ForEachCellInRadius(point.x, point.z, settings.loadRadius, settings.cellSize, [&](const WorldCell& cell) {
+                // Nearer the source itself is more urgent - cells ahead get the far end of the range
+                double away = GetDistanceToCell(source.position.x, source.position.z, cell, settings.cellSize);
+                float along = static_cast<float>(std::min(1.0, away / std::max(settings.loadRadius, 1.0f)));
+                Request(cell, settings.nearPriority + static_cast<int>(std::lround((settings.farPriority - settings.nearPriority) * along)));
+            });
+        }
+    }
+
+    // Out of range of everyone - drop loads, and take back what was handed out
+    for (auto it = cells.begin(); it != cells.end();) {
+        Cell& state = it->second;
+        if (!state.wanted) {
+            switch (state.state) {
+            case WorldCellState::Activating:
+            case WorldCellState::Active:
+                state.state = WorldCellState::Deactivating;
+                break;
+            case WorldCellState::Deactivating:
+                break;
+            default:
+                Release(state); // a manifest still being read is dropped when it turns up
+                it = cells.erase(it);
+                continue;
+            }
+        } else if (state.state == WorldCellState::LoadingAssets && graph.IsGroupReady(state.group)) {
+            state.assetsDone = true;
+            state.state = WorldCellState::Activating;
+        }
+        ++it;
+    }
+
+    // Manifest reads - nearest first, a few at a time
+    std::vector<std::pair<int, WorldCell>> waiting;
+    for (const auto& [cell, state] : cells) {
+        if (state.state == WorldCellState::Unloaded) waiting.emplace_back(state.priority, cell);
+    }
+    std::sort(waiting.begin(), waiting.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (const auto& [priority, cell] : waiting) {
+        if (readsInFlight >= settings.maxManifestReads) break;
+        ReadManifest(cell, cells[cell]);
+    }
+
+    Activate();
+}
+
+WorldCellState WorldStreamer::GetCellState(const WorldCell& cell) const {
+    auto it = cells.find(cell);
+    return it != cells.end() ? it->second.state : WorldCellState::Unloaded;
+}
+
+size_t WorldStreamer::GetActiveCellCount() const {
+    return static_cast<size_t>(std::count_if(cells.begin(), cells.end(),
+                                             [](const auto& entry) { return entry.second.state == WorldCellState::Active; }));
+}
+
+void WorldStreamer::Clear() {
+    for (auto& [cell, state] : cells) {
+        if (state.manifest) {
+            while (state.activated > 0) {
+                state.activated--;
+                stats.objectsDeactivated++;
+                if (deactivateCallback) deactivateCallback(cell, state.manifest->objects[state.activated]);
+            }
+        }
+        if (state.reported) {
+            stats.cellsDeactivated++;
+            if (deactivatedCallback) deactivatedCallback(cell);
+        }
+        Release(state);
+    }
+    cells.clear();
+}
+
+void WorldStreamer::UpdateSources(float deltaTime) {
+    for (auto& [id, source] : sources) {
+        if (source.moved && !source.explicitVelocity && source.hasPosition && deltaTime > 0.0f) {
+            Vector3 measured = (source.position - source.lastPosition).ToVector3() / deltaTime;
+            source.velocity += (measured - source.velocity) * (deltaTime / (VelocitySmoothing + deltaTime));
+        }
+        source.lastPosition = source.position;
+        source.hasPosition = true;
+        source.moved = false;
+    }
+}
+
+void WorldStreamer::Request(const WorldCell& cell, int priority) {
+    auto [it, inserted] = cells.try_emplace(cell);
+    Cell& state = it->second;
+    if (inserted) {
+        state.generation = nextGeneration++;
+        state.priority = priority;
+    } else if (state.requested && priority <= state.priority) {
+        return; // another source (or point on the path) already asked for more
+    }
+    state.wanted = true;
+    state.requested = true;
+
+    if (state.state == WorldCellState::Deactivating) {
+        state.state = WorldCellState::Activating; // came back before it was gone - pick up where it is
+    }
+    if (state.priority != priority) {
+        state.priority = priority;
+        if (state.state == WorldCellState::LoadingAssets) graph.SetGroupPriority(state.group, priority);
+    }
+}
+
+void WorldStreamer::ReadManifest(const WorldCell& cell, Cell& state) {
+    auto known = manifests.find(cell);
+    if (known != manifests.end() || manifestDirectory.empty()) {
+        std::shared_ptr<const WorldCellManifest> manifest = known != manifests.end() ? known->second : nullptr;
+        if (!manifest) {
+            auto empty = std::make_shared<WorldCellManifest>();
+            empty->cell = cell;
+            manifest = std::move(empty);
+        }
+        StartLoading(cell, state, std::move(manifest));
+        return;
+    }
+
+    state.state = WorldCellState::ReadingManifest;
+    readsInFlight++;
+    auto read = [this, cell, generation = state.generation, path = (std::filesystem::path(manifestDirectory) / GetManifestName(cell)).generic_string()]() {
+        auto manifest = std::make_shared<WorldCellManifest>();
+        manifest->cell = cell;
+        ReadResult result{ cell, generation, nullptr, std::string() };
+
+        // No file is just an empty cell; a file that doesn't parse is an error
+        FileView view;
+        if (!VirtualFileSystem::GetInstance().Open(path, view) || manifest->Parse(view.GetText(), result.error)) {
+            result.manifest = std::move(manifest);
+        } else {
+            result.error = path + ": " + result.error;
+        }
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        readResults.push_back(std::move(result));
+    };
+
+    if (jobSystem && jobSystem->IsInitialized()) {
+        jobSystem->Submit(std::move(read), JobPriority::Low, &outstanding);
+    } else {
+        read();
+    }
+}
+
+void WorldStreamer::PublishManifests() {
+    std::vector<ReadResult> results;
+    std::vector<GroupFailure> failures;
+    {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        results.swap(readResults);
+        failures.swap(failedGroups);
+    }
+
+    for (ReadResult& result : results) {
+        readsInFlight--;
+        auto it = cells.find(result.cell);
+        if (it == cells.end() || it->second.generation != result.generation) continue; // unloaded meanwhile
+
+        // A broken manifest still gives an (empty) cell, so the world carries on around it
+        if (!result.manifest) {
+            ReportError(result.cell, result.error);
+            auto empty = std::make_shared<WorldCellManifest>();
+            empty->cell = result.cell;
+            result.manifest = std::move(empty);
+        }
+        StartLoading(result.cell, it->second, std::move(result.manifest));
+    }
+
+    // Some assets didn't load - activate anyway, the objects that need them can tell
+    for (const GroupFailure& failure : failures) {
+        auto it = cells.find(failure.cell);
+        if (it == cells.end() || it->second.generation != failure.generation || it->second.assetsDone) continue;
+        ReportError(failure.cell, failure.error);
+        it->second.assetsDone = true;
+        if (it->second.state == WorldCellState::LoadingAssets) it->second.state = WorldCellState::Activating;
+    }
+}
+
+void WorldStreamer::StartLoading(const WorldCell& cell, Cell& state, std::shared_ptr<const WorldCellManifest> manifest) {
+    state.manifest = std::move(manifest);
+    if (state.manifest->assets.empty()) {
+        state.assetsDone = true;
+        state.state = WorldCellState::Activating;
+        return;
+    }
+
+    state.state = WorldCellState::LoadingAssets;
+    uint64_t generation = state.generation;
+    state.group = graph.LoadGroup(state.manifest->assets, state.priority, nullptr,
+        [this, cell, generation](AssetGroupId, const std::string& error) {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            failedGroups.push_back({ cell, generation, error });
+        });
+}
+
+void WorldStreamer::Activate() {
+    // Taking back first (that's memory coming back), then the nearest cells
+    std::vector<std::pair<WorldCell, Cell*>> work;
+    for (auto& [cell, state] : cells) {
+        if (state.state == WorldCellState::Deactivating || (state.state == WorldCellState::Activating && state.assetsDone)) {
+            work.emplace_back(cell, &state);
+        }
+    }
+    if (work.empty()) return;
+    std::sort(work.begin(), work.end(), [](const auto& a, const auto& b) {
+        bool aLeaving = a.second->state == WorldCellState::Deactivating;
+        bool bLeaving = b.second->state == WorldCellState::Deactivating;
+        if (aLeaving != bLeaving) return aLeaving;
+        return a.second->priority > b.second->priority;
+    });
+
+    // At least one object per frame, however small the budget
+    auto start = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (next < work.size()) {
+        if (!Step(work[next].first, *work[next].second)) next++;
+        if (MillisecondsSince(start) >= settings.activationBudget) break;
+    }
+    stats.worstActivationTime = std::max(stats.worstActivationTime, MillisecondsSince(start));
+
+    // Fully taken back - now the assets can go
+    for (auto& [cell, state] : work) {
+        if (state->state == WorldCellState::Deactivating && state->activated == 0) {
+            Release(*state);
+            cells.erase(cell);
+        }
+    }
+}
+
+bool WorldStreamer::Step(const WorldCell& cell, Cell& state) {
+    const std::vector<WorldCellObject>& objects = state.manifest->objects;
+    if (state.state == WorldCellState::Activating) {
+        if (state.activated < objects.size()) {
+            stats.objectsActivated++;
+            if (activateCallback) activateCallback(cell, objects[state.activated]);
+            state.activated++;
+            return true;
+        }
+        state.state = WorldCellState::Active;
+        if (!state.reported) {
+            state.reported = true;
+            stats.cellsActivated++;
+            if (activatedCallback) activatedCallback(cell);
+        }
+        return false;
+    }
+
+    if (state.activated > 0) {
+        state.activated--;
+        stats.objectsDeactivated++;
+        if (deactivateCallback) deactivateCallback(cell, objects[state.activated]);
+        return true;
+    }
+    if (state.reported) {
+        state.reported = false;
+        stats.cellsDeactivated++;
+        if (deactivatedCallback) deactivatedCallback(cell);
+    }
+    return false;
+}
+
+void WorldStreamer::Release(Cell& state) {
+    if (state.group != InvalidAssetGroupId) graph.ReleaseGroup(state.group);
+    state.group = InvalidAssetGroupId;
+}
+
+void WorldStreamer::ReportError(const WorldCell& cell, const std::string& error) {
+    stats.failures++;
+    if (errorCallback) errorCallback(cell, error);
+}
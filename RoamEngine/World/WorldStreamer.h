@@ -0,0 +1,173 @@
+// WorldStreamer.h - The conveyor belt
+// Lays the world down in front of the player and rolls it back up behind them
+
+#ifndef WORLDSTREAMER_H
+#define WORLDSTREAMER_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Assets/AssetGraph.h"
+#include "Core/ThreadManager.h"
+#include "Math/Vector3.h"
+#include "Math/Vector3d.h"
+#include "World/WorldCell.h"
+#include "World/WorldCellManifest.h"
+
+// Tuning - the radii decide memory, the budget decides how smooth it feels
+struct WorldStreamingSettings {
+    float cellSize = 128.0f;
+    float loadRadius = 384.0f;       // cells this close to a source start loading
+    float unloadRadius = 512.0f;     // and stay until every source is further than this - the gap stops thrashing
+    float lookAheadTime = 2.0f;      // seconds - cells around where each source is headed load too
+    double activationBudget = 1.0;   // milliseconds per frame for activating and deactivating objects
+    int nearPriority = 20;           // load priority of a cell under a source...
+    int farPriority = 0;             // ...falling to this at the load radius
+    uint32_t maxManifestReads = 4;   // manifest reads in flight
+};
+
+struct WorldStreamingStats {
+    uint64_t cellsActivated = 0;
+    uint64_t cellsDeactivated = 0;
+    uint64_t objectsActivated = 0;
+    uint64_t objectsDeactivated = 0;
+    uint64_t failures = 0;            // bad manifests and asset loads that failed
+    double worstActivationTime = 0.0; // milliseconds - the most one frame spent in the callbacks
+};
+
+// Where a cell is at
+enum class WorldCellState {
+    Unloaded,
+    ReadingManifest,
+    LoadingAssets,
+    Activating,   // its objects are being handed out, a few per frame
+    Active,
+    Deactivating  // and taken back, before its assets are released
+};
+
+// The WorldStreamer class - the world as a grid of cells, each loaded through the asset graph when a
+// source (player, camera, the car) comes within loadRadius and let go once every source is beyond
+// unloadRadius. Objects come and go through callbacks, a time budget's worth per frame. Main thread
+// only; call Update once per frame, after AssetManager::UpdateAsyncLoading.
+class WorldStreamer {
+public:
+    explicit WorldStreamer(AssetGraph& graph);
+    ~WorldStreamer(); // same as Clear
+
+    // Job system - manifests are read and parsed on workers when there are any
+    void SetJobSystem(ThreadManager* jobs) { jobSystem = jobs; }
+
+    void SetSettings(const WorldStreamingSettings& newSettings) { settings = newSettings; }
+    const WorldStreamingSettings& GetSettings() const { return settings; }
+
+    // Manifests - set in code, or read from <directory>/cell_<x>_<z>.cell through the VFS.
+    // A cell with neither is empty (open sea, say) rather than an error.
+    void SetManifest(const WorldCell& cell, WorldCellManifest manifest);
+    void SetManifestDirectory(const std::string& directory) { manifestDirectory = directory; }
+    static std::string GetManifestName(const WorldCell& cell);
+    WorldCell GetCell(const Vector3d& position) const;
+
+    // Callbacks - all run inside Update. Objects are deactivated in the reverse order they came in.
+    using ObjectCallback = std::function<void(const WorldCell& cell, const WorldCellObject& object)>;
+    using CellCallback = std::function<void(const WorldCell& cell)>;
+    using ErrorCallback = std::function<void(const WorldCell& cell, const std::string& error)>;
+    void SetObjectCallbacks(ObjectCallback onActivate, ObjectCallback onDeactivate);
+    void SetCellCallbacks(CellCallback onActivated, CellCallback onDeactivated);
+    void SetErrorCallback(ErrorCallback onError) { errorCallback = std::move(onError); }
+
+    // Streaming sources, in world space (FloatingOrigin::ToWorld for anything local) - give a velocity if
+    // you know it, otherwise it's worked out from the positions
+    void UpdateSource(uint32_t id, const Vector3d& position);
+    void UpdateSource(uint32_t id, const Vector3d& position, const Vector3& velocity);
+    void RemoveSource(uint32_t id);
+
+    // Per frame - picks the cells, starts and stops loads, then activates within the budget
+    void Update(float deltaTime);
+
+    // Queries
+    WorldCellState GetCellState(const WorldCell& cell) const;
+    bool IsCellActive(const WorldCell& cell) const { return GetCellState(cell) == WorldCellState::Active; }
+    size_t GetCellCount() const { return cells.size(); }
+    size_t GetActiveCellCount() const;
+    const WorldStreamingStats& GetStats() const { return stats; }
+
+    // Deactivate everything right now (budget or not), release every load and forget the cells
+    void Clear();
+
+private:
+    // Prevent copying - jobs and groups point back at us
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    struct Source {
+        Vector3d position;
+        Vector3 velocity;
+        Vector3d lastPosition;
+        bool explicitVelocity = false;
+        bool hasPosition = false;
+        bool moved = false;
+    };
+
+    struct Cell {
+        WorldCellState state = WorldCellState::Unloaded; // Unloaded here means waiting for a manifest read slot
+        uint64_t generation = 0;       // tells a late manifest or error apart from one for the cell's next life
+        std::shared_ptr<const WorldCellManifest> manifest;
+        AssetGroupId group = InvalidAssetGroupId;
+        int priority = 0;
+        size_t activated = 0;          // objects handed out so far
+        bool wanted = true;            // within a source's unload radius (or requested) this frame
+        bool requested = false;        // within a source's load radius this frame
+        bool assetsDone = false;       // the group is ready, or failed and was reported
+        bool reported = false;         // onActivated ran, so onDeactivated is owed
+    };
+
+    struct ReadResult {
+        WorldCell cell;
+        uint64_t generation;
+        std::shared_ptr<const WorldCellManifest> manifest; // nullptr if it didn't parse
+        std::string error;
+    };
+
+    struct GroupFailure {
+        WorldCell cell;
+        uint64_t generation;
+        std::string error;
+    };
+
+    void UpdateSources(float deltaTime);
+    void Request(const WorldCell& cell, int priority);
+    void ReadManifest(const WorldCell& cell, Cell& state);
+    void PublishManifests();
+    void StartLoading(const WorldCell& cell, Cell& state, std::shared_ptr<const WorldCellManifest> manifest);
+    void Activate();
+    bool Step(const WorldCell& cell, Cell& state); // one object - false once the cell has nothing left to do
+    void Release(Cell& state);
+    void ReportError(const WorldCell& cell, const std::string& error);
+
+    AssetGraph& graph;
+    ThreadManager* jobSystem;
+    WorldStreamingSettings settings;
+    WorldStreamingStats stats;
+    std::string manifestDirectory;
+    std::unordered_map<WorldCell, std::shared_ptr<const WorldCellManifest>, WorldCellHash> manifests;
+    std::unordered_map<uint32_t, Source> sources;
+    std::unordered_map<WorldCell, Cell, WorldCellHash> cells;
+    ObjectCallback activateCallback;
+    ObjectCallback deactivateCallback;
+    CellCallback activatedCallback;
+    CellCallback deactivatedCallback;
+    ErrorCallback errorCallback;
+    uint64_t nextGeneration;
+    uint32_t readsInFlight;
+
+    std::mutex resultMutex;
+    std::vector<ReadResult> readResults;  // from workers, picked up in Update
+    std::vector<GroupFailure> failedGroups; // from the graph's error callback
+    JobCounter outstanding;
+};
+
+#endif // WORLDSTREAMER_H